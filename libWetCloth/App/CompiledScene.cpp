@@ -0,0 +1,203 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "CompiledScene.h"
+
+#include <algorithm>
+#include <fstream>
+
+namespace {
+const char compiled_magic[4] = {'W', 'C', 'S', 'C'};
+const int compiled_version = 1;
+
+template <typename T>
+void write_value(std::ostream& os, const T& value) {
+  os.write((const char*)&value, sizeof(T));
+}
+
+template <typename T>
+bool read_value(std::istream& is, T& value) {
+  is.read((char*)&value, sizeof(T));
+  return is.good();
+}
+
+template <typename T>
+void write_array(std::ostream& os, const std::vector<T>& a) {
+  write_value(os, (int64_t)a.size());
+  if (!a.empty()) os.write((const char*)&a[0], a.size() * sizeof(T));
+}
+
+template <typename T>
+bool read_array(std::istream& is, std::vector<T>& a) {
+  int64_t n = 0;
+  if (!read_value(is, n) || n < 0) return false;
+  a.resize(n);
+  if (n > 0) is.read((char*)&a[0], n * sizeof(T));
+  return is.good();
+}
+
+template <typename Derived>
+void write_matrix(std::ostream& os, const Eigen::PlainObjectBase<Derived>& m) {
+  write_value(os, (int64_t)m.rows());
+  write_value(os, (int64_t)m.cols());
+  if (m.size() > 0)
+    os.write((const char*)m.data(),
+             m.size() * sizeof(typename Derived::Scalar));
+}
+
+template <typename Derived>
+bool read_matrix(std::istream& is, Eigen::PlainObjectBase<Derived>& m) {
+  int64_t rows = 0, cols = 0;
+  if (!read_value(is, rows) || !read_value(is, cols) || rows < 0 || cols < 0)
+    return false;
+  m.resize(rows, cols);
+  if (m.size() > 0)
+    is.read((char*)m.data(), m.size() * sizeof(typename Derived::Scalar));
+  return is.good();
+}
+
+void write_faces(std::ostream& os,
+                 const std::vector<std::vector<Vector3i> >& faces) {
+  write_value(os, (int64_t)faces.size());
+  for (const std::vector<Vector3i>& f : faces) write_array(os, f);
+}
+
+bool read_faces(std::istream& is, std::vector<std::vector<Vector3i> >& faces) {
+  int64_t n = 0;
+  if (!read_value(is, n) || n < 0) return false;
+  faces.resize(n);
+  for (std::vector<Vector3i>& f : faces)
+    if (!read_array(is, f)) return false;
+  return true;
+}
+
+void write_particle(std::ostream& os, const ParticleRecord& p) {
+  os.write((const char*)p.x.data(), 3 * sizeof(scalar));
+  os.write((const char*)p.v.data(), 3 * sizeof(scalar));
+  write_value(os, p.theta);
+  write_value(os, p.omega);
+  write_value(os, p.radius);
+  write_value(os, p.biradius);
+  write_value(os, p.vol);
+  write_value(os, p.fvol);
+  write_value(os, p.m);
+  write_value(os, p.fm);
+  write_value(os, p.vf);
+  write_value(os, p.group);
+  write_value(os, p.fixed);
+  write_value(os, p.liquid);
+}
+
+void read_particle(std::istream& is, ParticleRecord& p) {
+  is.read((char*)p.x.data(), 3 * sizeof(scalar));
+  is.read((char*)p.v.data(), 3 * sizeof(scalar));
+  read_value(is, p.theta);
+  read_value(is, p.omega);
+  read_value(is, p.radius);
+  read_value(is, p.biradius);
+  read_value(is, p.vol);
+  read_value(is, p.fvol);
+  read_value(is, p.m);
+  read_value(is, p.fm);
+  read_value(is, p.vf);
+  read_value(is, p.group);
+  read_value(is, p.fixed);
+  read_value(is, p.liquid);
+}
+}  // namespace
+
+void CompiledScene::clear() {
+  checksum = 0;
+  particles.clear();
+  cloth_faces.clear();
+  particle_remap.clear();
+  proxy_faces.clear();
+  meshes.clear();
+}
+
+namespace scenecompiler {
+uint64_t checksum(const std::vector<char>& data) {
+  uint64_t h = 14695981039346656037ULL;
+  for (char c : data) {
+    h ^= (uint64_t)(unsigned char)c;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool write(const std::string& filename, const CompiledScene& compiled) {
+  std::ofstream ofs(filename.c_str(), std::ios::binary);
+  if (!ofs.good()) return false;
+
+  ofs.write(compiled_magic, sizeof(compiled_magic));
+  write_value(ofs, compiled_version);
+  write_value(ofs, (int)sizeof(scalar));
+  write_value(ofs, compiled.checksum);
+
+  write_value(ofs, (int64_t)compiled.particles.size());
+  for (const ParticleRecord& p : compiled.particles) write_particle(ofs, p);
+
+  write_faces(ofs, compiled.cloth_faces);
+  write_array(ofs, compiled.particle_remap);
+  write_faces(ofs, compiled.proxy_faces);
+
+  write_value(ofs, (int64_t)compiled.meshes.size());
+  for (const EmbeddedClothMesh& mesh : compiled.meshes) {
+    write_matrix(ofs, mesh.proxy_particles);
+    write_matrix(ofs, mesh.proxy_faces);
+    write_matrix(ofs, mesh.faces);
+    write_matrix(ofs, mesh.parents);
+    write_matrix(ofs, mesh.weights);
+    write_matrix(ofs, mesh.offsets);
+  }
+
+  return ofs.good();
+}
+
+bool read(const std::string& filename, CompiledScene& compiled) {
+  compiled.clear();
+
+  std::ifstream ifs(filename.c_str(), std::ios::binary);
+  if (!ifs.good()) return false;
+
+  char magic[4];
+  int version = 0;
+  int scalar_size = 0;
+  ifs.read(magic, sizeof(magic));
+  if (!ifs.good() || !std::equal(magic, magic + 4, compiled_magic) ||
+      !read_value(ifs, version) || version != compiled_version ||
+      !read_value(ifs, scalar_size) || scalar_size != (int)sizeof(scalar) ||
+      !read_value(ifs, compiled.checksum))
+    return false;
+
+  int64_t num_particles = 0;
+  if (!read_value(ifs, num_particles) || num_particles < 0) return false;
+  compiled.particles.resize(num_particles);
+  for (ParticleRecord& p : compiled.particles) read_particle(ifs, p);
+
+  bool good = ifs.good() && read_faces(ifs, compiled.cloth_faces) &&
+              read_array(ifs, compiled.particle_remap) &&
+              read_faces(ifs, compiled.proxy_faces);
+
+  int64_t num_meshes = 0;
+  good = good && read_value(ifs, num_meshes) && num_meshes >= 0;
+  if (good) compiled.meshes.resize(num_meshes);
+  for (int64_t i = 0; good && i < num_meshes; ++i) {
+    EmbeddedClothMesh& mesh = compiled.meshes[i];
+    good = read_matrix(ifs, mesh.proxy_particles) &&
+           read_matrix(ifs, mesh.proxy_faces) && read_matrix(ifs, mesh.faces) &&
+           read_matrix(ifs, mesh.parents) && read_matrix(ifs, mesh.weights) &&
+           read_matrix(ifs, mesh.offsets);
+  }
+
+  if (!good) compiled.clear();
+  return good;
+}
+}  // namespace scenecompiler
@@ -0,0 +1,80 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef COMPILED_SCENE_H
+#define COMPILED_SCENE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "ClothEmbedding.h"
+#include "MathDefs.h"
+
+/*!
+ * Attributes of one <particle> node as written in the scene file.
+ */
+struct ParticleRecord {
+  Vector3s x;
+  Vector3s v;
+  scalar theta;
+  scalar omega;
+  scalar radius;
+  scalar biradius;
+  scalar vol;
+  scalar fvol;
+  scalar m;
+  scalar fm;
+  scalar vf;
+  int group;
+  unsigned char fixed;
+  unsigned char liquid;
+};
+
+/*!
+ * The part of an xml scene that is slow to parse and to derive: the
+ * particles, the faces of every cloth and the proxy meshes decimated from
+ * them. WetClothApp -c writes it once the scene has been validated, and the
+ * parser takes it instead of the <particle> and <face> nodes as long as its
+ * checksum still matches the xml file.
+ */
+struct CompiledScene {
+  uint64_t checksum = 0;
+
+  std::vector<ParticleRecord> particles;
+
+  // faces of every <cloth> node, in file particle indices
+  std::vector<std::vector<Vector3i> > cloth_faces;
+
+  // scene index of every particle in the file once the cloth proxies have
+  // replaced their clothes, -1 if dropped; empty if nothing was decimated
+  std::vector<int> particle_remap;
+  std::vector<std::vector<Vector3i> > proxy_faces;
+  std::vector<EmbeddedClothMesh> meshes;
+
+  void clear();
+};
+
+namespace scenecompiler {
+/*!
+ * FNV-1a hash of the scene file contents.
+ */
+uint64_t checksum(const std::vector<char>& data);
+
+bool write(const std::string& filename, const CompiledScene& compiled);
+
+/*!
+ * Returns false if the file cannot be read or was written by another
+ * version of the format.
+ */
+bool read(const std::string& filename, CompiledScene& compiled);
+}  // namespace scenecompiler
+
+#endif
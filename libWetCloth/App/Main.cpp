@@ -72,7 +72,12 @@ std::string g_scene_tag = "";
 ///////////////////////////////////////////////////////////////////////////////
 // Scene input/output/comparison state
 int g_save_to_binary = 0;
+int g_save_grid = 0;
 std::string g_binary_file_name;
+std::string g_telemetry_file_name;
+std::string g_preroll_file_name;
+std::string g_compile_file_name;
+std::string g_compiled_file_name;
 std::ofstream g_binary_output;
 std::string g_short_file_name;
 
@@ -410,7 +415,7 @@ void loadScene(const std::string& file_name) {
   xml_scene_parser.loadExecutableSimulation(
       file_name, g_rendering_enabled, g_executable_simulation, cam, g_dt,
       max_time, steps_per_sec_cap, g_bgcolor, g_description, g_scene_tag,
-      cam_init, g_binary_file_name);
+      cam_init, g_binary_file_name, g_compiled_file_name);
   assert(g_executable_simulation != NULL);
 
   // If the user did not request a custom viewport, try to compute a reasonable
@@ -464,11 +469,39 @@ void parseCommandLine(int argc, char** argv) {
     TCLAP::ValueArg<int> output("o", "outputfile",
                                 "Binary file to save simulation state to",
                                 false, 0, "integer", cmd);
+    // Frame stride of the grid field volumes
+    TCLAP::ValueArg<int> grid("e", "exportgrid",
+                              "Write the grid fields every n steps if n > 0",
+                              false, 0, "integer", cmd);
     // File to load for comparisons
     TCLAP::ValueArg<std::string> input(
         "i", "inputfile", "Binary file to load simulation pos from", false, "",
         "string", cmd);
 
+    // JSON-lines file to append per sub-step and per frame statistics to
+    TCLAP::ValueArg<std::string> telemetry(
+        "t", "telemetry", "JSON-lines file to write simulation telemetry to",
+        false, "", "string", cmd);
+
+    // Settle the elastic objects to rest, save the state and exit
+    TCLAP::ValueArg<std::string> preroll(
+        "r", "preroll",
+        "Solve for the rest pose and save it to a binary file for -i", false,
+        "", "string", cmd);
+
+    // Validate the scene, write its compiled form and exit
+    TCLAP::ValueArg<std::string> compile(
+        "c", "compile",
+        "Validate the scene and write a compiled scene file for -m", false, "",
+        "string", cmd);
+
+    // Take particles and clothes from a compiled scene instead of the xml
+    TCLAP::ValueArg<std::string> compiled(
+        "m", "compiled",
+        "Compiled scene file to load in place of the particles and clothes "
+        "of the xml scene",
+        false, "", "string", cmd);
+
     cmd.parse(argc, argv);
 
     assert(scene.isSet());
@@ -477,7 +510,12 @@ void parseCommandLine(int argc, char** argv) {
     g_rendering_enabled = display.getValue();
     g_dump_png = dumppng.getValue();
     g_save_to_binary = output.getValue();
+    g_save_grid = grid.getValue();
     g_binary_file_name = input.getValue();
+    g_telemetry_file_name = telemetry.getValue();
+    g_preroll_file_name = preroll.getValue();
+    g_compile_file_name = compile.getValue();
+    g_compiled_file_name = compiled.getValue();
   } catch (TCLAP::ArgException& e) {
     std::cerr << "error: " << e.what() << std::endl;
     exit(1);
@@ -546,6 +584,15 @@ void miscOutputCallback() {
                                             oss_exbd.str(), oss_spring.str());
   }
 
+  if (g_save_grid > 0 && !(g_current_step % g_save_grid) &&
+      g_current_step <= g_num_steps) {
+    std::stringstream oss_grid;
+    oss_grid << g_short_file_name << "/grid" << std::setw(5)
+             << std::setfill('0') << (g_current_step / g_save_grid) << ".wcgv";
+
+    g_executable_simulation->serializeGridFields(oss_grid.str());
+  }
+
   // Update the state of the renderers
 #ifdef RENDER_ENABLED
   if (g_rendering_enabled) g_executable_simulation->updateOpenGLRendererState();
@@ -572,6 +619,14 @@ int main(int argc, char** argv) {
   // Parse command line arguments
   parseCommandLine(argc, argv);
 
+  if (!g_compile_file_name.empty()) {
+    TwoDSceneXMLParser xml_scene_parser;
+    return xml_scene_parser.compileScene(g_xml_scene_file,
+                                         g_compile_file_name)
+               ? 0
+               : 1;
+  }
+
   std::vector<std::string> pathes;
 
   stringutils::split(g_xml_scene_file, '/', pathes);
@@ -594,6 +649,16 @@ int main(int argc, char** argv) {
   // Load the user-specified scene
   loadScene(g_xml_scene_file);
 
+  if (!g_telemetry_file_name.empty())
+    g_executable_simulation->openTelemetry(g_telemetry_file_name);
+
+  if (!g_preroll_file_name.empty()) {
+    g_executable_simulation->settleRestPose(g_preroll_file_name);
+    std::cout << "[rest pose saved to " << g_preroll_file_name << "]"
+              << std::endl;
+    return 0;
+  }
+
   // If requested, open the input file for the scene to benchmark
 #ifdef RENDER_ENABLED
   // Initialization for OpenGL and GLUT
@@ -11,6 +11,7 @@
 #include "ParticleSimulation.h"
 
 #include "MemUtilities.h"
+#include "QuasiStaticSolver.h"
 #include "TimingUtilities.h"
 
 #ifdef RENDER_ENABLED
@@ -409,10 +410,40 @@ void ParticleSimulation::readPos(const std::string& fn_pos) {
   ifs.close();
 }
 
+void ParticleSimulation::openTelemetry(const std::string& fn_telemetry) {
+  std::shared_ptr<TelemetryWriter> writer =
+      std::make_shared<TelemetryWriter>(fn_telemetry);
+  if (!writer->isOpen()) {
+    std::cerr << outputmod::startred
+              << "ERROR IN OPENING TELEMETRY FILE: " << outputmod::endred
+              << fn_telemetry << std::endl;
+    return;
+  }
+
+  m_core->setTelemetryWriter(writer);
+}
+
+bool ParticleSimulation::settleRestPose(const std::string& fn_pos) {
+  const std::shared_ptr<TwoDScene>& scene = m_core->getScene();
+  const LiquidInfo& info = scene->getLiquidInfo();
+
+  QuasiStaticSolver solver(info.quasi_static_max_iterations,
+                           info.quasi_static_tolerance);
+  const bool converged = solver.solve(*scene);
+
+  m_scene_serializer.serializePositionOnly(*scene, fn_pos, true);
+
+  return converged;
+}
+
 void ParticleSimulation::serializePositionOnly(const std::string& fn_pos) {
   m_scene_serializer.serializePositionOnly(*m_core->getScene(), fn_pos);
 }
 
+void ParticleSimulation::serializeGridFields(const std::string& fn_grid) {
+  m_scene_serializer.serializeGridFields(*m_core->getScene(), fn_grid);
+}
+
 void ParticleSimulation::serializeScene(
     const std::string& fn_clothes, const std::string& fn_hairs,
     const std::string& fn_fluid, const std::string& fn_internal_boundaries,
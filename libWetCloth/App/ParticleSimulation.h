@@ -51,7 +51,14 @@ class ParticleSimulation {
 
   void serializePositionOnly(const std::string& fn_pos);
 
+  void serializeGridFields(const std::string& fn_grid);
+
   void readPos(const std::string& fn_pos);
+
+  void openTelemetry(const std::string& fn_telemetry);
+
+  // settle the elastic objects to rest and save a state loadable with -i
+  bool settleRestPose(const std::string& fn_pos);
   /////////////////////////////////////////////////////////////////////////////
   // Status Functions
 
@@ -12,6 +12,7 @@
 
 #include <igl/boundary_loop.h>
 
+#include <cstring>
 #include <fstream>
 #include <iomanip>
 #include <numeric>
@@ -38,6 +39,122 @@ void serialize_pos_subprog(SerializePosPacket* packet) {
   delete packet;
 }
 
+// name and node offset, in cells from the bucket corner, of every channel
+// of a grid file in the order SerializeGridPacket stores them
+struct GridChannel {
+  const char* name;
+  float offset[3];
+};
+
+const GridChannel grid_channels[] = {
+    {"liquid_phi", {0.5f, 0.5f, 0.5f}}, {"pressure", {0.5f, 0.5f, 0.5f}},
+    {"sat_p", {0.5f, 0.5f, 0.5f}},      {"sat_x", {0.0f, 0.5f, 0.5f}},
+    {"sat_y", {0.5f, 0.0f, 0.5f}},      {"sat_z", {0.5f, 0.5f, 0.0f}},
+    {"vel_x", {0.0f, 0.5f, 0.5f}},      {"vel_y", {0.5f, 0.0f, 0.5f}},
+    {"vel_z", {0.5f, 0.5f, 0.0f}},      {"fluid_vel_x", {0.0f, 0.5f, 0.5f}},
+    {"fluid_vel_y", {0.5f, 0.0f, 0.5f}}, {"fluid_vel_z", {0.5f, 0.5f, 0.0f}},
+};
+
+const int num_grid_channels = sizeof(grid_channels) / sizeof(GridChannel);
+
+// tile encodings: a single value, the nodes that are non-zero under a
+// bit mask, or every node
+enum GRID_TILE_ENCODING {
+  GTE_CONSTANT = 0,
+  GTE_MASKED,
+  GTE_DENSE,
+};
+
+void serialize_grid_tile(std::ostream& os, const VectorXs& values,
+                         int num_nodes) {
+  unsigned char encoding = GTE_CONSTANT;
+  int num_nonzeros = 0;
+  const float first = values.size() == num_nodes ? (float)values(0) : 0.0f;
+  if (values.size() == num_nodes) {
+    for (int i = 0; i < num_nodes; ++i) {
+      const float v = (float)values(i);
+      if (v != first) encoding = GTE_DENSE;
+      if (v != 0.0f) ++num_nonzeros;
+    }
+  }
+
+  const int mask_bytes = (num_nodes + 7) / 8;
+  if (encoding == GTE_DENSE &&
+      mask_bytes + num_nonzeros * (int)sizeof(float) <
+          num_nodes * (int)sizeof(float))
+    encoding = GTE_MASKED;
+
+  os.write((const char*)&encoding, 1);
+  switch (encoding) {
+    case GTE_CONSTANT:
+      os.write((const char*)&first, sizeof(float));
+      break;
+    case GTE_MASKED: {
+      std::vector<unsigned char> mask(mask_bytes, 0U);
+      std::vector<float> nonzeros;
+      nonzeros.reserve(num_nonzeros);
+      for (int i = 0; i < num_nodes; ++i) {
+        const float v = (float)values(i);
+        if (v == 0.0f) continue;
+        mask[i / 8] |= (unsigned char)(1U << (i % 8));
+        nonzeros.push_back(v);
+      }
+      os.write((const char*)&mask[0], mask_bytes);
+      os.write((const char*)&nonzeros[0], num_nonzeros * sizeof(float));
+      break;
+    }
+    default: {
+      std::vector<float> dense(num_nodes);
+      for (int i = 0; i < num_nodes; ++i) dense[i] = (float)values(i);
+      os.write((const char*)&dense[0], num_nodes * sizeof(float));
+      break;
+    }
+  }
+}
+
+void serialize_grid_subprog(SerializeGridPacket* packet) {
+  std::ofstream ofs(packet->fn_grid.c_str(), std::ios::binary);
+
+  // header: magic, version, cell size, nodes per bucket side, corner of
+  // bucket (0, 0, 0), then name and node offset of every channel
+  const char magic[4] = {'W', 'C', 'G', 'V'};
+  const int version = 1;
+  const float dx = (float)packet->dx;
+  const float corner[3] = {(float)packet->bucket_mincorner(0),
+                           (float)packet->bucket_mincorner(1),
+                           (float)packet->bucket_mincorner(2)};
+  const int num_tiles = (int)packet->m_tile_handles.size();
+
+  ofs.write(magic, sizeof(magic));
+  ofs.write((const char*)&version, sizeof(int));
+  ofs.write((const char*)&dx, sizeof(float));
+  ofs.write((const char*)&packet->num_nodes, sizeof(int));
+  ofs.write((const char*)corner, sizeof(corner));
+  ofs.write((const char*)&num_grid_channels, sizeof(int));
+  for (const GridChannel& channel : grid_channels) {
+    const int len = (int)strlen(channel.name);
+    ofs.write((const char*)&len, sizeof(int));
+    ofs.write(channel.name, len);
+    ofs.write((const char*)channel.offset, sizeof(channel.offset));
+  }
+  ofs.write((const char*)&num_tiles, sizeof(int));
+
+  // tiles: bucket handle, then every channel; a tile's origin is
+  // corner + handle * num_nodes * dx
+  const int num_nodes =
+      packet->num_nodes * packet->num_nodes * packet->num_nodes;
+  for (int t = 0; t < num_tiles; ++t) {
+    ofs.write((const char*)packet->m_tile_handles[t].data(), 3 * sizeof(int));
+    for (int c = 0; c < num_grid_channels; ++c)
+      serialize_grid_tile(ofs, packet->m_channels[c][t], num_nodes);
+  }
+
+  ofs.flush();
+  ofs.close();
+
+  delete packet;
+}
+
 void serialize_subprog(SerializePacket* packet) {
   std::ofstream ofs_fluid(packet->fn_fluid.c_str());
   const int num_fp = packet->m_fluid_vertices.size();
@@ -105,6 +222,26 @@ void serialize_subprog(SerializePacket* packet) {
               << std::endl;
   }
 
+  if (!packet->m_embedded_cloth_vertices.empty()) {
+    std::ofstream ofs_embedded(packet->fn_embedded_clothes.c_str());
+    const int num_embedded_vtx = packet->m_embedded_cloth_vertices.size();
+    for (int i = 0; i < num_embedded_vtx; ++i) {
+      const Vector3s& v = packet->m_embedded_cloth_vertices[i];
+      ofs_embedded << "v " << std::setprecision(8) << v(0) << " " << v(1)
+                   << " " << v(2) << " " << packet->m_embedded_cloth_sat[i]
+                   << std::endl;
+    }
+    for (auto& n : packet->m_embedded_cloth_normals) {
+      ofs_embedded << "vn " << std::setprecision(8) << n(0) << " " << n(1)
+                   << " " << n(2) << std::endl;
+    }
+    for (auto& f : packet->m_embedded_cloth_indices) {
+      ofs_embedded << "f " << (f(0) + 1) << "//" << (f(0) + 1) << " "
+                   << (f(1) + 1) << "//" << (f(1) + 1) << " " << (f(2) + 1)
+                   << "//" << (f(2) + 1) << std::endl;
+    }
+  }
+
   std::ofstream ofs_internal(packet->fn_internal_boundaries.c_str());
   for (auto& v : packet->m_internal_vertices) {
     ofs_internal << "v " << std::setprecision(8) << v(0) << " " << v(1) << " "
@@ -162,12 +299,15 @@ void TwoDSceneSerializer::serializeScene(
   SerializePacket* data = new SerializePacket;
 
   updateDoubleFaceCloth(scene, data);
+  updateEmbeddedClothes(scene, data);
   updateHairs(scene, data);
   updateFluid(scene, data);
   updateMesh(scene, data);
   updateAttachSprings(scene, data);
 
   data->fn_clothes = fn_clothes.c_str();
+  data->fn_embedded_clothes =
+      fn_clothes.substr(0, fn_clothes.length() - 4) + "_embedded.obj";
   data->fn_fluid = fn_fluid.c_str();
   data->fn_hairs = fn_hairs.c_str();
   data->fn_external_boundaries = fn_external_boundaries.c_str();
@@ -179,13 +319,59 @@ void TwoDSceneSerializer::serializeScene(
 }
 
 void TwoDSceneSerializer::serializePositionOnly(TwoDScene& scene,
-                                                const std::string& fn_pos) {
+                                                const std::string& fn_pos,
+                                                bool wait) {
   SerializePosPacket* data = new SerializePosPacket;
   data->fn_pos = fn_pos.c_str();
   data->m_pos = scene.getX();
   data->m_d_gauss = scene.getGaussd();
 
   std::thread t(std::bind(serialize_pos_subprog, data));
+  if (wait)
+    t.join();
+  else
+    t.detach();
+}
+
+void TwoDSceneSerializer::serializeGridFields(const TwoDScene& scene,
+                                              const std::string& fn_grid) {
+  SerializeGridPacket* data = new SerializeGridPacket;
+  data->fn_grid = fn_grid;
+  data->dx = scene.getCellSize();
+  data->num_nodes = scene.getDefaultNumNodes();
+  data->bucket_mincorner = scene.getBucketMinCorner();
+
+  const Sorter& buckets = scene.getParticleBuckets();
+  const std::vector<unsigned char>& activated = scene.getBucketActivated();
+  std::vector<int> tile_buckets;
+  for (int bucket_idx = 0; bucket_idx < (int)activated.size(); ++bucket_idx) {
+    if (!activated[bucket_idx]) continue;
+    tile_buckets.push_back(bucket_idx);
+    data->m_tile_handles.push_back(buckets.bucket_handle(bucket_idx));
+  }
+
+  const std::vector<VectorXs>* fields[] = {
+      &scene.getNodeLiquidPhi(),   &scene.getNodePressure(),
+      &scene.getNodeSaturationP(), &scene.getNodeSaturationX(),
+      &scene.getNodeSaturationY(), &scene.getNodeSaturationZ(),
+      &scene.getNodeVelocityX(),   &scene.getNodeVelocityY(),
+      &scene.getNodeVelocityZ(),   &scene.getNodeFluidVelocityX(),
+      &scene.getNodeFluidVelocityY(), &scene.getNodeFluidVelocityZ(),
+  };
+
+  const int num_tiles = (int)tile_buckets.size();
+  data->m_channels.resize(num_grid_channels);
+  for (int c = 0; c < num_grid_channels; ++c) {
+    const std::vector<VectorXs>& field = *fields[c];
+    std::vector<VectorXs>& channel = data->m_channels[c];
+    channel.resize(num_tiles);
+    threadutils::for_each(0, num_tiles, [&](int t) {
+      const int bucket_idx = tile_buckets[t];
+      if (bucket_idx < (int)field.size()) channel[t] = field[bucket_idx];
+    });
+  }
+
+  std::thread t(std::bind(serialize_grid_subprog, data));
   t.detach();
 }
 
@@ -273,17 +459,30 @@ void TwoDSceneSerializer::updateHairs(const TwoDScene& scene,
 
 void TwoDSceneSerializer::updateFluid(const TwoDScene& scene,
                                       SerializePacket* data) {
-  data->m_fluid_vertices.resize(scene.getNumFluidParticles());
-  data->m_fluid_radii.resize(scene.getNumFluidParticles());
+  const int num_fluids = scene.getNumFluidParticles();
+  const int num_spray = scene.getNumSprayParticles();
+
+  data->m_fluid_vertices.resize(num_fluids + num_spray);
+  data->m_fluid_radii.resize(num_fluids + num_spray);
 
   const std::vector<int>& indices = scene.getFluidIndices();
   const VectorXs& x = scene.getX();
   const VectorXs& r = scene.getRadius();
 
-  threadutils::for_each(0, scene.getNumFluidParticles(), [&](int idx) {
+  threadutils::for_each(0, num_fluids, [&](int idx) {
     data->m_fluid_vertices[idx] = x.segment<3>(indices[idx] * 4);
     data->m_fluid_radii[idx] = r(indices[idx] * 2 + 0);
   });
+
+  // spray particles are written along with the liquid particles
+  const VectorXs& spray_x = scene.getSprayX();
+  const VectorXs& spray_vol = scene.getSprayVol();
+
+  threadutils::for_each(0, num_spray, [&](int idx) {
+    data->m_fluid_vertices[num_fluids + idx] = spray_x.segment<3>(idx * 4);
+    data->m_fluid_radii[num_fluids + idx] =
+        pow(spray_vol(idx) / M_PI * 0.75, 1.0 / 3.0);
+  });
 }
 
 void TwoDSceneSerializer::updateMesh(const TwoDScene& scene,
@@ -372,6 +571,53 @@ void TwoDSceneSerializer::updateAttachSprings(const TwoDScene& scene,
   });
 }
 
+void TwoDSceneSerializer::updateEmbeddedClothes(const TwoDScene& scene,
+                                                SerializePacket* data) {
+  const std::vector<EmbeddedClothMesh>& meshes = scene.getEmbeddedClothes();
+  if (meshes.empty()) return;
+
+  int num_verts = 0;
+  int num_faces = 0;
+  for (const EmbeddedClothMesh& mesh : meshes) {
+    num_verts += mesh.parents.rows();
+    num_faces += mesh.faces.rows();
+  }
+
+  data->m_embedded_cloth_vertices.resize(num_verts);
+  data->m_embedded_cloth_normals.resize(num_verts);
+  data->m_embedded_cloth_sat.resize(num_verts);
+  data->m_embedded_cloth_indices.resize(num_faces);
+
+  int vert_base = 0;
+  int face_base = 0;
+  for (const EmbeddedClothMesh& mesh : meshes) {
+    MatrixXs positions;
+    MatrixXs normals;
+    VectorXs saturation;
+    clothembedding::reconstruct(mesh, scene.getX(), scene.getFluidVol(),
+                                scene.getVol(), positions, normals,
+                                saturation);
+
+    const int mesh_verts = positions.rows();
+    threadutils::for_each(0, mesh_verts, [&](int i) {
+      data->m_embedded_cloth_vertices[vert_base + i] =
+          positions.row(i).transpose();
+      data->m_embedded_cloth_normals[vert_base + i] =
+          normals.row(i).transpose();
+      data->m_embedded_cloth_sat[vert_base + i] = saturation(i);
+    });
+
+    const int mesh_faces = mesh.faces.rows();
+    threadutils::for_each(0, mesh_faces, [&](int i) {
+      data->m_embedded_cloth_indices[face_base + i] =
+          mesh.faces.row(i).transpose() + Vector3i::Constant(vert_base);
+    });
+
+    vert_base += mesh_verts;
+    face_base += mesh_faces;
+  }
+}
+
 void TwoDSceneSerializer::updateDoubleFaceCloth(const TwoDScene& scene,
                                                 SerializePacket* data) {
   const VectorXs& x = scene.getX();
@@ -23,6 +23,16 @@ struct SerializePosPacket {
   MatrixXs m_d_gauss;
 };
 
+// one tile per activated bucket, one channel per exported grid field
+struct SerializeGridPacket {
+  std::string fn_grid;
+  scalar dx;
+  int num_nodes;
+  Vector3s bucket_mincorner;
+  std::vector<Vector3i> m_tile_handles;
+  std::vector<std::vector<VectorXs> > m_channels;  // channel -> tile -> nodes
+};
+
 struct SerializePacket {
   std::string fn_clothes;
   std::string fn_hairs;
@@ -47,6 +57,12 @@ struct SerializePacket {
   std::vector<int> m_hair_group;
   std::vector< std::vector< Vector3s> > m_hair_1st_frames;
 
+  std::string fn_embedded_clothes;
+  std::vector<Vector3s> m_embedded_cloth_vertices;
+  std::vector<Vector3s> m_embedded_cloth_normals;
+  std::vector<scalar> m_embedded_cloth_sat;
+  std::vector<Vector3i> m_embedded_cloth_indices;
+
   std::vector<Vector3s> m_attach_spring_vertices;
 
   std::vector<Vector3s> m_fluid_vertices;
@@ -71,13 +87,20 @@ class TwoDSceneSerializer {
                       const std::string& fn_external_boundaries,
                       const std::string& fn_springs);
 
-  void serializePositionOnly(TwoDScene& scene, const std::string& fn_pos);
+  // written in the background unless wait is set
+  void serializePositionOnly(TwoDScene& scene, const std::string& fn_pos,
+                             bool wait = false);
 
   void loadPosOnly(TwoDScene& scene, std::ifstream& inputstream);
 
+  // liquid phi, pressure, saturation and the solid and liquid velocities of
+  // the activated buckets, written in the background as a sparse tiled volume
+  void serializeGridFields(const TwoDScene& scene, const std::string& fn_grid);
+
   void initializeFaceLoops(const TwoDScene& scene);
 
   void updateDoubleFaceCloth(const TwoDScene& scene, SerializePacket* data);
+  void updateEmbeddedClothes(const TwoDScene& scene, SerializePacket* data);
   void updateHairs(const TwoDScene& scene, SerializePacket* data);
   void updateFluid(const TwoDScene& scene, SerializePacket* data);
   void updateMesh(const TwoDScene& scene, SerializePacket* data);
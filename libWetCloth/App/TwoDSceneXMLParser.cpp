@@ -10,6 +10,7 @@
 
 #include "TwoDSceneXMLParser.h"
 
+#include <algorithm>
 #include <fstream>
 #include <string>
 #include <unordered_set>
@@ -21,12 +22,35 @@ void TwoDSceneXMLParser::loadExecutableSimulation(
     std::shared_ptr<ParticleSimulation>& execsim, Camera& cam, scalar& dt,
     scalar& max_time, scalar& steps_per_sec_cap, renderingutils::Color& bgcolor,
     std::string& description, std::string& scenetag, bool& cam_inited,
-    const std::string& input_bin) {
+    const std::string& input_bin, const std::string& compiled_file) {
   // Load the xml document
   std::vector<char> xmlchars;
   rapidxml::xml_document<> doc;
   loadXMLFile(file_name, xmlchars, doc);
 
+  // The compiled scene replaces the particle and cloth nodes only if it was
+  // built from this very file
+  m_compiled_loaded = false;
+  if (!compiled_file.empty()) {
+    if (!scenecompiler::read(compiled_file, m_compiled)) {
+      std::cerr << outputmod::startred
+                << "WARNING IN XMLSCENEPARSER:" << outputmod::endred
+                << " Failed to read compiled scene " << compiled_file
+                << ". Parsing " << file_name << " instead." << std::endl;
+    } else if (m_compiled.checksum != m_xml_checksum) {
+      std::cerr << outputmod::startred
+                << "WARNING IN XMLSCENEPARSER:" << outputmod::endred
+                << " Compiled scene " << compiled_file
+                << " does not match the checksum of " << file_name
+                << ". Parsing the xml file instead." << std::endl;
+      m_compiled.clear();
+    } else {
+      m_compiled_loaded = true;
+      std::cout << "[compiled scene " << compiled_file << " loaded]"
+                << std::endl;
+    }
+  }
+
   // Attempt to locate the root node
   rapidxml::xml_node<>* node = doc.first_node("scene");
   if (node == NULL) {
@@ -202,6 +226,24 @@ void TwoDSceneXMLParser::loadDistanceFields(
       }
     }
 
+    int material = -1;
+    if (subnd->first_attribute("material")) {
+      std::string attribute(subnd->first_attribute("material")->value());
+      if (!stringutils::extractFromString(attribute, material) ||
+          material < -1 ||
+          material >= twodscene->getNumColliderMaterials()) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of material attribute for "
+                     "distancefield parameters. Value must refer to an "
+                     "existing ColliderMaterial. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    const int num_fields = (int)fields.size();
+
     if (bt == DFT_BOX || bt == DFT_SPHERE || bt == DFT_CAPSULE ||
         bt == DFT_CYLINDER || bt == DFT_FILE) {
       std::vector<DF_SOURCE_DURATION> durations;
@@ -684,6 +726,58 @@ void TwoDSceneXMLParser::loadDistanceFields(
 
       fields.push_back(ob);
     }
+
+    if ((int)fields.size() > num_fields) fields.back()->material = material;
+  }
+}
+
+void TwoDSceneXMLParser::loadColliderMaterials(
+    rapidxml::xml_node<>* node, const std::shared_ptr<TwoDScene>& twodscene) {
+  /* Referred to by the material attribute of distancefield, in order
+   <ColliderMaterial>
+   <sample saturation="0" friction="0.5" adhesion="0" />
+   <sample saturation="1" friction="0.1" adhesion="200" />
+   </ColliderMaterial>
+   */
+
+  int materialCount = 0;
+  for (rapidxml::xml_node<>* nd = node->first_node("ColliderMaterial"); nd;
+       nd = nd->next_sibling("ColliderMaterial")) {
+    ColliderMaterial material;
+
+    for (rapidxml::xml_node<>* subnd = nd->first_node("sample"); subnd;
+         subnd = subnd->next_sibling("sample")) {
+      scalar sample[3] = {0.0, 0.0, 0.0};
+      const char* names[3] = {"saturation", "friction", "adhesion"};
+      for (int r = 0; r < 3; ++r) {
+        if (!subnd->first_attribute(names[r])) continue;
+
+        std::string attribute(subnd->first_attribute(names[r])->value());
+        if (!stringutils::extractFromString(attribute, sample[r]) ||
+            sample[r] < 0.0) {
+          std::cerr << outputmod::startred
+                    << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                    << " Failed to parse value of " << names[r]
+                    << " attribute for ColliderMaterial " << materialCount
+                    << ". Value must be numeric and non-negative. Exiting."
+                    << std::endl;
+          exit(1);
+        }
+      }
+
+      material.insertSample(sample[0], sample[1], sample[2]);
+    }
+
+    if (material.saturation.empty()) {
+      std::cerr << outputmod::startred
+                << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                << " ColliderMaterial " << materialCount
+                << " has no sample. Exiting." << std::endl;
+      exit(1);
+    }
+
+    twodscene->insertColliderMaterial(material);
+    ++materialCount;
   }
 }
 
@@ -704,7 +798,10 @@ void TwoDSceneXMLParser::loadParticleSimulation(
   loadBucketInfo(node, scene);
 
   int mg_part, mg_df;
+  if (!m_compiled_loaded) compileSceneNodes(node, false);
+  loadClothProxies(node, scene);
   loadParticles(node, scene, mg_part);
+  loadColliderMaterials(node, scene);
   loadDistanceFields(node, scene, mg_df);
 
   loadElasticParameters(node, scene, dt);
@@ -719,6 +816,8 @@ void TwoDSceneXMLParser::loadParticleSimulation(
   loadClothes(node, scene);
   loadHairs(node, scene, dt);
   loadHairPose(node, scene);
+  if (!m_follower_strands.empty())
+    scene->bindFollowerStrands(m_guide_strands, m_follower_strands);
   loadScripts(node, scene);
 
   scene->initGaussSystem();
@@ -1349,6 +1448,9 @@ void TwoDSceneXMLParser::loadXMLFile(const std::string& filename,
     xmlchars.push_back(filecontents[i]);
   xmlchars.push_back('\0');
 
+  // rapidxml parses in place, so hash the text before it does
+  m_xml_checksum = scenecompiler::checksum(xmlchars);
+
   // Initialize the xml parser with the character vector
   doc.parse<0>(&xmlchars[0]);
 }
@@ -1386,8 +1488,10 @@ void TwoDSceneXMLParser::loadClothes(
   int numfaces = twodscene->getNumFaces();
   int numparticles = twodscene->getNumParticles();
 
+  int cloth_idx = -1;
   for (rapidxml::xml_node<>* nd = node->first_node("cloth"); nd;
        nd = nd->next_sibling("cloth")) {
+    ++cloth_idx;
     int paramsIndex = -1;
     if (nd->first_attribute("params")) {
       std::string attribute(nd->first_attribute("params")->value());
@@ -1413,22 +1517,14 @@ void TwoDSceneXMLParser::loadClothes(
 
     std::vector<Vector3i> faces;
 
-    for (rapidxml::xml_node<>* subnd = nd->first_node("face"); subnd;
-         subnd = subnd->next_sibling("face")) {
-      // Extract the particle's initial velocity
-      Vector3i face = Vector3i::Zero();
-      if (subnd->first_attribute("i")) {
-        std::string face_str(subnd->first_attribute("i")->value());
-        if (!stringutils::readList(face_str, ' ', face)) {
-          std::cerr << "Failed to load x, y, and z face for cloth "
-                    << numclothes << std::endl;
-          exit(1);
-        }
-      } else {
-        continue;
+    if (cloth_idx < (int)m_compiled.proxy_faces.size() &&
+        !m_compiled.proxy_faces[cloth_idx].empty()) {
+      faces = m_compiled.proxy_faces[cloth_idx];
+    } else {
+      faces = m_compiled.cloth_faces[cloth_idx];
+      for (Vector3i& face : faces) {
+        for (int r = 0; r < 3; ++r) face(r) = remapParticle(face(r), "cloth");
       }
-
-      faces.push_back(face);
     }
 
     std::unordered_set<int> unique_particles;
@@ -1488,6 +1584,472 @@ void TwoDSceneXMLParser::loadClothes(
   }
 }
 
+void TwoDSceneXMLParser::loadClothFaces(rapidxml::xml_node<>* node,
+                                        int cloth_idx,
+                                        std::vector<Vector3i>& faces) {
+  for (rapidxml::xml_node<>* subnd = node->first_node("face"); subnd;
+       subnd = subnd->next_sibling("face")) {
+    Vector3i face = Vector3i::Zero();
+    if (subnd->first_attribute("i")) {
+      std::string face_str(subnd->first_attribute("i")->value());
+      if (!stringutils::readList(face_str, ' ', face)) {
+        std::cerr << "Failed to load x, y, and z face for cloth " << cloth_idx
+                  << std::endl;
+        exit(1);
+      }
+    } else {
+      continue;
+    }
+
+    faces.push_back(face);
+  }
+}
+
+int TwoDSceneXMLParser::remapParticle(int pidx, const char* user) const {
+  const std::vector<int>& remap = m_compiled.particle_remap;
+  if (remap.empty() || pidx < 0 || pidx >= (int)remap.size()) return pidx;
+
+  const int new_pidx = remap[pidx];
+  if (new_pidx < 0) {
+    std::cerr << outputmod::startred
+              << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+              << " Particle " << pidx
+              << " was removed by a cloth proxy but is used by a " << user
+              << ". Exiting." << std::endl;
+    exit(1);
+  }
+
+  return new_pidx;
+}
+
+void TwoDSceneXMLParser::loadClothProxies(
+    rapidxml::xml_node<>* node, const std::shared_ptr<TwoDScene>& twodscene) {
+  for (const EmbeddedClothMesh& mesh : m_compiled.meshes)
+    twodscene->insertEmbeddedCloth(mesh);
+}
+
+int TwoDSceneXMLParser::compileSceneNodes(rapidxml::xml_node<>* node,
+                                          bool validate) {
+  m_compiled.clear();
+  m_compiled.checksum = m_xml_checksum;
+
+  compileParticles(node);
+  compileClothFaces(node);
+
+  // the proxies move particles, so the scene is checked as it was written
+  if (validate) {
+    const int num_problems = validateScene(node);
+    if (num_problems > 0) return num_problems;
+  }
+
+  compileClothProxies(node);
+  return 0;
+}
+
+void TwoDSceneXMLParser::compileClothFaces(rapidxml::xml_node<>* node) {
+  std::vector<std::vector<Vector3i> >& cloth_faces = m_compiled.cloth_faces;
+
+  for (rapidxml::xml_node<>* nd = node->first_node("cloth"); nd;
+       nd = nd->next_sibling("cloth")) {
+    const int cloth_idx = (int)cloth_faces.size();
+    cloth_faces.push_back(std::vector<Vector3i>());
+
+    if (nd->first_attribute("params")) {
+      std::string attribute(nd->first_attribute("params")->value());
+      int paramsIndex = -1;
+      if (stringutils::extractFromString(attribute, paramsIndex) &&
+          paramsIndex == -1)
+        continue;
+    }
+
+    loadClothFaces(nd, cloth_idx, cloth_faces.back());
+  }
+}
+
+void TwoDSceneXMLParser::compileClothProxies(rapidxml::xml_node<>* node) {
+  const std::vector<std::vector<Vector3i> >& cloth_faces =
+      m_compiled.cloth_faces;
+  std::vector<int> target_faces;
+
+  for (rapidxml::xml_node<>* nd = node->first_node("cloth"); nd;
+       nd = nd->next_sibling("cloth")) {
+    const int cloth_idx = (int)target_faces.size();
+    target_faces.push_back(0);
+
+    if (nd->first_attribute("simfaces")) {
+      std::string attribute(nd->first_attribute("simfaces")->value());
+      if (!stringutils::extractFromString(attribute, target_faces.back())) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of simfaces attribute for cloth "
+                  << cloth_idx << ". Value must be integer. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+  }
+
+  const int num_clothes = (int)cloth_faces.size();
+
+  bool any_proxy = false;
+  for (int i = 0; i < num_clothes; ++i) {
+    any_proxy = any_proxy || (target_faces[i] > 0 &&
+                              target_faces[i] < (int)cloth_faces[i].size());
+  }
+  if (!any_proxy) return;
+
+  // rest positions and fixed flags of the particles in the file
+  std::vector<ParticleRecord>& particles = m_compiled.particles;
+  const int num_particles = (int)particles.size();
+  std::vector<Vector3s> positions(num_particles);
+  std::vector<unsigned char> fixed(num_particles);
+  for (int pidx = 0; pidx < num_particles; ++pidx) {
+    positions[pidx] = particles[pidx].x;
+    fixed[pidx] = (unsigned char)(particles[pidx].fixed != 0);
+  }
+
+  // vertices shared between clothes are kept as they are
+  std::vector<int> num_owners(num_particles, 0);
+  for (int i = 0; i < num_clothes; ++i) {
+    std::unordered_set<int> unique_particles;
+    for (const Vector3i& f : cloth_faces[i])
+      for (int r = 0; r < 3; ++r)
+        if (f(r) >= 0 && f(r) < num_particles) unique_particles.insert(f(r));
+    for (int pidx : unique_particles) ++num_owners[pidx];
+  }
+
+  std::vector<unsigned char> keep(num_particles, 1U);
+  std::vector<EmbeddedClothMesh>& meshes = m_compiled.meshes;
+  std::vector<std::vector<int> > mesh_proxy_particles;
+
+  m_compiled.proxy_faces.resize(num_clothes);
+
+  for (int i = 0; i < num_clothes; ++i) {
+    const std::vector<Vector3i>& faces = cloth_faces[i];
+    const int num_faces = (int)faces.size();
+    if (target_faces[i] <= 0 || target_faces[i] >= num_faces) continue;
+
+    std::vector<int> verts;
+    std::unordered_map<int, int> local_index;
+    MatrixXi F(num_faces, 3);
+    for (int j = 0; j < num_faces; ++j) {
+      for (int r = 0; r < 3; ++r) {
+        const int pidx = faces[j](r);
+        if (pidx < 0 || pidx >= num_particles) {
+          std::cerr << outputmod::startred
+                    << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                    << " Face " << j << " of cloth " << i
+                    << " refers to a particle that does not exist. Exiting."
+                    << std::endl;
+          exit(1);
+        }
+
+        auto itr = local_index.find(pidx);
+        if (itr == local_index.end()) {
+          itr = local_index.emplace(pidx, (int)verts.size()).first;
+          verts.push_back(pidx);
+        }
+        F(j, r) = itr->second;
+      }
+    }
+
+    const int num_verts = (int)verts.size();
+    MatrixXs V(num_verts, 3);
+    std::vector<unsigned char> locked(num_verts);
+    for (int j = 0; j < num_verts; ++j) {
+      V.row(j) = positions[verts[j]].transpose();
+      locked[j] = fixed[verts[j]] || num_owners[verts[j]] > 1;
+    }
+
+    MatrixXs U;
+    MatrixXi G;
+    VectorXi birth;
+    if (!clothembedding::decimate(V, F, locked, target_faces[i], U, G,
+                                  birth)) {
+      std::cout << "[cloth " << i
+                << " is not edge-manifold, simulated at full resolution]"
+                << std::endl;
+      continue;
+    }
+
+    for (int pidx : verts) keep[pidx] = 0U;
+
+    std::vector<int> proxy_particles(U.rows());
+    for (int k = 0; k < (int)U.rows(); ++k) {
+      const int pidx = verts[birth(k)];
+      keep[pidx] = 1U;
+      particles[pidx].x = U.row(k).transpose();
+      proxy_particles[k] = pidx;
+    }
+
+    m_compiled.proxy_faces[i].resize(G.rows());
+    for (int j = 0; j < (int)G.rows(); ++j) {
+      m_compiled.proxy_faces[i][j] =
+          Vector3i(proxy_particles[G(j, 0)], proxy_particles[G(j, 1)],
+                   proxy_particles[G(j, 2)]);
+    }
+
+    EmbeddedClothMesh mesh;
+    clothembedding::embed(V, F, U, G, mesh);
+    meshes.push_back(mesh);
+    mesh_proxy_particles.push_back(proxy_particles);
+
+    std::cout << "[cloth " << i << ": " << num_faces
+              << " faces embedded in a proxy of " << G.rows() << " faces, "
+              << U.rows() << " vertices]" << std::endl;
+  }
+
+  std::vector<int>& remap = m_compiled.particle_remap;
+  remap.resize(num_particles);
+  int num_kept = 0;
+  for (int pidx = 0; pidx < num_particles; ++pidx)
+    remap[pidx] = keep[pidx] ? num_kept++ : -1;
+
+  for (auto& faces : m_compiled.proxy_faces)
+    for (Vector3i& f : faces)
+      for (int r = 0; r < 3; ++r) f(r) = remap[f(r)];
+
+  const int num_meshes = (int)meshes.size();
+  for (int i = 0; i < num_meshes; ++i) {
+    const std::vector<int>& proxy_particles = mesh_proxy_particles[i];
+    meshes[i].proxy_particles.resize(proxy_particles.size());
+    for (int k = 0; k < (int)proxy_particles.size(); ++k)
+      meshes[i].proxy_particles(k) = remap[proxy_particles[k]];
+  }
+}
+
+bool TwoDSceneXMLParser::compileScene(const std::string& file_name,
+                                      const std::string& out_file) {
+  std::vector<char> xmlchars;
+  rapidxml::xml_document<> doc;
+  loadXMLFile(file_name, xmlchars, doc);
+
+  rapidxml::xml_node<>* node = doc.first_node("scene");
+  if (node == NULL) {
+    std::cerr << outputmod::startred
+              << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+              << " Failed to parse xml scene file. Failed to locate root "
+                 "<scene> node."
+              << std::endl;
+    return false;
+  }
+
+  const int num_problems = compileSceneNodes(node, true);
+  if (num_problems > 0) {
+    std::cerr << outputmod::startred
+              << "ERROR IN XMLSCENEPARSER:" << outputmod::endred << " "
+              << num_problems << " problem(s) found in " << file_name
+              << ". Scene not compiled." << std::endl;
+    return false;
+  }
+
+  if (!scenecompiler::write(out_file, m_compiled)) {
+    std::cerr << outputmod::startred
+              << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+              << " Failed to write compiled scene " << out_file << "."
+              << std::endl;
+    return false;
+  }
+
+  int num_faces = 0;
+  for (const std::vector<Vector3i>& faces : m_compiled.cloth_faces)
+    num_faces += (int)faces.size();
+
+  std::cout << "[" << file_name << " compiled to " << out_file << ": "
+            << m_compiled.particles.size() << " particles, " << num_faces
+            << " cloth faces, " << m_compiled.meshes.size()
+            << " cloth proxies]" << std::endl;
+  return true;
+}
+
+int TwoDSceneXMLParser::validateScene(rapidxml::xml_node<>* node) {
+  const int max_reports = 32;
+  int num_problems = 0;
+  auto report = [&](const std::string& what) {
+    if (num_problems < max_reports)
+      std::cerr << outputmod::startred
+                << "ERROR IN SCENE:" << outputmod::endred << " " << what
+                << std::endl;
+    else if (num_problems == max_reports)
+      std::cerr << "[further problems are counted but not listed]"
+                << std::endl;
+    ++num_problems;
+  };
+
+  const std::vector<ParticleRecord>& particles = m_compiled.particles;
+  const std::vector<int>& remap = m_compiled.particle_remap;
+  const int num_particles = (int)particles.size();
+
+  for (int i = 0; i < num_particles; ++i) {
+    const ParticleRecord& p = particles[i];
+    const std::string name = "Particle " + std::to_string(i);
+    if (!p.x.allFinite() || !p.v.allFinite())
+      report(name + " has a non-finite position or velocity.");
+    if (p.radius < 0.0 || p.biradius < 0.0 || p.vol < 0.0 || p.fvol < 0.0 ||
+        p.m < 0.0 || p.fm < 0.0)
+      report(name + " has a negative radius, volume or mass.");
+    if (p.vf < 0.0 || p.vf > 1.0)
+      report(name + " has a volume fraction outside [0, 1].");
+    if (p.group < 0) report(name + " is in a negative group.");
+  }
+
+  int num_params = 0;
+  for (rapidxml::xml_node<>* nd = node->first_node("ElasticParameters"); nd;
+       nd = nd->next_sibling("ElasticParameters"))
+    ++num_params;
+
+  auto read_int = [](rapidxml::xml_node<>* nd, const char* name, int value) {
+    if (nd->first_attribute(name)) {
+      std::string attribute(nd->first_attribute(name)->value());
+      stringutils::extractFromString(attribute, value);
+    }
+    return value;
+  };
+
+  auto check_params = [&](int params, const std::string& name) {
+    if (params < 0 || params >= num_params)
+      report(name + " refers to ElasticParameters " + std::to_string(params) +
+             " but the scene has " + std::to_string(num_params) + ".");
+  };
+
+  // faces must be non-degenerate and every directed edge may only appear
+  // once, otherwise the edge is either duplicated or non-manifold
+  int cloth_idx = -1;
+  for (rapidxml::xml_node<>* nd = node->first_node("cloth"); nd;
+       nd = nd->next_sibling("cloth")) {
+    ++cloth_idx;
+    const int params = read_int(nd, "params", -1);
+    if (params == -1) continue;
+
+    const std::string name = "Cloth " + std::to_string(cloth_idx);
+    check_params(params, name);
+
+    const std::vector<Vector3i>& faces = m_compiled.cloth_faces[cloth_idx];
+    if (faces.empty()) report(name + " has no faces.");
+
+    std::vector<std::pair<int, int> > edges;
+    std::vector<Vector3i> sorted_faces;
+    edges.reserve(faces.size() * 3);
+    sorted_faces.reserve(faces.size());
+
+    const int num_faces = (int)faces.size();
+    for (int j = 0; j < num_faces; ++j) {
+      const Vector3i& f = faces[j];
+      const std::string face_name = name + " face " + std::to_string(j);
+      if (f.minCoeff() < 0 || f.maxCoeff() >= num_particles) {
+        report(face_name + " refers to a particle that does not exist.");
+        continue;
+      }
+      if (f(0) == f(1) || f(1) == f(2) || f(2) == f(0)) {
+        report(face_name + " repeats a vertex.");
+        continue;
+      }
+
+      const Vector3s e0 = particles[f(1)].x - particles[f(0)].x;
+      const Vector3s e1 = particles[f(2)].x - particles[f(0)].x;
+      const scalar scale = std::max(e0.squaredNorm(), e1.squaredNorm());
+      if (e0.cross(e1).norm() <=
+          std::numeric_limits<scalar>::epsilon() * scale)
+        report(face_name + " has zero area.");
+
+      for (int r = 0; r < 3; ++r)
+        edges.push_back(std::make_pair(f(r), f((r + 1) % 3)));
+
+      Vector3i sf = f;
+      std::sort(sf.data(), sf.data() + 3);
+      sorted_faces.push_back(sf);
+    }
+
+    std::sort(edges.begin(), edges.end());
+    for (int k = 1; k < (int)edges.size(); ++k)
+      if (edges[k] == edges[k - 1])
+        report(name + " has a duplicate or non-manifold edge " +
+               std::to_string(edges[k].first) + "-" +
+               std::to_string(edges[k].second) + ".");
+
+    auto face_less = [](const Vector3i& a, const Vector3i& b) {
+      return std::lexicographical_compare(a.data(), a.data() + 3, b.data(),
+                                          b.data() + 3);
+    };
+    std::sort(sorted_faces.begin(), sorted_faces.end(), face_less);
+    for (int k = 1; k < (int)sorted_faces.size(); ++k)
+      if (sorted_faces[k] == sorted_faces[k - 1])
+        report(name + " has a duplicate face " +
+               std::to_string(sorted_faces[k](0)) + " " +
+               std::to_string(sorted_faces[k](1)) + " " +
+               std::to_string(sorted_faces[k](2)) + ".");
+  }
+
+  // strands need at least one edge of non-zero length and followers need a
+  // guide to be interpolated from
+  int num_guides = 0;
+  int first_follower = -1;
+  int hair_idx = -1;
+  for (rapidxml::xml_node<>* nd = node->first_node("hair"); nd;
+       nd = nd->next_sibling("hair")) {
+    ++hair_idx;
+    const int params = read_int(nd, "params", -1);
+    if (params == -1) continue;
+
+    const std::string name = "Hair " + std::to_string(hair_idx);
+    check_params(params, name);
+
+    std::vector<int> indices;
+    const int start = read_int(nd, "start", 0);
+    const int count = read_int(nd, "count", 0);
+    if (count > 0) {
+      for (int i = 0; i < count; ++i) indices.push_back(start + i);
+    } else {
+      for (rapidxml::xml_node<>* subnd = nd->first_node("p"); subnd;
+           subnd = subnd->next_sibling("p"))
+        indices.push_back(read_int(subnd, "i", -1));
+    }
+
+    if (read_int(nd, "follow", 0)) {
+      if (first_follower < 0) first_follower = hair_idx;
+    } else {
+      ++num_guides;
+    }
+
+    if (indices.size() < 2) {
+      report(name + " has fewer than two particles.");
+      continue;
+    }
+
+    bool in_range = true;
+    for (int pidx : indices) {
+      if (pidx < 0 || pidx >= num_particles) {
+        report(name + " refers to particle " + std::to_string(pidx) +
+               " which does not exist.");
+        in_range = false;
+      } else if (!remap.empty() && remap[pidx] < 0) {
+        report(name + " uses particle " + std::to_string(pidx) +
+               " which was removed by a cloth proxy.");
+      }
+    }
+    if (!in_range) continue;
+
+    for (int i = 1; i < (int)indices.size(); ++i) {
+      const Vector3s& x0 = particles[indices[i - 1]].x;
+      const Vector3s& x1 = particles[indices[i]].x;
+      if ((x1 - x0).squaredNorm() == 0.0)
+        report(name + " has a zero-length edge at particle " +
+               std::to_string(indices[i]) + ".");
+    }
+  }
+
+  if (first_follower >= 0 && num_guides == 0)
+    report("Hair " + std::to_string(first_follower) +
+           " follows a guide strand but the scene has none to attach it to.");
+
+  for (rapidxml::xml_node<>* nd = node->first_node("distancefield"); nd;
+       nd = nd->next_sibling("distancefield"))
+    if (read_int(nd, "group", 0) < 0)
+      report("A distance field is in a negative group.");
+
+  return num_problems;
+}
+
 void TwoDSceneXMLParser::loadHairPose(
     rapidxml::xml_node<>* node, const std::shared_ptr<TwoDScene>& twodscene) {
   for (rapidxml::xml_node<>* nd = node->first_node("pose"); nd;
@@ -1603,6 +2165,11 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
   int numedges = twodscene->getNumEdges();
   int numparticles = twodscene->getNumParticles();
 
+  // the strand forces are created once the guides are known
+  std::vector<std::vector<int> > strand_particles;
+  std::vector<int> strand_params;
+  std::vector<unsigned char> strand_follow;
+
   for (rapidxml::xml_node<>* nd = node->first_node("hair"); nd;
        nd = nd->next_sibling("hair")) {
     int paramsIndex = -1;
@@ -1629,6 +2196,19 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
     if (paramsIndex == -1) continue;
     auto& params = twodscene->getElasticParameters(paramsIndex);
 
+    int follow = 0;
+    if (nd->first_attribute("follow")) {
+      std::string attribute(nd->first_attribute("follow")->value());
+      if (!stringutils::extractFromString(attribute, follow)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of follow attribute for hair "
+                  << numstrands << ". Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
     int start = 0;
     if (nd->first_attribute("start")) {
       std::string attribute(nd->first_attribute("start")->value());
@@ -1655,6 +2235,12 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
       }
     }
 
+    // the particles of a strand stay contiguous as long as none was dropped
+    if (count > 0) {
+      for (int i = 0; i < count; ++i) remapParticle(start + i, "hair");
+      start = remapParticle(start, "hair");
+    }
+
     std::vector<int> particle_indices;
     std::vector<int> edge_indices;
     VecX particle_radius;
@@ -1680,7 +2266,7 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
                     << numstrands << ". No attribute id." << std::endl;
           exit(1);
         }
-        particle_indices.push_back(id);
+        particle_indices.push_back(remapParticle(id, "hair"));
       }
 
       count = (int)particle_indices.size();
@@ -1816,7 +2402,8 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
       }
     }
 
-    // instance new ElasticParameters
+    // instance new ElasticParameters, params may dangle after the insertion
+    const bool collect_twist_coupling = params->m_collectTwistCoupling;
     const int idx_sp = twodscene->getNumElasticParameters();
     twodscene->insertElasticParameters(std::make_shared<ElasticParameters>(
         particle_radius, params->m_youngsModulus.get(),
@@ -1829,20 +2416,16 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
         params->m_postProjectFixed, params->m_useApproxJacobian,
         params->m_useTournierJacobian, params->m_straightHairs,
         params->m_color));
+    twodscene->getElasticParameters(idx_sp)->m_collectTwistCoupling =
+        collect_twist_coupling;
 
     for (int eidx : edge_indices) {
       twodscene->setEdgeToParameter(eidx, idx_sp);
     }
 
-    
-    {
-      auto strand_force = std::make_shared<StrandForce>(
-          twodscene, particle_indices, idx_sp, numstrands);
-      twodscene->insertForce(strand_force);
-      //only for debugging
-      twodscene->insertStrandForce(strand_force);
-    }
-
+    strand_particles.push_back(particle_indices);
+    strand_params.push_back(idx_sp);
+    strand_follow.push_back((unsigned char)(follow != 0));
 
     VectorXi solve_group(particle_indices.size());
     for (int i = 0; i < (int)particle_indices.size(); ++i)
@@ -1852,6 +2435,55 @@ void TwoDSceneXMLParser::loadHairs(rapidxml::xml_node<>* node,
 
     ++numstrands;
   }
+
+  // without a selection in the file, cluster the strands and simulate the
+  // most spread out ones
+  const scalar guide_ratio = twodscene->getLiquidInfo().guide_strand_ratio;
+  const bool selected = std::any_of(strand_follow.begin(),
+                                    strand_follow.end(),
+                                    [](unsigned char f) { return f != 0; });
+  if (!selected && guide_ratio > 0.0 && guide_ratio < 1.0) {
+    std::vector<unsigned char> is_guide;
+    strandskinning::selectGuides(twodscene->getX(), strand_particles,
+                                 guide_ratio, is_guide);
+    for (int i = 0; i < numstrands; ++i) strand_follow[i] = !is_guide[i];
+  }
+
+  m_guide_strands.clear();
+  m_follower_strands.clear();
+
+  // strands may share vertices, so each force is built with the tip flags
+  // of its own strand and the flags of the last strand are left in place
+  auto set_tips = [&](const std::vector<int>& strand) {
+    for (int k = 0; k < (int)strand.size(); ++k)
+      twodscene->setTipVerts(strand[k], k == (int)strand.size() - 1);
+  };
+
+  for (int i = 0; i < numstrands; ++i) {
+    if (strand_follow[i]) {
+      m_follower_strands.push_back(strand_particles[i]);
+      continue;
+    }
+
+    m_guide_strands.push_back(strand_particles[i]);
+
+    set_tips(strand_particles[i]);
+    auto strand_force = std::make_shared<StrandForce>(
+        twodscene, strand_particles[i], strand_params[i], i);
+    twodscene->insertForce(strand_force);
+    //only for debugging
+    twodscene->insertStrandForce(strand_force);
+  }
+
+  for (int i = 0; i < numstrands; ++i) set_tips(strand_particles[i]);
+
+  if (!m_follower_strands.empty() && m_guide_strands.empty()) {
+    std::cerr << outputmod::startred
+              << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+              << " All hairs follow, at least one guide is needed. Exiting."
+              << std::endl;
+    exit(1);
+  }
 }
 
 void TwoDSceneXMLParser::loadLiquidInfo(
@@ -1910,6 +2542,32 @@ void TwoDSceneXMLParser::loadLiquidInfo(
   info.levelset_thickness = 0.25;
   info.iteration_print_step = 0;
   info.elasto_capture_rate = 1.0;
+  info.use_narrow_band = false;
+  info.narrow_band_width = 4.0;
+  info.use_spray_particles = false;
+  info.spray_neighbor_count = 8;
+  info.spray_drag_coeff = 0.47;
+  info.use_guarded_step = false;
+  info.max_step_retries = 4;
+  info.max_velocity_bound = 1e+4;
+  info.max_solver_residual = 1.0;
+  info.use_adaptive_dt = false;
+  info.velocity_percentile = 0.99;
+  info.target_solver_iterations = 100;
+  info.max_dt_growth = 1.25;
+  info.validate_fraction_kernels = false;
+  info.quasi_static_max_iterations = 200;
+  info.quasi_static_tolerance = 1e-6;
+  info.use_split_viscosity = false;
+  info.viscosity_split_iterations = 2;
+  info.guide_strand_ratio = 0.0;
+  info.follower_blend = 1.0;
+  info.use_twist_condensation = false;
+  info.use_grid_relaxation = false;
+  info.grid_relaxation_iterations = 8;
+  info.use_monolithic_pressure = false;
+  info.elasto_integrator = 0;
+  info.elastic_cfl_number = 0.5;
 
   rapidxml::xml_node<>* nd = node->first_node("liquidinfo");
   if (nd) {
@@ -2586,6 +3244,355 @@ void TwoDSceneXMLParser::loadLiquidInfo(
         exit(1);
       }
     }
+
+    if ((subnd = nd->first_node("useNarrowBand"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.use_narrow_band)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useNarrowBand attribute for "
+                     "LiquidInfo. Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("narrowBandWidth"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.narrow_band_width)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of narrowBandWidth attribute for "
+                     "LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useSprayParticles"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.use_spray_particles)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useSprayParticles attribute "
+                     "for LiquidInfo. Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("sprayNeighborCount"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.spray_neighbor_count)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of sprayNeighborCount attribute "
+                     "for LiquidInfo. Value must be integer. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("sprayDragCoeff"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.spray_drag_coeff)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of sprayDragCoeff attribute for "
+                     "LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useGuardedStep"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.use_guarded_step)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useGuardedStep attribute for "
+                     "LiquidInfo. Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("maxStepRetries"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.max_step_retries)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of maxStepRetries attribute for "
+                     "LiquidInfo. Value must be integer. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("maxVelocityBound"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.max_velocity_bound)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of maxVelocityBound attribute "
+                     "for LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("maxSolverResidual"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.max_solver_residual)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of maxSolverResidual attribute "
+                     "for LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useAdaptiveDt"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.use_adaptive_dt)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useAdaptiveDt attribute for "
+                     "LiquidInfo. Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("velocityPercentile"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.velocity_percentile)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of velocityPercentile attribute "
+                     "for LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("targetSolverIterations"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.target_solver_iterations)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of targetSolverIterations "
+                     "attribute for LiquidInfo. Value must be integer. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("maxDtGrowth"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.max_dt_growth)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of maxDtGrowth attribute for "
+                     "LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("validateFractionKernels"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.validate_fraction_kernels)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of validateFractionKernels "
+                     "attribute for LiquidInfo. Value must be boolean. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("quasiStaticMaxIterations"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.quasi_static_max_iterations)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of quasiStaticMaxIterations "
+                     "attribute for LiquidInfo. Value must be integer. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("quasiStaticTolerance"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.quasi_static_tolerance)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of quasiStaticTolerance "
+                     "attribute for LiquidInfo. Value must be numeric. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useSplitViscosity"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.use_split_viscosity)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useSplitViscosity "
+                     "attribute for LiquidInfo. Value must be boolean. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("viscositySplitIterations"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.viscosity_split_iterations)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of viscositySplitIterations "
+                     "attribute for LiquidInfo. Value must be integer. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+      info.viscosity_split_iterations =
+          std::max(1, info.viscosity_split_iterations);
+    }
+
+    if ((subnd = nd->first_node("guideStrandRatio"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.guide_strand_ratio)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of guideStrandRatio attribute "
+                     "for LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("followerBlend"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute, info.follower_blend)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of followerBlend attribute for "
+                     "LiquidInfo. Value must be numeric. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+      info.follower_blend = mathutils::clamp(info.follower_blend, 0.0, 1.0);
+    }
+
+    if ((subnd = nd->first_node("useTwistCondensation"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.use_twist_condensation)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useTwistCondensation "
+                     "attribute for LiquidInfo. Value must be boolean. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useGridRelaxation"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.use_grid_relaxation)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useGridRelaxation attribute "
+                     "for LiquidInfo. Value must be boolean. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("gridRelaxationIterations"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(
+              attribute, info.grid_relaxation_iterations)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of gridRelaxationIterations "
+                     "attribute for LiquidInfo. Value must be integer. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("useMonolithicPressure"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.use_monolithic_pressure)) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of useMonolithicPressure "
+                     "attribute for LiquidInfo. Value must be boolean. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("elastoIntegrator"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (attribute == "implicit") {
+        info.elasto_integrator = 0;
+      } else if (attribute == "explicit") {
+        info.elasto_integrator = 1;
+      } else if (attribute == "auto") {
+        info.elasto_integrator = 2;
+      } else {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of elastoIntegrator attribute "
+                     "for LiquidInfo. Value must be implicit, explicit or "
+                     "auto. Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
+
+    if ((subnd = nd->first_node("elasticCFLNumber"))) {
+      std::string attribute(subnd->first_attribute("value")->value());
+      if (!stringutils::extractFromString(attribute,
+                                          info.elastic_cfl_number) ||
+          info.elastic_cfl_number <= 0.0) {
+        std::cerr << outputmod::startred
+                  << "ERROR IN XMLSCENEPARSER:" << outputmod::endred
+                  << " Failed to parse value of elasticCFLNumber attribute "
+                     "for LiquidInfo. Value must be a positive scalar. "
+                     "Exiting."
+                  << std::endl;
+        exit(1);
+      }
+    }
   }
 
   twodscene->setLiquidInfo(info);
@@ -2917,13 +3924,16 @@ void TwoDSceneXMLParser::loadElasticParameters(
     rad_vec(0) = radius;
     rad_vec(1) = biradius;
 
-    twodscene->insertElasticParameters(std::make_shared<ElasticParameters>(
+    auto elastic_params = std::make_shared<ElasticParameters>(
         rad_vec, YoungsModulus, shearModulus, stretchingMultiplier,
         collisionMultiplier, attachMultiplier, density, viscosity, baseRotation,
         dt, friction_alpha, friction_beta, restVolumeFraction,
         accumulateWithViscous, accumulateViscousOnlyForBendingModes,
         postProjectFixed, useApproxJacobian, useTournierJacobian, straightHairs,
-        haircolor));
+        haircolor);
+    elastic_params->m_collectTwistCoupling =
+        twodscene->getLiquidInfo().use_twist_condensation;
+    twodscene->insertElasticParameters(elastic_params);
     ++paramsCount;
   }
 }
@@ -2931,22 +3941,53 @@ void TwoDSceneXMLParser::loadElasticParameters(
 void TwoDSceneXMLParser::loadParticles(
     rapidxml::xml_node<>* node, const std::shared_ptr<TwoDScene>& twodscene,
     int& maxgroup) {
-  // Count the number of particles
-  int old_num_particles = twodscene->getNumParticles();
-  int numparticles = 0;
-  for (rapidxml::xml_node<>* nd = node->first_node("particle"); nd;
-       nd = nd->next_sibling("particle"))
-    ++numparticles;
+  const std::vector<ParticleRecord>& records = m_compiled.particles;
+  const std::vector<int>& remap = m_compiled.particle_remap;
 
-  twodscene->resizeParticleSystem(numparticles);
+  int numparticles = (int)records.size();
+  if (!remap.empty())
+    numparticles = (int)std::count_if(remap.begin(), remap.end(),
+                                      [](int pidx) { return pidx >= 0; });
 
-  // std::cout << "Num particles " << numparticles << std::endl;
+  twodscene->resizeParticleSystem(numparticles);
 
   maxgroup = 0;
 
+  int particle = 0;
+  const int num_records = (int)records.size();
+  for (int file_particle = 0; file_particle < num_records; ++file_particle) {
+    if (!remap.empty() && remap[file_particle] < 0) continue;
+
+    const ParticleRecord& p = records[file_particle];
+    twodscene->setPosition(particle, p.x);
+    twodscene->setVelocity(particle, p.v);
+    twodscene->setTheta(particle, p.theta);
+    twodscene->setOmega(particle, p.omega);
+    twodscene->setFixed(particle, p.fixed);
+    twodscene->setTwist(particle, false);
+    twodscene->setRadius(particle, p.radius, p.biradius);
+    twodscene->setVolume(particle, p.vol);
+    twodscene->setFluidVolume(particle, p.fvol);
+    twodscene->setGroup(particle, p.group);
+    twodscene->setMass(particle, p.m, 0.0);
+    twodscene->setFluidMass(particle, p.fm, 0.0);
+    if (p.liquid) twodscene->getFluidIndices().push_back(particle);
+    twodscene->setVolumeFraction(particle, p.vf);
+
+    maxgroup = std::max(maxgroup, p.group);
+
+    ++particle;
+  }
+}
+
+void TwoDSceneXMLParser::compileParticles(rapidxml::xml_node<>* node) {
+  std::vector<ParticleRecord>& records = m_compiled.particles;
+
   int particle = 0;
   for (rapidxml::xml_node<>* nd = node->first_node("particle"); nd;
-       nd = nd->next_sibling("particle")) {
+       nd = nd->next_sibling("particle"), ++particle) {
+    ParticleRecord p;
+
     // Extract the particle's initial position
     Vector3s pos = Vector3s::Zero();
     if (nd->first_attribute("x")) {
@@ -2962,7 +4003,8 @@ void TwoDSceneXMLParser::loadParticles(
           << particle << std::endl;
       exit(1);
     }
-    twodscene->setPosition(particle, pos);
+
+    p.x = pos;
 
     // Extract the particle's initial velocity
     Vector3s vel = Vector3s::Zero();
@@ -2975,7 +4017,7 @@ void TwoDSceneXMLParser::loadParticles(
       }
     }
 
-    twodscene->setVelocity(particle, vel);
+    p.v = vel;
 
     // parse theta
     scalar theta = 0.0;
@@ -2990,7 +4032,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setTheta(particle, theta);
+    p.theta = theta;
 
     scalar omega = 0.0;
     if (nd->first_attribute("omega")) {
@@ -3004,7 +4046,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setOmega(particle, omega);
+    p.omega = omega;
 
     // Determine if the particle is fixed
     int fixed = 0;
@@ -3019,8 +4061,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setFixed(particle, (unsigned char)(fixed & 0xFFU));
-    twodscene->setTwist(particle, false);
+    p.fixed = (unsigned char)(fixed & 0xFFU);
 
     // Extract the particle's radius, if present
     scalar radius = 0.0;
@@ -3048,7 +4089,8 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setRadius(particle, radius, biradius);
+    p.radius = radius;
+    p.biradius = biradius;
 
     scalar vol = 0.0;
     if (nd->first_attribute("vol")) {
@@ -3061,7 +4103,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setVolume(particle, vol);
+    p.vol = vol;
 
     scalar fvol = 0.0;
     if (nd->first_attribute("fvol")) {
@@ -3074,7 +4116,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setFluidVolume(particle, fvol);
+    p.fvol = fvol;
 
     int group = 0;
     if (nd->first_attribute("group")) {
@@ -3088,7 +4130,7 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setGroup(particle, group);
+    p.group = group;
 
     // Extract the particle's mass
     scalar mass = 0.0;
@@ -3104,7 +4146,7 @@ void TwoDSceneXMLParser::loadParticles(
       }
     }
 
-    twodscene->setMass(particle, mass, 0.0);
+    p.m = mass;
 
     scalar fmass = 0.0;
     if (nd->first_attribute("fm")) {
@@ -3119,13 +4161,12 @@ void TwoDSceneXMLParser::loadParticles(
       }
     }
 
-    twodscene->setFluidMass(particle, fmass, 0.0);
+    p.fm = fmass;
 
+    p.liquid = 0U;
     if (nd->first_attribute("state")) {
       std::string attribute(nd->first_attribute("state")->value());
-      if (attribute == "liquid") {
-        twodscene->getFluidIndices().push_back(particle);
-      }
+      if (attribute == "liquid") p.liquid = 1U;
     }
 
     scalar vf = 1.0;
@@ -3140,15 +4181,9 @@ void TwoDSceneXMLParser::loadParticles(
         exit(1);
       }
     }
-    twodscene->setVolumeFraction(particle, vf);
-
-    // std::cout << "Particle: " << particle << "    x: " << pos.transpose() <<
-    // "   v: " << vel.transpose() << "   m: " << mass << "   fixed: " << fixed
-    // << std::endl; std::cout << tags[particle] << std::endl;
+    p.vf = vf;
 
-    maxgroup = std::max(maxgroup, group);
-
-    ++particle;
+    records.push_back(p);
   }
 }
 
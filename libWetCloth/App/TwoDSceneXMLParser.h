@@ -15,9 +15,12 @@
 #include <fstream>
 #include <iostream>
 #include <limits>
+#include <unordered_map>
+#include <vector>
 
 #include "Camera.h"
 #include "CohesionForce.h"
+#include "CompiledScene.h"
 #include "DER/StrandForce.h"
 #include "ElasticParameters.h"
 #include "DistanceFields.h"
@@ -54,7 +57,16 @@ class TwoDSceneXMLParser {
                                 scalar& steps_per_sec_cap,
                                 renderingutils::Color& bgcolor,
                                 std::string& description, std::string& scenetag,
-                                bool& cam_inited, const std::string& input_bin);
+                                bool& cam_inited, const std::string& input_bin,
+                                const std::string& compiled_file);
+
+  /*!
+   * Parses and validates the particles, clothes and strands of the scene
+   * and writes them to out_file together with the cloth proxies derived from
+   * them, for loadExecutableSimulation to pick up instead of the xml nodes.
+   * Returns false if the scene is invalid, in which case nothing is written.
+   */
+  bool compileScene(const std::string& file_name, const std::string& out_file);
 
   // TODO: NEED AN EIGEN_ALIGNED_THING_HERE ?
  private:
@@ -84,6 +96,27 @@ class TwoDSceneXMLParser {
   void loadClothes(rapidxml::xml_node<>* node,
                    const std::shared_ptr<TwoDScene>& twodscene);
 
+  void loadClothProxies(rapidxml::xml_node<>* node,
+                        const std::shared_ptr<TwoDScene>& twodscene);
+
+  void loadClothFaces(rapidxml::xml_node<>* node, int cloth_idx,
+                      std::vector<Vector3i>& faces);
+
+  // fill m_compiled from the <particle> and <cloth> nodes; stops before the
+  // proxies and returns the number of problems if validation fails
+  int compileSceneNodes(rapidxml::xml_node<>* node, bool validate);
+
+  void compileParticles(rapidxml::xml_node<>* node);
+
+  void compileClothFaces(rapidxml::xml_node<>* node);
+
+  void compileClothProxies(rapidxml::xml_node<>* node);
+
+  // number of problems found in the compiled scene and the xml around it
+  int validateScene(rapidxml::xml_node<>* node);
+
+  int remapParticle(int pidx, const char* user) const;
+
   void loadSpringForces(rapidxml::xml_node<>* node,
                         const std::shared_ptr<TwoDScene>& twodscene);
 
@@ -100,6 +133,9 @@ class TwoDSceneXMLParser {
                           const std::shared_ptr<TwoDScene>& twodscene,
                           int& maxgroup);
 
+  void loadColliderMaterials(rapidxml::xml_node<>* node,
+                             const std::shared_ptr<TwoDScene>& twodscene);
+
   void loadElasticParameters(rapidxml::xml_node<>* node,
                             const std::shared_ptr<TwoDScene>& twodscene,
                             const scalar& dt);
@@ -126,6 +162,15 @@ class TwoDSceneXMLParser {
 
   void loadSceneDescriptionString(rapidxml::xml_node<>* node,
                                   std::string& description_string);
+
+  // particles, cloth faces and proxies, parsed or read from a compiled scene
+  CompiledScene m_compiled;
+  bool m_compiled_loaded = false;
+  uint64_t m_xml_checksum = 0;
+
+  // particles of the simulated and the interpolated strands
+  std::vector<std::vector<int> > m_guide_strands;
+  std::vector<std::vector<int> > m_follower_strands;
 };
 
 #endif
@@ -360,4 +360,40 @@ bool AMGPCGSolveSparse(const SparseMatrix<T> &matrix, const std::vector<T> &rhs,
   return false;
 }
 
+// keeps the multigrid hierarchy of a matrix between V-cycles, for solvers
+// that use it as a preconditioner for one block of a larger system
+template <class T>
+class AMGPreconditioner {
+ public:
+  void build(const SparseMatrix<T> &matrix, vector<Vector3i> &Dof_ijk, int ni,
+             int nj, int nk) {
+    std::shared_ptr<FixedSparseMatrix<T>> fixed_matrix =
+        std::make_shared<FixedSparseMatrix<T>>();
+    fixed_matrix->construct_from_matrix(matrix);
+    levelGen<T> amg_levelGen;
+    amg_levelGen.generateLevelsGalerkinCoarseningSparse(
+        A_L, R_L, P_L, p_L, total_level, fixed_matrix, Dof_ijk, ni, nj, nk);
+  }
+
+  // one V-cycle on the residual b
+  void apply(const vector<T> &b, vector<T> &x) {
+    amgPrecondCompressed(A_L, R_L, P_L, p_L, x, b);
+  }
+
+  void clear() {
+    A_L.clear();
+    R_L.clear();
+    P_L.clear();
+    p_L.clear();
+    total_level = 0;
+  }
+
+ private:
+  vector<std::shared_ptr<FixedSparseMatrix<T>>> A_L;
+  vector<FixedSparseMatrix<T>> R_L;
+  vector<FixedSparseMatrix<T>> P_L;
+  vector<vector<bool>> p_L;
+  int total_level = 0;
+};
+
 #endif
@@ -0,0 +1,285 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "ClothEmbedding.h"
+
+#include <igl/connect_boundary_to_infinity.h>
+#include <igl/decimate.h>
+#include <igl/is_edge_manifold.h>
+#include <igl/max_faces_stopping_condition.h>
+#include <igl/per_vertex_normals.h>
+#include <igl/point_simplex_squared_distance.h>
+#include <igl/remove_unreferenced.h>
+#include <igl/shortest_edge_and_midpoint.h>
+#include <igl/slice.h>
+#include <igl/slice_mask.h>
+
+#include <algorithm>
+#include <limits>
+#include <set>
+
+#include "MathUtilities.h"
+#include "ThreadUtils.h"
+
+namespace clothembedding {
+typedef std::set<std::pair<double, int> > CollapseQueue;
+
+bool decimate(const MatrixXs& V, const MatrixXi& F,
+              const std::vector<unsigned char>& locked, int target_faces,
+              MatrixXs& U, MatrixXi& G, VectorXi& birth) {
+  const int num_verts = V.rows();
+  const int orig_m = F.rows();
+  int m = orig_m;
+
+  // as igl::decimate does for open meshes: close the boundary with a vertex
+  // at infinity, whose edges are never collapsed
+  MatrixXs VO;
+  MatrixXi FO;
+  igl::connect_boundary_to_infinity(V, F, VO, FO);
+  if (!igl::is_edge_manifold(FO)) return false;
+
+  auto keep_locked =
+      [&](const MatrixXs&, const MatrixXi&, const MatrixXi& E,
+          const VectorXi&, const MatrixXi&, const MatrixXi&,
+          const CollapseQueue&, const std::vector<CollapseQueue::iterator>&,
+          const MatrixXs&, const int e) -> bool {
+    for (int r = 0; r < 2; ++r) {
+      const int v = E(e, r);
+      if (v < num_verts && locked[v]) return false;
+    }
+    return true;
+  };
+
+  auto ignore = [](const MatrixXs&, const MatrixXi&, const MatrixXi&,
+                   const VectorXi&, const MatrixXi&, const MatrixXi&,
+                   const CollapseQueue&,
+                   const std::vector<CollapseQueue::iterator>&,
+                   const MatrixXs&, const int, const int, const int,
+                   const int, const int, const bool) {};
+
+  MatrixXs UO;
+  MatrixXi GO;
+  VectorXi J, I;
+  igl::decimate(VO, FO, igl::shortest_edge_and_midpoint,
+                igl::max_faces_stopping_condition(m, orig_m, target_faces),
+                keep_locked, ignore, UO, GO, J, I);
+
+  // drop the faces to infinity and the vertex along with them
+  const Eigen::Array<bool, Eigen::Dynamic, 1> keep = (J.array() < orig_m);
+  igl::slice_mask(MatrixXi(GO), keep, 1, GO);
+
+  VectorXi unused, new_to_old;
+  igl::remove_unreferenced(UO, GO, U, G, unused, new_to_old);
+  igl::slice(I, new_to_old, 1, birth);
+
+  return true;
+}
+
+/*!
+ * the triangles of (U, G) closest to the rows of V, searched ring by ring in
+ * a uniform grid of the triangles
+ */
+static void closestFaces(const MatrixXs& V, const MatrixXs& U,
+                         const MatrixXi& G, VectorXi& closest_face) {
+  const int num_verts = V.rows();
+  const int num_faces = G.rows();
+
+  const Vector3s bbx_min = U.colwise().minCoeff().transpose();
+  const Vector3s bbx_max = U.colwise().maxCoeff().transpose();
+
+  scalar h = 0.0;
+  for (int i = 0; i < num_faces; ++i)
+    h += (U.row(G(i, 1)) - U.row(G(i, 0))).norm();
+  h = std::max(1e-12, h / (scalar)std::max(1, num_faces));
+
+  Vector3i dims;
+  while (true) {
+    for (int r = 0; r < 3; ++r)
+      dims(r) = (int)floor((bbx_max(r) - bbx_min(r)) / h) + 1;
+    if ((scalar)dims(0) * dims(1) * dims(2) <= 8.0 * num_faces + 64.0) break;
+    h *= 2.0;
+  }
+
+  auto cell_of = [&](const Vector3s& p) -> Vector3i {
+    Vector3i c;
+    for (int r = 0; r < 3; ++r)
+      c(r) = mathutils::clamp((int)floor((p(r) - bbx_min(r)) / h), 0,
+                              dims(r) - 1);
+    return c;
+  };
+
+  std::vector<std::vector<int> > cells(dims(0) * dims(1) * dims(2));
+  for (int i = 0; i < num_faces; ++i) {
+    Vector3s fmin = U.row(G(i, 0)).transpose();
+    Vector3s fmax = fmin;
+    for (int r = 1; r < 3; ++r) {
+      fmin = fmin.cwiseMin(U.row(G(i, r)).transpose());
+      fmax = fmax.cwiseMax(U.row(G(i, r)).transpose());
+    }
+    const Vector3i cmin = cell_of(fmin);
+    const Vector3i cmax = cell_of(fmax);
+    for (int k = cmin(2); k <= cmax(2); ++k)
+      for (int j = cmin(1); j <= cmax(1); ++j)
+        for (int l = cmin(0); l <= cmax(0); ++l)
+          cells[(k * dims(1) + j) * dims(0) + l].push_back(i);
+  }
+
+  const int max_ring = dims.maxCoeff();
+
+  closest_face.resize(num_verts);
+
+  threadutils::for_each(0, num_verts, [&](int i) {
+    const Vector3s p = V.row(i).transpose();
+    const Vector3i c = cell_of(p);
+
+    // the query may lie outside of the grid, the rings are counted from the
+    // clamped cell
+    const Vector3s c_min = bbx_min + c.cast<scalar>() * h;
+    const scalar outside =
+        (c_min - p).cwiseMax(p - c_min - Vector3s::Constant(h))
+            .cwiseMax(0.0)
+            .norm();
+
+    scalar best = std::numeric_limits<scalar>::infinity();
+    int best_face = 0;
+
+    for (int ring = 0; ring <= max_ring; ++ring) {
+      for (int k = c(2) - ring; k <= c(2) + ring; ++k) {
+        if (k < 0 || k >= dims(2)) continue;
+        for (int j = c(1) - ring; j <= c(1) + ring; ++j) {
+          if (j < 0 || j >= dims(1)) continue;
+          for (int l = c(0) - ring; l <= c(0) + ring; ++l) {
+            if (l < 0 || l >= dims(0)) continue;
+            if (std::max(std::abs(k - c(2)),
+                         std::max(std::abs(j - c(1)), std::abs(l - c(0)))) !=
+                ring)
+              continue;
+
+            for (int f : cells[(k * dims(1) + j) * dims(0) + l]) {
+              scalar dist2;
+              Vector3s cp;
+              igl::point_simplex_squared_distance<3>(p, U, G, f, dist2, cp);
+              if (dist2 < best) {
+                best = dist2;
+                best_face = f;
+              }
+            }
+          }
+        }
+      }
+
+      // the unvisited cells are at least ring * h away along some axis
+      const scalar reach = (scalar)ring * h;
+      if (best <= outside * outside + reach * reach) break;
+    }
+
+    closest_face(i) = best_face;
+  });
+}
+
+void embed(const MatrixXs& V, const MatrixXi& F, const MatrixXs& U,
+           const MatrixXi& G, EmbeddedClothMesh& mesh) {
+  const int num_verts = V.rows();
+
+  VectorXi closest_face;
+  closestFaces(V, U, G, closest_face);
+
+  MatrixXs proxy_normals;
+  igl::per_vertex_normals(U, G, igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA,
+                          proxy_normals);
+
+  mesh.proxy_faces = G;
+  mesh.faces = F;
+  mesh.parents.resize(num_verts, 3);
+  mesh.weights.resize(num_verts, 3);
+  mesh.offsets.resize(num_verts);
+
+  threadutils::for_each(0, num_verts, [&](int i) {
+    const Vector3i f = G.row(closest_face(i)).transpose();
+    const Vector3s a = U.row(f(0)).transpose();
+    const Vector3s e0 = U.row(f(1)).transpose() - a;
+    const Vector3s e1 = U.row(f(2)).transpose() - a;
+    const Vector3s ep = V.row(i).transpose() - a;
+
+    // coordinates of the projection onto the plane of the triangle, which
+    // leave the triangle where the decimation pulled the boundary in
+    const scalar d00 = e0.dot(e0);
+    const scalar d01 = e0.dot(e1);
+    const scalar d11 = e1.dot(e1);
+    const scalar denom = d00 * d11 - d01 * d01;
+
+    Vector3s w(1.0, 0.0, 0.0);
+    if (denom > 1e-20 * d00 * d11) {
+      w(1) = (d11 * e0.dot(ep) - d01 * e1.dot(ep)) / denom;
+      w(2) = (d00 * e1.dot(ep) - d01 * e0.dot(ep)) / denom;
+      w(0) = 1.0 - w(1) - w(2);
+    }
+    const Vector3s p = a + e0 * w(1) + e1 * w(2);
+
+    Vector3s n = Vector3s::Zero();
+    for (int r = 0; r < 3; ++r)
+      n += proxy_normals.row(f(r)).transpose() * w(r);
+
+    const scalar len = n.norm();
+    if (len > 1e-63) n /= len;
+
+    mesh.parents.row(i) = f.transpose();
+    mesh.weights.row(i) = w.transpose();
+    mesh.offsets(i) = (V.row(i).transpose() - p).dot(n);
+  });
+}
+
+void reconstruct(const EmbeddedClothMesh& mesh, const VectorXs& x,
+                 const VectorXs& fluid_vol, const VectorXs& vol,
+                 MatrixXs& positions, MatrixXs& normals,
+                 VectorXs& saturation) {
+  const int num_proxy = mesh.proxy_particles.size();
+  const int num_verts = mesh.parents.rows();
+
+  MatrixXs proxy_pos(num_proxy, 3);
+  VectorXs proxy_sat(num_proxy);
+  threadutils::for_each(0, num_proxy, [&](int i) {
+    const int pidx = mesh.proxy_particles(i);
+    proxy_pos.row(i) = x.segment<3>(pidx * 4).transpose();
+    proxy_sat(i) = fluid_vol(pidx) / std::max(1e-16, vol(pidx));
+  });
+
+  MatrixXs proxy_normals;
+  igl::per_vertex_normals(proxy_pos, mesh.proxy_faces,
+                          igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA,
+                          proxy_normals);
+
+  positions.resize(num_verts, 3);
+  saturation.resize(num_verts);
+
+  threadutils::for_each(0, num_verts, [&](int i) {
+    Vector3s p = Vector3s::Zero();
+    Vector3s n = Vector3s::Zero();
+    scalar sat = 0.0;
+    for (int r = 0; r < 3; ++r) {
+      const int k = mesh.parents(i, r);
+      const scalar w = mesh.weights(i, r);
+      p += proxy_pos.row(k).transpose() * w;
+      n += proxy_normals.row(k).transpose() * w;
+      sat += proxy_sat(k) * w;
+    }
+
+    const scalar len = n.norm();
+    if (len > 1e-63) p += n * (mesh.offsets(i) / len);
+
+    positions.row(i) = p.transpose();
+    saturation(i) = mathutils::clamp(sat, 0.0, 1.0);
+  });
+
+  igl::per_vertex_normals(positions, mesh.faces,
+                          igl::PER_VERTEX_NORMALS_WEIGHTING_TYPE_AREA,
+                          normals);
+}
+};  // namespace clothembedding
@@ -0,0 +1,59 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef CLOTH_EMBEDDING_H
+#define CLOTH_EMBEDDING_H
+
+#include <vector>
+
+#include "MathDefs.h"
+
+/*!
+ * A high-resolution cloth mesh driven by a decimated proxy that is simulated
+ * in its place. Every vertex follows a point on a proxy triangle, offset
+ * along the interpolated proxy normal.
+ */
+struct EmbeddedClothMesh {
+  VectorXi proxy_particles;  // scene particles of the proxy vertices
+  MatrixXi proxy_faces;      // into proxy_particles
+  MatrixXi faces;            // high-resolution faces
+  MatrixXi parents;          // proxy vertices each vertex is bound to
+  MatrixXs weights;          // barycentric weights of the parents
+  VectorXs offsets;          // distance along the interpolated normal
+};
+
+namespace clothembedding {
+/*!
+ * Decimates (V, F) by shortest-edge collapses until target_faces are left,
+ * never collapsing an edge with a locked end so that these vertices stay
+ * where they are. birth maps each vertex of U to the vertex of V it came
+ * from. Returns false if the mesh is not edge-manifold.
+ */
+bool decimate(const MatrixXs& V, const MatrixXi& F,
+              const std::vector<unsigned char>& locked, int target_faces,
+              MatrixXs& U, MatrixXi& G, VectorXi& birth);
+
+/*!
+ * Binds the vertices of (V, F) to their closest points on the proxy (U, G).
+ * proxy_particles is left for the caller.
+ */
+void embed(const MatrixXs& V, const MatrixXi& F, const MatrixXs& U,
+           const MatrixXi& G, EmbeddedClothMesh& mesh);
+
+/*!
+ * Positions, normals and saturation of the high-resolution mesh from the
+ * current state of the proxy particles.
+ */
+void reconstruct(const EmbeddedClothMesh& mesh, const VectorXs& x,
+                 const VectorXs& fluid_vol, const VectorXs& vol,
+                 MatrixXs& positions, MatrixXs& normals, VectorXs& saturation);
+};  // namespace clothembedding
+
+#endif
@@ -0,0 +1,63 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef COLLIDER_MATERIAL_H
+#define COLLIDER_MATERIAL_H
+
+#include <algorithm>
+#include <vector>
+
+#include "MathDefs.h"
+
+/*!
+ * Contact behaviour of the soft bodies against a collider, tabulated over
+ * the saturation of the touching vertex: the Coulomb friction coefficient
+ * and the adhesive stress (dyn/cm^2) pulling the vertex onto the collider.
+ * Samples are sorted by saturation; the curves are piecewise linear and
+ * held constant outside the sampled range.
+ */
+struct ColliderMaterial {
+  std::vector<scalar> saturation;
+  std::vector<scalar> friction;
+  std::vector<scalar> adhesion;
+
+  void insertSample(scalar s, scalar mu, scalar stress) {
+    const auto pos = std::upper_bound(saturation.begin(), saturation.end(), s);
+    const auto i = pos - saturation.begin();
+    saturation.insert(pos, s);
+    friction.insert(friction.begin() + i, mu);
+    adhesion.insert(adhesion.begin() + i, stress);
+  }
+
+  void evaluate(scalar s, scalar& mu, scalar& stress) const {
+    const int n = (int)saturation.size();
+    if (n == 0) {
+      mu = stress = 0.0;
+      return;
+    }
+
+    const int i =
+        (int)(std::upper_bound(saturation.begin(), saturation.end(), s) -
+              saturation.begin());
+    if (i == 0 || i == n) {
+      const int j = i == 0 ? 0 : n - 1;
+      mu = friction[j];
+      stress = adhesion[j];
+      return;
+    }
+
+    const scalar ds = saturation[i] - saturation[i - 1];
+    const scalar t = ds > 0.0 ? (s - saturation[i - 1]) / ds : 1.0;
+    mu = friction[i - 1] + (friction[i] - friction[i - 1]) * t;
+    stress = adhesion[i - 1] + (adhesion[i] - adhesion[i - 1]) * t;
+  }
+};
+
+#endif
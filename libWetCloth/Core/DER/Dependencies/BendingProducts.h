@@ -54,7 +54,7 @@ class BendingProducts : public DependencyNode<Mat11Array> {
     const MatX& bendingMatrix = m_bendingMatrixBase.get();
     const GradKArrayType& gradKappas = m_gradKappas.get();
 
-    for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+    for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
       symBProduct<11>(m_value[vtx], bendingMatrix.block<2, 2>(vtx * 2, 0),
                       gradKappas[vtx].block<11, 2>(0, 0));
       symBProductAdd<11>(m_value[vtx], bendingMatrix.block<2, 2>(vtx * 2, 0),
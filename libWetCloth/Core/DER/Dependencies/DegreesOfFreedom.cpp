@@ -16,7 +16,7 @@ void Edges::compute() {
   for (IndexType vtx = 0; vtx < m_firstValidIndex; ++vtx) {
     m_value[vtx].setZero();
   }
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     m_value[vtx] = dofs.segment<3>(4 * (vtx + 1)) - dofs.segment<3>(4 * vtx);
   }
 
@@ -29,7 +29,7 @@ void Lengths::compute() {
   for (IndexType vtx = 0; vtx < m_firstValidIndex; ++vtx) {
     m_value[vtx] = 0.0;
   }
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     m_value[vtx] = edges[vtx].norm();
     // assert( !isSmall(m_value[vtx]) ); // Commented-out assert, as it be may
     // thrown while we're checking stuff
@@ -45,7 +45,7 @@ void Tangents::compute() {
   for (IndexType vtx = 0; vtx < m_firstValidIndex; ++vtx) {
     m_value[vtx].setZero();
   }
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     m_value[vtx] = edges[vtx] / lengths[vtx];
   }
 
@@ -60,7 +60,7 @@ void CurvatureBinormals::compute() {
 
   const Vec3Array& tangents = m_tangents.get();
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec3& t1 = tangents[vtx - 1];
     const Vec3& t2 = tangents[vtx];
 
@@ -30,6 +30,24 @@ class DOFs : public DependencyNode<VecX> {
 
   VecX& get() { return m_value; }
 
+  // Only the vertices whose DOFs changed are dirtied downstream
+  virtual void set(const VecX& dofValues) {
+    if (dofValues.size() != m_value.size()) {
+      DependencyNode<VecX>::set(dofValues);
+      return;
+    }
+
+    IndexType first = 0;
+    IndexType last = dofValues.size();
+    while (first < last && dofValues[first] == m_value[first]) ++first;
+    while (last > first && dofValues[last - 1] == m_value[last - 1]) --last;
+    if (first == last) return;
+
+    m_value.segment(first, last - first) =
+        dofValues.segment(first, last - first);
+    setDependentsDirty(first / 4, (last - 1) / 4 + 1);
+  }
+
   Vec3 getVertex(IndexType vtx) const {
     assert(vtx < (m_numEdges + 1));
 
@@ -38,12 +56,12 @@ class DOFs : public DependencyNode<VecX> {
 
   void setVertex(IndexType vtx, const Vec3& point) {
     m_value.segment<3>(4 * vtx) = point;
-    setDependentsDirty();
+    setDependentsDirty(vtx, vtx + 1);
   }
 
   void setDof(IndexType i, const scalar& val) {
     m_value[i] = val;
-    setDependentsDirty();
+    setDependentsDirty(i / 4, i / 4 + 1);
   }
 
   // Accessors to the theta degrees of freedom
@@ -66,12 +84,12 @@ class DOFs : public DependencyNode<VecX> {
         m_value.data() + 4 * numberOfFixedThetas + 3,
         m_numEdges - numberOfFixedThetas) =
         thetas.tail(m_numEdges - numberOfFixedThetas);
-    setDependentsDirty();
+    setDependentsDirty(numberOfFixedThetas, m_numEdges);
   }
 
   void setTheta(IndexType vtx, scalar theta) {
     m_value[4 * vtx + 3] = theta;
-    setDependentsDirty();
+    setDependentsDirty(vtx, vtx + 1);
   }
 
   IndexType getNumEdges() const { return m_numEdges; }
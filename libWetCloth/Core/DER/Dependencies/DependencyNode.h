@@ -10,6 +10,8 @@
 #ifndef DEPENDENCYNODE_H
 #define DEPENDENCYNODE_H
 
+#include <algorithm>
+#include <limits>
 #include <list>
 
 #include "../Definitions.h"
@@ -21,36 +23,70 @@
  *
  * DependencyNodes are non-copyable by design, as the dependency relationship
  * is established in the constructor.
+ *
+ * Dirtiness is tracked over a range [dirtyBegin, dirtyEnd) of element indices
+ * (vertices and edges share the index of their first vertex). Dependents are
+ * dirtied over the same range widened by one element on each side, the
+ * stencil of the discrete rod operators, so that nodes computing element-wise
+ * may only update the elements in their dirty range.
  */
 class DependencyBase {
  public:
   DependencyBase(const DependencyBase&) = delete;
   DependencyBase& operator=(const DependencyBase&) = delete;
 
-  DependencyBase() : m_dirty(true) {}
+  DependencyBase()
+      : m_dirty(true), m_dirtyBegin(0), m_dirtyEnd(allIndices()) {}
 
   virtual ~DependencyBase() {}
 
+  static IndexType allIndices() {
+    return std::numeric_limits<IndexType>::max();
+  }
+
   bool isDirty() const { return m_dirty; }
 
-  void setDirty() {
-    if (!m_dirty) {
+  IndexType dirtyBegin() const { return m_dirtyBegin; }
+
+  IndexType dirtyEnd() const { return m_dirtyEnd; }
+
+  void setDirty() { setDirty(0, allIndices()); }
+
+  void setDirty(IndexType begin, IndexType end) {
+    if (m_dirty) {
+      if (begin >= m_dirtyBegin && end <= m_dirtyEnd) return;
+      begin = std::min(begin, m_dirtyBegin);
+      end = std::max(end, m_dirtyEnd);
+    }
 #ifdef VERBOSE_DEPENDENCY_NODE
-      std::cout << "Dirtying " << name() << ' ' << this << '\n';
+    std::cout << "Dirtying " << name() << ' ' << this << " [" << begin << ", "
+              << end << ")\n";
 #endif
-      m_dirty = true;
-      // Unlike Maya, we also dirty transitively
-      setDependentsDirty();
-    }
-    // NB if this was dirty, we can assume that it's dependents were dirty also
-    // because this method and the constructor are the only places where m_dirty
-    // can be set to true; in both cases the dependents are also dirtied. So no
-    // need to call setDependentsDirty() if we are already dirty here.
+    m_dirty = true;
+    m_dirtyBegin = begin;
+    m_dirtyEnd = end;
+    // Unlike Maya, we also dirty transitively
+    setDependentsDirty(begin, end);
+    // NB if this was dirty over a range containing [begin, end), we can assume
+    // that it's dependents were dirty over it also because this method and the
+    // constructor are the only places where m_dirty can be set to true; in
+    // both cases the dependents are also dirtied.
   }
 
+  // Called from compute(), this passes on the range being recomputed.
+  // Otherwise the whole value has been replaced.
   void setDependentsDirty() {
+    if (m_dirty)
+      setDependentsDirty(m_dirtyBegin, m_dirtyEnd);
+    else
+      setDependentsDirty(0, allIndices());
+  }
+
+  void setDependentsDirty(IndexType begin, IndexType end) {
+    const IndexType haloBegin = begin > 0 ? begin - 1 : 0;
+    const IndexType haloEnd = end < allIndices() ? end + 1 : end;
     for (auto dep = m_dependents.begin(); dep != m_dependents.end(); ++dep) {
-      (*dep)->setDirty();
+      (*dep)->setDirty(haloBegin, haloEnd);
     }
   }
 
@@ -59,6 +95,7 @@ class DependencyBase {
     std::cout << "Setting clean " << name() << ' ' << this << '\n';
 #endif
     m_dirty = false;
+    m_dirtyBegin = m_dirtyEnd = 0;
   }
 
   virtual const char* name() const = 0;
@@ -72,13 +109,19 @@ class DependencyBase {
   }
 
  protected:
-  void setDirtyWithoutPropagating() { m_dirty = true; }
+  void setDirtyWithoutPropagating() {
+    m_dirty = true;
+    m_dirtyBegin = 0;
+    m_dirtyEnd = allIndices();
+  }
 
   virtual void compute() = 0;
   std::list<DependencyBase*> m_dependents;
 
  private:
   bool m_dirty;
+  IndexType m_dirtyBegin;
+  IndexType m_dirtyEnd;
 };
 
 /**
@@ -110,7 +153,7 @@ class DependencyNode : public DependencyBase {
   }
 
   virtual void set(const ValueT& value) {
-    setDependentsDirty();
+    setDependentsDirty(0, allIndices());
     m_value = value;
   }
 
@@ -153,6 +196,8 @@ class DependencyNode<std::vector<ElemValueT, AllocatorT> >
 
   const ValueT& get() {
     if (isDirty() || m_value.size() != m_size) {
+      // nothing is kept from a cleared value
+      if (m_value.size() != m_size) setDirtyWithoutPropagating();
       compute();
 #ifdef VERBOSE_DEPENDENCY_NODE
       std::cout << "Computed " << name() << '\n';
@@ -166,7 +211,7 @@ class DependencyNode<std::vector<ElemValueT, AllocatorT> >
   const ElemValueT& operator[](IndexType i) { return get()[i]; }
 
   void set(const ValueT& value) {
-    setDependentsDirty();
+    setDependentsDirty(0, allIndices());
     m_value = value;
   }
 
@@ -175,7 +220,7 @@ class DependencyNode<std::vector<ElemValueT, AllocatorT> >
   const ValueT& getDirty() { return m_value; }
 
   virtual void set(IndexType i, const ElemValueT& elemVal) {
-    setDependentsDirty();
+    setDependentsDirty(i, i + 1);
     m_value.resize(m_size);
     m_value[i] = elemVal;
   }
@@ -203,6 +248,18 @@ class DependencyNode<std::vector<ElemValueT, AllocatorT> >
 
   IndexType getFirstValidIndex() { return m_firstValidIndex; }
 
+  /**
+   * @brief Elements [computeBegin(), computeEnd()) are the ones compute() has
+   * to update, the others still hold the value of the previous compute()
+   */
+  IndexType computeBegin() const {
+    return std::max(m_firstValidIndex, dirtyBegin());
+  }
+
+  IndexType computeEnd() const {
+    return std::min((IndexType)m_size, dirtyEnd());
+  }
+
   virtual void print(std::ostream& os) {
     os << name() << ":...\n";
     for (IndexType i = getFirstValidIndex(); i < size(); ++i) {
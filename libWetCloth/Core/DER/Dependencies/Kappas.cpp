@@ -20,7 +20,7 @@ void Kappas::compute() {
     m_value[vtx].setZero();
   }
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec3& kb = curvatureBinormals[vtx];
     const Vec3& m1e = materialFrames1[vtx - 1];
     const Vec3& m2e = materialFrames2[vtx - 1];
@@ -46,7 +46,7 @@ void GradKappas::compute() {
     m_value[vtx].setZero();
   }
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     GradKType& gradKappa = m_value[vtx];
     gradKappa.setZero();
 
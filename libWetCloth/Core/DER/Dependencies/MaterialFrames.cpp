@@ -47,7 +47,7 @@ void MaterialFrames<1>::compute() {
     m_value[vtx].setZero();
   }
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec3& u = referenceFrames1[vtx];
     const Vec3& v = referenceFrames2[vtx];
     const scalar s = sinThetas[vtx];
@@ -71,7 +71,7 @@ void MaterialFrames<2>::compute() {
     m_value[vtx].setZero();
   }
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec3& u = referenceFrames1[vtx];
     const Vec3& v = referenceFrames2[vtx];
     const scalar s = sinThetas[vtx];
@@ -53,7 +53,7 @@ void ReferenceFrames1::compute() {
     m_value[vtx].setZero();
   }
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     Vec3& previousTangent = m_previousTangents[vtx];
     const Vec3& currentTangent = tangents[vtx];
 
@@ -91,7 +91,7 @@ void ReferenceFrames2::compute() {
   for (IndexType vtx = 0; vtx < m_firstValidIndex; ++vtx) {
     m_value[vtx].setZero();
   }
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     m_value[vtx] = tangents[vtx].cross(referenceFrames1[vtx]);
   }
 
@@ -105,7 +105,7 @@ void ReferenceTwists::compute() {
   for (IndexType vtx = 0; vtx < m_firstValidIndex; ++vtx) {
     m_value[vtx] = 0.0;
   }
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec3& u0 = referenceFrames1[vtx - 1];
     const Vec3& u1 = referenceFrames1[vtx];
     const Vec3& tangent = tangents[vtx];
@@ -16,7 +16,7 @@ void Twists::compute() {
   const std::vector<scalar>& refTwists = m_refTwists.get();
   const VecX& dofs = m_dofs.get();
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     m_value[vtx] = refTwists[vtx] + dofs[4 * vtx + 3] - dofs[4 * vtx - 1];
   }
 
@@ -28,7 +28,7 @@ void GradTwists::compute() {
   const Vec3Array& curvatureBinormals = m_curvatureBinormals.get();
   const std::vector<scalar>& lengths = m_lengths.get();
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     Vec11& Dtwist = m_value[vtx];
     Dtwist.setZero();
 
@@ -48,7 +48,7 @@ void GradTwistsSquared::compute() {
   m_value.resize(m_size);
   const Vec11Array& gradTwists = m_gradTwists.get();
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     const Vec11& gradTwist = gradTwists[vtx];
     m_value[vtx] = gradTwist * gradTwist.transpose();
   }
@@ -62,7 +62,7 @@ void HessTwists::compute() {
   const std::vector<scalar>& lengths = m_lengths.get();
   const Vec3Array& curvatureBinormals = m_curvatureBinormals.get();
 
-  for (IndexType vtx = m_firstValidIndex; vtx < size(); ++vtx) {
+  for (IndexType vtx = computeBegin(); vtx < computeEnd(); ++vtx) {
     Mat11& DDtwist = m_value[vtx];
 
     DDtwist.setZero();
@@ -46,6 +46,7 @@ class ForceAccumulator {
   // Jacobian of the Force <==>  - Hessian of the Energy
   static void accumulate(TripletXs& hessianOfEnergy,
                          TripletXs& angularhessianOfEnergy,
+                         TripletXs& couplinghessianOfEnergy,
                          const StrandForce& strand) {
     typename ForceT::LocalJacobianType localJ;
     for (IndexType vtx = ForceT::s_first;
@@ -56,9 +57,14 @@ class ForceAccumulator {
         for (IndexType r = 0; r < localJ.rows(); ++r) {
           if (r % 4 == 3) {
             for (IndexType c = 0; c < localJ.cols(); ++c) {
-              if (c % 4 != 3 || isSmall(localJ(r, c))) continue;
-              angularhessianOfEnergy.push_back(
-                  Triplets((vtx - 1) * 4 + r, (vtx - 1) * 4 + c, localJ(r, c)));
+              if (isSmall(localJ(r, c))) continue;
+              // twist rows coupling to positions are kept apart
+              if (c % 4 == 3)
+                angularhessianOfEnergy.push_back(Triplets(
+                    (vtx - 1) * 4 + r, (vtx - 1) * 4 + c, localJ(r, c)));
+              else if (strand.collectsTwistCoupling())
+                couplinghessianOfEnergy.push_back(Triplets(
+                    (vtx - 1) * 4 + r, (vtx - 1) * 4 + c, localJ(r, c)));
             }
           } else {
             for (IndexType c = 0; c < localJ.cols(); ++c) {
@@ -241,13 +241,15 @@ void StrandForce::clearStored() {
   m_strandForceUpdate.setZero();
   m_strandHessianUpdate.clear();
   m_strandAngularHessianUpdate.clear();
+  m_strandTwistCouplingUpdate.clear();
 }
 
 void StrandForce::recomputeGlobal() {
   clearStored();
   accumulateQuantity(m_strandEnergyUpdate);
   accumulateQuantity(m_strandForceUpdate);
-  accumulateHessian(m_strandHessianUpdate, m_strandAngularHessianUpdate);
+  accumulateHessian(m_strandHessianUpdate, m_strandAngularHessianUpdate,
+                    m_strandTwistCouplingUpdate);
 
   // Free some memory
   m_strandState->m_hessTwists.free();
@@ -272,23 +274,24 @@ void StrandForce::accumulateQuantity(AccumulatedT& accumulated) {
 }
 
 void StrandForce::accumulateHessian(TripletXs& accumulated,
-                                    TripletXs& accumulated_twist) {
+                                    TripletXs& accumulated_twist,
+                                    TripletXs& accumulated_coupling) {
   ForceAccumulator<StretchingForce<NonViscous> >::accumulate(
-      accumulated, accumulated_twist, *this);
+      accumulated, accumulated_twist, accumulated_coupling, *this);
   ForceAccumulator<TwistingForce<NonViscous> >::accumulate(
-      accumulated, accumulated_twist, *this);
+      accumulated, accumulated_twist, accumulated_coupling, *this);
   ForceAccumulator<BendingForce<NonViscous> >::accumulate(
-      accumulated, accumulated_twist, *this);
+      accumulated, accumulated_twist, accumulated_coupling, *this);
 
   if (m_strandParams->m_accumulateWithViscous) {
     if (!m_strandParams->m_accumulateViscousOnlyForBendingModes) {
       ForceAccumulator<StretchingForce<Viscous> >::accumulate(
-          accumulated, accumulated_twist, *this);
+          accumulated, accumulated_twist, accumulated_coupling, *this);
     }
     ForceAccumulator<TwistingForce<Viscous> >::accumulate(
-        accumulated, accumulated_twist, *this);
+        accumulated, accumulated_twist, accumulated_coupling, *this);
     ForceAccumulator<BendingForce<Viscous> >::accumulate(
-        accumulated, accumulated_twist, *this);
+        accumulated, accumulated_twist, accumulated_coupling, *this);
   }
 }
 
@@ -392,6 +395,20 @@ void StrandForce::addAngularHessXToTotal(const VectorXs& x, const VectorXs& v,
   });
 }
 
+void StrandForce::addTwistCouplingHessXToTotal(TripletXs& hessE,
+                                               int hessE_index) {
+  const int num_hess = numTwistCouplingHessX();
+
+  threadutils::for_each(0, num_hess, [&](int i) {
+    const Triplets& data = m_strandTwistCouplingUpdate[i];
+    int col_vert = data.col() / 4;
+    int col_r = data.col() - col_vert * 4;
+    int row_vert = data.row() / 4;
+    hessE[hessE_index + i] = Triplets(
+        m_verts[row_vert], 4 * m_verts[col_vert] + col_r, -data.value());
+  });
+}
+
 void StrandForce::updateMultipliers(const VectorXs& x, const VectorXs& vplus,
                                     const VectorXs& m, const VectorXs& psi,
                                     const scalar& lambda, const scalar& dt) {
@@ -434,6 +451,10 @@ void StrandForce::updateMultipliers(const VectorXs& x, const VectorXs& vplus,
 
 int StrandForce::numHessX() { return m_strandHessianUpdate.size(); }
 
+int StrandForce::numTwistCouplingHessX() {
+  return m_strandTwistCouplingUpdate.size();
+}
+
 int StrandForce::numAngularHessX() {
   return m_strandAngularHessianUpdate.size();
 }
@@ -107,6 +107,16 @@ class StrandForce : public Force {
 
   virtual int numAngularHessX();
 
+  // twist rows of the Hessian against the positions, indexed by particle
+  // for the rows and by DOF for the columns
+  void addTwistCouplingHessXToTotal(TripletXs& hessE, int hessE_index);
+
+  int numTwistCouplingHessX();
+
+  bool collectsTwistCoupling() const {
+    return m_strandParams->m_collectTwistCoupling;
+  }
+
   virtual int flag() const;
 
   virtual const char* name();
@@ -140,7 +150,8 @@ class StrandForce : public Force {
   template <typename AccumulatedT>
   void accumulateQuantity(AccumulatedT& accumulated);
 
-  void accumulateHessian(TripletXs& accumulated, TripletXs& accumulated_twist);
+  void accumulateHessian(TripletXs& accumulated, TripletXs& accumulated_twist,
+                         TripletXs& accumulated_coupling);
 
   inline const auto& get_Frames1() const {
     return m_strandState->m_referenceFrames1.get();
@@ -170,6 +181,7 @@ class StrandForce : public Force {
   VecX m_strandForceUpdate;
   TripletXs m_strandHessianUpdate;
   TripletXs m_strandAngularHessianUpdate;
+  TripletXs m_strandTwistCouplingUpdate;
 
   //// Strand State (implicitly the end of timestep state, evolved from rest
   ///config) ////////////////////////
@@ -146,6 +146,7 @@ DistanceField::DistanceField(DISTANCE_FIELD_TYPE type_,
       parent(NULL),
       group(group_),
       params_index(params_index_),
+      material(-1),
       sampled(sampled_) {}
 
 void DistanceField::center(Vector3s& cent) const {
@@ -598,6 +599,24 @@ void DistanceFieldObject::apply_translation(const Vector3s& t) {
   future_center += t;
 }
 
+void DistanceFieldObject::save_state() {
+  saved_center = center;
+  saved_rot = rot;
+  saved_future_center = future_center;
+  saved_future_rot = future_rot;
+  saved_omega = omega;
+  saved_V = V;
+}
+
+void DistanceFieldObject::restore_state() {
+  center = saved_center;
+  rot = saved_rot;
+  future_center = saved_future_center;
+  future_rot = saved_future_rot;
+  omega = saved_omega;
+  V = saved_V;
+}
+
 scalar DistanceFieldObject::compute_phi(const Vector3s& pos) const {
   scalar phi = 0.0;
 
@@ -816,6 +835,14 @@ void DistanceFieldOperator::apply_translation(const Vector3s& t) {
                         [&](int i) { children[i]->apply_translation(t); });
 }
 
+void DistanceFieldOperator::save_state() {
+  for (auto& child : children) child->save_state();
+}
+
+void DistanceFieldOperator::restore_state() {
+  for (auto& child : children) child->restore_state();
+}
+
 void DistanceFieldOperator::advance(const scalar& dt) {
   int nb = children.size();
   threadutils::for_each(0, nb, [&](int i) { children[i]->advance(dt); });
@@ -919,6 +946,25 @@ int DistanceFieldOperator::vote_param_indices() {
   return m;
 }
 
+int DistanceFieldOperator::vote_material() {
+  int m = material;
+  int i = 0;
+  for (auto& child : children) {
+    int cm = child->vote_material();
+    if (i == 0) {
+      m = cm;
+      ++i;
+    } else if (m == cm)
+      ++i;
+    else
+      --i;
+  }
+
+  material = m;
+
+  return m;
+}
+
 DISTANCE_FIELD_USAGE DistanceFieldOperator::vote_usage() {
   DISTANCE_FIELD_USAGE m = usage;
   int i = 0;
@@ -68,7 +68,11 @@ struct DistanceField {
   virtual void apply_global_rotation(const Eigen::Quaternion<scalar>& rot) = 0;
   virtual void apply_local_rotation(const Eigen::Quaternion<scalar>& rot) = 0;
   virtual void apply_translation(const Vector3s& t) = 0;
+  // keep / bring back the kinematic state (used to roll back a sub-step)
+  virtual void save_state() = 0;
+  virtual void restore_state() = 0;
   virtual int vote_param_indices() { return params_index; };
+  virtual int vote_material() { return material; };
   virtual DISTANCE_FIELD_USAGE vote_usage() { return usage; };
   virtual bool vote_sampled() { return sampled; };
 
@@ -87,6 +91,8 @@ struct DistanceField {
   std::shared_ptr<DistanceField> parent;
   int group;
   int params_index;
+  // index of the ColliderMaterial in the scene, -1 for plain contact
+  int material;
   bool sampled;
 };
 
@@ -105,7 +111,10 @@ struct DistanceFieldOperator : public DistanceField {
   virtual void apply_global_rotation(const Eigen::Quaternion<scalar>& rot);
   virtual void apply_local_rotation(const Eigen::Quaternion<scalar>& rot);
   virtual void apply_translation(const Vector3s& t);
+  virtual void save_state();
+  virtual void restore_state();
   virtual int vote_param_indices();
+  virtual int vote_material();
   virtual DISTANCE_FIELD_USAGE vote_usage();
   virtual bool vote_sampled();
 
@@ -137,6 +146,8 @@ struct DistanceFieldObject : public DistanceField {
   virtual void apply_global_rotation(const Eigen::Quaternion<scalar>& rot);
   virtual void apply_local_rotation(const Eigen::Quaternion<scalar>& rot);
   virtual void apply_translation(const Vector3s& t);
+  virtual void save_state();
+  virtual void restore_state();
 
   virtual void render(
       const std::function<void(
@@ -157,6 +168,13 @@ struct DistanceFieldObject : public DistanceField {
   Vector3s omega;
   Vector3s V;
 
+  Vector3s saved_center;
+  Eigen::Quaternion<scalar> saved_rot;
+  Vector3s saved_future_center;
+  Eigen::Quaternion<scalar> saved_future_rot;
+  Vector3s saved_omega;
+  Vector3s saved_V;
+
   scalar sign;
 
   std::shared_ptr<SolidMesh> mesh;
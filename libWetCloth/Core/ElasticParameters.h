@@ -47,7 +47,8 @@ struct ElasticParameters {
         m_restVolumeFraction(restVolumeFraction),
         m_postProjectFixed(postProjectFixed),
         m_useApproxJacobian(true),
-        m_useTournierJacobian(false) {
+        m_useTournierJacobian(false),
+        m_collectTwistCoupling(false) {
     computeViscousForceCoefficients(dt);
   }
 
@@ -178,6 +179,9 @@ struct ElasticParameters {
   bool m_accumulateViscousOnlyForBendingModes;
   bool m_useApproxJacobian;
   bool m_useTournierJacobian;
+  // keep the twist-position coupling terms, only read when the twist DOFs
+  // are condensed out of the implicit solve
+  bool m_collectTwistCoupling;
   scalar m_straightHairs;
 };
 
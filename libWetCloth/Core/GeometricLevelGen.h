@@ -136,12 +136,13 @@ struct levelGen {
     p.resize(A.n);
     p.zero();
     Dof_ijk_coarse.resize(0);
-    std::unordered_map<unsigned int, unsigned int> index_mapping;
+    std::unordered_map<uint64_t, unsigned int> index_mapping;
     // generate index table for this level
     for (unsigned int idx_f = 0; idx_f < Dof_ijk_fine.size(); idx_f++) {
       Vector3i ijk = Dof_ijk_fine[idx_f];
       int coarse_i = ijk[0] / 2, coarse_j = ijk[1] / 2, coarse_k = ijk[2] / 2;
-      unsigned int idx = coarse_i + coarse_j * nni + coarse_k * nni * nnj;
+      uint64_t idx =
+          coarse_i + (uint64_t)nni * (coarse_j + (uint64_t)nnj * coarse_k);
       if (index_mapping.find(idx) == index_mapping.end()) {
         unsigned int idx_c = Dof_ijk_coarse.size();
         index_mapping[idx] = idx_c;
@@ -159,7 +160,8 @@ struct levelGen {
     for (unsigned int idx_f = 0; idx_f < Dof_ijk_fine.size(); idx_f++) {
       Vector3i ijk = Dof_ijk_fine[idx_f];
       int coarse_i = ijk[0] / 2, coarse_j = ijk[1] / 2, coarse_k = ijk[2] / 2;
-      unsigned int idx = coarse_i + coarse_j * nni + coarse_k * nni * nnj;
+      uint64_t idx =
+          coarse_i + (uint64_t)nni * (coarse_j + (uint64_t)nnj * coarse_k);
       unsigned int idx_c = index_mapping[idx];
       r.set_element(idx_c, idx_f, 0.125f);
     }
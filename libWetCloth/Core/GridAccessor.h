@@ -0,0 +1,233 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef GRID_ACCESSOR_H
+#define GRID_ACCESSOR_H
+
+#include <limits>
+#include <vector>
+
+#include "MathDefs.h"
+#include "MathUtilities.h"
+#include "Sorter.h"
+
+/*!
+ * Resolves global node coordinates (bucket handle * num_nodes + node handle)
+ * into (bucket index, node index) pairs. The last resolved bucket is cached,
+ * so that neighboring queries falling into the same bucket skip the bucket
+ * lookup entirely, and power-of-two bucket resolutions use shifts and masks
+ * instead of integer divisions.
+ *
+ * A locator keeps mutable state and must not be shared between threads;
+ * create one per bucket or per range of a parallel loop, so that the cache
+ * carries over between the items of the task.
+ */
+class BucketNodeLocator {
+ public:
+  BucketNodeLocator(const Sorter& buckets, int num_nodes,
+                    const std::vector<unsigned char>* bucket_activated = NULL)
+      : m_buckets(buckets),
+        m_activated(bucket_activated),
+        m_num_nodes(num_nodes),
+        m_shift(-1),
+        m_mask(0),
+        m_cached_bucket(-1),
+        m_cached_valid(false) {
+    for (int s = 0; s < 31; ++s) {
+      if ((1 << s) == num_nodes) {
+        m_shift = s;
+        m_mask = num_nodes - 1;
+        break;
+      }
+    }
+    m_cached_handle.setConstant(std::numeric_limits<int>::min());
+  }
+
+  inline Vector3i globalHandle(const Vector3i& bucket_handle,
+                               const Vector3i& node_handle) const {
+    return bucket_handle * m_num_nodes + node_handle;
+  }
+
+  inline int numNodes() const { return m_num_nodes; }
+
+  // return false if the node lies outside the grid or in an inactive bucket
+  inline bool locate(const Vector3i& node, int& bucket_idx, int& node_idx) {
+    Vector3i local;
+    if (!resolve(node, local)) {
+      bucket_idx = node_idx = -1;
+      return false;
+    }
+
+    bucket_idx = m_cached_bucket;
+    node_idx = localIndex(local);
+    return true;
+  }
+
+  inline bool locate(const Vector3i& node, Vector2i& bucket_node) {
+    return locate(node, bucket_node(0), bucket_node(1));
+  }
+
+ protected:
+  inline int floorDiv(int a) const {
+    if (m_shift >= 0) return a >> m_shift;
+    return (a >= 0) ? (a / m_num_nodes)
+                    : -((-a + m_num_nodes - 1) / m_num_nodes);
+  }
+
+  inline int localIndex(const Vector3i& local) const {
+    return (local(2) * m_num_nodes + local(1)) * m_num_nodes + local(0);
+  }
+
+  // update the cached bucket to the one containing node, and return the
+  // handle of the node inside that bucket
+  inline bool resolve(const Vector3i& node, Vector3i& local) {
+    Vector3i bucket_handle;
+    if (m_shift >= 0) {
+      bucket_handle = Vector3i(node(0) >> m_shift, node(1) >> m_shift,
+                               node(2) >> m_shift);
+      local = Vector3i(node(0) & m_mask, node(1) & m_mask, node(2) & m_mask);
+    } else {
+      bucket_handle =
+          Vector3i(floorDiv(node(0)), floorDiv(node(1)), floorDiv(node(2)));
+      local = node - bucket_handle * m_num_nodes;
+    }
+
+    if (bucket_handle != m_cached_handle) {
+      m_cached_handle = bucket_handle;
+      m_cached_bucket = m_buckets.find_bucket(
+          bucket_handle(0), bucket_handle(1), bucket_handle(2));
+      m_cached_valid = m_cached_bucket >= 0 && isValidBucket(m_cached_bucket);
+      onBucketChanged();
+    }
+
+    return m_cached_valid;
+  }
+
+  virtual bool isValidBucket(int bucket_idx) const {
+    return m_activated == NULL || (*m_activated)[bucket_idx];
+  }
+
+  virtual void onBucketChanged() {}
+
+  const Sorter& m_buckets;
+  const std::vector<unsigned char>* m_activated;
+
+  int m_num_nodes;
+  int m_shift;
+  int m_mask;
+
+  Vector3i m_cached_handle;
+  int m_cached_bucket;
+  bool m_cached_valid;
+};
+
+/*!
+ * Random access to a per-bucket node field (bucket id -> node values), in
+ * global node coordinates. Buckets whose field is empty are treated as
+ * inactive and return the default value.
+ */
+template <typename T>
+class GridAccessor : public BucketNodeLocator {
+ public:
+  typedef Eigen::Matrix<T, Eigen::Dynamic, 1> FieldType;
+
+  GridAccessor(const std::vector<FieldType>& data, const Sorter& buckets,
+               int num_nodes, const T& default_val)
+      : BucketNodeLocator(buckets, num_nodes),
+        m_data(data),
+        m_default_val(default_val),
+        m_cached_data(NULL) {}
+
+  inline T getValue(const Vector3i& node) {
+    return getValue(node, m_default_val);
+  }
+
+  inline T getValue(const Vector3i& node, const T& default_val) {
+    Vector3i local;
+    if (!resolve(node, local)) return default_val;
+    return m_cached_data[localIndex(local)];
+  }
+
+  // 2x2x2 block starting at base, ordered as in trilerp (x fastest)
+  inline void getStencil2(const Vector3i& base, T* out) {
+    Vector3i local;
+    const bool valid = resolve(base, local);
+    if (valid && local(0) < m_num_nodes - 1 && local(1) < m_num_nodes - 1 &&
+        local(2) < m_num_nodes - 1) {
+      const T* p = m_cached_data + localIndex(local);
+      const int sj = m_num_nodes;
+      const int sk = m_num_nodes * m_num_nodes;
+      out[0] = p[0];
+      out[1] = p[1];
+      out[2] = p[sj];
+      out[3] = p[sj + 1];
+      out[4] = p[sk];
+      out[5] = p[sk + 1];
+      out[6] = p[sk + sj];
+      out[7] = p[sk + sj + 1];
+      return;
+    }
+
+    for (int t = 0; t < 2; ++t)
+      for (int s = 0; s < 2; ++s)
+        for (int r = 0; r < 2; ++r)
+          out[t * 4 + s * 2 + r] = getValue(base + Vector3i(r, s, t));
+  }
+
+  // 3x3x3 block centred at centre, x fastest
+  inline void getStencil3(const Vector3i& centre, T* out) {
+    Vector3i local;
+    const bool valid = resolve(centre, local);
+    if (valid && local.minCoeff() > 0 && local.maxCoeff() < m_num_nodes - 1) {
+      const int sj = m_num_nodes;
+      const int sk = m_num_nodes * m_num_nodes;
+      const T* p = m_cached_data + localIndex(local) - sk - sj - 1;
+      for (int t = 0; t < 3; ++t)
+        for (int s = 0; s < 3; ++s)
+          for (int r = 0; r < 3; ++r)
+            out[t * 9 + s * 3 + r] = p[t * sk + s * sj + r];
+      return;
+    }
+
+    for (int t = 0; t < 3; ++t)
+      for (int s = 0; s < 3; ++s)
+        for (int r = 0; r < 3; ++r)
+          out[t * 9 + s * 3 + r] =
+              getValue(centre + Vector3i(r - 1, s - 1, t - 1));
+  }
+
+  // trilinear interpolation, grid_pos is in cells from the first node
+  inline T interpolate(const Vector3s& grid_pos) {
+    const Vector3i base((int)floor(grid_pos(0)), (int)floor(grid_pos(1)),
+                        (int)floor(grid_pos(2)));
+    T buf[8];
+    getStencil2(base, buf);
+
+    return mathutils::trilerp(
+        buf[0], buf[1], buf[2], buf[3], buf[4], buf[5], buf[6], buf[7],
+        grid_pos(0) - (scalar)base(0), grid_pos(1) - (scalar)base(1),
+        grid_pos(2) - (scalar)base(2));
+  }
+
+ protected:
+  virtual bool isValidBucket(int bucket_idx) const {
+    return m_data[bucket_idx].size() > 0;
+  }
+
+  virtual void onBucketChanged() {
+    m_cached_data = m_cached_valid ? m_data[m_cached_bucket].data() : NULL;
+  }
+
+  const std::vector<FieldType>& m_data;
+  T m_default_val;
+  const T* m_cached_data;
+};
+
+#endif
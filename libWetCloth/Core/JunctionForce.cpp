@@ -82,7 +82,24 @@ JunctionForce::JunctionForce(const std::shared_ptr<TwoDScene>& scene)
 void JunctionForce::addEnergyToTotal(const VectorXs& x, const VectorXs& v,
                                      const VectorXs& m, const VectorXs& psi,
                                      const scalar& lambda, scalar& E) {
-  std::cerr << "NOT IMPLEMENTED!" << std::endl;
+  for (int i = 0; i < (int)m_junctions_indices.size(); ++i) {
+    const int pidx = m_junctions_indices[i];
+    const scalar psi_coeff = pow(psi(pidx), lambda);
+    const std::vector<int>& another_ps = m_junctions_edges[i];
+    const int num_pes = (int)another_ps.size();
+
+    const Vector3s& x0 = x.segment<3>(pidx * 4);
+    const Vector3s& ori = m_junction_orientation.segment<3>(i * 3);
+
+    for (int j = 0; j < num_pes; ++j) {
+      const Vector3s e12 = x.segment<3>(another_ps[j] * 4) - x0;
+      const Vector3s e23 = ori * m_junction_signs[i][j];
+
+      const scalar theta = atan2(e12.cross(e23).norm(), e12.dot(e23));
+
+      E += 0.5 * m_bending_coeff[i][j] * psi_coeff * theta * theta;
+    }
+  }
 }
 
 void JunctionForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
@@ -13,52 +13,53 @@
 #include "MathUtilities.h"
 #include "TwoDScene.h"
 
+namespace {
+// sliding speed (cm/s) below which friction turns into viscous damping
+const scalar friction_eps = 1e-3;
+}  // namespace
+
 LevelSetForce::LevelSetForce(const std::shared_ptr<TwoDScene>& scene,
                              const scalar& l0, const scalar& b)
     : Force(),
       m_scene(scene),
       m_l0(std::min(scene->getCellSize() * 3.0, l0)),
-      m_b(b) {
+      m_b(b),
+      m_use_distance_field(false) {
   assert(m_l0 >= 0.0);
   assert(m_b >= 0.0);
 }
 
 LevelSetForce::~LevelSetForce() {}
 
-void LevelSetForce::addEnergyToTotal(const VectorXs& x, const VectorXs& v,
-                                     const VectorXs& m, const VectorXs& psi,
-                                     const scalar& lambda, scalar& E) {
-  assert(x.size() == v.size());
-  assert(x.size() % 4 == 0);
-  std::cerr << "NOT IMPLEMENTED!" << std::endl;
-}
-
-void LevelSetForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
-                                    const VectorXs& m, const VectorXs& psi,
-                                    const scalar& lambda, VectorXs& gradE) {
-  assert(x.size() == v.size());
-  assert(x.size() == gradE.size());
-  assert(x.size() % 4 == 0);
-
-  const int num_elasto = m_process_list.size();
-  const std::vector<VectorXs>& solid_phi = m_scene->getNodeSolidPhi();
-
-  const VectorXs& vol = m_scene->getVol();
-
-  const scalar K = m_scene->getLiquidInfo().levelset_young_modulus;
+/*!
+ * penetration depth below the layer of thickness l0, and the outward normal.
+ * With the distance fields sampled directly the result is a function of pos
+ * only, otherwise it is interpolated with the current particle weights.
+ */
+scalar LevelSetForce::computePenetration(const VectorXs& x, int pidx,
+                                         Vector3s& grad_phi) const {
+  const Vector3s& pos = x.segment<3>(pidx * 4);
 
-  const scalar iD = m_scene->getInverseDCoeff();
+  scalar phi_ori = 0.0;
+  grad_phi.setZero();
 
-  threadutils::for_each(0, num_elasto, [&](int idx) {
-    const int pidx = m_process_list[idx];
+  if (m_use_distance_field) {
+    const scalar h = m_scene->getCellSize() * 1e-3;
+    Vector3s vel;
+    phi_ori = m_scene->computePhiVel(pos, vel);
+    for (int r = 0; r < 3; ++r) {
+      Vector3s dp = Vector3s::Zero();
+      dp(r) = h;
+      grad_phi(r) = (m_scene->computePhiVel(pos + dp, vel) -
+                     m_scene->computePhiVel(pos - dp, vel)) /
+                    (2.0 * h);
+    }
+  } else {
+    const std::vector<VectorXs>& solid_phi = m_scene->getNodeSolidPhi();
+    const scalar iD = m_scene->getInverseDCoeff();
     const auto& node_indices_sphi = m_scene->getParticleNodesSolidPhi(pidx);
     const auto& particle_weights = m_scene->getParticleWeights(pidx);
 
-    const Vector3s& pos = x.segment<3>(pidx * 4);
-
-    scalar phi_ori = 0.0;
-    Vector3s grad_phi = Vector3s::Zero();
-
     for (int nidx = 0; nidx < node_indices_sphi.rows(); ++nidx) {
       const int bucket_idx = node_indices_sphi(nidx, 0);
       const int node_idx = node_indices_sphi(nidx, 1);
@@ -76,75 +77,145 @@ void LevelSetForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
       phi_ori += phi * w;
       grad_phi += phi * iD * w * (np - pos);
     }
+  }
+
+  if (grad_phi.norm() > 1e-12) grad_phi.normalize();
 
-    if (grad_phi.norm() > 1e-12) grad_phi.normalize();
+  return phi_ori - m_l0;
+}
 
-    phi_ori -= m_l0;
+bool LevelSetForce::computeContactCoefficients(int idx, scalar& mu,
+                                               scalar& stress) const {
+  const int material = m_process_material[idx];
+  if (material < 0) return false;
 
-    if (phi_ori < 0.0) {
+  const int pidx = m_process_list[idx];
+  const scalar sat = mathutils::clamp(
+      m_scene->getFluidVol()(pidx) / std::max(1e-16, m_scene->getVol()(pidx)),
+      0.0, 1.0);
+
+  m_scene->getColliderMaterial(material).evaluate(sat, mu, stress);
+  return true;
+}
+
+void LevelSetForce::setUseDistanceField(bool use_distance_field) {
+  m_use_distance_field = use_distance_field;
+}
+
+void LevelSetForce::addEnergyToTotal(const VectorXs& x, const VectorXs& v,
+                                     const VectorXs& m, const VectorXs& psi,
+                                     const scalar& lambda, scalar& E) {
+  assert(x.size() == v.size());
+  assert(x.size() % 4 == 0);
+
+  const int num_elasto = m_process_list.size();
+  const VectorXs& vol = m_scene->getVol();
+  const scalar K = m_scene->getLiquidInfo().levelset_young_modulus;
+
+  VectorXs energies(num_elasto);
+  threadutils::for_each(0, num_elasto, [&](int idx) {
+    const int pidx = m_process_list[idx];
+
+    Vector3s grad_phi;
+    const scalar phi = computePenetration(x, pidx, grad_phi);
+
+    if (phi < 0.0) {
       const scalar k = K * pow(vol(pidx), 1. / 3.);
+      energies(idx) = 0.5 * k * phi * phi;
 
-      gradE.segment<3>(pidx * 4) += k * phi_ori * grad_phi;
+      scalar mu, stress;
+      if (computeContactCoefficients(idx, mu, stress))
+        energies(idx) += stress * pow(vol(pidx), 2. / 3.) * phi;
+    } else {
+      energies(idx) = 0.0;
     }
   });
-}
 
-bool LevelSetForce::parallelized() const { return true; }
+  E += energies.sum();
+}
 
-void LevelSetForce::addHessXToTotal(const VectorXs& x, const VectorXs& v,
+void LevelSetForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
                                     const VectorXs& m, const VectorXs& psi,
-                                    const scalar& lambda, TripletXs& hessE,
-                                    int hessE_index, const scalar& dt) {
+                                    const scalar& lambda, VectorXs& gradE) {
   assert(x.size() == v.size());
-  assert(x.size() == m.size());
+  assert(x.size() == gradE.size());
   assert(x.size() % 4 == 0);
 
   const int num_elasto = m_process_list.size();
-  const std::vector<VectorXs>& solid_phi = m_scene->getNodeSolidPhi();
 
   const VectorXs& vol = m_scene->getVol();
 
   const scalar K = m_scene->getLiquidInfo().levelset_young_modulus;
 
-  const scalar iD = m_scene->getInverseDCoeff();
-
   threadutils::for_each(0, num_elasto, [&](int idx) {
     const int pidx = m_process_list[idx];
-    const auto& node_indices_sphi = m_scene->getParticleNodesSolidPhi(pidx);
-    const auto& particle_weights = m_scene->getParticleWeights(pidx);
 
-    scalar phi_ori = 0.0;
-    Vector3s grad_phi = Vector3s::Zero();
+    Vector3s grad_phi;
+    const scalar phi_ori = computePenetration(x, pidx, grad_phi);
 
-    const Vector3s& pos = x.segment<3>(pidx * 4);
+    if (phi_ori < 0.0) {
+      const scalar k = K * pow(vol(pidx), 1. / 3.);
 
-    for (int nidx = 0; nidx < node_indices_sphi.rows(); ++nidx) {
-      const int bucket_idx = node_indices_sphi(nidx, 0);
-      const int node_idx = node_indices_sphi(nidx, 1);
+      gradE.segment<3>(pidx * 4) += k * phi_ori * grad_phi;
 
-      scalar phi;
-      if (m_scene->isBucketActivated(bucket_idx)) {
-        phi = solid_phi[bucket_idx](node_idx);
-      } else {
-        phi = 3.0 * m_scene->getCellSize();
+      scalar mu, stress;
+      if (computeContactCoefficients(idx, mu, stress)) {
+        // adhesion pulls the particle into the contact layer
+        gradE.segment<3>(pidx * 4) +=
+            stress * pow(vol(pidx), 2. / 3.) * grad_phi;
+
+        // regularized Coulomb friction, damping the sliding velocity
+        // relative to the collider; the damped part is in the Hessian
+        const Matrix3s P =
+            Matrix3s::Identity() - grad_phi * grad_phi.transpose();
+        const Vector3s& v_col = m_process_collider_vel[idx];
+        const scalar vt = (P * (v.segment<3>(pidx * 4) - v_col)).norm();
+        const scalar c = mu * k * -phi_ori / std::max(vt, friction_eps);
+
+        gradE.segment<3>(pidx * 4) -= c * (P * v_col);
       }
+    }
+  });
+}
 
-      const scalar w = particle_weights(nidx, 3);
-      const Vector3s& np = m_scene->getNodePosSolidPhi(bucket_idx, node_idx);
+bool LevelSetForce::parallelized() const { return true; }
 
-      phi_ori += phi * w;
-      grad_phi += phi * iD * w * (np - pos);
-    }
+void LevelSetForce::addHessXToTotal(const VectorXs& x, const VectorXs& v,
+                                    const VectorXs& m, const VectorXs& psi,
+                                    const scalar& lambda, TripletXs& hessE,
+                                    int hessE_index, const scalar& dt) {
+  assert(x.size() == v.size());
+  assert(x.size() == m.size());
+  assert(x.size() % 4 == 0);
 
-    if (grad_phi.norm() > 1e-12) grad_phi.normalize();
+  const int num_elasto = m_process_list.size();
+
+  const VectorXs& vol = m_scene->getVol();
 
-    phi_ori -= m_l0;
+  const scalar K = m_scene->getLiquidInfo().levelset_young_modulus;
+
+  threadutils::for_each(0, num_elasto, [&](int idx) {
+    const int pidx = m_process_list[idx];
+
+    Vector3s grad_phi;
+    const scalar phi_ori = computePenetration(x, pidx, grad_phi);
 
     if (phi_ori < 0.0) {
       const scalar k = K * pow(vol(pidx), 1. / 3.);
 
       Matrix3s hess = k * grad_phi * grad_phi.transpose();
 
+      scalar mu, stress;
+      if (computeContactCoefficients(idx, mu, stress)) {
+        const Matrix3s P =
+            Matrix3s::Identity() - grad_phi * grad_phi.transpose();
+        const Vector3s& v_col = m_process_collider_vel[idx];
+        const scalar vt = (P * (v.segment<3>(pidx * 4) - v_col)).norm();
+        const scalar c = mu * k * -phi_ori / std::max(vt, friction_eps);
+
+        hess += c / dt * P;
+      }
+
       for (int s = 0; s < 3; ++s)
         for (int r = 0; r < 3; ++r) {
           hessE[hessE_index + idx * 9 + s * 3 + r] =
@@ -169,14 +240,22 @@ void LevelSetForce::preCompute() {
   const VectorXs& x = m_scene->getX();
   m_process_list.resize(0);
   m_process_list.reserve(num_elasto);
+  m_process_material.resize(0);
+  m_process_collider_vel.resize(0);
 
   for (int i = 0; i < num_elasto; ++i) {
     if (m_scene->isFixed(i) & 1) continue;
 
     Vector3s vel;
-    scalar phi = m_scene->computePhiVel(x.segment<3>(i * 4), vel);
-
-    if (phi < m_l0) m_process_list.push_back(i);
+    int material;
+    scalar phi =
+        m_scene->computePhiVelMaterial(x.segment<3>(i * 4), vel, material);
+
+    if (phi < m_l0) {
+      m_process_list.push_back(i);
+      m_process_material.push_back(material);
+      m_process_collider_vel.push_back(vel);
+    }
   }
 }
 
@@ -55,13 +55,28 @@ class LevelSetForce : public Force {
 
   virtual bool parallelized() const;
 
+  // sample the distance fields of the solids directly instead of the solid
+  // phi on the grid, so that the force does not depend on the grid state
+  void setUseDistanceField(bool use_distance_field);
+
  private:
+  scalar computePenetration(const VectorXs& x, int pidx,
+                            Vector3s& grad_phi) const;
+
+  // friction coefficient and adhesive stress of the idx-th processed
+  // particle against its collider; false if the collider has no material
+  bool computeContactCoefficients(int idx, scalar& mu, scalar& stress) const;
+
   std::shared_ptr<TwoDScene> m_scene;
 
   std::vector<int> m_process_list;
+  std::vector<int> m_process_material;
+  std::vector<Vector3s> m_process_collider_vel;
 
   scalar m_l0;
   scalar m_b;
+
+  bool m_use_distance_field;
 };
 
 #endif
@@ -36,7 +36,8 @@ LinearizedImplicitEuler::LinearizedImplicitEuler(
       m_maxiters(maxiters),
       m_manifold_substeps(manifold_substeps),
       m_viscosity_substeps(viscosity_substeps),
-      m_surf_tension_substeps(surf_tension_substeps) {}
+      m_surf_tension_substeps(surf_tension_substeps),
+      m_twist_condensed(false) {}
 
 LinearizedImplicitEuler::~LinearizedImplicitEuler() {}
 
@@ -440,6 +441,9 @@ void LinearizedImplicitEuler::performGlobalMultiply(
   });
   //    m_multiply_buffer = m_A * m_pre_mult_buffer;
 
+  if (m_twist_condensed)
+    condenseTwist(dt, m_pre_mult_buffer, m_multiply_buffer);
+
   // W^TAWx
   mapSoftParticlesToNode(scene, out_node_vec_x, out_node_vec_y, out_node_vec_z,
                          m_multiply_buffer);
@@ -562,11 +566,17 @@ void LinearizedImplicitEuler::constructNodeForce(
   m_angular_moment_buffer.resize(num_elasto);
 
   if (scene.getLiquidInfo().solve_solid) {
-    scene.accumulateGradU(rhs);
+    if (scene.useExplicitElasto(dt))
+      scene.accumulateGradUParallel(rhs);
+    else
+      scene.accumulateGradU(rhs);
     rhs *= -dt;
 
     assert(!std::isnan(rhs.sum()));
 
+    // the explicit sub-cycles replace this impulse by their own
+    if (scene.useExplicitElasto(dt)) m_elasto_impulse_buffer = rhs;
+
     threadutils::for_each(0, num_elasto, [&](int pidx) {
       m_angular_moment_buffer[pidx] =
           rhs[pidx * 4 + 3] + m[pidx * 4 + 3] * v[pidx * 4 + 3];
@@ -843,6 +853,111 @@ void LinearizedImplicitEuler::constructAngularHessianPostProcess(
   });
 }
 
+void LinearizedImplicitEuler::constructTwistCondensation(TwoDScene& scene,
+                                                         const scalar& dt) {
+  const int num_elasto = scene.getNumSoftElastoParticles();
+  const VectorXs& m = scene.getM();
+
+  constructAngularHessianPreProcess(scene, dt);
+  scene.accumulateTwistCouplingddUdxdx(m_twist_triA);
+
+  TripletXs tri_tt;
+  tri_tt.reserve(m_angular_triA.size() + num_elasto);
+  for (const Triplets& tri : m_angular_triA)
+    tri_tt.push_back(Triplets(tri.row(), tri.col(), tri.value() * dt * dt));
+
+  // twists without inertia (e.g. of cloth vertices) are decoupled and
+  // simply stay at zero
+  for (int i = 0; i < num_elasto; ++i) {
+    const scalar mt = m(i * 4 + 3);
+    tri_tt.push_back(Triplets(i, i, mt > 0.0 ? mt : 1.0));
+  }
+
+  SparseXs A_tt(num_elasto, num_elasto);
+  A_tt.setFromTriplets(tri_tt.begin(), tri_tt.end());
+
+  m_twist_coupling.resize(num_elasto, num_elasto * 4);
+  m_twist_coupling.setFromTriplets(m_twist_triA.begin(), m_twist_triA.end());
+  m_twist_coupling_t = m_twist_coupling.transpose();
+
+  // the twist block is banded along each strand, the factorization is
+  // linear in the number of twists
+  m_twist_solver.compute(A_tt);
+  m_twist_condensed = (m_twist_solver.info() == Eigen::Success);
+
+  if (!m_twist_condensed)
+    std::cout << "WARNING: twist factorization failed, twist is not "
+                 "condensed!"
+              << std::endl;
+}
+
+void LinearizedImplicitEuler::condenseTwist(const scalar& dt,
+                                            const VectorXs& part_vec,
+                                            VectorXs& out) {
+  // H_xx Wx - h^2 H_xt (M_t + h^2 H_tt)^-1 H_tx Wx
+  m_twist_buffer.setZero(m_twist_coupling.rows());
+  multiplyTwistCoupling(m_twist_coupling, part_vec, 1.0, m_twist_buffer);
+  m_twist_buffer = m_twist_solver.solve(m_twist_buffer);
+  multiplyTwistCoupling(m_twist_coupling_t, m_twist_buffer, -dt * dt, out);
+}
+
+void LinearizedImplicitEuler::multiplyTwistCoupling(const SparseRXs& C,
+                                                    const VectorXs& x,
+                                                    const scalar& s,
+                                                    VectorXs& out) {
+  // out += s * C x, row by row
+  threadutils::for_each(0, (int)C.outerSize(), [&](int i) {
+    scalar val = 0.0;
+    for (SparseRXs::InnerIterator it(C, i); it; ++it)
+      val += it.value() * x(it.index());
+    out(i) += val * s;
+  });
+}
+
+scalar LinearizedImplicitEuler::condenseTwistRHS(
+    const TwoDScene& scene, const scalar& dt, std::vector<VectorXs>& node_res_x,
+    std::vector<VectorXs>& node_res_y, std::vector<VectorXs>& node_res_z,
+    std::vector<VectorXs>& node_tmp_x, std::vector<VectorXs>& node_tmp_y,
+    std::vector<VectorXs>& node_tmp_z) {
+  // f_x - h^2 W^T H_xt (M_t + h^2 H_tt)^-1 f_t
+  m_twist_buffer = m_twist_solver.solve(m_angular_moment_buffer);
+  m_multiply_buffer.setZero(m_twist_coupling_t.rows());
+  multiplyTwistCoupling(m_twist_coupling_t, m_twist_buffer, dt * dt,
+                        m_multiply_buffer);
+  mapSoftParticlesToNode(scene, node_tmp_x, node_tmp_y, node_tmp_z,
+                         m_multiply_buffer);
+
+  const Sorter& buckets = scene.getParticleBuckets();
+
+  buckets.for_each_bucket([&](int bucket_idx) {
+    node_res_x[bucket_idx] -= node_tmp_x[bucket_idx];
+    node_res_y[bucket_idx] -= node_tmp_y[bucket_idx];
+    node_res_z[bucket_idx] -= node_tmp_z[bucket_idx];
+    node_tmp_x[bucket_idx] = m_node_rhs_x[bucket_idx] - node_tmp_x[bucket_idx];
+    node_tmp_y[bucket_idx] = m_node_rhs_y[bucket_idx] - node_tmp_y[bucket_idx];
+    node_tmp_z[bucket_idx] = m_node_rhs_z[bucket_idx] - node_tmp_z[bucket_idx];
+  });
+
+  return lengthNodeVectors(node_tmp_x, node_tmp_y, node_tmp_z);
+}
+
+void LinearizedImplicitEuler::recoverTwist(const TwoDScene& scene,
+                                           const scalar& dt) {
+  const int num_elasto = scene.getNumSoftElastoParticles();
+
+  if (m_pre_mult_buffer.size() != num_elasto * 4)
+    m_pre_mult_buffer.resize(num_elasto * 4);
+
+  mapNodeToSoftParticles(scene, m_node_v_plus_x, m_node_v_plus_y,
+                         m_node_v_plus_z, m_pre_mult_buffer);
+
+  // (M_t + h^2 H_tt) w = f_t - h^2 H_tx Wx
+  m_twist_buffer = m_angular_moment_buffer;
+  multiplyTwistCoupling(m_twist_coupling, m_pre_mult_buffer, -dt * dt,
+                        m_twist_buffer);
+  m_angular_v_plus_buffer = m_twist_solver.solve(m_twist_buffer);
+}
+
 void LinearizedImplicitEuler::constructHDV(TwoDScene& scene, const scalar& dt) {
   const std::vector<VectorXs>& node_mass_x = scene.getNodeMassX();
   const std::vector<VectorXs>& node_mass_y = scene.getNodeMassY();
@@ -1189,6 +1304,9 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCR(TwoDScene& scene,
     constructHessianPreProcess(scene, dt);
     constructHessianPostProcess(scene, dt);
 
+    if (scene.getLiquidInfo().use_twist_condensation)
+      constructTwistCondensation(scene, dt);
+
     allocateNodeVectors(scene, m_node_r_x, m_node_r_y, m_node_r_z);
     allocateNodeVectors(scene, m_node_z_x, m_node_z_y, m_node_z_z);
     allocateNodeVectors(scene, m_node_p_x, m_node_p_y, m_node_p_z);
@@ -1210,6 +1328,11 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCR(TwoDScene& scene,
           m_node_rhs_z[bucket_idx] - m_node_z_z[bucket_idx];
     });
 
+    if (m_twist_condensed)
+      res_norm_0 = condenseTwistRHS(scene, dt, m_node_z_x, m_node_z_y,
+                                    m_node_z_z, m_node_p_x, m_node_p_y,
+                                    m_node_p_z);
+
     scalar res_norm =
         lengthNodeVectors(m_node_z_x, m_node_z_y, m_node_z_z) / res_norm_0;
 
@@ -1378,9 +1501,19 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCR(TwoDScene& scene,
                 << (rho_criterion / (res_norm_0 * res_norm_0))
                 << ", abs. rho: " << rho << "/" << rho_criterion << "]"
                 << std::endl;
+      checkSolveResidual(scene, "elasto", iter, res_norm);
     }
   }
 
+  if (m_twist_condensed) {
+    recoverTwist(scene, dt);
+    m_twist_condensed = false;
+
+    std::cout << "[twist back-substitution: " << m_twist_coupling.rows()
+              << " twists]" << std::endl;
+    return true;
+  }
+
   if (res_norm_1 > m_pcg_criterion) {
     const int num_elasto = scene.getNumSoftElastoParticles();
 
@@ -1696,6 +1829,7 @@ bool LinearizedImplicitEuler::stepImplicitElastoLagrangian(TwoDScene& scene,
 
       std::cout << "[pcg total iter: " << iter << ", res: " << res_norm << "]"
                 << std::endl;
+      checkSolveResidual(scene, "elasto", iter, res_norm);
     }
   }
 
@@ -1875,6 +2009,7 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCGCoSolve(
 
       std::cout << "[pcg total iter: " << iter << ", res: " << res_norm << "]"
                 << std::endl;
+      checkSolveResidual(scene, "elasto", iter, res_norm);
     }
   }
 
@@ -1890,13 +2025,15 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCG(TwoDScene& scene,
 
   scalar res_norm_0 =
       lengthNodeVectors(m_node_rhs_x, m_node_rhs_y, m_node_rhs_z);
-  scalar res_norm_1 = m_angular_moment_buffer.norm();
 
   if (res_norm_0 > m_pcg_criterion) {
     // build Hessian
     constructHessianPreProcess(scene, dt);
     constructHessianPostProcess(scene, dt);
 
+    if (scene.getLiquidInfo().use_twist_condensation)
+      constructTwistCondensation(scene, dt);
+
     allocateNodeVectors(scene, m_node_r_x, m_node_r_y, m_node_r_z);
     allocateNodeVectors(scene, m_node_z_x, m_node_z_y, m_node_z_z);
     allocateNodeVectors(scene, m_node_p_x, m_node_p_y, m_node_p_z);
@@ -1915,6 +2052,11 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCG(TwoDScene& scene,
           m_node_rhs_z[bucket_idx] - m_node_r_z[bucket_idx];
     });
 
+    if (m_twist_condensed)
+      res_norm_0 = condenseTwistRHS(scene, dt, m_node_r_x, m_node_r_y,
+                                    m_node_r_z, m_node_p_x, m_node_p_y,
+                                    m_node_p_z);
+
     scalar res_norm =
         lengthNodeVectors(m_node_r_x, m_node_r_y, m_node_r_z) / res_norm_0;
 
@@ -2022,9 +2164,28 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCG(TwoDScene& scene,
                 << (rho_criterion / (res_norm_0 * res_norm_0))
                 << ", abs. rho: " << rho << "/" << rho_criterion << "]"
                 << std::endl;
+      checkSolveResidual(scene, "elasto", iter, res_norm);
     }
   }
 
+  if (m_twist_condensed) {
+    recoverTwist(scene, dt);
+    m_twist_condensed = false;
+
+    std::cout << "[twist back-substitution: " << m_twist_coupling.rows()
+              << " twists]" << std::endl;
+    return true;
+  }
+
+  stepImplicitTwistDiagonalPCG(scene, dt);
+
+  return true;
+}
+
+void LinearizedImplicitEuler::stepImplicitTwistDiagonalPCG(TwoDScene& scene,
+                                                           scalar dt) {
+  const scalar res_norm_1 = m_angular_moment_buffer.norm();
+
   if (res_norm_1 > m_pcg_criterion) {
     const int num_elasto = scene.getNumSoftElastoParticles();
 
@@ -2121,7 +2282,6 @@ bool LinearizedImplicitEuler::stepImplicitElastoDiagonalPCG(TwoDScene& scene,
                 << std::endl;
     }
   }
-  return true;
 }
 
 bool LinearizedImplicitEuler::stepImplicitViscosityDiagonalPCG(
@@ -2159,20 +2319,49 @@ bool LinearizedImplicitEuler::stepImplicitViscosityDiagonalPCG(
     int iter_out;
     scalar residual;
 
-    viscosity::applyNodeViscosityImplicit(
-        scene, m_node_visc_indices_x, m_node_visc_indices_y,
-        m_node_visc_indices_z, offset_nodes_x, offset_nodes_y, offset_nodes_z,
-        m_visc_matrix, m_visc_rhs, m_visc_solution, node_vel_x, node_vel_y,
-        node_vel_z, residual, iter_out, m_viscous_criterion, m_maxiters);
+    if (scene.getLiquidInfo().use_split_viscosity) {
+      scalar coupled_error;
 
-    std::cout << "[implicit viscosity sub-step: " << i
-              << ", total iter: " << iter_out << ", res: " << residual << "]"
-              << std::endl;
+      viscosity::applyNodeViscosityImplicitSplit(
+          scene, m_node_visc_indices_x, m_node_visc_indices_y,
+          m_node_visc_indices_z, offset_nodes_x, offset_nodes_y,
+          offset_nodes_z, m_visc_matrix, m_visc_rhs, m_visc_solution,
+          node_vel_src_x, node_vel_src_y, node_vel_src_z, node_vel_x,
+          node_vel_y, node_vel_z,
+          scene.getLiquidInfo().viscosity_split_iterations, residual,
+          iter_out, coupled_error, m_viscous_criterion, m_maxiters);
+
+      std::cout << "[split viscosity sub-step: " << i
+                << ", total iter: " << iter_out << ", res: " << residual
+                << ", coupled res: " << coupled_error << "]" << std::endl;
+    } else {
+      viscosity::applyNodeViscosityImplicit(
+          scene, m_node_visc_indices_x, m_node_visc_indices_y,
+          m_node_visc_indices_z, offset_nodes_x, offset_nodes_y,
+          offset_nodes_z, m_visc_matrix, m_visc_rhs, m_visc_solution,
+          node_vel_x, node_vel_y, node_vel_z, residual, iter_out,
+          m_viscous_criterion, m_maxiters);
+
+      std::cout << "[implicit viscosity sub-step: " << i
+                << ", total iter: " << iter_out << ", res: " << residual
+                << "]" << std::endl;
+    }
+
+    recordSolve("viscosity", iter_out, residual, std::isfinite(residual));
   }
 
   return true;
 }
 
+void LinearizedImplicitEuler::checkSolveResidual(const TwoDScene& scene,
+                                                 const std::string& name,
+                                                 int iterations,
+                                                 const scalar& res_norm) {
+  const bool success = std::isfinite(res_norm) &&
+                       res_norm <= scene.getLiquidInfo().max_solver_residual;
+  recordSolve(name, iterations, res_norm, success);
+}
+
 bool LinearizedImplicitEuler::acceptVelocity(TwoDScene& scene) {
   const Sorter& buckets = scene.getParticleBuckets();
 
@@ -2305,6 +2494,8 @@ bool LinearizedImplicitEuler::stepImplicitElastoAMGPCG(TwoDScene& scene,
     std::cout << "[amg pcg elasto total iter: " << iterations
               << ", res: " << tolerance << "]" << std::endl;
 
+    recordSolve("elasto", iterations, tolerance, success);
+
     if (!success) {
       std::cout << "WARNING: AMG PCG solve failed!" << std::endl;
 
@@ -2342,13 +2533,128 @@ bool LinearizedImplicitEuler::stepImplicitElasto(TwoDScene& scene, scalar dt) {
   } else if (scene.getLiquidInfo().use_pcr) {
     return stepImplicitElastoDiagonalPCR(scene, dt);
   } else {
-    if (scene.getLiquidInfo().use_cosolve_angular)
+    if (scene.getLiquidInfo().use_cosolve_angular &&
+        !scene.getLiquidInfo().use_twist_condensation)
       return stepImplicitElastoDiagonalPCGCoSolve(scene, dt);
     else
       return stepImplicitElastoDiagonalPCG(scene, dt);
   }
 }
 
+bool LinearizedImplicitEuler::stepExplicitElasto(TwoDScene& scene, scalar dt) {
+  const int num_elasto = scene.getNumSoftElastoParticles();
+  const int ndof_elasto = num_elasto * 4;
+  if (ndof_elasto == 0) return true;
+
+  // stepVelocity and applyPressureDragElasto have already put the velocities
+  // pushed over the whole step by the forces at x^n (plus pressure and drag)
+  // into m_node_v_plus and the twists into m_angular_v_plus_buffer, which is
+  // symplectic Euler when the step fits under the elastic wave bound.
+  const int num_subcycles = scene.getNumElastoSubcycles(dt);
+  if (num_subcycles <= 1) return true;
+
+  const scalar sub_dt = dt / (scalar)num_subcycles;
+  const Sorter& buckets = scene.getParticleBuckets();
+  VectorXs& x = scene.getX();
+  const VectorXs& m = scene.getM();
+
+  auto zero_fixed = [&](VectorXs& vec) {
+    threadutils::for_each(0, num_elasto, [&](int pidx) {
+      if (scene.isFixed(pidx) & 1) vec.segment<3>(pidx * 4).setZero();
+      if (scene.isFixed(pidx) & 2) vec[pidx * 4 + 3] = 0.0;
+    });
+  };
+
+  // velocity change on the grid from an impulse on the vertices, into
+  // m_node_v_tmp
+  auto solve_impulse = [&](const VectorXs& part_impulse) {
+    mapSoftParticlesToNode(scene, m_node_v_tmp_x, m_node_v_tmp_y,
+                           m_node_v_tmp_z, part_impulse);
+
+    if (scene.getNumFluidParticles() > 0) {
+      performInvLocalSolve(scene, m_node_v_tmp_x, m_node_v_tmp_y,
+                           m_node_v_tmp_z, m_node_inv_Cs_x, m_node_inv_Cs_y,
+                           m_node_inv_Cs_z, m_node_v_tmp_x, m_node_v_tmp_y,
+                           m_node_v_tmp_z);
+    } else {
+      performLocalSolve(scene, m_node_v_tmp_x, m_node_v_tmp_y, m_node_v_tmp_z,
+                        scene.getNodeMassX(), scene.getNodeMassY(),
+                        scene.getNodeMassZ(), m_node_v_tmp_x, m_node_v_tmp_y,
+                        m_node_v_tmp_z);
+    }
+  };
+
+  // the vertices start the sub-cycles with what the grid gives them without
+  // the forces at x^n, and move on their own masses under the wave bound
+  VectorXs impulse = -m_elasto_impulse_buffer;
+  solve_impulse(impulse);
+
+  buckets.for_each_bucket([&](int bucket_idx) {
+    if (!scene.isBucketActivated(bucket_idx)) return;
+
+    m_node_v_tmp_x[bucket_idx] += m_node_v_plus_x[bucket_idx];
+    m_node_v_tmp_y[bucket_idx] += m_node_v_plus_y[bucket_idx];
+    m_node_v_tmp_z[bucket_idx] += m_node_v_plus_z[bucket_idx];
+  });
+
+  VectorXs part_v_start(ndof_elasto);
+  mapNodeToSoftParticles(scene, m_node_v_tmp_x, m_node_v_tmp_y, m_node_v_tmp_z,
+                         part_v_start);
+  threadutils::for_each(0, num_elasto, [&](int pidx) {
+    part_v_start[pidx * 4 + 3] =
+        m_angular_v_plus_buffer[pidx] +
+        impulse[pidx * 4 + 3] / std::max(1e-20, m[pidx * 4 + 3]);
+  });
+
+  // impulse of the sub-cycles so far
+  impulse = m_elasto_impulse_buffer * (sub_dt / dt);
+  VectorXs gradU(ndof_elasto);
+  VectorXs dv(ndof_elasto);
+  VectorXs disp = VectorXs::Zero(ndof_elasto);
+  const VectorXs x_start = x.segment(0, ndof_elasto);
+
+  for (int k = 1; k < num_subcycles; ++k) {
+    performLocalSolve(scene, impulse, m, dv);
+    dv += part_v_start;
+    zero_fixed(dv);
+    disp += dv * sub_dt;
+
+    // re-evaluate the particle forces at the sub-cycle positions, the stress
+    // at the gauss points follows the grid and stays at x^n
+    x.segment(0, ndof_elasto) = x_start + disp;
+    scene.precompute();
+
+    gradU.setZero();
+    scene.accumulateGradUParallel(gradU);
+    impulse -= gradU * sub_dt;
+  }
+
+  // the forces go back to x^n, where the advection starts from
+  x.segment(0, ndof_elasto) = x_start;
+  scene.precompute();
+
+  // swap the impulse of the forces at x^n for that of the sub-cycles, less
+  // the reactions the kinematic vertices take up
+  zero_fixed(impulse);
+  impulse -= m_elasto_impulse_buffer;
+  solve_impulse(impulse);
+
+  buckets.for_each_bucket([&](int bucket_idx) {
+    if (!scene.isBucketActivated(bucket_idx)) return;
+
+    m_node_v_plus_x[bucket_idx] += m_node_v_tmp_x[bucket_idx];
+    m_node_v_plus_y[bucket_idx] += m_node_v_tmp_y[bucket_idx];
+    m_node_v_plus_z[bucket_idx] += m_node_v_tmp_z[bucket_idx];
+  });
+
+  threadutils::for_each(0, num_elasto, [&](int pidx) {
+    m_angular_v_plus_buffer[pidx] +=
+        impulse[pidx * 4 + 3] / std::max(1e-20, m[pidx * 4 + 3]);
+  });
+
+  return true;
+}
+
 bool LinearizedImplicitEuler::applyPressureDragElasto(TwoDScene& scene,
                                                       scalar dt) {
   if (scene.getNumFluidParticles() == 0) return false;
@@ -2380,6 +2686,415 @@ bool LinearizedImplicitEuler::applyPressureDragElasto(TwoDScene& scene,
   return true;
 }
 
+void LinearizedImplicitEuler::scatterMonolithic(
+    const TwoDScene& scene, const VectorXs& x, std::vector<VectorXs>& node_v_x,
+    std::vector<VectorXs>& node_v_y, std::vector<VectorXs>& node_v_z,
+    std::vector<VectorXs>& node_p) {
+  const int num_elasto_dofs = m_effective_node_indices.size();
+  const int num_pressure_dofs = m_monolithic_pressure_indices.size();
+
+  // nodes off the DOFs are left untouched
+  threadutils::for_each(0, num_elasto_dofs, [&](int dof_idx) {
+    const Vector3i& index = m_effective_node_indices[dof_idx];
+    switch (index(1)) {
+      case 0:
+        node_v_x[index[0]][index[2]] = x[dof_idx];
+        break;
+      case 1:
+        node_v_y[index[0]][index[2]] = x[dof_idx];
+        break;
+      case 2:
+        node_v_z[index[0]][index[2]] = x[dof_idx];
+        break;
+      default:
+        break;
+    }
+  });
+
+  threadutils::for_each(0, num_pressure_dofs, [&](int dof_idx) {
+    const Vector2i& index = m_monolithic_pressure_indices[dof_idx];
+    node_p[index[0]][index[1]] = x[num_elasto_dofs + dof_idx];
+  });
+}
+
+void LinearizedImplicitEuler::gatherMonolithic(
+    const TwoDScene& scene, const std::vector<VectorXs>& node_v_x,
+    const std::vector<VectorXs>& node_v_y,
+    const std::vector<VectorXs>& node_v_z,
+    const std::vector<VectorXs>& node_p, VectorXs& x) {
+  const int num_elasto_dofs = m_effective_node_indices.size();
+  const int num_pressure_dofs = m_monolithic_pressure_indices.size();
+
+  if (x.size() != num_elasto_dofs + num_pressure_dofs)
+    x.resize(num_elasto_dofs + num_pressure_dofs);
+
+  threadutils::for_each(0, num_elasto_dofs, [&](int dof_idx) {
+    const Vector3i& index = m_effective_node_indices[dof_idx];
+    switch (index(1)) {
+      case 0:
+        x[dof_idx] = node_v_x[index[0]][index[2]];
+        break;
+      case 1:
+        x[dof_idx] = node_v_y[index[0]][index[2]];
+        break;
+      case 2:
+        x[dof_idx] = node_v_z[index[0]][index[2]];
+        break;
+      default:
+        x[dof_idx] = 0.0;
+        break;
+    }
+  });
+
+  threadutils::for_each(0, num_pressure_dofs, [&](int dof_idx) {
+    const Vector2i& index = m_monolithic_pressure_indices[dof_idx];
+    x[num_elasto_dofs + dof_idx] = node_p[index[0]][index[1]];
+  });
+}
+
+void LinearizedImplicitEuler::performMonolithicMultiply(TwoDScene& scene,
+                                                        const scalar& dt,
+                                                        const VectorXs& x,
+                                                        VectorXs& out) {
+  const Sorter& buckets = scene.getParticleBuckets();
+
+  // m_node_p and m_monolithic_pressure are zero off the DOFs
+  scatterMonolithic(scene, x, m_node_p_x, m_node_p_y, m_node_p_z,
+                    m_monolithic_pressure);
+
+  buckets.for_each_bucket([&](int bucket_idx) {
+    m_node_t_x[bucket_idx].setZero();
+    m_node_t_y[bucket_idx].setZero();
+    m_node_t_z[bucket_idx].setZero();
+    m_node_w_x[bucket_idx].setZero();
+    m_node_w_y[bucket_idx].setZero();
+    m_node_w_z[bucket_idx].setZero();
+  });
+
+  // elasto rows: (M_s + [hdvs]M_f + h^2 H) u_s minus the pressure force
+  performGlobalMultiply(scene, dt, m_node_Cs_x, m_node_Cs_y, m_node_Cs_z,
+                        m_node_p_x, m_node_p_y, m_node_p_z, m_node_q_x,
+                        m_node_q_y, m_node_q_z);
+
+  if (scene.getLiquidInfo().apply_pressure_solid)
+    pressure::applyPressureGradsElastoRHS(
+        scene, m_monolithic_pressure, m_node_t_x, m_node_t_y, m_node_t_z,
+        m_node_mfhdvm_hdvm_x, m_node_mfhdvm_hdvm_y, m_node_mfhdvm_hdvm_z, dt);
+
+  // pressure rows: divergence of the mixture, with u_f dragged by u_s and
+  // accelerated by the pressure
+  addSolidDrag(scene, m_node_p_x, m_node_p_y, m_node_p_z, m_node_w_x,
+               m_node_w_y, m_node_w_z);
+
+  pressure::applyPressureGradsFluid(
+      scene, m_monolithic_pressure, m_node_w_x, m_node_w_y, m_node_w_z,
+      m_node_inv_mfhdvm_x, m_node_inv_mfhdvm_y, m_node_inv_mfhdvm_z, dt);
+
+  pressure::constructNodeIncompressibleCondition(
+      scene, m_monolithic_ic, m_node_w_x, m_node_w_y, m_node_w_z, m_node_p_x,
+      m_node_p_y, m_node_p_z);
+
+  buckets.for_each_bucket([&](int bucket_idx) {
+    m_node_q_x[bucket_idx] -= m_node_t_x[bucket_idx];
+    m_node_q_y[bucket_idx] -= m_node_t_y[bucket_idx];
+    m_node_q_z[bucket_idx] -= m_node_t_z[bucket_idx];
+    m_monolithic_ic[bucket_idx] -= m_monolithic_ic_0[bucket_idx];
+  });
+
+  gatherMonolithic(scene, m_node_q_x, m_node_q_y, m_node_q_z, m_monolithic_ic,
+                   out);
+}
+
+bool LinearizedImplicitEuler::projectMonolithic(TwoDScene& scene, scalar dt) {
+  const Sorter& buckets = scene.getParticleBuckets();
+  const LiquidInfo& info = scene.getLiquidInfo();
+
+  m_effective_node_indices.clear();
+  m_monolithic_pressure_indices.clear();
+
+  int num_pressure_dofs = 0;
+
+  if (scene.getNumFluidParticles() > 0 &&
+      scene.getNumSoftElastoParticles() > 0) {
+    buildLocalGlobalMapping(scene, m_node_global_indices_x,
+                            m_node_global_indices_y, m_node_global_indices_z,
+                            m_effective_node_indices, m_dof_ijk);
+
+    allocateCenterNodeVectors(scene, m_fine_global_indices);
+
+    num_pressure_dofs = pressure::assembleNodePressure(
+        scene, m_fine_pressure_rhs, m_fine_pressure_matrix,
+        m_fine_global_indices, m_monolithic_pressure_indices,
+        m_monolithic_pressure_ijk, m_node_psi_fs_x, m_node_psi_fs_y,
+        m_node_psi_fs_z, m_node_psi_sf_x, m_node_psi_sf_y, m_node_psi_sf_z,
+        m_node_v_fluid_plus_x, m_node_v_fluid_plus_y, m_node_v_fluid_plus_z,
+        m_node_v_plus_x, m_node_v_plus_y, m_node_v_plus_z, m_node_inv_C_x,
+        m_node_inv_C_y, m_node_inv_C_z, m_node_inv_Cs_x, m_node_inv_Cs_y,
+        m_node_inv_Cs_z, m_node_mfhdvm_hdvm_x, m_node_mfhdvm_hdvm_y,
+        m_node_mfhdvm_hdvm_z, m_node_mshdvm_hdvm_x, m_node_mshdvm_hdvm_y,
+        m_node_mshdvm_hdvm_z, dt);
+  }
+
+  const int num_elasto_dofs = m_effective_node_indices.size();
+
+  // nothing couples the two solves, the split one is exact
+  if (num_elasto_dofs == 0 || num_pressure_dofs == 0) {
+    m_effective_node_indices.clear();
+    m_monolithic_pressure_indices.clear();
+
+    projectFine(scene, dt);
+    applyPressureDragElasto(scene, dt);
+    return stepImplicitElasto(scene, dt);
+  }
+
+  const int system_size = num_elasto_dofs + num_pressure_dofs;
+
+  // u_f^*
+  const auto& m_node_v_f_star_x = scene.getNodeFluidVelocityX();
+  const auto& m_node_v_f_star_y = scene.getNodeFluidVelocityY();
+  const auto& m_node_v_f_star_z = scene.getNodeFluidVelocityZ();
+
+  const std::vector<VectorXs>& node_mass_fluid_x = scene.getNodeFluidMassX();
+  const std::vector<VectorXs>& node_mass_fluid_y = scene.getNodeFluidMassY();
+  const std::vector<VectorXs>& node_mass_fluid_z = scene.getNodeFluidMassZ();
+
+  addFluidDragRHS(scene, m_node_v_f_star_x, m_node_v_f_star_y,
+                  m_node_v_f_star_z, m_node_rhs_x, m_node_rhs_y, m_node_rhs_z);
+
+  // start from the velocity of the split solve without pressure
+  performInvLocalSolve(scene, m_node_rhs_x, m_node_rhs_y, m_node_rhs_z,
+                       m_node_inv_Cs_x, m_node_inv_Cs_y, m_node_inv_Cs_z,
+                       m_node_v_plus_x, m_node_v_plus_y, m_node_v_plus_z);
+
+  constructHessianPreProcess(scene, dt);
+  constructHessianPostProcess(scene, dt);
+
+  const bool use_group_precondition = info.use_group_precondition;
+
+  allocateNodeVectors(scene, m_node_r_x, m_node_r_y, m_node_r_z);
+  allocateNodeVectors(scene, m_node_z_x, m_node_z_y, m_node_z_z);
+  allocateNodeVectors(scene, m_node_p_x, m_node_p_y, m_node_p_z);
+  allocateNodeVectors(scene, m_node_q_x, m_node_q_y, m_node_q_z);
+  allocateNodeVectors(scene, m_node_w_x, m_node_w_y, m_node_w_z);
+  allocateNodeVectors(scene, m_node_t_x, m_node_t_y, m_node_t_z);
+  allocateCenterNodeVectors(scene, m_monolithic_pressure);
+
+  // the divergence left by the drag-relaxed u_f^* and the kinematic solids
+  // is the right-hand side of the pressure rows, and with u_f zero the
+  // constant to remove from every product
+  buckets.for_each_bucket([&](int bucket_idx) {
+    const int num_nodes = scene.getNumNodes(bucket_idx);
+
+    m_node_p_x[bucket_idx].setZero();
+    m_node_p_y[bucket_idx].setZero();
+    m_node_p_z[bucket_idx].setZero();
+    m_node_r_x[bucket_idx].setZero();
+    m_node_r_y[bucket_idx].setZero();
+    m_node_r_z[bucket_idx].setZero();
+    m_node_w_x[bucket_idx].setZero();
+    m_node_w_y[bucket_idx].setZero();
+    m_node_w_z[bucket_idx].setZero();
+
+    for (int i = 0; i < num_nodes; ++i) {
+      m_node_z_x[bucket_idx][i] = m_node_v_fluid_plus_x[bucket_idx][i] *
+                                  node_mass_fluid_x[bucket_idx][i] *
+                                  m_node_inv_mfhdvm_x[bucket_idx][i];
+      m_node_z_y[bucket_idx][i] = m_node_v_fluid_plus_y[bucket_idx][i] *
+                                  node_mass_fluid_y[bucket_idx][i] *
+                                  m_node_inv_mfhdvm_y[bucket_idx][i];
+      m_node_z_z[bucket_idx][i] = m_node_v_fluid_plus_z[bucket_idx][i] *
+                                  node_mass_fluid_z[bucket_idx][i] *
+                                  m_node_inv_mfhdvm_z[bucket_idx][i];
+    }
+  });
+
+  pressure::constructNodeIncompressibleCondition(
+      scene, m_monolithic_ic_0, m_node_w_x, m_node_w_y, m_node_w_z, m_node_p_x,
+      m_node_p_y, m_node_p_z);
+
+  pressure::constructNodeIncompressibleCondition(
+      scene, m_monolithic_ic, m_node_z_x, m_node_z_y, m_node_z_z, m_node_p_x,
+      m_node_p_y, m_node_p_z);
+
+  VectorXs b;
+  gatherMonolithic(scene, m_node_rhs_x, m_node_rhs_y, m_node_rhs_z,
+                   m_monolithic_ic, b);
+  b.segment(num_elasto_dofs, num_pressure_dofs) *= -1.0;
+
+  // diagonal of M_s + [hdvs]M_f on the elasto DOFs
+  VectorXs inv_Cs;
+  gatherMonolithic(scene, m_node_inv_Cs_x, m_node_inv_Cs_y, m_node_inv_Cs_z,
+                   m_monolithic_ic, inv_Cs);
+
+  scalar norm_s = b.segment(0, num_elasto_dofs).norm();
+  scalar norm_p = b.segment(num_elasto_dofs, num_pressure_dofs).norm();
+  if (norm_s == 0.0) norm_s = 1.0;
+  if (norm_p == 0.0) norm_p = 1.0;
+
+  // each block is measured relative to its own right-hand side
+  VectorXs weights(system_size);
+  weights.segment(0, num_elasto_dofs).setConstant(1.0 / (norm_s * norm_s));
+  weights.segment(num_elasto_dofs, num_pressure_dofs)
+      .setConstant(1.0 / (norm_p * norm_p));
+
+  const int bucket_num_cell = scene.getDefaultNumNodes();
+  AMGPreconditioner<scalar> amg;
+  amg.build(m_fine_pressure_matrix, m_monolithic_pressure_ijk,
+            buckets.ni * bucket_num_cell, buckets.nj * bucket_num_cell,
+            buckets.nk * bucket_num_cell);
+
+  std::vector<scalar> amg_rhs(num_pressure_dofs);
+  std::vector<scalar> amg_result(num_pressure_dofs);
+  VectorXs precond_buffer(system_size);
+
+  // block upper-triangular preconditioner: a V-cycle on the split pressure
+  // matrix, which approximates the negated Schur complement, then the elasto
+  // block with the pressure force of that update moved to the right
+  auto precondition = [&](const VectorXs& r, VectorXs& z) {
+    if (z.size() != system_size) z.resize(system_size);
+
+    Eigen::Map<VectorXs>(&amg_rhs[0], num_pressure_dofs) =
+        r.segment(num_elasto_dofs, num_pressure_dofs);
+    amg.apply(amg_rhs, amg_result);
+
+    z.segment(0, num_elasto_dofs).setZero();
+    z.segment(num_elasto_dofs, num_pressure_dofs) =
+        -Eigen::Map<VectorXs>(&amg_result[0], num_pressure_dofs);
+
+    if (info.apply_pressure_solid) {
+      scatterMonolithic(scene, z, m_node_p_x, m_node_p_y, m_node_p_z,
+                        m_monolithic_pressure);
+
+      buckets.for_each_bucket([&](int bucket_idx) {
+        m_node_t_x[bucket_idx].setZero();
+        m_node_t_y[bucket_idx].setZero();
+        m_node_t_z[bucket_idx].setZero();
+      });
+
+      pressure::applyPressureGradsElastoRHS(
+          scene, m_monolithic_pressure, m_node_t_x, m_node_t_y, m_node_t_z,
+          m_node_mfhdvm_hdvm_x, m_node_mfhdvm_hdvm_y, m_node_mfhdvm_hdvm_z,
+          dt);
+
+      gatherMonolithic(scene, m_node_t_x, m_node_t_y, m_node_t_z,
+                       m_monolithic_pressure, precond_buffer);
+
+      precond_buffer.segment(0, num_elasto_dofs) +=
+          r.segment(0, num_elasto_dofs);
+    } else {
+      precond_buffer.segment(0, num_elasto_dofs) =
+          r.segment(0, num_elasto_dofs);
+    }
+
+    if (use_group_precondition) {
+      scatterMonolithic(scene, precond_buffer, m_node_r_x, m_node_r_y,
+                        m_node_r_z, m_monolithic_pressure);
+      performGroupedLocalSolve(scene, m_node_r_x, m_node_r_y, m_node_r_z,
+                               m_node_z_x, m_node_z_y, m_node_z_z);
+      gatherMonolithic(scene, m_node_z_x, m_node_z_y, m_node_z_z,
+                       m_monolithic_pressure, precond_buffer);
+      z.segment(0, num_elasto_dofs) =
+          precond_buffer.segment(0, num_elasto_dofs);
+    } else {
+      z.segment(0, num_elasto_dofs) =
+          precond_buffer.segment(0, num_elasto_dofs)
+              .cwiseProduct(inv_Cs.segment(0, num_elasto_dofs));
+    }
+  };
+
+  auto weighted_dot = [&](const VectorXs& a, const VectorXs& c) {
+    return a.cwiseProduct(weights).dot(c);
+  };
+
+  VectorXs x;
+  gatherMonolithic(scene, m_node_v_plus_x, m_node_v_plus_y, m_node_v_plus_z,
+                   m_monolithic_pressure, x);
+  x.segment(num_elasto_dofs, num_pressure_dofs).setZero();
+
+  VectorXs r;
+  performMonolithicMultiply(scene, dt, x, r);
+  r = b - r;
+
+  scalar res_s = r.segment(0, num_elasto_dofs).norm() / norm_s;
+  scalar res_p = r.segment(num_elasto_dofs, num_pressure_dofs).norm() / norm_p;
+
+  // restarted GCR, since the system is neither symmetric nor definite
+  const int num_restart = std::max(1, std::min(m_maxiters, 20));
+  if ((int)m_monolithic_z.size() != num_restart) {
+    m_monolithic_z.resize(num_restart);
+    m_monolithic_q.resize(num_restart);
+  }
+
+  VectorXs z, q;
+  int num_directions = 0;
+  int iter = 0;
+  for (; iter < m_maxiters &&
+         (res_s > m_pcg_criterion || res_p > m_pressure_criterion);
+       ++iter) {
+    precondition(r, z);
+    performMonolithicMultiply(scene, dt, z, q);
+
+    for (int j = 0; j < num_directions; ++j) {
+      const scalar beta = weighted_dot(q, m_monolithic_q[j]);
+      q -= m_monolithic_q[j] * beta;
+      z -= m_monolithic_z[j] * beta;
+    }
+
+    const scalar len = sqrt(weighted_dot(q, q));
+    if (!(len > 0.0)) break;
+
+    q /= len;
+    z /= len;
+
+    const scalar alpha = weighted_dot(r, q);
+    x += z * alpha;
+    r -= q * alpha;
+
+    if (num_directions == num_restart) num_directions = 0;
+    m_monolithic_z[num_directions] = z;
+    m_monolithic_q[num_directions] = q;
+    ++num_directions;
+
+    res_s = r.segment(0, num_elasto_dofs).norm() / norm_s;
+    res_p = r.segment(num_elasto_dofs, num_pressure_dofs).norm() / norm_p;
+
+    if (info.iteration_print_step > 0 && iter % info.iteration_print_step == 0)
+      std::cout << "[monolithic gcr total iter: " << iter
+                << ", elasto res: " << res_s << "/" << m_pcg_criterion
+                << ", pressure res: " << res_p << "/" << m_pressure_criterion
+                << "]" << std::endl;
+  }
+
+  std::cout << "[monolithic gcr total iter: " << iter
+            << ", elasto res: " << res_s << "/" << m_pcg_criterion
+            << ", pressure res: " << res_p << "/" << m_pressure_criterion
+            << ", dofs: " << num_elasto_dofs << " + " << num_pressure_dofs
+            << "]" << std::endl;
+
+  checkSolveResidual(scene, "monolithic", iter, std::max(res_s, res_p));
+
+  const bool converged =
+      res_s <= m_pcg_criterion && res_p <= m_pressure_criterion;
+
+  std::vector<VectorXs>& node_pressure = scene.getNodePressure();
+  buckets.for_each_bucket(
+      [&](int bucket_idx) { node_pressure[bucket_idx].setZero(); });
+
+  scatterMonolithic(scene, x, m_node_v_plus_x, m_node_v_plus_y,
+                    m_node_v_plus_z, node_pressure);
+
+  // keep the elasto right-hand side as the split solve leaves it
+  if (info.apply_pressure_solid)
+    pressure::applyPressureGradsElastoRHS(
+        scene, node_pressure, m_node_rhs_x, m_node_rhs_y, m_node_rhs_z,
+        m_node_mfhdvm_hdvm_x, m_node_mfhdvm_hdvm_y, m_node_mfhdvm_hdvm_z, dt);
+
+  // the strand twists only couple to the grid through the translational DOFs
+  stepImplicitTwistDiagonalPCG(scene, dt);
+
+  return converged;
+}
+
 void LinearizedImplicitEuler::pushFluidVelocity() {
   m_fluid_vel_stack.push(m_node_v_fluid_plus_x);
   m_fluid_vel_stack.push(m_node_v_fluid_plus_y);
@@ -2445,7 +3160,12 @@ bool LinearizedImplicitEuler::applyPressureDragFluid(TwoDScene& scene,
     // apply pressure
     std::vector<VectorXs>& node_pressure = scene.getNodePressure();
 
-    if (scene.getLiquidInfo().drag_by_future_solid) {
+    // the monolithic solve already gives u_s^{n+1} and the coupled pressure
+    const bool monolithic = scene.getLiquidInfo().use_monolithic_pressure &&
+                            scene.getLiquidInfo().solve_solid &&
+                            !scene.useExplicitElasto(dt);
+
+    if (scene.getLiquidInfo().drag_by_future_solid || monolithic) {
       const Sorter& buckets = scene.getParticleBuckets();
 
       buckets.for_each_bucket([&](int bucket_idx) {
@@ -2508,7 +3228,10 @@ bool LinearizedImplicitEuler::projectFine(TwoDScene& scene, scalar dt) {
 
   allocateCenterNodeVectors(scene, m_fine_global_indices);
 
-  pressure::solveNodePressure(
+  scalar pressure_residual = 0.0;
+  int pressure_iterations = 0;
+
+  const bool solved = pressure::solveNodePressure(
       scene, scene.getNodePressure(), m_fine_pressure_rhs,
       m_fine_pressure_matrix, m_fine_global_indices, m_node_psi_fs_x,
       m_node_psi_fs_y, m_node_psi_fs_z, m_node_psi_sf_x, m_node_psi_sf_y,
@@ -2517,8 +3240,10 @@ bool LinearizedImplicitEuler::projectFine(TwoDScene& scene, scalar dt) {
       m_node_inv_C_x, m_node_inv_C_y, m_node_inv_C_z, m_node_inv_Cs_x,
       m_node_inv_Cs_y, m_node_inv_Cs_z, m_node_mfhdvm_hdvm_x,
       m_node_mfhdvm_hdvm_y, m_node_mfhdvm_hdvm_z, m_node_mshdvm_hdvm_x,
-      m_node_mshdvm_hdvm_y, m_node_mshdvm_hdvm_z, dt, m_pressure_criterion,
-      m_maxiters);
+      m_node_mshdvm_hdvm_y, m_node_mshdvm_hdvm_z, dt, pressure_residual,
+      pressure_iterations, m_pressure_criterion, m_maxiters);
+
+  recordSolve("pressure", pressure_iterations, pressure_residual, solved);
 
 #ifdef CHECK_EQU_24
   pushFluidVelocity();
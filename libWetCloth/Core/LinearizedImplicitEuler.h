@@ -42,12 +42,17 @@ class LinearizedImplicitEuler : public SceneStepper {
 
   virtual bool stepImplicitElasto(TwoDScene& scene, scalar dt);
 
+  virtual bool stepExplicitElasto(TwoDScene& scene, scalar dt);
+
   virtual bool stepImplicitElastoLagrangian(TwoDScene& scene, scalar dt);
 
   virtual bool stepImplicitElastoDiagonalPCR(TwoDScene& scene, scalar dt);
 
   virtual bool stepImplicitElastoDiagonalPCG(TwoDScene& scene, scalar dt);
 
+  // diagonally preconditioned CG on the strand twists alone
+  virtual void stepImplicitTwistDiagonalPCG(TwoDScene& scene, scalar dt);
+
   virtual bool stepImplicitViscosityDiagonalPCG(
       const TwoDScene& scene, const std::vector<VectorXs>& node_vel_src_x,
       const std::vector<VectorXs>& node_vel_src_y,
@@ -65,6 +70,8 @@ class LinearizedImplicitEuler : public SceneStepper {
 
   virtual bool applyPressureDragElasto(TwoDScene& scene, scalar dt);
 
+  virtual bool projectMonolithic(TwoDScene& scene, scalar dt);
+
   virtual bool applyPressureDragFluid(TwoDScene& scene, scalar dt);
 
   virtual bool manifoldPropagate(TwoDScene& scene, scalar dt);
@@ -86,6 +93,10 @@ class LinearizedImplicitEuler : public SceneStepper {
  private:
   void zeroFixedDoFs(const TwoDScene& scene, VectorXs& vec);
 
+  // flag the solve as failed if the relative residual is not acceptable
+  void checkSolveResidual(const TwoDScene& scene, const std::string& name,
+                          int iterations, const scalar& res_norm);
+
   void performLocalSolve(const TwoDScene& scene,
                          const std::vector<VectorXs>& node_rhs_x,
                          const std::vector<VectorXs>& node_rhs_y,
@@ -128,6 +139,25 @@ class LinearizedImplicitEuler : public SceneStepper {
                                 std::vector<VectorXs>& out_node_vec_y,
                                 std::vector<VectorXs>& out_node_vec_z);
 
+  // copies between the flattened unknowns of the monolithic solve (elasto
+  // velocity DOFs, then pressure DOFs) and the node vectors
+  void scatterMonolithic(const TwoDScene& scene, const VectorXs& x,
+                         std::vector<VectorXs>& node_v_x,
+                         std::vector<VectorXs>& node_v_y,
+                         std::vector<VectorXs>& node_v_z,
+                         std::vector<VectorXs>& node_p);
+
+  void gatherMonolithic(const TwoDScene& scene,
+                        const std::vector<VectorXs>& node_v_x,
+                        const std::vector<VectorXs>& node_v_y,
+                        const std::vector<VectorXs>& node_v_z,
+                        const std::vector<VectorXs>& node_p, VectorXs& x);
+
+  // applies the linear part of the coupled momentum and incompressibility
+  // equations, with the fluid velocity eliminated node by node
+  void performMonolithicMultiply(TwoDScene& scene, const scalar& dt,
+                                 const VectorXs& x, VectorXs& out);
+
   void performGlobalMultiply(const TwoDScene& scene, const scalar& dt,
                              const std::vector<VectorXs>& node_m_x,
                              const std::vector<VectorXs>& node_m_y,
@@ -262,6 +292,24 @@ class LinearizedImplicitEuler : public SceneStepper {
 
   void constructAngularHessianPostProcess(TwoDScene& scene, const scalar& dt);
 
+  void constructTwistCondensation(TwoDScene& scene, const scalar& dt);
+
+  void condenseTwist(const scalar& dt, const VectorXs& part_vec,
+                     VectorXs& out);
+
+  scalar condenseTwistRHS(const TwoDScene& scene, const scalar& dt,
+                          std::vector<VectorXs>& node_res_x,
+                          std::vector<VectorXs>& node_res_y,
+                          std::vector<VectorXs>& node_res_z,
+                          std::vector<VectorXs>& node_tmp_x,
+                          std::vector<VectorXs>& node_tmp_y,
+                          std::vector<VectorXs>& node_tmp_z);
+
+  void recoverTwist(const TwoDScene& scene, const scalar& dt);
+
+  void multiplyTwistCoupling(const SparseRXs& C, const VectorXs& x,
+                             const scalar& s, VectorXs& out);
+
   //    std::vector< Eigen::SimplicialLDLT< SparseXs >* > m_local_solvers;
 
   //    SparseXs m_A;
@@ -274,6 +322,7 @@ class LinearizedImplicitEuler : public SceneStepper {
 
   VectorXs m_angular_moment_buffer;
   VectorXs m_angular_v_plus_buffer;
+  VectorXs m_elasto_impulse_buffer;
 
   std::vector<std::vector<std::vector<Matrix3s> > > m_gauss_ddphidfdf;
 
@@ -286,6 +335,15 @@ class LinearizedImplicitEuler : public SceneStepper {
   const int m_viscosity_substeps;
   const int m_surf_tension_substeps;
 
+  // twist-twist block of M + h^2 H and the twist rows of H coupling to the
+  // translational DOFs, for the Schur complement over the strand twists
+  bool m_twist_condensed;
+  TripletXs m_twist_triA;
+  SparseRXs m_twist_coupling;
+  SparseRXs m_twist_coupling_t;
+  Eigen::SimplicialLDLT<SparseXs> m_twist_solver;
+  VectorXs m_twist_buffer;
+
   std::vector<VectorXs> m_node_rhs_x;
   std::vector<VectorXs> m_node_rhs_y;
   std::vector<VectorXs> m_node_rhs_z;
@@ -468,6 +526,16 @@ class LinearizedImplicitEuler : public SceneStepper {
   robertbridson::SparseMatrix<scalar> m_fine_pressure_matrix;
   std::vector<VectorXi> m_fine_global_indices;
 
+  // monolithic solve: pressure DOF locations, the divergence of the known
+  // solid velocities, and the GCR directions with their images
+  std::vector<Vector2i> m_monolithic_pressure_indices;
+  std::vector<Vector3i> m_monolithic_pressure_ijk;
+  std::vector<VectorXs> m_monolithic_pressure;
+  std::vector<VectorXs> m_monolithic_ic;
+  std::vector<VectorXs> m_monolithic_ic_0;
+  std::vector<VectorXs> m_monolithic_z;
+  std::vector<VectorXs> m_monolithic_q;
+
   SparseXs m_A;
   std::vector<VectorXi> m_node_global_indices_x;
   std::vector<VectorXi> m_node_global_indices_y;
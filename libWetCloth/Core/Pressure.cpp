@@ -282,10 +282,12 @@ void constructNodeIncompressibleCondition(
   });
 }
 
-void solveNodePressure(
-    const TwoDScene& scene, std::vector<VectorXs>& pressure,
-    std::vector<double>& rhs, robertbridson::SparseMatrix<scalar>& matrix,
+int assembleNodePressure(
+    const TwoDScene& scene, std::vector<double>& rhs,
+    robertbridson::SparseMatrix<scalar>& matrix,
     std::vector<VectorXi>& node_global_indices,
+    std::vector<Vector2i>& effective_node_indices,
+    std::vector<Vector3i>& dof_ijk,
     const std::vector<VectorXs>& node_psi_fs_x,
     const std::vector<VectorXs>& node_psi_fs_y,
     const std::vector<VectorXs>& node_psi_fs_z,
@@ -309,13 +311,9 @@ void solveNodePressure(
     const std::vector<VectorXs>& node_mfhdvm_hdvm_z,
     const std::vector<VectorXs>& node_mshdvm_hdvm_x,  // (M_s+hDVm)^{-1}hDVm
     const std::vector<VectorXs>& node_mshdvm_hdvm_y,
-    const std::vector<VectorXs>& node_mshdvm_hdvm_z, const scalar& dt,
-    const scalar& criterion, int maxiters) {
+    const std::vector<VectorXs>& node_mshdvm_hdvm_z, const scalar& dt) {
   const Sorter& buckets = scene.getParticleBuckets();
   const int bucket_num_cell = scene.getDefaultNumNodes();
-  const int ni = buckets.ni * bucket_num_cell;
-  const int nj = buckets.nj * bucket_num_cell;
-  const int nk = buckets.nk * bucket_num_cell;
 
   const std::vector<VectorXs>& node_liquid_phi = scene.getNodeLiquidPhi();
   const std::vector<VectorXi>& pressure_neighbors =
@@ -396,15 +394,10 @@ void solveNodePressure(
 
   const int total_num_nodes =
       num_effective_nodes[num_effective_nodes.size() - 1];
-  if (total_num_nodes == 0) return;
+  if (total_num_nodes == 0) return 0;
 
-  std::vector<Vector2i> effective_node_indices(total_num_nodes);
-  std::vector<Vector3i> dof_ijk(total_num_nodes);
-  std::vector<double> result(total_num_nodes);
-
-  result.assign(total_num_nodes, 0.0);
-  buckets.for_each_bucket(
-      [&](int bucket_idx) { pressure[bucket_idx].setZero(); });
+  effective_node_indices.resize(total_num_nodes);
+  dof_ijk.resize(total_num_nodes);
 
   if ((int)rhs.size() != total_num_nodes) {
     rhs.resize(total_num_nodes);
@@ -790,6 +783,67 @@ void solveNodePressure(
     }
   });
 
+  return total_num_nodes;
+}
+
+bool solveNodePressure(
+    const TwoDScene& scene, std::vector<VectorXs>& pressure,
+    std::vector<double>& rhs, robertbridson::SparseMatrix<scalar>& matrix,
+    std::vector<VectorXi>& node_global_indices,
+    const std::vector<VectorXs>& node_psi_fs_x,
+    const std::vector<VectorXs>& node_psi_fs_y,
+    const std::vector<VectorXs>& node_psi_fs_z,
+    const std::vector<VectorXs>& node_psi_sf_x,
+    const std::vector<VectorXs>& node_psi_sf_y,
+    const std::vector<VectorXs>& node_psi_sf_z,
+    const std::vector<VectorXs>& node_fluid_vel_x,
+    const std::vector<VectorXs>& node_fluid_vel_y,
+    const std::vector<VectorXs>& node_fluid_vel_z,
+    const std::vector<VectorXs>& node_elasto_vel_x,
+    const std::vector<VectorXs>& node_elasto_vel_y,
+    const std::vector<VectorXs>& node_elasto_vel_z,
+    const std::vector<VectorXs>& node_inv_C_x,
+    const std::vector<VectorXs>& node_inv_C_y,
+    const std::vector<VectorXs>& node_inv_C_z,
+    const std::vector<VectorXs>& node_inv_Cs_x,
+    const std::vector<VectorXs>& node_inv_Cs_y,
+    const std::vector<VectorXs>& node_inv_Cs_z,
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_x,  // (M_f+hDVm)^{-1}hDVm
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_y,
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_z,
+    const std::vector<VectorXs>& node_mshdvm_hdvm_x,  // (M_s+hDVm)^{-1}hDVm
+    const std::vector<VectorXs>& node_mshdvm_hdvm_y,
+    const std::vector<VectorXs>& node_mshdvm_hdvm_z, const scalar& dt,
+    scalar& residual, int& iter_out, const scalar& criterion, int maxiters) {
+  std::vector<Vector2i> effective_node_indices;
+  std::vector<Vector3i> dof_ijk;
+
+  const int total_num_nodes = assembleNodePressure(
+      scene, rhs, matrix, node_global_indices, effective_node_indices,
+      dof_ijk, node_psi_fs_x, node_psi_fs_y, node_psi_fs_z, node_psi_sf_x,
+      node_psi_sf_y, node_psi_sf_z, node_fluid_vel_x, node_fluid_vel_y,
+      node_fluid_vel_z, node_elasto_vel_x, node_elasto_vel_y,
+      node_elasto_vel_z, node_inv_C_x, node_inv_C_y, node_inv_C_z,
+      node_inv_Cs_x, node_inv_Cs_y, node_inv_Cs_z, node_mfhdvm_hdvm_x,
+      node_mfhdvm_hdvm_y, node_mfhdvm_hdvm_z, node_mshdvm_hdvm_x,
+      node_mshdvm_hdvm_y, node_mshdvm_hdvm_z, dt);
+
+  if (total_num_nodes == 0) {
+    residual = 0.0;
+    iter_out = 0;
+    return true;
+  }
+
+  const Sorter& buckets = scene.getParticleBuckets();
+  const int bucket_num_cell = scene.getDefaultNumNodes();
+  const int ni = buckets.ni * bucket_num_cell;
+  const int nj = buckets.nj * bucket_num_cell;
+  const int nk = buckets.nk * bucket_num_cell;
+
+  std::vector<double> result(total_num_nodes, 0.0);
+  buckets.for_each_bucket(
+      [&](int bucket_idx) { pressure[bucket_idx].setZero(); });
+
   bool success = false;
   scalar tolerance = 0.0;
   int iterations = 0;
@@ -827,6 +881,11 @@ void solveNodePressure(
     const Vector2i& dof_loc = effective_node_indices[dof_idx];
     pressure[dof_loc[0]][dof_loc[1]] = result[dof_idx];
   });
+
+  residual = tolerance;
+  iter_out = iterations;
+
+  return success && std::isfinite(tolerance);
 }
 
 void multiplyPressureMatrix(const TwoDScene& scene,
@@ -1871,12 +1930,7 @@ void extrapolate(const TwoDScene& scene, std::vector<VectorXuc>& node_valid,
                 assert(neigh_idx(r) >= 0 && neigh_idx(r) < num_nodes);
               }
 
-              if (node_bucket_handle(0) < 0 ||
-                  node_bucket_handle(0) >= buckets.dim_size(0) ||
-                  node_bucket_handle(1) < 0 ||
-                  node_bucket_handle(1) >= buckets.dim_size(1) ||
-                  node_bucket_handle(2) < 0 ||
-                  node_bucket_handle(2) >= buckets.dim_size(2))
+              if (!buckets.has_bucket(node_bucket_handle))
                 continue;
 
               const int node_bucket_idx =
@@ -39,7 +39,42 @@ void multiplyPressureMatrix(const TwoDScene& scene,
                             const std::vector<VectorXs>& node_inv_mdvs_y,
                             const std::vector<VectorXs>& node_inv_mdvs_z,
                             const scalar& dt);
-void solveNodePressure(
+
+// assigns the pressure DOFs and builds the ghost-fluid pressure matrix and
+// right-hand side. Returns the number of DOFs, with effective_node_indices
+// mapping each DOF to its (bucket, node) and dof_ijk to its grid cell.
+int assembleNodePressure(
+    const TwoDScene& scene, std::vector<double>& rhs,
+    robertbridson::SparseMatrix<scalar>& matrix,
+    std::vector<VectorXi>& node_global_indices,
+    std::vector<Vector2i>& effective_node_indices,
+    std::vector<Vector3i>& dof_ijk,
+    const std::vector<VectorXs>& node_psi_fs_x,
+    const std::vector<VectorXs>& node_psi_fs_y,
+    const std::vector<VectorXs>& node_psi_fs_z,
+    const std::vector<VectorXs>& node_psi_sf_x,
+    const std::vector<VectorXs>& node_psi_sf_y,
+    const std::vector<VectorXs>& node_psi_sf_z,
+    const std::vector<VectorXs>& node_fluid_vel_x,
+    const std::vector<VectorXs>& node_fluid_vel_y,
+    const std::vector<VectorXs>& node_fluid_vel_z,
+    const std::vector<VectorXs>& node_elasto_vel_x,
+    const std::vector<VectorXs>& node_elasto_vel_y,
+    const std::vector<VectorXs>& node_elasto_vel_z,
+    const std::vector<VectorXs>& node_inv_C_x,
+    const std::vector<VectorXs>& node_inv_C_y,
+    const std::vector<VectorXs>& node_inv_C_z,
+    const std::vector<VectorXs>& node_inv_Cs_x,
+    const std::vector<VectorXs>& node_inv_Cs_y,
+    const std::vector<VectorXs>& node_inv_Cs_z,
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_x,  // (M_f+hDVm)^{-1}hDVm
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_y,
+    const std::vector<VectorXs>& node_mfhdvm_hdvm_z,
+    const std::vector<VectorXs>& node_mshdvm_hdvm_x,  // (M_s+hDVm)^{-1}hDVm
+    const std::vector<VectorXs>& node_mshdvm_hdvm_y,
+    const std::vector<VectorXs>& node_mshdvm_hdvm_z, const scalar& dt);
+
+bool solveNodePressure(
     const TwoDScene& scene, std::vector<VectorXs>& pressure,
     std::vector<double>& rhs, robertbridson::SparseMatrix<scalar>& matrix,
     std::vector<VectorXi>& node_global_indices,
@@ -67,7 +102,7 @@ void solveNodePressure(
     const std::vector<VectorXs>& node_mshdvm_hdvm_x,  // (M_s+hDVm)^{-1}hDVm
     const std::vector<VectorXs>& node_mshdvm_hdvm_y,
     const std::vector<VectorXs>& node_mshdvm_hdvm_z, const scalar& dt,
-    const scalar& criterion, int maxiters);
+    scalar& residual, int& iter_out, const scalar& criterion, int maxiters);
 
 void constructJacobiPreconditioner(const TwoDScene& scene,
                                    std::vector<VectorXs>& out_node_vec,
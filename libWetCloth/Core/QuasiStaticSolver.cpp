@@ -0,0 +1,240 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "QuasiStaticSolver.h"
+
+#include <Eigen/SparseCholesky>
+#include <iostream>
+
+#include "CohesionForce.h"
+#include "LevelSetForce.h"
+#include "ThreadUtils.h"
+
+// sufficient decrease for the line search [Nocedal and Wright 2006]
+const static scalar g_armijo_coeff = 1e-4;
+const static int g_max_line_search_steps = 20;
+const static int g_max_regularizations = 16;
+
+// pseudo time of the mass regularization
+const static scalar g_initial_pseudo_dt = 0.1;
+const static scalar g_max_pseudo_dt = 1e+3;
+
+QuasiStaticSolver::QuasiStaticSolver(int max_iterations,
+                                     const scalar& tolerance)
+    : m_max_iterations(max_iterations),
+      m_tolerance(tolerance),
+      m_num_iterations(0),
+      m_residual(0.0) {}
+
+int QuasiStaticSolver::getNumIterations() const { return m_num_iterations; }
+
+scalar QuasiStaticSolver::getResidual() const { return m_residual; }
+
+scalar QuasiStaticSolver::evaluate(TwoDScene& scene, const VectorXs& x,
+                                   bool derivatives) {
+  scene.getX() = x;
+
+  const VectorXs& m = scene.getM();
+  const VectorXs& psi = scene.getVolumeFraction();
+  const scalar lambda = scene.getLiquidInfo().lambda;
+
+  for (auto& force : m_forces) force->preCompute();
+
+  scalar E = 0.0;
+  for (auto& force : m_forces)
+    force->addEnergyToTotal(x, m_zero_v, m, psi, lambda, E);
+
+  if (!derivatives) return E;
+
+  VectorXs gradE = VectorXs::Zero(x.size());
+  for (auto& force : m_forces)
+    force->addGradEToTotal(x, m_zero_v, m, psi, lambda, gradE);
+
+  const int num_free = (int)m_free_dofs.size();
+  m_gradient.resize(num_free);
+  for (int i = 0; i < num_free; ++i) m_gradient(i) = gradE(m_free_dofs[i]);
+
+  int num_hess = 0;
+  std::vector<int> offsets(m_forces.size());
+  for (int i = 0; i < (int)m_forces.size(); ++i) {
+    offsets[i] = num_hess;
+    num_hess += m_forces[i]->numHessX();
+  }
+
+  m_hess_triplets.resize(num_hess);
+  for (int i = 0; i < (int)m_forces.size(); ++i)
+    m_forces[i]->addHessXToTotal(x, m_zero_v, m, psi, lambda, m_hess_triplets,
+                                 offsets[i], 0.0);
+
+  TripletXs free_triplets;
+  free_triplets.reserve(num_hess);
+  for (const Triplets& t : m_hess_triplets) {
+    const int r = m_dof_index[t.row()];
+    const int c = m_dof_index[t.col()];
+    if (r >= 0 && c >= 0 && t.value() != 0.0)
+      free_triplets.push_back(Triplets(r, c, t.value()));
+  }
+
+  m_hessian.resize(num_free, num_free);
+  m_hessian.setFromTriplets(free_triplets.begin(), free_triplets.end());
+
+  return E;
+}
+
+bool QuasiStaticSolver::solve(TwoDScene& scene) {
+  // elastic forces, colliders and gravity; cohesion comes from the liquid
+  m_forces.clear();
+  std::vector<LevelSetForce*> levelset_forces;
+  for (auto& force : scene.getForces()) {
+    if (!(force->flag() & 1)) continue;
+    if (std::dynamic_pointer_cast<CohesionForce>(force)) continue;
+
+    LevelSetForce* levelset = dynamic_cast<LevelSetForce*>(force.get());
+    if (levelset) {
+      // the grid is not rebuilt during the solve
+      levelset->setUseDistanceField(true);
+      levelset_forces.push_back(levelset);
+    }
+    m_forces.push_back(force);
+  }
+
+  const int num_elasto = scene.getNumSoftElastoParticles();
+  const VectorXs& m = scene.getM();
+
+  VectorXs x = scene.getX();
+  m_zero_v = VectorXs::Zero(x.size());
+
+  m_dof_index.assign(x.size(), -1);
+  m_free_dofs.clear();
+  for (int i = 0; i < num_elasto; ++i) {
+    const unsigned char fixed = scene.isFixed(i);
+    if (!(fixed & 1)) {
+      for (int r = 0; r < 3; ++r) {
+        m_dof_index[i * 4 + r] = (int)m_free_dofs.size();
+        m_free_dofs.push_back(i * 4 + r);
+      }
+    }
+    if (scene.isTwist(i) && !(fixed & 2)) {
+      m_dof_index[i * 4 + 3] = (int)m_free_dofs.size();
+      m_free_dofs.push_back(i * 4 + 3);
+    }
+  }
+
+  const int num_free = (int)m_free_dofs.size();
+  VectorXs mass(num_free);
+  for (int i = 0; i < num_free; ++i)
+    mass(i) = std::max(1e-12, m(m_free_dofs[i]));
+
+  const scalar max_move = scene.getCellSize();
+
+  scalar pseudo_dt = g_initial_pseudo_dt;
+  scalar initial_residual = 0.0;
+  bool converged = (num_free == 0);
+
+  m_num_iterations = 0;
+  m_residual = 0.0;
+
+  for (int iter = 0; iter < m_max_iterations && !converged; ++iter) {
+    // viscous forces measure from the current iterate, so they only damp
+    // the steps and vanish at the equilibrium
+    scene.getX() = x;
+    for (auto& force : m_forces) force->updateStartState();
+
+    const scalar E = evaluate(scene, x, true);
+
+    m_residual = m_gradient.lpNorm<Eigen::Infinity>();
+    if (iter == 0) initial_residual = m_residual;
+    m_num_iterations = iter;
+
+    if (m_residual <= m_tolerance * initial_residual || m_residual < 1e-63) {
+      converged = true;
+      break;
+    }
+
+    // Newton direction, with more regularization until it is a descent one
+    VectorXs d;
+    bool found = false;
+    for (int k = 0; k < g_max_regularizations && !found; ++k) {
+      SparseXs A = m_hessian;
+      for (int i = 0; i < num_free; ++i)
+        A.coeffRef(i, i) += mass(i) / (pseudo_dt * pseudo_dt);
+
+      Eigen::SimplicialLDLT<SparseXs> solver(A);
+      if (solver.info() == Eigen::Success &&
+          solver.vectorD().minCoeff() > 0.0) {
+        d = solver.solve(-m_gradient);
+        found = d.allFinite() && d.dot(m_gradient) < 0.0;
+      }
+
+      if (!found) pseudo_dt *= 0.25;
+    }
+
+    if (!found) {
+      std::cout << "[quasi-static: no descent direction found]" << std::endl;
+      break;
+    }
+
+    // never move a vertex by more than a cell, the colliders are thin
+    scalar max_d = 0.0;
+    for (int i = 0; i < num_free; ++i)
+      if (m_free_dofs[i] % 4 != 3) max_d = std::max(max_d, fabs(d(i)));
+    if (max_d > max_move) d *= max_move / max_d;
+
+    const scalar slope = d.dot(m_gradient);
+    scalar alpha = 1.0;
+    bool accepted = false;
+    VectorXs x_trial = x;
+    for (int k = 0; k < g_max_line_search_steps; ++k) {
+      for (int i = 0; i < num_free; ++i)
+        x_trial(m_free_dofs[i]) = x(m_free_dofs[i]) + alpha * d(i);
+
+      const scalar E_trial = evaluate(scene, x_trial, false);
+      if (std::isfinite(E_trial) &&
+          E_trial <= E + g_armijo_coeff * alpha * slope) {
+        accepted = true;
+        break;
+      }
+      alpha *= 0.5;
+    }
+
+    std::cout << "[quasi-static iter: " << iter << ", energy: " << E
+              << ", residual: " << m_residual << ", step: " << alpha
+              << ", pseudo-dt: " << pseudo_dt << "]" << std::endl;
+
+    if (accepted) {
+      x = x_trial;
+      if (alpha == 1.0)
+        pseudo_dt = std::min(pseudo_dt * 2.0, g_max_pseudo_dt);
+    } else {
+      pseudo_dt *= 0.25;
+    }
+  }
+
+  if (!converged) m_num_iterations = m_max_iterations;
+
+  for (LevelSetForce* levelset : levelset_forces)
+    levelset->setUseDistanceField(false);
+
+  // leave the scene at rest in the settled state
+  scene.getX() = x;
+  VectorXs& v = scene.getV();
+  threadutils::for_each(0, num_elasto,
+                        [&](int i) { v.segment<4>(i * 4).setZero(); });
+
+  for (auto& force : m_forces) force->preCompute();
+  scene.updateGaussSystem(0.0);
+
+  std::cout << "[quasi-static " << (converged ? "converged" : "stopped")
+            << " after " << m_num_iterations
+            << " iterations, residual: " << m_residual << " (initial "
+            << initial_residual << ")]" << std::endl;
+
+  return converged;
+}
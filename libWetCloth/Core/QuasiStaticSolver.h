@@ -0,0 +1,60 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef QUASI_STATIC_SOLVER_H
+#define QUASI_STATIC_SOLVER_H
+
+#include <memory>
+#include <vector>
+
+#include "Force.h"
+#include "MathDefs.h"
+#include "TwoDScene.h"
+
+/*!
+ * Finds the rest pose of the elastic objects under their elastic forces,
+ * the colliders and gravity, ignoring the liquid. Each iteration takes a
+ * Newton step regularized with the mass matrix (a backward Euler step of
+ * pseudo time h that grows as the steps are accepted), followed by a
+ * backtracking line search on the total energy.
+ */
+class QuasiStaticSolver {
+ public:
+  QuasiStaticSolver(int max_iterations, const scalar& tolerance);
+
+  // returns true if the gradient dropped below tolerance times its initial
+  // norm; the scene is left at the last iterate with zero elastic velocity
+  bool solve(TwoDScene& scene);
+
+  int getNumIterations() const;
+  scalar getResidual() const;
+
+ private:
+  // places the scene at x and returns the energy; with derivatives the
+  // gradient and Hessian over the free DOFs are computed as well
+  scalar evaluate(TwoDScene& scene, const VectorXs& x, bool derivatives);
+
+  int m_max_iterations;
+  scalar m_tolerance;
+
+  int m_num_iterations;
+  scalar m_residual;
+
+  std::vector<std::shared_ptr<Force> > m_forces;
+  std::vector<int> m_dof_index;
+  std::vector<int> m_free_dofs;
+
+  VectorXs m_zero_v;
+  VectorXs m_gradient;
+  SparseXs m_hessian;
+  TripletXs m_hess_triplets;
+};
+
+#endif
@@ -12,6 +12,8 @@
 
 #include <numeric>
 
+SceneStepper::SceneStepper() : m_apic(true), m_solve_failed(false) {}
+
 SceneStepper::~SceneStepper() {}
 
 bool SceneStepper::advectScene(TwoDScene& scene, scalar dt) {
@@ -44,6 +46,27 @@ void SceneStepper::setUseApic(bool apic) { m_apic = apic; }
 
 bool SceneStepper::useApic() const { return m_apic; }
 
+bool SceneStepper::hasSolveFailure() const { return m_solve_failed; }
+
+void SceneStepper::clearSolveFailure() { m_solve_failed = false; }
+
+const std::map<std::string, SceneStepper::SolveStats>&
+SceneStepper::getSolveStats() const {
+  return m_solve_stats;
+}
+
+void SceneStepper::clearSolveStats() { m_solve_stats.clear(); }
+
+void SceneStepper::recordSolve(const std::string& name, int iterations,
+                               const scalar& residual, bool success) {
+  SolveStats& stats = m_solve_stats[name];
+  stats.iterations = iterations;
+  stats.residual = residual;
+  stats.success = success;
+
+  if (!success) m_solve_failed = true;
+}
+
 void SceneStepper::mapNodeToSoftParticles(
     const TwoDScene& scene, const std::vector<VectorXs>& node_vec_x,
     const std::vector<VectorXs>& node_vec_y,
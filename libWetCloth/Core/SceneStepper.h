@@ -11,13 +11,23 @@
 #define SCENE_STEPPER
 
 #include <functional>
+#include <map>
 #include <stack>
+#include <string>
 
 #include "MathDefs.h"
 #include "TwoDScene.h"
 
 class SceneStepper {
  public:
+  struct SolveStats {
+    int iterations;
+    scalar residual;
+    bool success;
+  };
+
+  SceneStepper();
+
   virtual ~SceneStepper();
 
   virtual bool stepScene(TwoDScene& scene, scalar dt) = 0;
@@ -30,6 +40,11 @@ class SceneStepper {
 
   virtual bool applyPressureDragElasto(TwoDScene& scene, scalar dt) = 0;
 
+  // solves the pressure and the elasto velocities as one coupled system,
+  // replacing projectFine, applyPressureDragElasto and stepImplicitElasto.
+  // Returns whether the coupled solve converged.
+  virtual bool projectMonolithic(TwoDScene& scene, scalar dt) = 0;
+
   virtual bool applyPressureDragFluid(TwoDScene& scene, scalar dt) = 0;
 
   virtual bool acceptVelocity(TwoDScene& scene) = 0;
@@ -40,6 +55,10 @@ class SceneStepper {
 
   virtual bool stepImplicitElasto(TwoDScene& scene, scalar dt) = 0;
 
+  // symplectic Euler in place of stepImplicitElasto, sub-cycled under the
+  // elastic wave-speed bound
+  virtual bool stepExplicitElasto(TwoDScene& scene, scalar dt) = 0;
+
   virtual bool stepImplicitElastoLagrangian(TwoDScene& scene, scalar dt) = 0;
 
   virtual scalar computeDivergence(TwoDScene& scene) = 0;
@@ -60,6 +79,16 @@ class SceneStepper {
 
   virtual bool useApic() const;
 
+  // whether a linear solve failed since the last clearSolveFailure()
+  virtual bool hasSolveFailure() const;
+
+  virtual void clearSolveFailure();
+
+  // iterations and final residual of the linear solves, by solver name
+  virtual const std::map<std::string, SolveStats>& getSolveStats() const;
+
+  virtual void clearSolveStats();
+
   // tools function
   void mapNodeToSoftParticles(const TwoDScene& scene,
                               const std::vector<VectorXs>& node_vec_x,
@@ -149,7 +178,12 @@ class SceneStepper {
   void allocateLagrangianVectors(const TwoDScene& scene, VectorXs& vec);
 
  protected:
+  void recordSolve(const std::string& name, int iterations,
+                   const scalar& residual, bool success);
+
   bool m_apic;
+  bool m_solve_failed;
+  std::map<std::string, SolveStats> m_solve_stats;
 };
 
 #endif
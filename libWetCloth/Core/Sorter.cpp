@@ -13,13 +13,19 @@
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <tbb/tbb.h>
 
+#include <algorithm>
+
 using namespace std;
 
-Sorter::Sorter() : ni(0), nj(0), nk(0) { array_sup.resize(0); }
+Sorter::Sorter() : ni(0), nj(0), nk(0), is_sparse(false), subdiv(1) {
+  array_sup.resize(0);
+}
 
-Sorter::Sorter(int ni_, int nj_, int nk_) : ni(ni_), nj(nj_), nk(nk_) {
+Sorter::Sorter(int ni_, int nj_, int nk_)
+    : ni(ni_), nj(nj_), nk(nk_), is_sparse(false), subdiv(1) {
   resize(ni, nj, nk);
 }
 
@@ -30,4 +36,157 @@ void Sorter::resize(int ni_, int nj_, int nk_) {
   ni = ni_;
   nj = nj_;
   nk = nk_;
+
+  is_sparse = false;
+  subdiv = 1;
+  handles.clear();
+  table_keys.clear();
+  table_values.clear();
+}
+
+void Sorter::assign_domain(const Sorter& other) {
+  ni = other.ni;
+  nj = other.nj;
+  nk = other.nk;
+  is_sparse = other.is_sparse;
+  subdiv = other.subdiv;
+  handles = other.handles;
+  table_keys = other.table_keys;
+  table_values = other.table_values;
+
+  array_sup.resize(size());
+}
+
+void Sorter::build_domain(std::vector<int64_t>& keys, int halo) {
+  auto make_unique = [](std::vector<int64_t>& v) {
+    tbb::parallel_sort(v.begin(), v.end());
+    v.erase(std::unique(v.begin(), v.end()), v.end());
+  };
+
+  make_unique(keys);
+
+  // dilate the occupied buckets by the halo, one axis at a time
+  const int64_t strides[] = {1, ni, (int64_t)ni * nj};
+  const int dims[] = {ni, nj, nk};
+  for (int r = 0; r < 3 && halo > 0; ++r) {
+    std::vector<int64_t> dilated;
+    dilated.reserve(keys.size() * (2 * halo + 1));
+    for (int64_t key : keys) {
+      const int c = (int)((key / strides[r]) % dims[r]);
+      for (int o = std::max(-halo, -c); o <= std::min(halo, dims[r] - 1 - c);
+           ++o)
+        dilated.push_back(key + o * strides[r]);
+    }
+
+    make_unique(dilated);
+    keys.swap(dilated);
+  }
+
+  const int num_buckets = (int)keys.size();
+  handles.resize(num_buckets);
+  for (int bucket_idx = 0; bucket_idx < num_buckets; ++bucket_idx) {
+    const int64_t key = keys[bucket_idx];
+    handles[bucket_idx] =
+        Vector3i((int)(key % ni), (int)((key / ni) % nj),
+                 (int)(key / ((int64_t)ni * nj)));
+  }
+
+  subdiv = 1;
+  build_table();
+}
+
+void Sorter::refine_domain(const Sorter& coarse, int subdiv_) {
+  subdiv = subdiv_;
+  ni = coarse.ni * subdiv;
+  nj = coarse.nj * subdiv;
+  nk = coarse.nk * subdiv;
+
+  const int num_coarse = coarse.size();
+  const int num_cells = subdiv * subdiv * subdiv;
+  handles.resize((size_t)num_coarse * num_cells);
+
+  threadutils::for_each(0, num_coarse, [&](int bucket_idx) {
+    const Vector3i h = coarse.bucket_handle(bucket_idx) * subdiv;
+    for (int k = 0; k < subdiv; ++k)
+      for (int j = 0; j < subdiv; ++j)
+        for (int i = 0; i < subdiv; ++i)
+          handles[bucket_idx * num_cells + (k * subdiv + j) * subdiv + i] =
+              h + Vector3i(i, j, k);
+  });
+
+  // the cells of a bucket are contiguous, so the table of the buckets is
+  // enough to find them
+  table_keys = coarse.table_keys;
+  table_values = coarse.table_values;
+
+  is_sparse = true;
+  array_sup.resize(handles.size());
+}
+
+void Sorter::build_table() {
+  const int num_buckets = (int)handles.size();
+
+  uint64_t table_size = 1;
+  while (table_size < 2 * (uint64_t)num_buckets) table_size <<= 1;
+  table_keys.assign(table_size, -1);
+  table_values.assign(table_size, -1);
+
+  const uint64_t mask = table_size - 1;
+  for (int bucket_idx = 0; bucket_idx < num_buckets; ++bucket_idx) {
+    const Vector3i& h = handles[bucket_idx];
+    const int64_t key = bucket_key(h(0), h(1), h(2));
+
+    uint64_t slot = hash_key(key) & mask;
+    while (table_keys[slot] >= 0) slot = (slot + 1) & mask;
+    table_keys[slot] = key;
+    table_values[slot] = bucket_idx;
+  }
+
+  is_sparse = true;
+  array_sup.resize(num_buckets);
+}
+
+void Sorter::build_ranges() {
+  const int np = (int)array_idx.size();
+
+  memset(&array_sup[0], 0, array_sup.size() * sizeof(std::pair<int, int>));
+
+  const unsigned int num_cells = (unsigned int)array_sup.size();
+
+  threadutils::for_each(0, np, [&](int pidx) {
+    int G_ID = pidx;
+    int G_ID_PREV = G_ID - 1;
+    int G_ID_NEXT = G_ID + 1;
+
+    unsigned int cell = (unsigned int)(array_idx[G_ID] >> 32UL);
+    // points outside the domain belong to no bucket
+    if (cell >= num_cells) return;
+
+    unsigned int cell_prev =
+        G_ID_PREV < 0 ? -1U : (unsigned int)(array_idx[G_ID_PREV] >> 32UL);
+    unsigned int cell_next =
+        G_ID_NEXT >= np ? -1U : (unsigned int)(array_idx[G_ID_NEXT] >> 32UL);
+    if (cell != cell_prev) {
+      // I'm the start of a cell
+      array_sup[cell].first = G_ID;
+    }
+    if (cell != cell_next) {
+      // I'm the end of a cell
+      array_sup[cell].second = G_ID + 1;
+    }
+  });
+}
+
+void Sorter::color_buckets(int numcolors,
+                           std::vector<std::vector<int> >& colors) const {
+  colors.assign(numcolors * numcolors * numcolors, std::vector<int>());
+
+  const int num_buckets = size();
+  for (int bucket_idx = 0; bucket_idx < num_buckets; ++bucket_idx) {
+    const Vector3i& h = handles[bucket_idx];
+    const int t = h(2) % numcolors;
+    const int s = h(1) % numcolors;
+    const int r = h(0) % numcolors;
+    colors[(t * numcolors + s) * numcolors + r].push_back(bucket_idx);
+  }
 }
@@ -8,6 +8,7 @@
 // License, v. 2.0. If a copy of the MPL was not distributed with this
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 
+#include <algorithm>
 #include <vector>
 
 #include "MathDefs.h"
@@ -17,6 +18,15 @@
 #ifndef SORTER_H
 #define SORTER_H
 
+/*!
+ * Buckets of the ni x nj x nk box, with the points sorted into them. The box
+ * is either dense, or a sparse domain holding only the buckets of a set of
+ * points and a halo around them: those are indexed compactly in the order of
+ * their coordinates and looked up through a hash table, so that the bucket
+ * count and the per-bucket loops do not grow with the volume of the box.
+ * Points outside a sparse domain are not sorted into any bucket; they are
+ * left to the next domain built around them.
+ */
 class Sorter {
  public:
   Sorter();
@@ -24,13 +34,70 @@ class Sorter {
   void resize(int ni_, int nj_, int nk_);
   ~Sorter();
 
+  /*!
+   * Sparse domain made of the buckets of total_size points, given by func as
+   * in sort(), and of the buckets within halo of them.
+   */
+  template <typename Callable>
+  void resize(int ni_, int nj_, int nk_, size_t total_size, int halo,
+              Callable func) {
+    ni = ni_;
+    nj = nj_;
+    nk = nk_;
+
+    std::vector<int64_t> keys(total_size);
+    threadutils::for_each(0, (int)total_size, [&](int idx) {
+      int i, j, k;
+      func(idx, i, j, k);
+      i = std::max(0, std::min(ni - 1, i));
+      j = std::max(0, std::min(nj - 1, j));
+      k = std::max(0, std::min(nk - 1, k));
+      keys[idx] = bucket_key(i, j, k);
+    });
+
+    build_domain(keys, halo);
+  }
+
+  // take the box and the buckets of another sorter, so that both share the
+  // same bucket indices
+  void assign_domain(const Sorter& other);
+
+  // split every bucket of the sparse domain of coarse into subdiv^3 cells,
+  // indexed so that the cells of one bucket are contiguous and follow the
+  // order of the buckets. The cells are found through the table of coarse.
+  void refine_domain(const Sorter& coarse, int subdiv_);
+
+  inline bool sparse() const { return is_sparse; }
+
+  inline int64_t bucket_key(int i, int j, int k) const {
+    return ((int64_t)k * nj + j) * ni + i;
+  }
+
+  // index of the bucket, or -1 if it is outside the box or the domain
+  inline int find_bucket(int i, int j, int k) const {
+    if (i < 0 || i > ni - 1 || j < 0 || j > nj - 1 || k < 0 || k > nk - 1)
+      return -1;
+
+    if (!is_sparse) return k * (ni * nj) + j * ni + i;
+
+    if (subdiv == 1) return find_key(bucket_key(i, j, k));
+
+    // a cell of a refined domain: its bucket, then its place in the bucket
+    const int bucket_idx = find_key(
+        ((int64_t)(k / subdiv) * (nj / subdiv) + j / subdiv) * (ni / subdiv) +
+        i / subdiv);
+    if (bucket_idx < 0) return -1;
+
+    return (bucket_idx * subdiv + k % subdiv) * subdiv * subdiv +
+           (j % subdiv) * subdiv + i % subdiv;
+  }
+
   inline bool has_bucket(int i, int j, int k) const {
-    return !(i < 0 || i > ni - 1 || j < 0 || j > nj - 1 || k < 0 || k > nk - 1);
+    return find_bucket(i, j, k) >= 0;
   }
 
   inline bool has_bucket(const Vector3i& h) const {
-    return !(h(0) < 0 || h(0) > ni - 1 || h(1) < 0 || h(1) > nj - 1 ||
-             h(2) < 0 || h(2) > nk - 1);
+    return find_bucket(h(0), h(1), h(2)) >= 0;
   }
 
   inline bool has_bucket_x(int i, int j, int k) const {
@@ -61,10 +128,12 @@ class Sorter {
   }
 
   inline int bucket_index(int i, int j, int k) const {
+    if (is_sparse) return find_bucket(i, j, k);
     return k * (ni * nj) + j * ni + i;
   }
 
   inline int bucket_index(const Vector3i& h) const {
+    if (is_sparse) return find_bucket(h(0), h(1), h(2));
     return h(2) * (ni * nj) + h(1) * ni + h(0);
   }
 
@@ -74,6 +143,8 @@ class Sorter {
   }
 
   inline Vector3i bucket_handle(int bucket_idx) const {
+    if (is_sparse) return handles[bucket_idx];
+
     Vector3i p;
     p[2] = bucket_idx / (ni * nj);
     p[1] = (bucket_idx - p[2] * (ni * nj)) / ni;
@@ -120,7 +191,9 @@ class Sorter {
 
   inline int dim_size(int d) const { return Vector3i(ni, nj, nk)(d); }
 
-  inline int size() const { return ni * nj * nk; }
+  inline int size() const {
+    return is_sparse ? (int)handles.size() : ni * nj * nk;
+  }
 
   template <typename Callable>
   void sort(size_t total_size, Callable func) {
@@ -128,8 +201,6 @@ class Sorter {
       array_idx.resize(total_size);
     }
 
-    memset(&array_sup[0], 0, array_sup.size() * sizeof(std::pair<int, int>));
-
     const int np = (int)total_size;
 
     threadutils::for_each(0, np, [&](int pidx) {
@@ -138,30 +209,91 @@ class Sorter {
       i = std::max(0, std::min(ni - 1, i));
       j = std::max(0, std::min(nj - 1, j));
       k = std::max(0, std::min(nk - 1, k));
-      array_idx[pidx] = hash(i, j, k, pidx);
+
+      // a point outside the domain goes after the last bucket
+      int bucket_idx = bucket_index(i, j, k);
+      if (bucket_idx < 0) bucket_idx = size();
+
+      array_idx[pidx] = (uint64_t)bucket_idx << 32UL | (uint64_t)pidx;
     });
 
     tbb::parallel_sort(array_idx.begin(), array_idx.end());
 
+    build_ranges();
+  }
+
+  /*!
+   * Sorts the points into the buckets of this sorter and into the cells of
+   * its refinement (see refine_domain) with a single parallel sort: func
+   * gives the cell of a point, and the points end up ordered by bucket,
+   * then by cell, then by index, so that the cell ranges of a bucket
+   * partition its bucket range.
+   */
+  template <typename Callable>
+  void sort(size_t total_size, Sorter& cells, Callable func) {
+    array_idx.resize(total_size);
+    cells.array_idx.resize(total_size);
+
+    const int np = (int)total_size;
+    const int sub = cells.subdiv;
+    const int num_cells = sub * sub * sub;
+
     threadutils::for_each(0, np, [&](int pidx) {
-      int G_ID = pidx;
-      int G_ID_PREV = G_ID - 1;
-      int G_ID_NEXT = G_ID + 1;
-
-      unsigned int cell = (unsigned int)(array_idx[G_ID] >> 32UL);
-      unsigned int cell_prev =
-          G_ID_PREV < 0 ? -1U : (unsigned int)(array_idx[G_ID_PREV] >> 32UL);
-      unsigned int cell_next =
-          G_ID_NEXT >= np ? -1U : (unsigned int)(array_idx[G_ID_NEXT] >> 32UL);
-      if (cell != cell_prev) {
-        // I'm the start of a cell
-        array_sup[cell].first = G_ID;
-      }
-      if (cell != cell_next) {
-        // I'm the end of a cell
-        array_sup[cell].second = G_ID + 1;
-      }
+      int i, j, k;
+      func(pidx, i, j, k);
+      i = std::max(0, std::min(cells.ni - 1, i));
+      j = std::max(0, std::min(cells.nj - 1, j));
+      k = std::max(0, std::min(cells.nk - 1, k));
+
+      // a point outside the domain goes after the last cell
+      int cell_idx = cells.find_bucket(i, j, k);
+      if (cell_idx < 0) cell_idx = size() * num_cells;
+
+      cells.array_idx[pidx] = (uint64_t)cell_idx << 32UL | (uint64_t)pidx;
     });
+
+    tbb::parallel_sort(cells.array_idx.begin(), cells.array_idx.end());
+
+    threadutils::for_each(0, np, [&](int n) {
+      const uint64_t cell_idx = cells.array_idx[n] >> 32UL;
+      array_idx[n] = (cell_idx / num_cells) << 32UL |
+                     (cells.array_idx[n] & 0xFFFFFFFFUL);
+    });
+
+    build_ranges();
+    cells.build_ranges();
+  }
+
+  /*!
+   * Sorts the points again only if one of them has left the bucket it was
+   * sorted into, or the number of points has changed. Returns whether it
+   * sorted.
+   */
+  template <typename Callable>
+  bool update(size_t total_size, Callable func) {
+    if (array_idx.size() != total_size) {
+      sort(total_size, func);
+      return true;
+    }
+
+    std::vector<unsigned char> moved(total_size);
+    threadutils::for_each(0, (int)total_size, [&](int n) {
+      const int pidx = (int)(array_idx[n] & 0xFFFFFFFFUL);
+      int i, j, k;
+      func(pidx, i, j, k);
+      i = std::max(0, std::min(ni - 1, i));
+      j = std::max(0, std::min(nj - 1, j));
+      k = std::max(0, std::min(nk - 1, k));
+
+      int bucket_idx = bucket_index(i, j, k);
+      if (bucket_idx < 0) bucket_idx = size();
+      moved[n] = (uint64_t)bucket_idx != array_idx[n] >> 32UL;
+    });
+
+    const bool any_moved =
+        std::find(moved.begin(), moved.end(), 1U) != moved.end();
+    if (any_moved) sort(total_size, func);
+    return any_moved;
   }
 
   inline int get_bucket_size(int bucket_idx) const {
@@ -195,6 +327,32 @@ class Sorter {
     const int ySweepOff = (swCount == 2 || swCount == 6) ? nj + 1 : 0;
     const int zSweepOff = (swCount == 3 || swCount == 7) ? nk + 1 : 0;
 
+    if (is_sparse) {
+      // the same diagonal fronts, made of the existing buckets only
+      const int nsystem = size();
+      std::vector<std::pair<int, int> > fronts(nsystem);
+      threadutils::for_each(0, nsystem, [&](int bucket_idx) {
+        const Vector3i& h = handles[bucket_idx];
+        const int level = abs(h(0) + 1 - xSweepOff) +
+                          abs(h(1) + 1 - ySweepOff) + abs(h(2) + 1 - zSweepOff);
+        fronts[bucket_idx] =
+            std::pair<int, int>(incr ? level : -level, bucket_idx);
+      });
+
+      tbb::parallel_sort(fronts.begin(), fronts.end());
+
+      for (int first = 0; first < nsystem;) {
+        int last = first + 1;
+        while (last < nsystem && fronts[last].first == fronts[first].first)
+          ++last;
+
+        threadutils::for_each(first, last,
+                              [&](int idx) { func(fronts[idx].second); });
+        first = last;
+      }
+      return;
+    }
+
     for (int level = start; level != end;
          level = (incr) ? level + 1 : level - 1) {
       const int xs = std::max(1, level - (nj + nk));
@@ -245,15 +403,14 @@ class Sorter {
 
   template <typename Callable>
   void get_bucket(int i, int j, int k, Callable func) const {
-    if (i < 0 || i > ni - 1 || j < 0 || j > nj - 1 || k < 0 || k > nk - 1)
-      return;
-    int bucket_idx = bucket_index(i, j, k);
+    int bucket_idx = find_bucket(i, j, k);
+    if (bucket_idx < 0) return;
     get_bucket(bucket_idx, func);
   }
 
   template <typename Callable>
   void for_each_bucket(Callable func, bool forced_serial = false) const {
-    int nsystem = ni * nj * nk;
+    int nsystem = size();
     if (forced_serial) {
       for (int bucket_idx = 0; bucket_idx < nsystem; ++bucket_idx) {
         func(bucket_idx);
@@ -319,6 +476,16 @@ class Sorter {
 
   template <typename Callable>
   void for_each_bucket_colored(Callable func, int numcolors = 2) const {
+    if (is_sparse) {
+      std::vector<std::vector<int> > colors;
+      color_buckets(numcolors, colors);
+      for (const std::vector<int>& color : colors) {
+        threadutils::for_each(0, (int)color.size(),
+                              [&](int idx) { func(color[idx]); });
+      }
+      return;
+    }
+
     const int sni = (ni + numcolors - 1) / numcolors;
     const int snj = (nj + numcolors - 1) / numcolors;
     const int snk = (nk + numcolors - 1) / numcolors;
@@ -358,10 +525,9 @@ class Sorter {
            j <= center_handle(1) + search_range; ++j)
         for (int k = center_handle(2) - search_range;
              k <= center_handle(2) + search_range; ++k) {
-          if (i < 0 || i > ni - 1 || j < 0 || j > nj - 1 || k < 0 || k > nk - 1)
-            continue;
+          int bucket_idx = find_bucket(i, j, k);
+          if (bucket_idx < 0) continue;
 
-          int bucket_idx = bucket_index(i, j, k);
           const std::pair<int, int>& G_START_END = array_sup[bucket_idx];
           for (int N_ID = G_START_END.first; N_ID < G_START_END.second;
                ++N_ID) {
@@ -380,17 +546,16 @@ class Sorter {
            j <= center_handle(1) + search_range; ++j)
         for (int k = center_handle(2) - search_range;
              k <= center_handle(2) + search_range; ++k) {
-          if (i < 0 || i > ni - 1 || j < 0 || j > nj - 1 || k < 0 || k > nk - 1)
-            continue;
+          int bucket_idx = find_bucket(i, j, k);
+          if (bucket_idx < 0) continue;
 
-          int bucket_idx = bucket_index(i, j, k);
           if (func(bucket_idx)) return;
         }
   }
 
   template <typename Callable>
   void for_each_bucket_particles(Callable func) const {
-    int nsystem = ni * nj * nk;
+    int nsystem = size();
     threadutils::for_each(0, nsystem, [&](int bucket_idx) {
       const std::pair<int, int>& G_START_END = array_sup[bucket_idx];
       for (int N_ID = G_START_END.first; N_ID < G_START_END.second; ++N_ID) {
@@ -402,6 +567,17 @@ class Sorter {
   template <typename Callable>
   void for_each_bucket_particles_colored(Callable func,
                                          int numcolors = 2) const {
+    if (is_sparse) {
+      std::vector<std::vector<int> > colors;
+      color_buckets(numcolors, colors);
+      for (const std::vector<int>& color : colors) {
+        threadutils::for_each(0, (int)color.size(), [&](int idx) {
+          get_bucket(color[idx], [&](int pidx) { func(pidx, color[idx]); });
+        });
+      }
+      return;
+    }
+
     const int sni = (ni + numcolors - 1) / numcolors;
     const int snj = (nj + numcolors - 1) / numcolors;
     const int snk = (nk + numcolors - 1) / numcolors;
@@ -452,6 +628,22 @@ class Sorter {
     mathutils::fisherYates(numcolors, rand_vec_s);
     mathutils::fisherYates(numcolors, rand_vec_r);
 
+    if (is_sparse) {
+      std::vector<std::vector<int> > colors;
+      color_buckets(numcolors, colors);
+      for (int t : rand_vec_t)
+        for (int s : rand_vec_s)
+          for (int r : rand_vec_r) {
+            const std::vector<int>& color =
+                colors[(t * numcolors + s) * numcolors + r];
+            threadutils::for_each(0, (int)color.size(), [&](int idx) {
+              get_bucket(color[idx],
+                         [&](int pidx) { func(pidx, color[idx]); });
+            });
+          }
+      return;
+    }
+
     for (int t : rand_vec_t)
       for (int s : rand_vec_s)
         for (int r : rand_vec_r) {
@@ -485,6 +677,46 @@ class Sorter {
   int ni;
   int nj;
   int nk;
+
+ private:
+  static inline uint64_t hash_key(int64_t key) {
+    uint64_t h = (uint64_t)key * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 32);
+  }
+
+  void build_domain(std::vector<int64_t>& keys, int halo);
+
+  // hash table of the sparse domain from the bucket handles
+  void build_table();
+
+  // start and end of every bucket in the sorted array_idx
+  void build_ranges();
+
+  // index stored in the table for a bucket key, or -1
+  inline int find_key(int64_t key) const {
+    const uint64_t mask = table_keys.size() - 1;
+    for (uint64_t slot = hash_key(key) & mask;; slot = (slot + 1) & mask) {
+      if (table_keys[slot] == key) return table_values[slot];
+      if (table_keys[slot] < 0) return -1;
+    }
+  }
+
+  // buckets of the sparse domain grouped by color, in the order of the
+  // dense colored loops
+  void color_buckets(int numcolors,
+                     std::vector<std::vector<int> >& colors) const;
+
+  bool is_sparse;
+
+  // cells per bucket edge of the sorter this one was refined from
+  int subdiv;
+
+  // sparse domain: coordinates of every bucket, and the open addressing
+  // table from the bucket keys to their indices (-1 keys are empty slots).
+  // A refined domain keeps the table of the buckets it was refined from.
+  std::vector<Vector3i> handles;
+  std::vector<int64_t> table_keys;
+  std::vector<int> table_values;
 };
 
 #endif
@@ -0,0 +1,162 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "StrandSkinning.h"
+
+#include <Eigen/Geometry>
+
+#include <algorithm>
+#include <limits>
+#include <unordered_set>
+
+#include "MathUtilities.h"
+#include "ThreadUtils.h"
+
+namespace strandskinning {
+static Vector3s centroid(const VectorXs& x, const std::vector<int>& strand) {
+  Vector3s c = Vector3s::Zero();
+  for (int pidx : strand) c += x.segment<3>(pidx * 4);
+  return c / (scalar)std::max(1, (int)strand.size());
+}
+
+void selectGuides(const VectorXs& x,
+                  const std::vector<std::vector<int> >& strands,
+                  scalar ratio, std::vector<unsigned char>& is_guide) {
+  const int num_strands = strands.size();
+  is_guide.assign(num_strands, 0);
+  if (num_strands == 0) return;
+
+  const int num_guides = mathutils::clamp(
+      (int)std::round(ratio * (scalar)num_strands), 1, num_strands);
+
+  std::vector<Vector3s> centers(num_strands);
+  for (int i = 0; i < num_strands; ++i) centers[i] = centroid(x, strands[i]);
+
+  std::vector<scalar> dist(num_strands,
+                           std::numeric_limits<scalar>::infinity());
+  int next = 0;
+  for (int k = 0; k < num_guides; ++k) {
+    is_guide[next] = 1;
+    const Vector3s c = centers[next];
+
+    int farthest = next;
+    scalar farthest_dist = -1.0;
+    for (int i = 0; i < num_strands; ++i) {
+      dist[i] = std::min(dist[i], (centers[i] - c).squaredNorm());
+      if (!is_guide[i] && dist[i] > farthest_dist) {
+        farthest_dist = dist[i];
+        farthest = i;
+      }
+    }
+    next = farthest;
+  }
+}
+
+void bind(const VectorXs& x, const std::vector<std::vector<int> >& guides,
+          const std::vector<std::vector<int> >& followers,
+          std::vector<FollowerVertex>& bindings) {
+  const int num_guides = guides.size();
+  const int num_followers = followers.size();
+
+  std::vector<Vector3s> guide_centers(num_guides);
+  for (int i = 0; i < num_guides; ++i)
+    guide_centers[i] = centroid(x, guides[i]);
+
+  std::vector<int> offsets(num_followers + 1, 0);
+  for (int i = 0; i < num_followers; ++i)
+    offsets[i + 1] = offsets[i] + (int)followers[i].size();
+
+  bindings.resize(offsets[num_followers]);
+
+  threadutils::for_each(0, num_followers, [&](int i) {
+    const std::vector<int>& follower = followers[i];
+    const Vector3s c = centroid(x, follower);
+
+    std::vector<std::pair<scalar, int> > nearest(num_guides);
+    for (int j = 0; j < num_guides; ++j)
+      nearest[j] = std::make_pair((guide_centers[j] - c).squaredNorm(), j);
+
+    const int num_influences = std::min(3, num_guides);
+    std::partial_sort(nearest.begin(), nearest.begin() + num_influences,
+                      nearest.end());
+
+    for (int k = 0; k < (int)follower.size(); ++k) {
+      FollowerVertex& fv = bindings[offsets[i] + k];
+      fv.particle = follower[k];
+      fv.num_influences = num_influences;
+
+      const Vector3s p = x.segment<3>(fv.particle * 4);
+
+      scalar sum_weights = 0.0;
+      for (int r = 0; r < num_influences; ++r) {
+        const std::vector<int>& guide = guides[nearest[r].second];
+
+        int closest = 0;
+        scalar closest_dist = std::numeric_limits<scalar>::infinity();
+        for (int l = 0; l < (int)guide.size(); ++l) {
+          const scalar d = (x.segment<3>(guide[l] * 4) - p).squaredNorm();
+          if (d < closest_dist) {
+            closest_dist = d;
+            closest = l;
+          }
+        }
+
+        // the frame of the last vertex is its incoming edge
+        StrandInfluence& inf = fv.influences[r];
+        inf.vertex = guide[closest];
+        if (guide.size() < 2)
+          inf.next = inf.vertex;
+        else if (closest + 1 < (int)guide.size())
+          inf.next = guide[closest + 1];
+        else
+          inf.next = guide[closest - 1];
+
+        const Vector3s a = x.segment<3>(inf.vertex * 4);
+        inf.offset = p - a;
+        inf.rest_tangent = x.segment<3>(inf.next * 4) - a;
+        inf.weight = 1.0 / (closest_dist + 1e-12);
+        sum_weights += inf.weight;
+      }
+
+      for (int r = 0; r < num_influences; ++r)
+        fv.influences[r].weight /= sum_weights;
+    }
+  });
+
+  // vertices shared with a guide stay simulated, and a vertex shared by
+  // several followers is skinned once
+  std::unordered_set<int> bound;
+  for (const std::vector<int>& guide : guides)
+    bound.insert(guide.begin(), guide.end());
+
+  int num_kept = 0;
+  for (const FollowerVertex& fv : bindings)
+    if (bound.insert(fv.particle).second) bindings[num_kept++] = fv;
+  bindings.resize(num_kept);
+}
+
+Vector3s skin(const FollowerVertex& v, const VectorXs& x) {
+  Vector3s p = Vector3s::Zero();
+  for (int r = 0; r < v.num_influences; ++r) {
+    const StrandInfluence& inf = v.influences[r];
+    const Vector3s a = x.segment<3>(inf.vertex * 4);
+
+    const Vector3s t = x.segment<3>(inf.next * 4) - a;
+    if (inf.rest_tangent.squaredNorm() > 1e-63 && t.squaredNorm() > 1e-63) {
+      const Eigen::Quaternion<scalar> q =
+          Eigen::Quaternion<scalar>::FromTwoVectors(inf.rest_tangent, t);
+      p += (a + q * inf.offset) * inf.weight;
+    } else {
+      p += (a + inf.offset) * inf.weight;
+    }
+  }
+  return p;
+}
+};  // namespace strandskinning
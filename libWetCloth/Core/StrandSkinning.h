@@ -0,0 +1,65 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef STRAND_SKINNING_H
+#define STRAND_SKINNING_H
+
+#include <vector>
+
+#include "MathDefs.h"
+
+/*!
+ * A vertex of a guide strand a follower vertex is attached to. The offset
+ * is stored in the frame of the guide edge (vertex, next) at binding time.
+ */
+struct StrandInfluence {
+  int vertex;
+  int next;
+  scalar weight;
+  Vector3s offset;
+  Vector3s rest_tangent;
+};
+
+/*!
+ * A vertex of a follower strand, interpolated from up to three guide
+ * strands instead of being simulated.
+ */
+struct FollowerVertex {
+  int particle;
+  int num_influences;
+  StrandInfluence influences[3];
+};
+
+namespace strandskinning {
+/*!
+ * Picks round(ratio * #strands) guides by farthest-point sampling of the
+ * strand centroids, so that the guides cover the whole bundle.
+ */
+void selectGuides(const VectorXs& x,
+                  const std::vector<std::vector<int> >& strands,
+                  scalar ratio, std::vector<unsigned char>& is_guide);
+
+/*!
+ * Binds every vertex of the followers to the closest vertex of the three
+ * guides nearest to their strand, weighted by inverse squared distance.
+ * Vertices shared with a guide are left out.
+ */
+void bind(const VectorXs& x, const std::vector<std::vector<int> >& guides,
+          const std::vector<std::vector<int> >& followers,
+          std::vector<FollowerVertex>& bindings);
+
+/*!
+ * Position of a follower vertex from the current guides, where each offset
+ * is rotated along with its guide edge.
+ */
+Vector3s skin(const FollowerVertex& v, const VectorXs& x);
+};  // namespace strandskinning
+
+#endif
@@ -0,0 +1,63 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "TelemetryWriter.h"
+
+TelemetryWriter::TelemetryWriter(const std::string& filename)
+    : m_filename(filename), m_ofs(filename.c_str(), std::ios::app),
+      m_done(false) {
+  if (m_ofs.is_open()) m_thread = std::thread(&TelemetryWriter::run, this);
+}
+
+TelemetryWriter::~TelemetryWriter() {
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_done = true;
+  }
+  m_cond.notify_one();
+
+  if (m_thread.joinable()) m_thread.join();
+}
+
+bool TelemetryWriter::isOpen() const { return m_ofs.is_open(); }
+
+const std::string& TelemetryWriter::getFileName() const { return m_filename; }
+
+void TelemetryWriter::write(const std::string& record) {
+  if (!m_ofs.is_open()) return;
+
+  {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queue.push_back(record);
+  }
+  m_cond.notify_one();
+}
+
+void TelemetryWriter::run() {
+  std::deque<std::string> batch;
+
+  while (true) {
+    bool done;
+    {
+      std::unique_lock<std::mutex> lock(m_mutex);
+      m_cond.wait(lock, [this] { return m_done || !m_queue.empty(); });
+      batch.swap(m_queue);
+      done = m_done;
+    }
+
+    for (const std::string& record : batch) m_ofs << record << '\n';
+    batch.clear();
+
+    // flush per batch so a monitor tailing the file sees whole records
+    m_ofs.flush();
+
+    if (done) break;
+  }
+}
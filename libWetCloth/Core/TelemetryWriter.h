@@ -0,0 +1,53 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef TELEMETRY_WRITER_H
+#define TELEMETRY_WRITER_H
+
+#include <condition_variable>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/*!
+ * Appends records to a JSON-lines file. Records are queued by the simulation
+ * thread and written by a background thread; the destructor flushes
+ * everything still in the queue.
+ */
+class TelemetryWriter {
+ public:
+  explicit TelemetryWriter(const std::string& filename);
+
+  ~TelemetryWriter();
+
+  bool isOpen() const;
+
+  // record must be a single JSON object without line breaks
+  void write(const std::string& record);
+
+  const std::string& getFileName() const;
+
+ private:
+  void run();
+
+  std::string m_filename;
+  std::ofstream m_ofs;
+
+  std::deque<std::string> m_queue;
+  std::mutex m_mutex;
+  std::condition_variable m_cond;
+  bool m_done;
+
+  std::thread m_thread;
+};
+
+#endif
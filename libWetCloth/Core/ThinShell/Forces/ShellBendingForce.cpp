@@ -145,7 +145,32 @@ void ShellBendingForce::computeBendingRestPhi(const VectorXs& rest_pos,
 void ShellBendingForce::addEnergyToTotal(const VectorXs& x, const VectorXs& v,
                                          const VectorXs& m, const VectorXs& psi,
                                          const scalar& lambda, scalar& E) {
-  std::cerr << "NOT IMPLEMENTED!" << std::endl;
+  // bending angles of the current shape, measured as for the rest shape
+  VectorXs phis(m_E_unique.rows());
+  phis.setZero();
+  computeBendingRestPhi(x, phis);
+
+  for (int e : m_unique_edge_usable) {
+    const int idx1 = m_E_unique(e, 0);
+    const int idx2 = m_E_unique(e, 1);
+
+    scalar restareas = m_triangle_rest_area(m_per_unique_edge_triangles(e, 0)) +
+                       m_triangle_rest_area(m_per_unique_edge_triangles(e, 1));
+    scalar e0_rest_sqnorm =
+        (m_rest_pos.segment<3>(idx2 * 4) - m_rest_pos.segment<3>(idx1 * 4))
+            .squaredNorm();
+    const scalar psi_coeff = pow((psi(idx2) + psi(idx1)) * 0.5, lambda);
+
+    scalar ka = m_bending_stiffness * psi_coeff * 3. * e0_rest_sqnorm /
+                restareas;  // dyne.cm
+    scalar kb =
+        m_viscous_stiffness * psi_coeff * 3. * e0_rest_sqnorm / restareas;
+
+    const scalar dist = phis(e) - m_per_edge_rest_phi(e);
+    const scalar viscous_dist = phis(e) - m_per_edge_start_phi(e);
+
+    E += ka * dist * dist + kb * viscous_dist * viscous_dist;
+  }
 }
 
 void ShellBendingForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
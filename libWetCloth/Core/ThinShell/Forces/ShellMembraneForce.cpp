@@ -101,7 +101,45 @@ void ShellMembraneForce::addEnergyToTotal(const VectorXs& x, const VectorXs& v,
                                           const VectorXs& m,
                                           const VectorXs& psi,
                                           const scalar& lambda, scalar& E) {
-  std::cerr << "NOT IMPLEMENTED!" << std::endl;
+  for (int f = 0; f < m_F.rows(); ++f) {
+    const scalar psi_base =
+        (psi(m_F(f, 0)) + psi(m_F(f, 1)) + psi(m_F(f, 2))) / 3.0;
+    const scalar psi_coeff = pow(psi_base, lambda);
+
+    const Vector3s& x0 = x.segment<3>(m_F(f, 0) * 4);
+    const Vector3s& x1 = x.segment<3>(m_F(f, 1) * 4);
+    const Vector3s& x2 = x.segment<3>(m_F(f, 2) * 4);
+
+    const Vector3s U = x0 * m_membrane_ru(f, 0) + x1 * m_membrane_ru(f, 1) +
+                       x2 * m_membrane_ru(f, 2);
+    const Vector3s V = x0 * m_membrane_rv(f, 0) + x1 * m_membrane_rv(f, 1) +
+                       x2 * m_membrane_rv(f, 2);
+
+    const Vector3s strain = Vector3s(0.5 * (U.dot(U) - 1), 0.5 * (V.dot(V) - 1),
+                                     U.dot(V));
+
+    E += 0.5 * psi_coeff * m_triangle_rest_area(f) *
+         strain.dot(m_membrane_material_tensor * strain);  // dyne.cm
+
+    if (m_apply_viscous) {
+      const Vector3s& sx0 = m_start_pos.segment<3>(m_F(f, 0) * 4);
+      const Vector3s& sx1 = m_start_pos.segment<3>(m_F(f, 1) * 4);
+      const Vector3s& sx2 = m_start_pos.segment<3>(m_F(f, 2) * 4);
+
+      const Vector3s sU = sx0 * m_membrane_ru(f, 0) +
+                          sx1 * m_membrane_ru(f, 1) + sx2 * m_membrane_ru(f, 2);
+      const Vector3s sV = sx0 * m_membrane_rv(f, 0) +
+                          sx1 * m_membrane_rv(f, 1) + sx2 * m_membrane_rv(f, 2);
+
+      const Vector3s viscous_strain =
+          Vector3s(0.5 * (U.dot(U) - sU.dot(sU)), 0.5 * (V.dot(V) - sV.dot(sV)),
+                   U.dot(V) - sU.dot(sV));
+
+      E += 0.5 * psi_coeff * m_triangle_rest_area(f) *
+           viscous_strain.dot(m_membrane_material_viscous_tensor *
+                              viscous_strain);
+    }
+  }
 }
 
 void ShellMembraneForce::addGradEToTotal(const VectorXs& x, const VectorXs& v,
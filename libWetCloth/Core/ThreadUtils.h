@@ -39,6 +39,20 @@ static void for_each(Index start, Index end, Callable func) {
 #endif
 }
 
+// calls func(begin, end) on consecutive sub-ranges of [start, end), so that
+// per-task state such as grid accessors is set up once per sub-range
+template <typename Index, typename Callable>
+static void for_each_range(Index start, Index end, Callable func) {
+#if (defined(NDEBUG) || DEBUG_PARALLEL) && !NO_PARALLEL
+  tbb::parallel_for(tbb::blocked_range<Index>(start, end),
+                    [&](const tbb::blocked_range<Index>& r) {
+                      func(r.begin(), r.end());
+                    });
+#else
+  if (start < end) func(start, end);
+#endif
+}
+
 template <typename Data, typename Callable>
 static void for_each(std::vector<Data>& vec, Callable func) {
 #if (defined(NDEBUG) || DEBUG_PARALLEL) && !NO_PARALLEL
@@ -0,0 +1,213 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "TimeStepController.h"
+
+#include <algorithm>
+#include <sstream>
+
+#include "ThreadUtils.h"
+
+// the highest simulation frequency (1/30 s)
+const static scalar g_max_step_size = 1.0 / 30.0;
+
+// PI gains on the iteration error (see [Gustafsson et al. 1988])
+const static scalar g_integral_gain = 0.3;
+const static scalar g_proportional_gain = 0.4;
+
+TimeStepController::~TimeStepController() {}
+
+void TimeStepController::beginFrame(const TwoDScene& scene,
+                                    const scalar& frame_dt) {}
+
+void TimeStepController::endStep(const TwoDScene& scene,
+                                 const SceneStepper& stepper,
+                                 const scalar& sub_dt, bool rolled_back) {}
+
+scalar TimeStepController::fitToFrame(const scalar& max_dt,
+                                      const scalar& remaining) {
+  const int num_steps =
+      std::max(1, (int)ceil(remaining / std::max(1e-63, max_dt) - 1e-8));
+  return remaining / (scalar)num_steps;
+}
+
+CFLTimeStepController::CFLTimeStepController()
+    : m_max_dt(g_max_step_size) {}
+
+void CFLTimeStepController::beginFrame(const TwoDScene& scene,
+                                       const scalar& frame_dt) {
+  const scalar dx = scene.getCellSize();
+  const scalar max_elasto_dt =
+      dx / std::max(1e-63, scene.getMaxVelocity()) / 3.0;
+  const scalar max_fluid_dt =
+      dx / std::max(1e-63, scene.getMaxFluidVelocity()) * 3.0;
+
+  m_max_dt = g_max_step_size;
+  m_reason = "max frequency";
+  if (max_elasto_dt < m_max_dt) {
+    m_max_dt = max_elasto_dt;
+    m_reason = "elasto CFL";
+  }
+  if (max_fluid_dt < m_max_dt) {
+    m_max_dt = max_fluid_dt;
+    m_reason = "fluid CFL";
+  }
+
+  // uniform sub-steps over the frame
+  m_max_dt = fitToFrame(m_max_dt, frame_dt);
+}
+
+scalar CFLTimeStepController::computeStepSize(const TwoDScene& scene,
+                                              const scalar& remaining,
+                                              std::string& reason) {
+  reason = m_reason;
+  return std::min(m_max_dt, remaining);
+}
+
+std::string CFLTimeStepController::getName() const { return "cfl"; }
+
+/*!
+ * percentile and maximum of the speeds, reorders speeds
+ */
+static void speedStatistics(std::vector<scalar>& speeds,
+                            const scalar& percentile, scalar& pct_speed,
+                            scalar& max_speed) {
+  pct_speed = max_speed = 0.0;
+  if (speeds.empty()) return;
+
+  const int n = (int)speeds.size();
+  const int k = std::max(0, std::min(n - 1, (int)floor(percentile * n)));
+  std::nth_element(speeds.begin(), speeds.begin() + k, speeds.end());
+  pct_speed = speeds[k];
+  max_speed = *std::max_element(speeds.begin() + k, speeds.end());
+}
+
+AdaptiveTimeStepController::AdaptiveTimeStepController(
+    const scalar& velocity_percentile, int target_iterations,
+    const scalar& max_growth)
+    : m_velocity_percentile(velocity_percentile),
+      m_target_iterations(target_iterations),
+      m_max_growth(max_growth),
+      m_proposed_dt(0.0),
+      m_last_error(1.0),
+      m_solver_dt(0.0) {}
+
+scalar AdaptiveTimeStepController::computeStepSize(const TwoDScene& scene,
+                                                   const scalar& remaining,
+                                                   std::string& reason) {
+  const scalar dx = scene.getCellSize();
+
+  const VectorXs& v = scene.getV();
+  const int num_elasto = scene.getNumSoftElastoParticles();
+  std::vector<scalar> elasto_speeds(num_elasto);
+  threadutils::for_each(0, num_elasto, [&](int i) {
+    elasto_speeds[i] = v.segment<3>(i * 4).norm();
+  });
+
+  const VectorXs& fluid_v = scene.getFluidV();
+  const std::vector<int>& fluids = scene.getFluidIndices();
+  const int num_fluid = scene.getNumFluidParticles();
+  std::vector<scalar> fluid_speeds(num_fluid);
+  threadutils::for_each(0, num_fluid, [&](int i) {
+    fluid_speeds[i] = fluid_v.segment<3>(fluids[i] * 4).norm();
+  });
+
+  scalar elasto_pct, elasto_max, fluid_pct, fluid_max;
+  speedStatistics(elasto_speeds, m_velocity_percentile, elasto_pct,
+                  elasto_max);
+  speedStatistics(fluid_speeds, m_velocity_percentile, fluid_pct, fluid_max);
+
+  scalar dt = g_max_step_size;
+  reason = "max frequency";
+
+  auto limit = [&](const scalar& candidate, const std::string& why) {
+    if (candidate < dt) {
+      dt = candidate;
+      reason = why;
+    }
+  };
+
+  // the bulk follows the CFL rule, outliers may go three times as far
+  limit(dx / std::max(1e-63, elasto_pct) / 3.0, "elasto velocity percentile");
+  limit(dx / std::max(1e-63, elasto_max), "elasto max velocity");
+  limit(dx / std::max(1e-63, fluid_pct) * 3.0, "fluid velocity percentile");
+  limit(dx / std::max(1e-63, fluid_max) * 9.0, "fluid max velocity");
+
+  if (m_solver_dt > 0.0) limit(m_solver_dt, m_solver_reason);
+
+  if (m_proposed_dt > 0.0)
+    limit(m_proposed_dt * m_max_growth, "growth limit");
+
+  // grow from the proposal rather than from the step cut to fit the frame
+  m_proposed_dt = dt;
+
+  const scalar fitted = fitToFrame(dt, remaining);
+  if (fitted < dt * 0.999) reason += ", fit to frame";
+
+  return fitted;
+}
+
+void AdaptiveTimeStepController::endStep(const TwoDScene& scene,
+                                         const SceneStepper& stepper,
+                                         const scalar& sub_dt,
+                                         bool rolled_back) {
+  // sub_dt is the reduced step that was kept after the roll back
+  if (rolled_back) {
+    m_proposed_dt = sub_dt;
+    m_solver_dt = sub_dt;
+    m_solver_reason = "rollback";
+    m_last_error = 1.0;
+    return;
+  }
+
+  int max_iterations = 0;
+  std::string max_solver;
+  for (auto& entry : stepper.getSolveStats()) {
+    if (!entry.second.success) {
+      m_proposed_dt = sub_dt;
+      m_solver_dt = sub_dt * 0.5;
+      m_solver_reason = entry.first + " solve failed";
+      m_last_error = 1.0;
+      return;
+    }
+
+    if (entry.second.iterations > max_iterations) {
+      max_iterations = entry.second.iterations;
+      max_solver = entry.first;
+    }
+  }
+
+  if (max_iterations == 0) {
+    m_solver_dt = 0.0;
+    m_last_error = 1.0;
+    return;
+  }
+
+  const scalar error =
+      (scalar)m_target_iterations / (scalar)std::max(1, max_iterations);
+  const scalar factor = pow(error, g_integral_gain) *
+                        pow(error / m_last_error, g_proportional_gain);
+
+  m_last_error = error;
+
+  // the solvers have room to spare, leave it to the growth limit
+  if (factor >= m_max_growth) {
+    m_solver_dt = 0.0;
+    return;
+  }
+
+  m_solver_dt = std::max(sub_dt, m_proposed_dt) * std::max(factor, 0.5);
+
+  std::ostringstream oss;
+  oss << max_solver << " iterations (" << max_iterations << ")";
+  m_solver_reason = oss.str();
+}
+
+std::string AdaptiveTimeStepController::getName() const { return "adaptive"; }
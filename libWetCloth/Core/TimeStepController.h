@@ -0,0 +1,97 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef TIME_STEP_CONTROLLER_H
+#define TIME_STEP_CONTROLLER_H
+
+#include <string>
+
+#include "MathDefs.h"
+#include "SceneStepper.h"
+#include "TwoDScene.h"
+
+/*!
+ * Chooses the sub-step sizes inside a frame. beginFrame is called once per
+ * frame, computeStepSize before every sub-step with the time left in the
+ * frame, and endStep after every sub-step has been accepted, with the size it
+ * was taken with. rolled_back tells that it replaced a failed, larger one.
+ */
+class TimeStepController {
+ public:
+  virtual ~TimeStepController();
+
+  virtual void beginFrame(const TwoDScene& scene, const scalar& frame_dt);
+
+  // the returned step never exceeds remaining; reason tells what limited it
+  virtual scalar computeStepSize(const TwoDScene& scene,
+                                 const scalar& remaining,
+                                 std::string& reason) = 0;
+
+  virtual void endStep(const TwoDScene& scene, const SceneStepper& stepper,
+                       const scalar& sub_dt, bool rolled_back);
+
+  virtual std::string getName() const = 0;
+
+ protected:
+  // split remaining into equal sub-steps no larger than max_dt
+  static scalar fitToFrame(const scalar& max_dt, const scalar& remaining);
+};
+
+/*!
+ * The CFL rule: 1/3 cell per step for the fastest elastic vertex, 3 cells
+ * for the fastest liquid particle, fixed for the whole frame.
+ */
+class CFLTimeStepController : public TimeStepController {
+ public:
+  CFLTimeStepController();
+
+  virtual void beginFrame(const TwoDScene& scene, const scalar& frame_dt);
+
+  virtual scalar computeStepSize(const TwoDScene& scene,
+                                 const scalar& remaining, std::string& reason);
+
+  virtual std::string getName() const;
+
+ private:
+  scalar m_max_dt;
+  std::string m_reason;
+};
+
+/*!
+ * Feedback-controlled step size. Velocities are estimated by a percentile of
+ * the particle speeds (the maximum only enters with a looser bound), the
+ * iteration counts of the linear solves drive a PI controller, and the step
+ * may grow by at most a fixed ratio from one sub-step to the next.
+ */
+class AdaptiveTimeStepController : public TimeStepController {
+ public:
+  AdaptiveTimeStepController(const scalar& velocity_percentile,
+                             int target_iterations, const scalar& max_growth);
+
+  virtual scalar computeStepSize(const TwoDScene& scene,
+                                 const scalar& remaining, std::string& reason);
+
+  virtual void endStep(const TwoDScene& scene, const SceneStepper& stepper,
+                       const scalar& sub_dt, bool rolled_back);
+
+  virtual std::string getName() const;
+
+ private:
+  scalar m_velocity_percentile;
+  int m_target_iterations;
+  scalar m_max_growth;
+
+  scalar m_proposed_dt;
+  scalar m_last_error;
+  scalar m_solver_dt;
+  std::string m_solver_reason;
+};
+
+#endif
@@ -16,10 +16,12 @@
 #include <iostream>
 #include <numeric>
 #include <stack>
+#include <sstream>
 #include <unordered_set>
 
 #include "AttachForce.h"
 #include "DER/StrandForce.h"
+#include "GridAccessor.h"
 #include "MathUtilities.h"
 #include "ThreadUtils.h"
 #include "SpherePattern.h"
@@ -71,6 +73,40 @@ std::ostream& operator<<(std::ostream& os, const LiquidInfo& info) {
      << std::endl;
   os << "check divergence: " << info.check_divergence << std::endl;
   os << "use varying fraction: " << info.use_varying_fraction << std::endl;
+  os << "use narrow band: " << info.use_narrow_band << std::endl;
+  os << "narrow band width: " << info.narrow_band_width << std::endl;
+  os << "use spray particles: " << info.use_spray_particles << std::endl;
+  os << "spray neighbor count: " << info.spray_neighbor_count << std::endl;
+  os << "spray drag coeff: " << info.spray_drag_coeff << std::endl;
+  os << "use guarded step: " << info.use_guarded_step << std::endl;
+  os << "max step retries: " << info.max_step_retries << std::endl;
+  os << "max velocity bound: " << info.max_velocity_bound << std::endl;
+  os << "max solver residual: " << info.max_solver_residual << std::endl;
+  os << "use adaptive dt: " << info.use_adaptive_dt << std::endl;
+  os << "velocity percentile: " << info.velocity_percentile << std::endl;
+  os << "target solver iterations: " << info.target_solver_iterations
+     << std::endl;
+  os << "max dt growth: " << info.max_dt_growth << std::endl;
+  os << "validate fraction kernels: " << info.validate_fraction_kernels
+     << std::endl;
+  os << "quasi static max iterations: " << info.quasi_static_max_iterations
+     << std::endl;
+  os << "quasi static tolerance: " << info.quasi_static_tolerance
+     << std::endl;
+  os << "use split viscosity: " << info.use_split_viscosity << std::endl;
+  os << "viscosity split iterations: " << info.viscosity_split_iterations
+     << std::endl;
+  os << "use twist condensation: " << info.use_twist_condensation
+     << std::endl;
+  os << "guide strand ratio: " << info.guide_strand_ratio << std::endl;
+  os << "follower blend: " << info.follower_blend << std::endl;
+  os << "use grid relaxation: " << info.use_grid_relaxation << std::endl;
+  os << "grid relaxation iterations: " << info.grid_relaxation_iterations
+     << std::endl;
+  os << "use monolithic pressure: " << info.use_monolithic_pressure
+     << std::endl;
+  os << "elasto integrator: " << info.elasto_integrator << std::endl;
+  os << "elastic cfl number: " << info.elastic_cfl_number << std::endl;
   return os;
 }
 
@@ -84,6 +120,8 @@ TwoDScene::TwoDScene()
       m_fixed(),
       step_count(0),
       m_edges(),
+      m_elastic_wave_dt(1e+63),
+      m_elasto_solve_iterations(0),
       m_num_colors(1),
       m_forces() {
   sphere_pattern::generateSpherePattern(m_sphere_pattern);
@@ -107,6 +145,10 @@ int TwoDScene::getNumElasticParameters() const {
   return m_strandParameters.size();
 }
 
+int TwoDScene::getNumColliderMaterials() const {
+  return m_collider_materials.size();
+}
+
 const VectorXs& TwoDScene::getX() const { return m_x; }
 
 VectorXs& TwoDScene::getX() { return m_x; }
@@ -1614,6 +1656,11 @@ void TwoDScene::updateParticleBoundingBox() {
                                                    std::max(x(2), y(2)), 0.0);
                                  });
 
+  if (m_liquid_info.use_narrow_band && !m_interior_phi.empty()) {
+    bbmin.segment<3>(0) = bbmin.segment<3>(0).cwiseMin(m_interior_bbx_min);
+    bbmax.segment<3>(0) = bbmax.segment<3>(0).cwiseMax(m_interior_bbx_max);
+  }
+
   const scalar dx = m_bucket_size * 2.0;
 
   m_bbx_min = Vector3s(floor(bbmin(0) / dx) * dx, floor(bbmin(1) / dx) * dx,
@@ -1692,17 +1739,54 @@ void TwoDScene::rebucketizeParticles() {
                std::max(1, (int)ceil(grid_size(1) / m_bucket_size)),
                std::max(1, (int)ceil(grid_size(2) / m_bucket_size)));
 
-  m_particle_buckets.resize(num_buckets(0), num_buckets(1), num_buckets(2));
-  m_gauss_buckets.resize(num_buckets(0), num_buckets(1), num_buckets(2));
-  m_particle_cells.resize(grid_num_cells(0), grid_num_cells(1),
-                          grid_num_cells(2));
+  // the buckets holding liquid interior, which may hold no particle at all
+  std::vector<Vector3s> interior_centers;
+  if (m_liquid_info.use_narrow_band) {
+    const int num_interior_buckets = (int)m_interior_phi.size();
+    for (int bucket_idx = 0; bucket_idx < num_interior_buckets; ++bucket_idx) {
+      const VectorXs& bucket_phi = m_interior_phi[bucket_idx];
+      if (bucket_phi.size() == 0 || bucket_phi.minCoeff() >= 0.0) continue;
+
+      interior_centers.push_back(
+          m_interior_mincorner +
+          (m_interior_buckets.bucket_handle(bucket_idx).cast<scalar>() +
+           Vector3s::Constant(0.5)) *
+              m_bucket_size);
+    }
+  }
 
-  m_particle_buckets.sort(getNumParticles(), [&](int pidx, int& i, int& j,
-                                                 int& k) {
-    i = (int)floor((m_x(pidx * 4 + 0) - m_bucket_mincorner(0)) / m_bucket_size);
-    j = (int)floor((m_x(pidx * 4 + 1) - m_bucket_mincorner(1)) / m_bucket_size);
-    k = (int)floor((m_x(pidx * 4 + 2) - m_bucket_mincorner(2)) / m_bucket_size);
-  });
+  // only the occupied buckets and the border around them exist, so that a
+  // stray particle far from the rest does not inflate the per-bucket data
+  const int num_parts = getNumParticles();
+  const int num_gausses = getNumGausses();
+  m_particle_buckets.resize(
+      num_buckets(0), num_buckets(1), num_buckets(2),
+      num_parts + num_gausses + interior_centers.size(), (int)extra_border,
+      [&](int idx, int& i, int& j, int& k) {
+        Vector3s pos;
+        if (idx < num_parts)
+          pos = m_x.segment<3>(idx * 4);
+        else if (idx < num_parts + num_gausses)
+          pos = m_x_gauss.segment<3>((idx - num_parts) * 4);
+        else
+          pos = interior_centers[idx - num_parts - num_gausses];
+
+        i = (int)floor((pos(0) - m_bucket_mincorner(0)) / m_bucket_size);
+        j = (int)floor((pos(1) - m_bucket_mincorner(1)) / m_bucket_size);
+        k = (int)floor((pos(2) - m_bucket_mincorner(2)) / m_bucket_size);
+      });
+  m_gauss_buckets.assign_domain(m_particle_buckets);
+  m_particle_cells.refine_domain(m_particle_buckets, m_num_nodes);
+
+  // sort the particles into the buckets and, in the same pass, into the grid
+  // cells within every bucket
+  m_particle_buckets.sort(
+      getNumParticles(), m_particle_cells,
+      [&](int pidx, int& i, int& j, int& k) {
+        i = (int)floor((m_x(pidx * 4 + 0) - m_grid_mincorner(0)) / dx);
+        j = (int)floor((m_x(pidx * 4 + 1) - m_grid_mincorner(1)) / dx);
+        k = (int)floor((m_x(pidx * 4 + 2) - m_grid_mincorner(2)) / dx);
+      });
 
   m_gauss_buckets.sort(getNumGausses(), [&](int pidx, int& i, int& j, int& k) {
     i = (int)floor((m_x_gauss(pidx * 4 + 0) - m_bucket_mincorner(0)) /
@@ -1718,6 +1802,22 @@ void TwoDScene::rebucketizeParticles() {
   m_bucket_activated.assign(total_buckets, 0U);
 }
 
+/*!
+ * sort the particles again into the buckets of the current domain, after
+ * particles were added or removed. The domain is kept, since the grid data
+ * built on it is still in use: particles outside of it stay out of every
+ * bucket until rebucketizeParticles builds the next domain around them,
+ * which also sorts the grid cells.
+ */
+void TwoDScene::sortParticles() {
+  m_particle_buckets.sort(getNumParticles(), [&](int pidx, int& i, int& j,
+                                                 int& k) {
+    i = (int)floor((m_x(pidx * 4 + 0) - m_bucket_mincorner(0)) / m_bucket_size);
+    j = (int)floor((m_x(pidx * 4 + 1) - m_bucket_mincorner(1)) / m_bucket_size);
+    k = (int)floor((m_x(pidx * 4 + 2) - m_bucket_mincorner(2)) / m_bucket_size);
+  });
+}
+
 /*!
  * remove empty particles.
  */
@@ -1742,15 +1842,7 @@ void TwoDScene::removeEmptyParticles() {
       m_fluids[i - num_elasto] = i;
     }
 
-    m_particle_buckets.sort(
-        new_num_parts, [&](int pidx, int& i, int& j, int& k) {
-          i = (int)floor((m_x(pidx * 4 + 0) - m_bucket_mincorner(0)) /
-                         m_bucket_size);
-          j = (int)floor((m_x(pidx * 4 + 1) - m_bucket_mincorner(1)) /
-                         m_bucket_size);
-          k = (int)floor((m_x(pidx * 4 + 2) - m_bucket_mincorner(2)) /
-                         m_bucket_size);
-        });
+    sortParticles();
   }
 }
 
@@ -1784,6 +1876,24 @@ void TwoDScene::terminateParticles() {
 /*!
  * project particles to avoid penetrating rigid bodies
  */
+void TwoDScene::updateFollowerStrands(const scalar& dt) {
+  const int num_followers = m_follower_vertices.size();
+  if (!num_followers) return;
+
+  const scalar alpha = m_liquid_info.follower_blend;
+
+  // pull the followers toward the skinned guides, with the correction
+  // taken into their velocity so that the grid transfer sees it
+  threadutils::for_each(0, num_followers, [&](int i) {
+    const FollowerVertex& fv = m_follower_vertices[i];
+    const int pidx = fv.particle;
+    const Vector3s dx =
+        (strandskinning::skin(fv, m_x) - m_x.segment<3>(pidx * 4)) * alpha;
+    m_x.segment<3>(pidx * 4) += dx;
+    m_v.segment<3>(pidx * 4) += dx / dt;
+  });
+}
+
 void TwoDScene::solidProjection(const scalar& dt) {
   const int num_parts = getNumParticles();
   const int num_elasto = getNumElastoParticles();
@@ -1886,90 +1996,72 @@ void TwoDScene::updateSolidWeights() {
   m_node_solid_weight_z.resize(num_buckets);
 
   const scalar dx = getCellSize();
+  const bool validate = m_liquid_info.validate_fraction_kernels;
+  std::vector<scalar> bucket_max_diff(validate ? num_buckets : 0, 0.0);
+
+  const std::vector<VectorXi>* node_indices[3] = {&m_node_index_solid_phi_x,
+                                                  &m_node_index_solid_phi_y,
+                                                  &m_node_index_solid_phi_z};
+  std::vector<VectorXs>* weights[3] = {&m_node_solid_weight_x,
+                                       &m_node_solid_weight_y,
+                                       &m_node_solid_weight_z};
 
   m_particle_buckets.for_each_bucket([&](int bucket_idx) {
     if (!m_bucket_activated[bucket_idx]) return;
 
-    const VectorXi& bucket_node_idx_solid_phi_x =
-        m_node_index_solid_phi_x[bucket_idx];
-    const VectorXi& bucket_node_idx_solid_phi_y =
-        m_node_index_solid_phi_y[bucket_idx];
-    const VectorXi& bucket_node_idx_solid_phi_z =
-        m_node_index_solid_phi_z[bucket_idx];
-
     const int num_solid_phi = getNumNodes(bucket_idx);
 
-    VectorXs& bucket_weight_x = m_node_solid_weight_x[bucket_idx];
-    VectorXs& bucket_weight_y = m_node_solid_weight_y[bucket_idx];
-    VectorXs& bucket_weight_z = m_node_solid_weight_z[bucket_idx];
-
-    if (bucket_weight_x.size() != num_solid_phi)
-      bucket_weight_x.resize(num_solid_phi);
-    if (bucket_weight_y.size() != num_solid_phi)
-      bucket_weight_y.resize(num_solid_phi);
-    if (bucket_weight_z.size() != num_solid_phi)
-      bucket_weight_z.resize(num_solid_phi);
-
-    for (int i = 0; i < num_solid_phi; ++i) {
-      const Vector8i& indices = bucket_node_idx_solid_phi_x.segment<8>(i * 8);
-      scalar phi0 = 0.5 * dx;
-      scalar phi1 = 0.5 * dx;
-      scalar phi2 = 0.5 * dx;
-      scalar phi3 = 0.5 * dx;
-
-      if (indices[0] >= 0 && m_bucket_activated[indices[0]])
-        phi0 = m_node_solid_phi[indices[0]][indices[1]];
-      if (indices[2] >= 0 && m_bucket_activated[indices[2]])
-        phi1 = m_node_solid_phi[indices[2]][indices[3]];
-      if (indices[4] >= 0 && m_bucket_activated[indices[4]])
-        phi2 = m_node_solid_phi[indices[4]][indices[5]];
-      if (indices[6] >= 0 && m_bucket_activated[indices[6]])
-        phi3 = m_node_solid_phi[indices[6]][indices[7]];
-
-      bucket_weight_x(i) = mathutils::clamp(
-          1.0 - mathutils::fraction_inside(phi0, phi1, phi2, phi3), 0.0, 1.0);
-    }
-
-    for (int i = 0; i < num_solid_phi; ++i) {
-      const Vector8i& indices = bucket_node_idx_solid_phi_y.segment<8>(i * 8);
-      scalar phi0 = 0.5 * dx;
-      scalar phi1 = 0.5 * dx;
-      scalar phi2 = 0.5 * dx;
-      scalar phi3 = 0.5 * dx;
-
-      if (indices[0] >= 0 && m_bucket_activated[indices[0]])
-        phi0 = m_node_solid_phi[indices[0]][indices[1]];
-      if (indices[2] >= 0 && m_bucket_activated[indices[2]])
-        phi1 = m_node_solid_phi[indices[2]][indices[3]];
-      if (indices[4] >= 0 && m_bucket_activated[indices[4]])
-        phi2 = m_node_solid_phi[indices[4]][indices[5]];
-      if (indices[6] >= 0 && m_bucket_activated[indices[6]])
-        phi3 = m_node_solid_phi[indices[6]][indices[7]];
-
-      bucket_weight_y(i) = mathutils::clamp(
-          1.0 - mathutils::fraction_inside(phi0, phi1, phi2, phi3), 0.0, 1.0);
-    }
-
-    for (int i = 0; i < num_solid_phi; ++i) {
-      const Vector8i& indices = bucket_node_idx_solid_phi_z.segment<8>(i * 8);
-      scalar phi0 = 0.5 * dx;
-      scalar phi1 = 0.5 * dx;
-      scalar phi2 = 0.5 * dx;
-      scalar phi3 = 0.5 * dx;
-
-      if (indices[0] >= 0 && m_bucket_activated[indices[0]])
-        phi0 = m_node_solid_phi[indices[0]][indices[1]];
-      if (indices[2] >= 0 && m_bucket_activated[indices[2]])
-        phi1 = m_node_solid_phi[indices[2]][indices[3]];
-      if (indices[4] >= 0 && m_bucket_activated[indices[4]])
-        phi2 = m_node_solid_phi[indices[4]][indices[5]];
-      if (indices[6] >= 0 && m_bucket_activated[indices[6]])
-        phi3 = m_node_solid_phi[indices[6]][indices[7]];
-
-      bucket_weight_z(i) = mathutils::clamp(
-          1.0 - mathutils::fraction_inside(phi0, phi1, phi2, phi3), 0.0, 1.0);
+    // corner-major solid phi around each face, and the inside fractions
+    VectorXs corner_phi(num_solid_phi * 4);
+    VectorXs fractions(num_solid_phi);
+
+    for (int r = 0; r < 3; ++r) {
+      const VectorXi& bucket_node_idx_solid_phi =
+          (*node_indices[r])[bucket_idx];
+      VectorXs& bucket_weight = (*weights[r])[bucket_idx];
+
+      if (bucket_weight.size() != num_solid_phi)
+        bucket_weight.resize(num_solid_phi);
+
+      for (int i = 0; i < num_solid_phi; ++i) {
+        const Vector8i& indices = bucket_node_idx_solid_phi.segment<8>(i * 8);
+        for (int c = 0; c < 4; ++c) {
+          const int nb_bucket = indices[c * 2];
+          corner_phi(c * num_solid_phi + i) =
+              (nb_bucket >= 0 && m_bucket_activated[nb_bucket])
+                  ? m_node_solid_phi[nb_bucket][indices[c * 2 + 1]]
+                  : 0.5 * dx;
+        }
+      }
+
+      fraction_inside_batch(corner_phi.data(), num_solid_phi,
+                            fractions.data());
+
+      for (int i = 0; i < num_solid_phi; ++i) {
+        bucket_weight(i) = mathutils::clamp(1.0 - fractions(i), 0.0, 1.0);
+      }
+
+      if (validate) {
+        for (int i = 0; i < num_solid_phi; ++i) {
+          const scalar frac = mathutils::fraction_inside(
+              corner_phi(i), corner_phi(num_solid_phi + i),
+              corner_phi(num_solid_phi * 2 + i),
+              corner_phi(num_solid_phi * 3 + i));
+          bucket_max_diff[bucket_idx] =
+              std::max(bucket_max_diff[bucket_idx], fabs(frac - fractions(i)));
+        }
+      }
     }
   });
+
+  if (validate) {
+    const scalar max_diff = bucket_max_diff.empty()
+                                ? 0.0
+                                : *std::max_element(bucket_max_diff.begin(),
+                                                    bucket_max_diff.end());
+    std::cout << "[validate solid weights, max diff: " << max_diff << "]"
+              << std::endl;
+  }
 }
 
 /*!
@@ -1981,35 +2073,44 @@ void TwoDScene::correctLiquidParticles(const scalar& dt) {
 
   if (num_fluid == 0) return;
 
-  m_particle_cells.sort(
-      (int)m_fluids.size(), [&](int pidx, int& i, int& j, int& k) {
-        Vector3s local_x =
-            (m_x.segment<3>(m_fluids[pidx] * 4) - m_grid_mincorner) / dx;
-        i = (int)floor(local_x(0));
-        j = (int)floor(local_x(1));
-        k = (int)floor(local_x(2));
-      });
+  if (m_liquid_info.use_grid_relaxation) {
+    relaxLiquidParticlesOnGrid(dt);
+    return;
+  }
 
-  const scalar coeff = m_liquid_info.correction_strength / dt;
+  auto particle_cell = [&](int pidx, int& i, int& j, int& k) {
+    Vector3s local_x = (m_x.segment<3>(pidx * 4) - m_grid_mincorner) / dx;
+    i = (int)floor(local_x(0));
+    j = (int)floor(local_x(1));
+    k = (int)floor(local_x(2));
+  };
 
-  const scalar iD = getInverseDCoeff();
+  // the cells were filled along with the buckets in rebucketizeParticles; sort
+  // again only if a particle has crossed into another cell since
+  m_particle_cells.update(getNumParticles(), particle_cell);
+
+  const scalar coeff = m_liquid_info.correction_strength / dt;
 
   const int correction_selector = rand() % m_liquid_info.correction_step;
+  const int num_elasto = getNumElastoParticles();
 
-  m_particle_cells.for_each_bucket_particles_colored([&](int i, int cell_idx) {
-    if (i % m_liquid_info.correction_step != correction_selector) return;
+  m_particle_cells.for_each_bucket_particles_colored([&](int liquid_pidx,
+                                                         int cell_idx) {
+    if (!isFluid(liquid_pidx)) return;
 
-    const int liquid_pidx = m_fluids[i];
+    // the liquid particles follow the elastic ones in the particle arrays
+    if ((liquid_pidx - num_elasto) % m_liquid_info.correction_step !=
+        correction_selector)
+      return;
 
     const Vector3s& pos = m_x.segment<3>(liquid_pidx * 4);
     const scalar& radii = m_radius(liquid_pidx * 2 + 0);
 
     Vector3s spring = Vector3s::Zero();
     m_particle_cells.loop_neighbor_bucket_particles(
-        cell_idx, [&](int ni, int) -> bool {
-          if (i == ni) return false;
-
-          const int liquid_npidx = m_fluids[ni];
+        cell_idx, [&](int liquid_npidx, int) -> bool {
+          if (liquid_pidx == liquid_npidx || !isFluid(liquid_npidx))
+            return false;
 
           const Vector3s& np = m_x.segment<3>(liquid_npidx * 4);
           const scalar nr = m_radius(liquid_npidx * 2 + 0);
@@ -2033,42 +2134,182 @@ void TwoDScene::correctLiquidParticles(const scalar& dt) {
           return false;
         });
 
-    Vector3s buf0 = pos + spring * dt;
+    m_x.segment<3>(liquid_pidx * 4) =
+        pushOutOfSolid(liquid_pidx, spring * dt);
+  });
+}
 
-    const auto& node_indices_sphi = m_particle_nodes_solid_phi[liquid_pidx];
-    const auto& particle_weights = m_particle_weights[liquid_pidx];
+/*!
+ * displaced position of a particle, moved back along the solid normal if the
+ * displacement takes it into the solid
+ */
+Vector3s TwoDScene::pushOutOfSolid(int pidx, const Vector3s& dpos) const {
+  const Vector3s& pos = m_x.segment<3>(pidx * 4);
+  const scalar iD = getInverseDCoeff();
 
-    scalar phi_ori = 0.0;
-    Vector3sT grad_phi = Vector3s::Zero();
+  Vector3s buf0 = pos + dpos;
 
-    for (int nidx = 0; nidx < node_indices_sphi.rows(); ++nidx) {
-      const int bucket_idx = node_indices_sphi(nidx, 0);
-      const int node_idx = node_indices_sphi(nidx, 1);
+  const auto& node_indices_sphi = m_particle_nodes_solid_phi[pidx];
+  const auto& particle_weights = m_particle_weights[pidx];
 
-      scalar phi;
-      if (m_bucket_activated[bucket_idx]) {
-        phi = m_node_solid_phi[bucket_idx](node_idx);
+  scalar phi_ori = 0.0;
+  Vector3sT grad_phi = Vector3s::Zero();
+
+  for (int nidx = 0; nidx < node_indices_sphi.rows(); ++nidx) {
+    const int bucket_idx = node_indices_sphi(nidx, 0);
+    const int node_idx = node_indices_sphi(nidx, 1);
+
+    scalar phi;
+    if (m_bucket_activated[bucket_idx]) {
+      phi = m_node_solid_phi[bucket_idx](node_idx);
+    } else {
+      phi = 3.0 * getCellSize();
+    }
+
+    const scalar w = particle_weights(nidx, 3);
+    const Vector3s& np = m_node_pos[bucket_idx].segment<3>(node_idx * 3);
+
+    phi_ori += phi * w;
+    grad_phi += phi * iD * w * (np - pos);
+  }
+
+  if (grad_phi.norm() > 1e-20) grad_phi.normalize();
+
+  const scalar phi_now = phi_ori + grad_phi * dpos;
+
+  if (phi_now < 0.0) {
+    buf0 -= phi_now * grad_phi.transpose();
+  }
+
+  return buf0;
+}
+
+/*!
+ * relax the liquid particles without a neighbor search: the liquid volume in
+ * excess of the free cell volume is splatted to the pressure nodes and
+ * diffused into a potential by Jacobi sweeps of -lap(phi) = excess, with
+ * phi = 0 on nodes without liquid. The particles then move down the gradient
+ * of the potential.
+ */
+void TwoDScene::relaxLiquidParticlesOnGrid(const scalar& dt) {
+  const int num_fluid = getNumFluidParticles();
+
+  if (num_fluid == 0) return;
+
+  const int num_buckets = getNumBuckets();
+  const scalar dx = getCellSize();
+  const scalar dV = dx * dx * dx;
+  const scalar iD = getInverseDCoeff();
+
+  std::vector<VectorXs> node_excess(num_buckets);
+  std::vector<VectorXs> node_potential(num_buckets);
+  std::vector<VectorXs> node_potential_next(num_buckets);
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    if (!m_bucket_activated[bucket_idx]) return;
+
+    const auto& bucket_node_particles_p = m_node_particles_p[bucket_idx];
+    const int num_nodes_p = getNumNodes(bucket_idx);
+
+    // negative excess marks nodes without liquid
+    node_excess[bucket_idx].resize(num_nodes_p);
+    node_potential[bucket_idx].setZero(num_nodes_p);
+    node_potential_next[bucket_idx].setZero(num_nodes_p);
+
+    for (int i = 0; i < num_nodes_p; ++i) {
+      scalar vol_liquid = 0.0;
+      scalar vol_solid = 0.0;
+
+      for (auto& pair : bucket_node_particles_p[i]) {
+        const int pidx = pair.first;
+        if (m_particle_to_surfel[pidx] >= 0) continue;
+
+        const scalar w = m_particle_weights_p[pidx](pair.second);
+
+        if (isFluid(pidx)) {
+          vol_liquid += m_fluid_vol(pidx) * w;
+        } else {
+          vol_solid += m_rest_vol(pidx) * w * m_rest_volume_fraction[pidx];
+        }
+      }
+
+      if (vol_liquid > 0.0) {
+        node_excess[bucket_idx](i) = std::max(
+            0.0, vol_liquid / std::max(1e-20, dV - vol_solid) - 1.0);
       } else {
-        phi = 3.0 * getCellSize();
+        node_excess[bucket_idx](i) = -1.0;
       }
+    }
+  });
 
-      const scalar w = particle_weights(nidx, 3);
-      const Vector3s& np = m_node_pos[bucket_idx].segment<3>(node_idx * 3);
+  const scalar dx2 = dx * dx;
 
-      phi_ori += phi * w;
-      grad_phi += phi * iD * w * (np - pos);
-    }
+  for (int iter = 0; iter < m_liquid_info.grid_relaxation_iterations;
+       ++iter) {
+    m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+      if (!m_bucket_activated[bucket_idx]) return;
 
-    if (grad_phi.norm() > 1e-20) grad_phi.normalize();
+      const VectorXi& bucket_pp_neighbors = m_node_pp_neighbors[bucket_idx];
+      const VectorXs& bucket_excess = node_excess[bucket_idx];
+      VectorXs& bucket_next = node_potential_next[bucket_idx];
 
-    const Vector3s dpos = spring * dt;
-    const scalar phi_now = phi_ori + grad_phi * dpos;
+      const int num_nodes_p = bucket_excess.size();
 
-    if (phi_now < 0.0) {
-      buf0 -= phi_now * grad_phi.transpose();
+      for (int i = 0; i < num_nodes_p; ++i) {
+        if (bucket_excess(i) < 0.0) {
+          bucket_next(i) = 0.0;
+          continue;
+        }
+
+        // the first six are the face neighbors
+        scalar sum = dx2 * bucket_excess(i);
+        for (int r = 0; r < 6; ++r) {
+          const int nb_bucket_idx = bucket_pp_neighbors[i * 36 + r * 2 + 0];
+          const int nb_node_idx = bucket_pp_neighbors[i * 36 + r * 2 + 1];
+          if (nb_bucket_idx < 0) continue;
+
+          sum += node_potential[nb_bucket_idx](nb_node_idx);
+        }
+
+        bucket_next(i) = sum / 6.0;
+      }
+    });
+
+    node_potential.swap(node_potential_next);
+  }
+
+  const scalar coeff = m_liquid_info.correction_strength;
+
+  // as in the pairwise correction, one in every correction_step particles
+  // moves per call
+  const int correction_selector = rand() % m_liquid_info.correction_step;
+
+  threadutils::for_each(0, num_fluid, [&](int i) {
+    if (i % m_liquid_info.correction_step != correction_selector) return;
+
+    const int liquid_pidx = m_fluids[i];
+    if (!m_inside[liquid_pidx]) return;
+
+    const Vector3s& pos = m_x.segment<3>(liquid_pidx * 4);
+    const auto& indices_p = m_particle_nodes_p[liquid_pidx];
+    const auto& weights_p = m_particle_weights_p[liquid_pidx];
+
+    Vector3s grad_potential = Vector3s::Zero();
+
+    for (int nidx = 0; nidx < indices_p.rows(); ++nidx) {
+      const int bucket_idx = indices_p(nidx, 0);
+      const int node_idx = indices_p(nidx, 1);
+      if (!m_bucket_activated[bucket_idx]) continue;
+
+      const Vector3s& np = getNodePosP(bucket_idx, node_idx);
+      grad_potential += node_potential[bucket_idx](node_idx) * iD *
+                        weights_p(nidx) * (np - pos);
     }
 
-    m_x.segment<3>(liquid_pidx * 4) = buf0;
+    if (grad_potential.squaredNorm() == 0.0) return;
+
+    m_x.segment<3>(liquid_pidx * 4) =
+        pushOutOfSolid(liquid_pidx, -coeff * grad_potential);
   });
 }
 
@@ -2479,12 +2720,7 @@ void TwoDScene::splitLiquidParticles() {
     }
   });
 
-  m_particle_buckets.sort(getNumParticles(), [&](int pidx, int& i, int& j,
-                                                 int& k) {
-    i = (int)floor((m_x(pidx * 4 + 0) - m_bucket_mincorner(0)) / m_bucket_size);
-    j = (int)floor((m_x(pidx * 4 + 1) - m_bucket_mincorner(1)) / m_bucket_size);
-    k = (int)floor((m_x(pidx * 4 + 2) - m_bucket_mincorner(2)) / m_bucket_size);
-  });
+  sortParticles();
 
   relabelLiquidParticles();
 }
@@ -3249,138 +3485,1040 @@ void TwoDScene::advectCurvatureP(const scalar& dt) {
         const scalar phi =
             sqrt(std::max(0.0, sqr_d)) - std::max(dx * 0.71, rad_e);
 
-        if (phi < phis(indices(i, 1))) {
-          phis(indices(i, 1)) = phi;
-        }
-      }
-    } else if (gidx < num_edges + num_faces) {
-      const int fidx = gidx - num_edges;
+        if (phi < phis(indices(i, 1))) {
+          phis(indices(i, 1)) = phi;
+        }
+      }
+    } else if (gidx < num_edges + num_faces) {
+      const int fidx = gidx - num_edges;
+
+      const auto& indices = m_gauss_nodes_p[gidx];
+      const scalar rad_e = m_radius_gauss(gidx);
+
+      for (int i = 0; i < indices.rows(); ++i) {
+        if (indices(i, 0) < 0) continue;
+
+        VectorXs& phis = m_node_combined_phi[indices(i, 0)];
+        if (indices(i, 1) < 0 || indices(i, 1) >= phis.size()) continue;
+
+        const Vector3s& np = getNodePosP(indices(i, 0), indices(i, 1));
+
+        scalar sqr_d = dx * 3.0;
+        Vector3s cp;
+        igl::point_simplex_squared_distance<3>(np, m_x_reshaped, m_faces, fidx,
+                                               sqr_d, cp);
+
+        const scalar phi =
+            sqrt(std::max(0.0, sqr_d)) - std::max(dx * 0.51, rad_e);
+
+        if (phi < phis(indices(i, 1))) {
+          phis(indices(i, 1)) = phi;
+        }
+      }
+    }
+  });
+}
+
+const std::vector<VectorXs>& TwoDScene::getNodeSurfTensionP() const {
+  return m_node_surf_tension;
+}
+
+bool TwoDScene::useSurfTension() const {
+  return m_liquid_info.use_surf_tension;
+}
+
+/*!
+ * update liquid levelset
+ */
+void TwoDScene::updateLiquidPhi(scalar dt) {
+  const int num_buckets = (int)m_particle_buckets.size();
+
+  m_node_liquid_phi.resize(num_buckets);
+  m_node_pressure.resize(num_buckets);
+
+  const scalar dx = getCellSize();
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    const int num_nodes = getNumNodes(bucket_idx);
+
+    m_node_liquid_phi[bucket_idx].resize(num_nodes);
+    m_node_liquid_phi[bucket_idx].setConstant(3.0 * m_bucket_size);
+    m_node_pressure[bucket_idx].resize(num_nodes);
+    m_node_pressure[bucket_idx].setZero();
+
+    // the grid-represented interior counts as liquid
+    if (m_liquid_info.use_narrow_band &&
+        (int)m_node_interior_phi_p.size() == num_buckets &&
+        m_node_interior_phi_p[bucket_idx].size() == num_nodes) {
+      m_node_liquid_phi[bucket_idx] = m_node_liquid_phi[bucket_idx].cwiseMin(
+          m_node_interior_phi_p[bucket_idx]);
+    }
+  });
+
+  if (getNumFluidParticles() == 0) return;
+
+  const int num_elasto = getNumElastoParticles();
+
+  m_particle_buckets.for_each_bucket_particles_colored(
+      [&](int pidx, int bucket_idx) {
+        if (pidx < num_elasto) return;
+
+        const auto& indices = m_particle_nodes_p[pidx];
+
+        const Vector3s& pos =
+            m_x.segment<3>(pidx * 4);  // + m_fluid_v.segment<3>(pidx * 4) * dt;
+
+        for (int i = 0; i < indices.rows(); ++i) {
+          if (!m_bucket_activated[indices(i, 0)]) continue;
+
+          VectorXs& phis = m_node_liquid_phi[indices(i, 0)];
+          assert(indices(i, 1) >= 0 && indices(i, 1) < phis.size());
+
+          const Vector3s& np = getNodePosP(indices(i, 0), indices(i, 1));
+
+          const scalar phi = (pos - np).norm() -
+                             std::max(dx * 0.883644, m_radius(pidx * 2 + 0));
+
+          if (phi < phis(indices(i, 1))) {
+            phis(indices(i, 1)) = phi;
+          }
+        }
+      },
+      3);
+
+  auto solid_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
+    return dfptr->usage == DFU_SOLID;
+  };
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    VectorXs& bucket_liquid_phi = m_node_liquid_phi[bucket_idx];
+
+    const int num_pressure = bucket_liquid_phi.size();
+
+    for (int i = 0; i < num_pressure; ++i) {
+      const Vector3s& np = getNodePosP(bucket_idx, i);
+
+      Vector3s vel;
+      const scalar sphi = computePhiVel(np, vel, solid_sel);
+      if (sphi < 0.0) bucket_liquid_phi(i) = -0.5 * dx;
+    }
+  });
+
+  // update variables for viscosity computation
+  if (m_liquid_info.compute_viscosity) {
+    updateLiquidPhiLattice();
+    estimateVolumeFractionsFromLattice();
+  }
+
+  if (m_liquid_info.use_surf_tension) {
+    extendLiquidPhi();
+  }
+}
+
+/*!
+ * initialize a liquid particle at pos, moving with vel and holding vol of
+ * liquid
+ */
+void TwoDScene::initLiquidParticle(int part_idx, const Vector3s& pos,
+                                   const Vector3s& vel, const scalar& vol) {
+  const scalar rad = pow(vol / M_PI * 0.75, 1.0 / 3.0);
+
+  m_x.segment<4>(part_idx * 4) = Vector4s(pos(0), pos(1), pos(2), 0.0);
+  m_rest_x.segment<4>(part_idx * 4) = m_x.segment<4>(part_idx * 4);
+  m_v.segment<4>(part_idx * 4).setZero();
+  m_dv.segment<4>(part_idx * 4).setZero();
+  m_fluid_v.segment<4>(part_idx * 4) = Vector4s(vel(0), vel(1), vel(2), 0.0);
+  m_m.segment<4>(part_idx * 4).setZero();
+  m_fluid_m.segment<3>(part_idx * 4)
+      .setConstant(vol * m_liquid_info.liquid_density);
+  m_fluid_m(part_idx * 4 + 3) = m_fluid_m(part_idx * 4 + 0) * rad * rad * 0.4;
+  m_fluid_vol(part_idx) = vol;
+  m_vol(part_idx) = 0.0;
+  m_rest_vol(part_idx) = 0.0;
+  m_shape_factor(part_idx) = 0.0;
+  m_radius(part_idx * 2 + 0) = m_radius(part_idx * 2 + 1) = rad;
+  m_volume_fraction(part_idx) = 0.0;
+  m_rest_volume_fraction(part_idx) = 0.0;
+  m_fixed[part_idx] = 0U;
+  m_twist[part_idx] = false;
+  m_particle_rest_length(part_idx) = rad * 2.0;
+  m_particle_rest_area(part_idx) = M_PI * rad * rad;
+  m_particle_group[part_idx] = 0;
+  m_B.block<3, 3>(part_idx * 3, 0).setZero();
+  m_fB.block<3, 3>(part_idx * 3, 0).setZero();
+  m_is_strand_tip[part_idx] = false;
+  m_div[part_idx].resize(0);
+  m_particle_to_surfel[part_idx] = -1;
+  m_inside[part_idx] = 0U;
+  m_classifier[part_idx] = PC_o;
+  m_orientation.segment<3>(part_idx * 3).setZero();
+}
+
+/*!
+ * narrow-band liquid: measure the depth of the liquid on the grid of the
+ * previous sub-step, remove particles sunk below the band, reseed particles
+ * where the band has moved into the grid-only interior, and keep the interior
+ * (phi and fluid velocity) for the next sub-step.
+ */
+void TwoDScene::updateLiquidNarrowBand() {
+  if (!m_liquid_info.use_narrow_band) return;
+
+  const int num_buckets = getNumBuckets();
+  if (num_buckets == 0 || (int)m_node_liquid_phi.size() != num_buckets ||
+      (int)m_node_vel_fluid_x.size() != num_buckets)
+    return;
+
+  const scalar dx = getCellSize();
+  const scalar band = m_liquid_info.narrow_band_width;
+  const int max_depth = (int)ceil(band) + 3;
+  const int num_elasto = getNumElastoParticles();
+
+  auto solid_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
+    return dfptr->usage == DFU_SOLID;
+  };
+
+  auto cell_of = [&](const Vector3s& pos) -> Vector3i {
+    const Vector3s local = (pos - m_grid_mincorner) / dx;
+    return Vector3i((int)floor(local(0)), (int)floor(local(1)),
+                    (int)floor(local(2)));
+  };
+
+  // liquid depth in cells, counted from the nearest non-liquid node
+  std::vector<VectorXs> depth(num_buckets);
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    const VectorXs& bucket_phi = m_node_liquid_phi[bucket_idx];
+    VectorXs& bucket_depth = depth[bucket_idx];
+    bucket_depth.resize(bucket_phi.size());
+    for (int i = 0; i < bucket_phi.size(); ++i)
+      bucket_depth(i) = (bucket_phi(i) < 0.0) ? (scalar)max_depth : 0.0;
+  });
+
+  // keep the liquid around elastic objects in the band, where capturing and
+  // dripping work on particles
+  BucketNodeLocator locator(m_particle_buckets, m_num_nodes,
+                            &m_bucket_activated);
+  for (int pidx = 0; pidx < num_elasto; ++pidx) {
+    if (!isSoft(pidx)) continue;
+
+    int bucket_idx, node_idx;
+    if (locator.locate(cell_of(m_x.segment<3>(pidx * 4)), bucket_idx,
+                       node_idx)) {
+      depth[bucket_idx](node_idx) = 0.0;
+    }
+  }
+
+  for (int iter = 0; iter < max_depth; ++iter) {
+    const std::vector<VectorXs> prev_depth = depth;
+
+    m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+      VectorXs& bucket_depth = depth[bucket_idx];
+      if (!bucket_depth.size()) return;
+
+      GridAccessor<scalar> accessor(prev_depth, m_particle_buckets,
+                                    m_num_nodes, 0.0);
+      const Vector3i handle = m_particle_buckets.bucket_handle(bucket_idx);
+
+      for (int i = 0; i < bucket_depth.size(); ++i) {
+        if (bucket_depth(i) == 0.0) continue;
+
+        const Vector3i node =
+            accessor.globalHandle(handle, getNodeHandle(i));
+        scalar nb_depth = bucket_depth(i) - 1.0;
+        for (int r = 0; r < 3; ++r) {
+          const Vector3i offset = Vector3i::Unit(r);
+          nb_depth = std::min(nb_depth, accessor.getValue(node - offset));
+          nb_depth = std::min(nb_depth, accessor.getValue(node + offset));
+        }
+
+        bucket_depth(i) = nb_depth + 1.0;
+      }
+    });
+  }
+
+  // interior phi, crossing zero half a cell below the band
+  std::vector<VectorXs> interior_phi(num_buckets);
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    interior_phi[bucket_idx] =
+        (VectorXs::Constant(depth[bucket_idx].size(), band + 0.5) -
+         depth[bucket_idx]) *
+        dx;
+  });
+
+  // remove particles that sank below the band
+  const int num_parts = getNumParticles();
+  threadutils::for_each_range(num_elasto, num_parts, [&](int begin, int end) {
+    GridAccessor<scalar> accessor(interior_phi, m_particle_buckets,
+                                  m_num_nodes, dx);
+    for (int pidx = begin; pidx < end; ++pidx) {
+      const scalar phi = accessor.interpolate(
+          (m_x.segment<3>(pidx * 4) - m_grid_mincorner) / dx -
+          Vector3s::Constant(0.5));
+      if (phi < -0.5 * dx) m_fluid_vol(pidx) = 0.0;
+    }
+  });
+
+  const int num_before_cull = getNumFluidParticles();
+  removeEmptyParticles();
+  const int num_culled = num_before_cull - getNumFluidParticles();
+
+  // reseed the cells that were liquid on the grid only and are now in the
+  // band
+  int num_reseeded = 0;
+
+  if ((int)m_node_interior_phi_p.size() == num_buckets) {
+    std::vector<VectorXs> cell_vol(num_buckets);
+    m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+      cell_vol[bucket_idx].setZero(depth[bucket_idx].size());
+    });
+
+    for (int pidx : m_fluids) {
+      int bucket_idx, node_idx;
+      if (locator.locate(cell_of(m_x.segment<3>(pidx * 4)), bucket_idx,
+                         node_idx)) {
+        cell_vol[bucket_idx](node_idx) += m_fluid_vol(pidx);
+      }
+    }
+
+    const scalar rad = mathutils::defaultRadiusMultiplier() * dx *
+                       m_liquid_info.particle_cell_multiplier;
+    const scalar pvol = 4.0 / 3.0 * M_PI * rad * rad * rad;
+    const scalar full_vol =
+        pvol / pow(m_liquid_info.particle_cell_multiplier, 3.0);
+
+    std::vector<Vector3s> new_pos;
+
+    // sequential, since scalarRand is not thread-safe
+    for (int bucket_idx = 0; bucket_idx < num_buckets; ++bucket_idx) {
+      const VectorXs& prev_interior = m_node_interior_phi_p[bucket_idx];
+      const int num_nodes_p = depth[bucket_idx].size();
+      if (prev_interior.size() != num_nodes_p) continue;
+
+      for (int i = 0; i < num_nodes_p; ++i) {
+        if (prev_interior(i) >= 0.0 || interior_phi[bucket_idx](i) < 0.0 ||
+            m_node_liquid_phi[bucket_idx](i) >= 0.0)
+          continue;
+
+        const int n_seed =
+            (int)floor((full_vol - cell_vol[bucket_idx](i)) / pvol + 0.5);
+        if (n_seed <= 0) continue;
+
+        const Vector3s np = getNodePosP(bucket_idx, i);
+        Vector3s vel;
+        if (computePhiVel(np, vel, solid_sel) < 0.0) continue;
+
+        for (int s = 0; s < n_seed; ++s) {
+          new_pos.push_back(
+              np + Vector3s(mathutils::scalarRand(-0.5 * dx, 0.5 * dx),
+                            mathutils::scalarRand(-0.5 * dx, 0.5 * dx),
+                            mathutils::scalarRand(-0.5 * dx, 0.5 * dx)));
+        }
+      }
+    }
+
+    num_reseeded = (int)new_pos.size();
+
+    if (num_reseeded > 0) {
+      const int df_index = getNumParticles();
+      const int sp_index = getNumFluidParticles();
+
+      m_fluids.resize(sp_index + num_reseeded);
+      conservativeResizeParticles(df_index + num_reseeded);
+
+      threadutils::for_each_range(0, num_reseeded, [&](int begin, int end) {
+        GridAccessor<scalar> u(m_node_vel_fluid_x, m_particle_buckets,
+                               m_num_nodes, 0.0);
+        GridAccessor<scalar> v(m_node_vel_fluid_y, m_particle_buckets,
+                               m_num_nodes, 0.0);
+        GridAccessor<scalar> w(m_node_vel_fluid_z, m_particle_buckets,
+                               m_num_nodes, 0.0);
+
+        for (int i = begin; i < end; ++i) {
+          const Vector3s& pos = new_pos[i];
+          const Vector3s grid_pos = (pos - m_grid_mincorner) / dx;
+
+          const Vector3s vel(
+              u.interpolate(grid_pos - Vector3s(0.0, 0.5, 0.5)),
+              v.interpolate(grid_pos - Vector3s(0.5, 0.0, 0.5)),
+              w.interpolate(grid_pos - Vector3s(0.5, 0.5, 0.0)));
+
+          initLiquidParticle(df_index + i, pos, vel, pvol);
+          m_fluids[sp_index + i] = df_index + i;
+        }
+      });
+    }
+  }
+
+  std::cout << "[narrow band: culled " << num_culled << ", reseeded "
+            << num_reseeded << "]" << std::endl;
+
+  // keep the interior for the next sub-step
+  Vector3s bbx_min = Vector3s::Constant(1e+20);
+  Vector3s bbx_max = Vector3s::Constant(-1e+20);
+  bool has_interior = false;
+
+  for (int bucket_idx = 0; bucket_idx < num_buckets; ++bucket_idx) {
+    const VectorXs& bucket_phi = interior_phi[bucket_idx];
+    for (int i = 0; i < bucket_phi.size(); ++i) {
+      if (bucket_phi(i) >= 0.0) continue;
+
+      // solids carry the depth across walls, but hold no liquid
+      const Vector3s np = getNodePosP(bucket_idx, i);
+      if (computePhi(np, solid_sel) < 0.0) continue;
+
+      bbx_min = bbx_min.cwiseMin(np);
+      bbx_max = bbx_max.cwiseMax(np);
+      has_interior = true;
+    }
+  }
+
+  if (!has_interior) {
+    m_interior_phi.clear();
+    m_interior_vel_x.clear();
+    m_interior_vel_y.clear();
+    m_interior_vel_z.clear();
+    return;
+  }
+
+  m_interior_buckets.assign_domain(m_particle_buckets);
+  m_interior_mincorner = m_grid_mincorner;
+  m_interior_bbx_min = bbx_min - Vector3s::Constant(dx);
+  m_interior_bbx_max = bbx_max + Vector3s::Constant(dx);
+  m_interior_phi.swap(interior_phi);
+  m_interior_vel_x = m_node_vel_fluid_x;
+  m_interior_vel_y = m_node_vel_fluid_y;
+  m_interior_vel_z = m_node_vel_fluid_z;
+}
+
+/*!
+ * activate the buckets covered by the grid-represented liquid interior, which
+ * may hold no particle at all
+ */
+void TwoDScene::activateLiquidInteriorBuckets() {
+  if (!m_liquid_info.use_narrow_band || m_interior_phi.empty()) return;
+
+  auto solid_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
+    return dfptr->usage == DFU_SOLID;
+  };
+
+  const scalar dx = getCellSize();
+  const int num_interior_buckets = (int)m_interior_phi.size();
+
+  for (int bucket_idx = 0; bucket_idx < num_interior_buckets; ++bucket_idx) {
+    const VectorXs& bucket_phi = m_interior_phi[bucket_idx];
+    const Vector3i handle = m_interior_buckets.bucket_handle(bucket_idx);
+
+    for (int i = 0; i < bucket_phi.size(); ++i) {
+      if (bucket_phi(i) >= 0.0) continue;
+
+      const Vector3s np =
+          m_interior_mincorner +
+          ((handle * m_num_nodes + getNodeHandle(i)).cast<scalar>() +
+           Vector3s::Constant(0.5)) *
+              dx;
+      if (computePhi(np, solid_sel) < 0.0) continue;
+
+      const Vector3s local = (np - m_grid_mincorner) / m_bucket_size;
+      const Vector3i new_handle((int)floor(local(0)), (int)floor(local(1)),
+                                (int)floor(local(2)));
+      const int new_idx = m_particle_buckets.find_bucket(
+          new_handle(0), new_handle(1), new_handle(2));
+      if (new_idx >= 0) m_bucket_activated[new_idx] = 1U;
+    }
+  }
+}
+
+/*!
+ * semi-Lagrangian advection of the liquid interior onto the current grid
+ */
+void TwoDScene::advectLiquidInterior(scalar dt) {
+  const int num_buckets = getNumBuckets();
+
+  m_node_interior_phi_p.resize(num_buckets);
+  m_node_interior_phi_x.resize(num_buckets);
+  m_node_interior_phi_y.resize(num_buckets);
+  m_node_interior_phi_z.resize(num_buckets);
+  m_node_interior_vel_x.resize(num_buckets);
+  m_node_interior_vel_y.resize(num_buckets);
+  m_node_interior_vel_z.resize(num_buckets);
+
+  const bool has_interior =
+      m_liquid_info.use_narrow_band && !m_interior_phi.empty();
+  const scalar dx = getCellSize();
+  const scalar far_phi = 3.0 * m_bucket_size;
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    const int num_nodes = has_interior ? getNumNodes(bucket_idx) : 0;
+
+    m_node_interior_phi_p[bucket_idx].setConstant(num_nodes, far_phi);
+    m_node_interior_phi_x[bucket_idx].setConstant(num_nodes, far_phi);
+    m_node_interior_phi_y[bucket_idx].setConstant(num_nodes, far_phi);
+    m_node_interior_phi_z[bucket_idx].setConstant(num_nodes, far_phi);
+    m_node_interior_vel_x[bucket_idx].setZero(num_nodes);
+    m_node_interior_vel_y[bucket_idx].setZero(num_nodes);
+    m_node_interior_vel_z[bucket_idx].setZero(num_nodes);
+
+    if (!num_nodes) return;
+
+    GridAccessor<scalar> phi(m_interior_phi, m_interior_buckets, m_num_nodes,
+                             far_phi);
+    GridAccessor<scalar> u(m_interior_vel_x, m_interior_buckets, m_num_nodes,
+                           0.0);
+    GridAccessor<scalar> v(m_interior_vel_y, m_interior_buckets, m_num_nodes,
+                           0.0);
+    GridAccessor<scalar> w(m_interior_vel_z, m_interior_buckets, m_num_nodes,
+                           0.0);
+
+    auto sample_vel = [&](const Vector3s& grid_pos) -> Vector3s {
+      return Vector3s(u.interpolate(grid_pos - Vector3s(0.0, 0.5, 0.5)),
+                      v.interpolate(grid_pos - Vector3s(0.5, 0.0, 0.5)),
+                      w.interpolate(grid_pos - Vector3s(0.5, 0.5, 0.0)));
+    };
+
+    // departure point in cells of the interior grid
+    auto backtrace = [&](const Vector3s& pos) -> Vector3s {
+      const Vector3s grid_pos = (pos - m_interior_mincorner) / dx;
+      return grid_pos - sample_vel(grid_pos) * dt / dx;
+    };
+
+    auto sample_phi = [&](const Vector3s& grid_pos) -> scalar {
+      return phi.interpolate(grid_pos - Vector3s::Constant(0.5));
+    };
+
+    for (int i = 0; i < num_nodes; ++i) {
+      m_node_interior_phi_p[bucket_idx](i) =
+          sample_phi(backtrace(getNodePosP(bucket_idx, i)));
+
+      const Vector3s xp = backtrace(getNodePosX(bucket_idx, i));
+      m_node_interior_phi_x[bucket_idx](i) = sample_phi(xp);
+      m_node_interior_vel_x[bucket_idx](i) = sample_vel(xp)(0);
+
+      const Vector3s yp = backtrace(getNodePosY(bucket_idx, i));
+      m_node_interior_phi_y[bucket_idx](i) = sample_phi(yp);
+      m_node_interior_vel_y[bucket_idx](i) = sample_vel(yp)(1);
+
+      const Vector3s zp = backtrace(getNodePosZ(bucket_idx, i));
+      m_node_interior_phi_z[bucket_idx](i) = sample_phi(zp);
+      m_node_interior_vel_z[bucket_idx](i) = sample_vel(zp)(2);
+    }
+  });
+}
+
+/*!
+ * fill the liquid volume missing from the particles on the nodes covered by
+ * the liquid interior, carrying the interior velocity
+ */
+void TwoDScene::mapLiquidInteriorNodes() {
+  if (!m_liquid_info.use_narrow_band || m_interior_phi.empty()) return;
+
+  const scalar dx = getCellSize();
+  const scalar dV = dx * dx * dx;
+  const scalar rho = m_liquid_info.liquid_density;
+
+  auto fill_nodes = [&](const VectorXs& interior_phi,
+                        const VectorXs& interior_vel, const VectorXs& vol,
+                        const VectorXs& psi, VectorXs& mass_fluid,
+                        VectorXs& vel_fluid, VectorXs& vol_fluid,
+                        VectorXs& sat) {
+    const int num_nodes = interior_phi.size();
+    for (int i = 0; i < num_nodes; ++i) {
+      const scalar frac =
+          mathutils::clamp(0.5 - interior_phi(i) / dx, 0.0, 1.0);
+      if (frac == 0.0) continue;
+
+      const scalar vol_solid = psi(i) * dV;
+      const scalar vol_fluid_elasto = std::max(0.0, vol(i) - vol_solid);
+      const scalar vol_add =
+          frac * (dV - vol_solid) - vol_fluid(i) - vol_fluid_elasto;
+      if (vol_add <= 0.0) continue;
+
+      const scalar mass_add = vol_add * rho;
+      vel_fluid(i) =
+          (vel_fluid(i) * mass_fluid(i) + interior_vel(i) * mass_add) /
+          (mass_fluid(i) + mass_add);
+      mass_fluid(i) += mass_add;
+      vol_fluid(i) += vol_add;
+      sat(i) = mathutils::clamp((vol_fluid(i) + vol_fluid_elasto) /
+                                    std::max(1e-20, dV - vol_solid),
+                                0.0, 1.0);
+    }
+  };
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    if (!m_bucket_activated[bucket_idx]) return;
+
+    fill_nodes(m_node_interior_phi_x[bucket_idx],
+               m_node_interior_vel_x[bucket_idx], m_node_vol_x[bucket_idx],
+               m_node_psi_x[bucket_idx], m_node_mass_fluid_x[bucket_idx],
+               m_node_vel_fluid_x[bucket_idx], m_node_vol_fluid_x[bucket_idx],
+               m_node_sat_x[bucket_idx]);
+    fill_nodes(m_node_interior_phi_y[bucket_idx],
+               m_node_interior_vel_y[bucket_idx], m_node_vol_y[bucket_idx],
+               m_node_psi_y[bucket_idx], m_node_mass_fluid_y[bucket_idx],
+               m_node_vel_fluid_y[bucket_idx], m_node_vol_fluid_y[bucket_idx],
+               m_node_sat_y[bucket_idx]);
+    fill_nodes(m_node_interior_phi_z[bucket_idx],
+               m_node_interior_vel_z[bucket_idx], m_node_vol_z[bucket_idx],
+               m_node_psi_z[bucket_idx], m_node_mass_fluid_z[bucket_idx],
+               m_node_vel_fluid_z[bucket_idx], m_node_vol_fluid_z[bucket_idx],
+               m_node_sat_z[bucket_idx]);
+  });
+}
+
+/*!
+ * secondary spray: absorb spray particles that re-entered the liquid or came
+ * close to elastic objects, and demote isolated liquid particles to spray.
+ * Both are decided on the grid of the previous sub-step.
+ */
+void TwoDScene::updateSprayParticles() {
+  if (!m_liquid_info.use_spray_particles) return;
+
+  const int num_buckets = getNumBuckets();
+  if (num_buckets == 0 || (int)m_node_liquid_phi.size() != num_buckets)
+    return;
+
+  const scalar dx = getCellSize();
+  const int num_elasto = getNumElastoParticles();
+
+  auto cell_of = [&](const Vector3s& pos) -> Vector3i {
+    const Vector3s local = (pos - m_grid_mincorner) / dx;
+    return Vector3i((int)floor(local(0)), (int)floor(local(1)),
+                    (int)floor(local(2)));
+  };
+
+  // number of liquid particles and elastic vertices in each cell
+  std::vector<VectorXi> fluid_count(num_buckets);
+  std::vector<VectorXi> elasto_count(num_buckets);
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    const int num_nodes_p = m_node_liquid_phi[bucket_idx].size();
+    fluid_count[bucket_idx].setZero(num_nodes_p);
+    elasto_count[bucket_idx].setZero(num_nodes_p);
+  });
+
+  BucketNodeLocator locator(m_particle_buckets, m_num_nodes,
+                            &m_bucket_activated);
+  const int num_parts = getNumParticles();
+  for (int pidx = 0; pidx < num_parts; ++pidx) {
+    if (pidx < num_elasto && !isSoft(pidx)) continue;
+
+    int bucket_idx, node_idx;
+    if (!locator.locate(cell_of(m_x.segment<3>(pidx * 4)), bucket_idx,
+                        node_idx))
+      continue;
+
+    if (pidx < num_elasto)
+      ++elasto_count[bucket_idx](node_idx);
+    else
+      ++fluid_count[bucket_idx](node_idx);
+  }
+
+  auto count_block = [](GridAccessor<int>& accessor, const Vector3i& cell) {
+    int buf[27];
+    accessor.getStencil3(cell, buf);
+
+    int count = 0;
+    for (int i = 0; i < 27; ++i) count += buf[i];
+    return count;
+  };
+
+  // spray re-entering the liquid or touching elastic objects
+  const int num_spray = getNumSprayParticles();
+  std::vector<unsigned char> absorbed(num_spray, 0U);
+
+  threadutils::for_each_range(0, num_spray, [&](int begin, int end) {
+    GridAccessor<scalar> liquid_phi(m_node_liquid_phi, m_particle_buckets,
+                                    m_num_nodes, 3.0 * m_bucket_size);
+    GridAccessor<int> elasto(elasto_count, m_particle_buckets, m_num_nodes,
+                             0);
+
+    for (int sidx = begin; sidx < end; ++sidx) {
+      const Vector3s& pos = m_spray_x.segment<3>(sidx * 4);
+      const scalar phi = liquid_phi.interpolate(
+          (pos - m_grid_mincorner) / dx - Vector3s::Constant(0.5));
+      if (phi < -0.5 * dx || count_block(elasto, cell_of(pos)) > 0)
+        absorbed[sidx] = 1U;
+    }
+  });
+
+  // isolated liquid particles away from elastic objects
+  const int num_fluids = getNumFluidParticles();
+  std::vector<unsigned char> demoted(num_fluids, 0U);
+
+  threadutils::for_each_range(0, num_fluids, [&](int begin, int end) {
+    GridAccessor<int> fluid(fluid_count, m_particle_buckets, m_num_nodes, 0);
+    GridAccessor<int> elasto(elasto_count, m_particle_buckets, m_num_nodes,
+                             0);
+
+    for (int fidx = begin; fidx < end; ++fidx) {
+      const Vector3i cell = cell_of(m_x.segment<3>(m_fluids[fidx] * 4));
+      if (count_block(fluid, cell) <= m_liquid_info.spray_neighbor_count &&
+          count_block(elasto, cell) == 0)
+        demoted[fidx] = 1U;
+    }
+  });
+
+  std::vector<int> absorbed_indices;
+  std::vector<int> kept_indices;
+  for (int sidx = 0; sidx < num_spray; ++sidx) {
+    if (absorbed[sidx])
+      absorbed_indices.push_back(sidx);
+    else
+      kept_indices.push_back(sidx);
+  }
+
+  std::vector<int> demoted_indices;
+  for (int fidx = 0; fidx < num_fluids; ++fidx) {
+    if (demoted[fidx]) demoted_indices.push_back(m_fluids[fidx]);
+  }
+
+  const int num_absorbed = (int)absorbed_indices.size();
+  const int num_demoted = (int)demoted_indices.size();
+
+  if (num_absorbed == 0 && num_demoted == 0) return;
+
+  // the new spray set: kept spray followed by demoted particles
+  const int new_num_spray = (int)kept_indices.size() + num_demoted;
+  VectorXs spray_x(new_num_spray * 4);
+  VectorXs spray_v(new_num_spray * 4);
+  VectorXs spray_vol(new_num_spray);
+
+  threadutils::for_each(0, new_num_spray, [&](int i) {
+    if (i < (int)kept_indices.size()) {
+      const int sidx = kept_indices[i];
+      spray_x.segment<4>(i * 4) = m_spray_x.segment<4>(sidx * 4);
+      spray_v.segment<4>(i * 4) = m_spray_v.segment<4>(sidx * 4);
+      spray_vol(i) = m_spray_vol(sidx);
+    } else {
+      const int pidx = demoted_indices[i - kept_indices.size()];
+      spray_x.segment<4>(i * 4) = m_x.segment<4>(pidx * 4);
+      spray_v.segment<4>(i * 4) = m_fluid_v.segment<4>(pidx * 4);
+      spray_vol(i) = m_fluid_vol(pidx);
+    }
+  });
+
+  // absorbed spray becomes liquid particles again
+  if (num_absorbed > 0) {
+    const int df_index = getNumParticles();
+    const int sp_index = getNumFluidParticles();
+
+    m_fluids.resize(sp_index + num_absorbed);
+    conservativeResizeParticles(df_index + num_absorbed);
+
+    threadutils::for_each(0, num_absorbed, [&](int i) {
+      const int sidx = absorbed_indices[i];
+      initLiquidParticle(df_index + i, m_spray_x.segment<3>(sidx * 4),
+                         m_spray_v.segment<3>(sidx * 4), m_spray_vol(sidx));
+      m_fluids[sp_index + i] = df_index + i;
+    });
+  }
+
+  for (int pidx : demoted_indices) m_fluid_vol(pidx) = 0.0;
+
+  removeEmptyParticles();
+
+  m_spray_x.swap(spray_x);
+  m_spray_v.swap(spray_v);
+  m_spray_vol.swap(spray_vol);
+
+  std::cout << "[spray: demoted " << num_demoted << ", absorbed "
+            << num_absorbed << ", total " << new_num_spray << "]"
+            << std::endl;
+}
+
+/*!
+ * ballistic motion of the spray particles, with the external forces applied
+ * on liquid, quadratic air drag, and collision against the solid distance
+ * fields
+ */
+void TwoDScene::advectSprayParticles(const scalar& dt) {
+  const int num_spray = getNumSprayParticles();
+  if (num_spray == 0) return;
+
+  const scalar rho = m_liquid_info.liquid_density;
+  const scalar eps = getCellSize() * 0.01;
+
+  VectorXs spray_m(num_spray * 4);
+  threadutils::for_each(0, num_spray, [&](int sidx) {
+    const scalar mass = m_spray_vol(sidx) * rho;
+    spray_m.segment<4>(sidx * 4) = Vector4s(mass, mass, mass, 0.0);
+  });
 
-      const auto& indices = m_gauss_nodes_p[gidx];
-      const scalar rad_e = m_radius_gauss(gidx);
+  VectorXs gradE(num_spray * 4);
+  gradE.setZero();
 
-      for (int i = 0; i < indices.rows(); ++i) {
-        if (indices(i, 0) < 0) continue;
+  VectorXs spray_psi(num_spray);
+  spray_psi.setZero();
 
-        VectorXs& phis = m_node_combined_phi[indices(i, 0)];
-        if (indices(i, 1) < 0 || indices(i, 1) >= phis.size()) continue;
+  for (std::vector<Force*>::size_type i = 0; i < m_forces.size(); ++i) {
+    if (m_forces[i]->flag() & 2)
+      m_forces[i]->addGradEToTotal(m_spray_x, m_spray_v, spray_m, spray_psi,
+                                   m_liquid_info.lambda, gradE);
+  }
 
-        const Vector3s& np = getNodePosP(indices(i, 0), indices(i, 1));
+  auto solid_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
+    return dfptr->usage == DFU_SOLID;
+  };
 
-        scalar sqr_d = dx * 3.0;
-        Vector3s cp;
-        igl::point_simplex_squared_distance<3>(np, m_x_reshaped, m_faces, fidx,
-                                               sqr_d, cp);
+  auto term_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
+    return dfptr->usage == DFU_TERMINATOR;
+  };
 
-        const scalar phi =
-            sqrt(std::max(0.0, sqr_d)) - std::max(dx * 0.51, rad_e);
+  threadutils::for_each(0, num_spray, [&](int sidx) {
+    Vector3s pos = m_spray_x.segment<3>(sidx * 4);
+    Vector3s vel = m_spray_v.segment<3>(sidx * 4);
 
-        if (phi < phis(indices(i, 1))) {
-          phis(indices(i, 1)) = phi;
-        }
-      }
-    }
-  });
-}
+    const scalar rad = pow(m_spray_vol(sidx) / M_PI * 0.75, 1.0 / 3.0);
 
-const std::vector<VectorXs>& TwoDScene::getNodeSurfTensionP() const {
-  return m_node_surf_tension;
-}
+    vel -= gradE.segment<3>(sidx * 4) / spray_m(sidx * 4) * dt;
 
-bool TwoDScene::useSurfTension() const {
-  return m_liquid_info.use_surf_tension;
-}
+    // drag of a sphere, integrated implicitly in its magnitude
+    const scalar k = 0.375 * m_liquid_info.spray_drag_coeff *
+                     m_liquid_info.air_density / rho / rad;
+    vel /= 1.0 + k * vel.norm() * dt;
 
-/*!
- * update liquid levelset
- */
-void TwoDScene::updateLiquidPhi(scalar dt) {
-  const int num_buckets = (int)m_particle_buckets.size();
+    pos += vel * dt;
 
-  m_node_liquid_phi.resize(num_buckets);
-  m_node_pressure.resize(num_buckets);
+    Vector3s solid_vel;
+    const scalar phi = computePhiVel(pos, solid_vel, solid_sel);
+    if (phi < 0.0) {
+      Vector3s normal(
+          computePhi(pos + Vector3s(eps, 0, 0), solid_sel) -
+              computePhi(pos - Vector3s(eps, 0, 0), solid_sel),
+          computePhi(pos + Vector3s(0, eps, 0), solid_sel) -
+              computePhi(pos - Vector3s(0, eps, 0), solid_sel),
+          computePhi(pos + Vector3s(0, 0, eps), solid_sel) -
+              computePhi(pos - Vector3s(0, 0, eps), solid_sel));
 
-  const scalar dx = getCellSize();
+      if (normal.norm() > 1e-20) {
+        normal.normalize();
+        pos -= phi * normal;
 
-  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
-    const int num_nodes = getNumNodes(bucket_idx);
+        const scalar vn = (vel - solid_vel).dot(normal);
+        if (vn < 0.0) vel -= vn * normal;
+      }
+    }
 
-    m_node_liquid_phi[bucket_idx].resize(num_nodes);
-    m_node_liquid_phi[bucket_idx].setConstant(3.0 * m_bucket_size);
-    m_node_pressure[bucket_idx].resize(num_nodes);
-    m_node_pressure[bucket_idx].setZero();
+    m_spray_x.segment<3>(sidx * 4) = pos;
+    m_spray_v.segment<3>(sidx * 4) = vel;
+
+    if (computePhi(pos, term_sel) < 0.0) m_spray_vol(sidx) = 0.0;
   });
 
-  if (getNumFluidParticles() == 0) return;
+  // remove the spray caught by terminators
+  int new_num_spray = 0;
+  for (int sidx = 0; sidx < num_spray; ++sidx) {
+    if (m_spray_vol(sidx) < 1e-20) continue;
 
-  const int num_elasto = getNumElastoParticles();
+    if (new_num_spray != sidx) {
+      m_spray_x.segment<4>(new_num_spray * 4) = m_spray_x.segment<4>(sidx * 4);
+      m_spray_v.segment<4>(new_num_spray * 4) = m_spray_v.segment<4>(sidx * 4);
+      m_spray_vol(new_num_spray) = m_spray_vol(sidx);
+    }
+    ++new_num_spray;
+  }
 
-  m_particle_buckets.for_each_bucket_particles_colored(
-      [&](int pidx, int bucket_idx) {
-        if (pidx < num_elasto) return;
+  if (new_num_spray < num_spray) {
+    m_spray_x.conservativeResize(new_num_spray * 4);
+    m_spray_v.conservativeResize(new_num_spray * 4);
+    m_spray_vol.conservativeResize(new_num_spray);
+  }
+}
 
-        const auto& indices = m_particle_nodes_p[pidx];
+int TwoDScene::getNumSprayParticles() const { return m_spray_vol.size(); }
 
-        const Vector3s& pos =
-            m_x.segment<3>(pidx * 4);  // + m_fluid_v.segment<3>(pidx * 4) * dt;
+const VectorXs& TwoDScene::getSprayX() const { return m_spray_x; }
 
-        for (int i = 0; i < indices.rows(); ++i) {
-          if (!m_bucket_activated[indices(i, 0)]) continue;
+const VectorXs& TwoDScene::getSprayVol() const { return m_spray_vol; }
 
-          VectorXs& phis = m_node_liquid_phi[indices(i, 0)];
-          assert(indices(i, 1) >= 0 && indices(i, 1) < phis.size());
+/*!
+ * snapshot the state at the beginning of a sub-step
+ */
+void TwoDScene::saveState(SceneState& state) {
+  state.num_particles = getNumParticles();
+
+  state.x = m_x;
+  state.rest_x = m_rest_x;
+  state.v = m_v;
+  state.saved_v = m_saved_v;
+  state.dv = m_dv;
+  state.fluid_v = m_fluid_v;
+  state.m = m_m;
+  state.fluid_m = m_fluid_m;
+  state.radius = m_radius;
+  state.vol = m_vol;
+  state.rest_vol = m_rest_vol;
+  state.shape_factor = m_shape_factor;
+  state.fluid_vol = m_fluid_vol;
+  state.inside = m_inside;
+  state.volume_fraction = m_volume_fraction;
+  state.rest_volume_fraction = m_rest_volume_fraction;
+  state.orientation = m_orientation;
+  state.B = m_B;
+  state.fB = m_fB;
+  state.classifier = m_classifier;
+  state.fixed = m_fixed;
+  state.twist = m_twist;
+  state.is_strand_tip = m_is_strand_tip;
+  state.particle_to_surfel = m_particle_to_surfel;
+  state.particle_group = m_particle_group;
+  state.fluids = m_fluids;
+  state.surfel_norms = m_surfel_norms;
+
+  state.x_gauss = m_x_gauss;
+  state.v_gauss = m_v_gauss;
+  state.dv_gauss = m_dv_gauss;
+  state.fluid_v_gauss = m_fluid_v_gauss;
+  state.m_gauss = m_m_gauss;
+  state.vol_gauss = m_vol_gauss;
+  state.radius_gauss = m_radius_gauss;
+  state.fluid_m_gauss = m_fluid_m_gauss;
+  state.fluid_vol_gauss = m_fluid_vol_gauss;
+  state.volume_fraction_gauss = m_volume_fraction_gauss;
+  state.Fe_gauss = m_Fe_gauss;
+  state.d_gauss = m_d_gauss;
+  state.dFe_gauss = m_dFe_gauss;
+  state.norm_gauss = m_norm_gauss;
+
+  state.group_pos = m_group_pos;
+  state.group_rot = m_group_rot;
+  state.group_prev_pos = m_group_prev_pos;
+  state.group_prev_rot = m_group_prev_rot;
+  state.shooting_vol_accum = m_shooting_vol_accum;
+
+  for (auto& df : m_group_distance_field) {
+    if (df) df->save_state();
+  }
 
-          const Vector3s& np = getNodePosP(indices(i, 0), indices(i, 1));
+  state.interior_buckets = m_interior_buckets;
+  state.interior_mincorner = m_interior_mincorner;
+  state.interior_bbx_min = m_interior_bbx_min;
+  state.interior_bbx_max = m_interior_bbx_max;
+  state.interior_phi = m_interior_phi;
+  state.interior_vel_x = m_interior_vel_x;
+  state.interior_vel_y = m_interior_vel_y;
+  state.interior_vel_z = m_interior_vel_z;
 
-          const scalar phi = (pos - np).norm() -
-                             std::max(dx * 0.883644, m_radius(pidx * 2 + 0));
+  state.spray_x = m_spray_x;
+  state.spray_v = m_spray_v;
+  state.spray_vol = m_spray_vol;
+}
 
-          if (phi < phis(indices(i, 1))) {
-            phis(indices(i, 1)) = phi;
-          }
-        }
-      },
-      3);
+/*!
+ * roll back to a snapshot taken by saveState, by swapping the buffers back.
+ * Only liquid particles are ever added or removed, so resizing keeps the
+ * topology of the elastic vertices. Forces recompute their start state from
+ * the particles in the next sub-step. The grid is rebuilt around the restored
+ * particles; its fields are dropped, so the narrow band and the spray, which
+ * read them before the grid is rebuilt, skip the retried sub-step as they do
+ * the first one.
+ */
+void TwoDScene::restoreState(SceneState& state) {
+  conservativeResizeParticles(state.num_particles);
+
+  m_x.swap(state.x);
+  m_rest_x.swap(state.rest_x);
+  m_v.swap(state.v);
+  m_saved_v.swap(state.saved_v);
+  m_dv.swap(state.dv);
+  m_fluid_v.swap(state.fluid_v);
+  m_m.swap(state.m);
+  m_fluid_m.swap(state.fluid_m);
+  m_radius.swap(state.radius);
+  m_vol.swap(state.vol);
+  m_rest_vol.swap(state.rest_vol);
+  m_shape_factor.swap(state.shape_factor);
+  m_fluid_vol.swap(state.fluid_vol);
+  m_inside.swap(state.inside);
+  m_volume_fraction.swap(state.volume_fraction);
+  m_rest_volume_fraction.swap(state.rest_volume_fraction);
+  m_orientation.swap(state.orientation);
+  m_B.swap(state.B);
+  m_fB.swap(state.fB);
+  m_classifier.swap(state.classifier);
+  m_fixed.swap(state.fixed);
+  m_twist.swap(state.twist);
+  m_is_strand_tip.swap(state.is_strand_tip);
+  m_particle_to_surfel.swap(state.particle_to_surfel);
+  m_particle_group.swap(state.particle_group);
+  m_fluids.swap(state.fluids);
+  m_surfel_norms.swap(state.surfel_norms);
+
+  m_x_gauss.swap(state.x_gauss);
+  m_v_gauss.swap(state.v_gauss);
+  m_dv_gauss.swap(state.dv_gauss);
+  m_fluid_v_gauss.swap(state.fluid_v_gauss);
+  m_m_gauss.swap(state.m_gauss);
+  m_vol_gauss.swap(state.vol_gauss);
+  m_radius_gauss.swap(state.radius_gauss);
+  m_fluid_m_gauss.swap(state.fluid_m_gauss);
+  m_fluid_vol_gauss.swap(state.fluid_vol_gauss);
+  m_volume_fraction_gauss.swap(state.volume_fraction_gauss);
+  m_Fe_gauss.swap(state.Fe_gauss);
+  m_d_gauss.swap(state.d_gauss);
+  m_dFe_gauss.swap(state.dFe_gauss);
+  m_norm_gauss.swap(state.norm_gauss);
+
+  m_group_pos.swap(state.group_pos);
+  m_group_rot.swap(state.group_rot);
+  m_group_prev_pos.swap(state.group_prev_pos);
+  m_group_prev_rot.swap(state.group_prev_rot);
+  m_shooting_vol_accum.swap(state.shooting_vol_accum);
+
+  for (auto& df : m_group_distance_field) {
+    if (df) df->restore_state();
+  }
 
-  auto solid_sel = [](const std::shared_ptr<DistanceField>& dfptr) -> bool {
-    return dfptr->usage == DFU_SOLID;
-  };
+  std::swap(m_interior_buckets, state.interior_buckets);
+  m_interior_mincorner = state.interior_mincorner;
+  m_interior_bbx_min = state.interior_bbx_min;
+  m_interior_bbx_max = state.interior_bbx_max;
+  m_interior_phi.swap(state.interior_phi);
+  m_interior_vel_x.swap(state.interior_vel_x);
+  m_interior_vel_y.swap(state.interior_vel_y);
+  m_interior_vel_z.swap(state.interior_vel_z);
 
-  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
-    VectorXs& bucket_liquid_phi = m_node_liquid_phi[bucket_idx];
+  m_spray_x.swap(state.spray_x);
+  m_spray_v.swap(state.spray_v);
+  m_spray_vol.swap(state.spray_vol);
 
-    const int num_pressure = bucket_liquid_phi.size();
+  m_node_liquid_phi.clear();
+  m_node_interior_phi_p.clear();
+  m_node_vel_fluid_x.clear();
+  m_node_vel_fluid_y.clear();
+  m_node_vel_fluid_z.clear();
 
-    for (int i = 0; i < num_pressure; ++i) {
-      const Vector3s& np = getNodePosP(bucket_idx, i);
+  updateParticleBoundingBox();
+  rebucketizeParticles();
+}
 
-      Vector3s vel;
-      const scalar sphi = computePhiVel(np, vel, solid_sel);
-      if (sphi < 0.0) bucket_liquid_phi(i) = -0.5 * dx;
-    }
-  });
+/*!
+ * check the particles for non-finite values and runaway velocities, return
+ * false with a short description of the first problem found
+ */
+bool TwoDScene::checkStateHealth(std::string& reason) const {
+  if (!m_x.allFinite() || !m_x_gauss.allFinite() || !m_spray_x.allFinite()) {
+    reason = "non-finite position";
+    return false;
+  }
 
-  // update variables for viscosity computation
-  if (m_liquid_info.compute_viscosity) {
-    estimateVolumeFractions(m_node_liquid_c_vf, m_node_pos,
-                            Vector3s(0.5, 0.5, 0.5));
-    estimateVolumeFractions(m_node_liquid_u_vf, m_node_pos,
-                            Vector3s(0.0, 0.5, 0.5));
-    estimateVolumeFractions(m_node_liquid_v_vf, m_node_pos,
-                            Vector3s(0.5, 0.0, 0.5));
-    estimateVolumeFractions(m_node_liquid_w_vf, m_node_pos,
-                            Vector3s(0.5, 0.5, 0.0));
-    estimateVolumeFractions(m_node_liquid_ex_vf, m_node_pos,
-                            Vector3s(0.5, 0.0, 0.0));
-    estimateVolumeFractions(m_node_liquid_ey_vf, m_node_pos,
-                            Vector3s(0.0, 0.5, 0.0));
-    estimateVolumeFractions(m_node_liquid_ez_vf, m_node_pos,
-                            Vector3s(0.0, 0.0, 0.5));
+  if (!m_v.allFinite() || !m_fluid_v.allFinite() || !m_spray_v.allFinite()) {
+    reason = "non-finite velocity";
+    return false;
   }
 
-  if (m_liquid_info.use_surf_tension) {
-    extendLiquidPhi();
+  const scalar max_vel = m_liquid_info.max_velocity_bound;
+  if (max_vel > 0.0) {
+    const scalar elasto_vel = getMaxVelocity();
+    const scalar fluid_vel = getMaxFluidVelocity();
+    if (elasto_vel > max_vel || fluid_vel > max_vel) {
+      std::ostringstream oss;
+      oss << "velocity " << std::max(elasto_vel, fluid_vel) << " above bound "
+          << max_vel;
+      reason = oss.str();
+      return false;
+    }
   }
+
+  return true;
 }
 
 /*!
@@ -3540,104 +4678,180 @@ void TwoDScene::renormalizeLiquidPhi() {
 }
 
 /*!
- * calculate volume fraction of non-rigid body region, used for implicit
- * viscosity
+ * resample the liquid levelset onto a lattice with half-cell spacing. The
+ * lattice starts one cell below the first pressure node of the bucket, so that
+ * every corner sampled by the viscosity volume fractions is a lattice point.
+ * Values are identical to trilinear samples of the phi at those points.
  */
-void TwoDScene::estimateVolumeFractions(std::vector<VectorXs>& volumes,
-                                        const std::vector<VectorXs>& node_pos,
-                                        const Vector3s& np_offset) {
+void TwoDScene::updateLiquidPhiLattice() {
+  const int num_buckets = getNumBuckets();
+
+  if ((int)m_node_liquid_phi_lattice.size() != num_buckets)
+    m_node_liquid_phi_lattice.resize(num_buckets);
+
   const scalar dx = getCellSize();
-  const Vector3s ori =
-      m_grid_mincorner + Vector3s(0.5 * dx, 0.5 * dx, 0.5 * dx);
+  const int nn = m_num_nodes;
+  const int np = nn + 2;      // pressure nodes per dimension, with ghosts
+  const int nl = 2 * nn + 2;  // lattice points per dimension
+
   m_particle_buckets.for_each_bucket([&](int bucket_idx) {
-    const int num_nodes = volumes[bucket_idx].size();
+    VectorXs& lattice = m_node_liquid_phi_lattice[bucket_idx];
 
-    for (int i = 0; i < num_nodes; ++i) {
-      const Vector3s& centre =
-          node_pos[bucket_idx].segment<3>(i * 3) + np_offset;
-
-      scalar offset = 0.5 * dx;
-      scalar phi000 = interpolateValue(
-          Vector3s(centre + Vector3s(-offset, -offset, -offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi001 = interpolateValue(
-          Vector3s(centre + Vector3s(-offset, -offset, +offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi010 = interpolateValue(
-          Vector3s(centre + Vector3s(-offset, +offset, -offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi011 = interpolateValue(
-          Vector3s(centre + Vector3s(-offset, +offset, +offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi100 = interpolateValue(
-          Vector3s(centre + Vector3s(+offset, -offset, -offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi101 = interpolateValue(
-          Vector3s(centre + Vector3s(+offset, -offset, +offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi110 = interpolateValue(
-          Vector3s(centre + Vector3s(+offset, +offset, -offset)),
-          m_node_liquid_phi, ori, dx);
-      scalar phi111 = interpolateValue(
-          Vector3s(centre + Vector3s(+offset, +offset, +offset)),
-          m_node_liquid_phi, ori, dx);
-
-      volumes[bucket_idx][i] = volume_fraction(phi000, phi100, phi010, phi110,
-                                               phi001, phi101, phi011, phi111);
+    if (!m_bucket_activated[bucket_idx]) {
+      lattice.resize(0);
+      return;
     }
-  });
-}
 
-scalar TwoDScene::interpolateValue(const Vector3s& pos,
-                                   const std::vector<VectorXs>& phi,
-                                   const Vector3s& phi_ori,
-                                   const scalar& default_val) {
-  const scalar dx = getCellSize();
-  Vector3s grid_pos = pos - phi_ori;
-  Vector3s base_pos = grid_pos / dx;
-  Vector3i base_idx = Vector3i((int)floor(base_pos(0)), (int)floor(base_pos(1)),
-                               (int)floor(base_pos(2)));
-
-  scalar buf[8];
-  for (int t = 0; t < 2; ++t)
-    for (int s = 0; s < 2; ++s)
-      for (int r = 0; r < 2; ++r) {
-        int local_idx = t * 4 + s * 2 + r;
-        Vector3i query_idx = base_idx + Vector3i(r, s, t);
-        Vector3i bucket_handle =
-            Vector3i(query_idx(0) / m_num_nodes, query_idx(1) / m_num_nodes,
-                     query_idx(2) / m_num_nodes);
-
-        if (bucket_handle(0) < 0 || bucket_handle(0) >= m_particle_buckets.ni ||
-            bucket_handle(1) < 0 || bucket_handle(1) >= m_particle_buckets.nj ||
-            bucket_handle(2) < 0 || bucket_handle(2) >= m_particle_buckets.nk) {
-          buf[local_idx] = default_val;
-          continue;
+    const Vector3i bucket_handle = m_particle_buckets.bucket_handle(bucket_idx);
+
+    // resolve the neighbor buckets once instead of once per sample
+    int neighbors[27];
+    for (int t = 0; t < 3; ++t)
+      for (int s = 0; s < 3; ++s)
+        for (int r = 0; r < 3; ++r) {
+          const Vector3i nb_handle =
+              bucket_handle + Vector3i(r - 1, s - 1, t - 1);
+          int nb_idx = m_particle_buckets.find_bucket(
+              nb_handle(0), nb_handle(1), nb_handle(2));
+          if (nb_idx >= 0 && !m_bucket_activated[nb_idx]) nb_idx = -1;
+          neighbors[t * 9 + s * 3 + r] = nb_idx;
         }
 
-        const int bucket_idx = m_particle_buckets.bucket_index(bucket_handle);
-        if (!m_bucket_activated[bucket_idx]) {
-          buf[local_idx] = default_val;
-          continue;
+    // gather pressure nodes [-1, nn] of this bucket, with ghosts taken from
+    // the neighbors
+    VectorXs padded(np * np * np);
+    for (int k = 0; k < np; ++k) {
+      const int bk = (k == 0) ? 0 : ((k == np - 1) ? 2 : 1);
+      const int lk = k - 1 - (bk - 1) * nn;
+      for (int j = 0; j < np; ++j) {
+        const int bj = (j == 0) ? 0 : ((j == np - 1) ? 2 : 1);
+        const int lj = j - 1 - (bj - 1) * nn;
+        for (int i = 0; i < np; ++i) {
+          const int bi = (i == 0) ? 0 : ((i == np - 1) ? 2 : 1);
+          const int li = i - 1 - (bi - 1) * nn;
+
+          const int nb_idx = neighbors[bk * 9 + bj * 3 + bi];
+          padded(k * np * np + j * np + i) =
+              (nb_idx < 0)
+                  ? dx
+                  : m_node_liquid_phi[nb_idx](lk * nn * nn + lj * nn + li);
+        }
+      }
+    }
+
+    // separable refinement, in the same axis order as trilerp
+    VectorXs refined_x(np * np * nl);
+    for (int k = 0; k < np; ++k)
+      for (int j = 0; j < np; ++j)
+        for (int h = 0; h < nl; ++h) {
+          const int base = k * np * np + j * np + (h >> 1);
+          refined_x(k * np * nl + j * nl + h) =
+              (h & 1) ? mathutils::lerp(padded(base), padded(base + 1), 0.5)
+                      : padded(base);
         }
 
-        Vector3i node_handle =
-            Vector3i(query_idx(0) - bucket_handle(0) * m_num_nodes,
-                     query_idx(1) - bucket_handle(1) * m_num_nodes,
-                     query_idx(2) - bucket_handle(2) * m_num_nodes);
+    VectorXs refined_y(np * nl * nl);
+    for (int k = 0; k < np; ++k)
+      for (int h = 0; h < nl; ++h)
+        for (int i = 0; i < nl; ++i) {
+          const int base = k * np * nl + (h >> 1) * nl + i;
+          refined_y(k * nl * nl + h * nl + i) =
+              (h & 1) ? mathutils::lerp(refined_x(base), refined_x(base + nl),
+                                        0.5)
+                      : refined_x(base);
+        }
 
-        const int node_idx = node_handle(2) * m_num_nodes * m_num_nodes +
-                             node_handle(1) * m_num_nodes + node_handle(0);
+    if (lattice.size() != nl * nl * nl) lattice.resize(nl * nl * nl);
 
-        buf[local_idx] = phi[bucket_idx][node_idx];
-      }
+    for (int h = 0; h < nl; ++h)
+      for (int j = 0; j < nl; ++j)
+        for (int i = 0; i < nl; ++i) {
+          const int base = (h >> 1) * nl * nl + j * nl + i;
+          lattice(h * nl * nl + j * nl + i) =
+              (h & 1) ? mathutils::lerp(refined_y(base),
+                                        refined_y(base + nl * nl), 0.5)
+                      : refined_y(base);
+        }
+  });
+}
+
+/*!
+ * calculate the volume fractions of cell centres, faces and edges from the
+ * liquid phi lattice in a single pass, used for implicit viscosity
+ */
+void TwoDScene::estimateVolumeFractionsFromLattice() {
+  const int nn = m_num_nodes;
+  const int nl = 2 * nn + 2;
+
+  // offsets of the sample centres from the node, in half cells
+  const int offsets[7][3] = {{1, 1, 1}, {0, 1, 1}, {1, 0, 1}, {1, 1, 0},
+                             {1, 0, 0}, {0, 1, 0}, {0, 0, 1}};
+
+  std::vector<VectorXs>* volumes[7] = {
+      &m_node_liquid_c_vf,  &m_node_liquid_u_vf,  &m_node_liquid_v_vf,
+      &m_node_liquid_w_vf,  &m_node_liquid_ex_vf, &m_node_liquid_ey_vf,
+      &m_node_liquid_ez_vf};
+
+  const bool validate = m_liquid_info.validate_fraction_kernels;
+  std::vector<scalar> bucket_max_diff(validate ? getNumBuckets() : 0, 0.0);
+
+  m_particle_buckets.for_each_bucket([&](int bucket_idx) {
+    const VectorXs& lattice = m_node_liquid_phi_lattice[bucket_idx];
+    if (lattice.size() == 0) return;
+
+    const int num_nodes = nn * nn * nn;
+
+    // lattice offsets of the cube corners, in the order of volume_fraction
+    const int di = 2;
+    const int dj = 2 * nl;
+    const int dk = 2 * nl * nl;
+    const int corner_offsets[8] = {0,  di,      dj,      di + dj,
+                                   dk, di + dk, dj + dk, di + dj + dk};
+
+    VectorXs corner_phi(num_nodes * 8);
+
+    for (int f = 0; f < 7; ++f) {
+      VectorXs& bucket_volumes = (*volumes[f])[bucket_idx];
+      assert(bucket_volumes.size() == num_nodes);
+
+      for (int k = 0; k < nn; ++k)
+        for (int j = 0; j < nn; ++j)
+          for (int i = 0; i < nn; ++i) {
+            const int node_idx = k * nn * nn + j * nn + i;
+            const int base = (k * 2 + offsets[f][2]) * nl * nl +
+                             (j * 2 + offsets[f][1]) * nl +
+                             (i * 2 + offsets[f][0]);
+
+            for (int c = 0; c < 8; ++c)
+              corner_phi(c * num_nodes + node_idx) =
+                  lattice(base + corner_offsets[c]);
+          }
 
-  Vector3s frac = Vector3s(base_pos(0) - (scalar)base_idx(0),
-                           base_pos(1) - (scalar)base_idx(1),
-                           base_pos(2) - (scalar)base_idx(2));
+      volume_fraction_batch(corner_phi.data(), num_nodes,
+                            bucket_volumes.data());
+
+      if (validate) {
+        for (int i = 0; i < num_nodes; ++i) {
+          const scalar frac = volume_fraction(
+              corner_phi(i), corner_phi(num_nodes + i),
+              corner_phi(num_nodes * 2 + i), corner_phi(num_nodes * 3 + i),
+              corner_phi(num_nodes * 4 + i), corner_phi(num_nodes * 5 + i),
+              corner_phi(num_nodes * 6 + i), corner_phi(num_nodes * 7 + i));
+          bucket_max_diff[bucket_idx] = std::max(
+              bucket_max_diff[bucket_idx], fabs(frac - bucket_volumes(i)));
+        }
+      }
+    }
+  });
 
-  return mathutils::trilerp(buf[0], buf[1], buf[2], buf[3], buf[4], buf[5],
-                            buf[6], buf[7], frac[0], frac[1], frac[2]);
+  if (validate) {
+    const scalar max_diff = bucket_max_diff.empty()
+                                ? 0.0
+                                : *std::max_element(bucket_max_diff.begin(),
+                                                    bucket_max_diff.end());
+    std::cout << "[validate volume fractions, max diff: " << max_diff << "]"
+              << std::endl;
+  }
 }
 
 const std::vector<VectorXuc>& TwoDScene::getNodeLiquidValidX() const {
@@ -3742,10 +4956,10 @@ void TwoDScene::findNodes(const Sorter& buckets, const VectorXs& x,
               }
 
               assert(cell_local_idx(r) >= 0 && cell_local_idx(r) < m_num_nodes);
-              assert(node_bucket_handle(r) >= 0 &&
-                     node_bucket_handle(r) < m_particle_buckets.dim_size(r));
             }
 
+            assert(buckets.has_bucket(node_bucket_handle));
+
             int node_bucket_idx = buckets.bucket_index(node_bucket_handle);
             if (hasNewNode) {
               m_bucket_activated[node_bucket_idx] = 1U;
@@ -4198,6 +5412,59 @@ scalar TwoDScene::getMaxFluidVelocity() const {
   return sqrt(max_vel);
 }
 
+scalar TwoDScene::getElasticWaveStepSize() const { return m_elastic_wave_dt; }
+
+void TwoDScene::updateElasticWaveStepSize() {
+  const int num_edges = getNumEdges();
+  const int num_faces = getNumFaces();
+  const int num_elements = num_edges + num_faces;
+
+  m_elastic_wave_dt = 1e+63;
+  if (m_liquid_info.elasto_integrator == 0 || num_elements == 0) return;
+
+  VectorXs element_dt(num_elements);
+  threadutils::for_each(0, num_elements, [&](int i) {
+    const scalar rho = getGaussDensity(i);
+    const scalar E = getYoungModulus(i);
+    if (isGaussFixed(i) || rho <= 0.0 || E <= 0.0) {
+      element_dt(i) = 1e+63;
+      return;
+    }
+
+    // the leg of an isosceles right triangle stands in for the shortest
+    // edge of a face
+    const scalar len = (i < num_edges)
+                           ? m_edge_rest_length(i)
+                           : sqrt(2.0 * m_face_rest_area(i - num_edges));
+    element_dt(i) = len / sqrt(E / rho);
+  });
+
+  m_elastic_wave_dt =
+      m_liquid_info.elastic_cfl_number * element_dt.minCoeff();
+}
+
+int TwoDScene::getNumElastoSubcycles(const scalar& dt) const {
+  return std::max(1, (int)ceil(dt / m_elastic_wave_dt * (1.0 - 1e-8)));
+}
+
+void TwoDScene::setElastoSolveIterations(int iterations) {
+  m_elasto_solve_iterations = iterations;
+}
+
+bool TwoDScene::useExplicitElasto(const scalar& dt) const {
+  switch (m_liquid_info.elasto_integrator) {
+    case 1:
+      return true;
+    case 2:
+      // a sub-cycle re-evaluates the forces once, about the cost of one
+      // Krylov iteration's Hessian product; until an implicit solve has been
+      // measured the count is zero and the implicit path is taken
+      return getNumElastoSubcycles(dt) <= m_elasto_solve_iterations;
+    default:
+      return false;
+  }
+}
+
 const std::vector<VectorXi>& TwoDScene::getNodeIndexEdgeX() const {
   return m_node_index_edge_x;
 }
@@ -4238,12 +5505,7 @@ void TwoDScene::connectEdgeNodes() {
               ey_local_idx(2) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ex(node_idx * 8 + r * 2 + 0) = -1;
               bucket_node_idx_ex(node_idx * 8 + r * 2 + 1) = -1;
             } else {
@@ -4272,12 +5534,7 @@ void TwoDScene::connectEdgeNodes() {
               ez_local_idx(1) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ex(node_idx * 8 + 4 + r * 2 + 0) = -1;
               bucket_node_idx_ex(node_idx * 8 + 4 + r * 2 + 1) = -1;
             } else {
@@ -4307,12 +5564,7 @@ void TwoDScene::connectEdgeNodes() {
               ex_local_idx(2) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ey(node_idx * 8 + r * 2 + 0) = -1;
               bucket_node_idx_ey(node_idx * 8 + r * 2 + 1) = -1;
             } else {
@@ -4341,12 +5593,7 @@ void TwoDScene::connectEdgeNodes() {
               ez_local_idx(0) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ey(node_idx * 8 + 4 + r * 2 + 0) = -1;
               bucket_node_idx_ey(node_idx * 8 + 4 + r * 2 + 1) = -1;
             } else {
@@ -4377,12 +5624,7 @@ void TwoDScene::connectEdgeNodes() {
               ex_local_idx(1) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ez(node_idx * 8 + r * 2 + 0) = -1;
               bucket_node_idx_ez(node_idx * 8 + r * 2 + 1) = -1;
             } else {
@@ -4412,12 +5654,7 @@ void TwoDScene::connectEdgeNodes() {
               ey_local_idx(0) -= m_num_nodes;
             }
 
-            if (node_bucket_handle(0) < 0 ||
-                node_bucket_handle(0) >= m_particle_buckets.dim_size(0) ||
-                node_bucket_handle(1) < 0 ||
-                node_bucket_handle(1) >= m_particle_buckets.dim_size(1) ||
-                node_bucket_handle(2) < 0 ||
-                node_bucket_handle(2) >= m_particle_buckets.dim_size(2)) {
+            if (!m_particle_buckets.has_bucket(node_bucket_handle)) {
               bucket_node_idx_ez(node_idx * 8 + 4 + r * 2 + 0) = -1;
               bucket_node_idx_ez(node_idx * 8 + 4 + r * 2 + 1) = -1;
             } else {
@@ -4475,12 +5712,7 @@ void TwoDScene::connectSolidPhiNodes() {
                 sphi_local_idx(2) -= m_num_nodes;
               }
 
-              if (node_bucket_handle_x(0) < 0 ||
-                  node_bucket_handle_x(0) >= m_particle_buckets.dim_size(0) ||
-                  node_bucket_handle_x(1) < 0 ||
-                  node_bucket_handle_x(1) >= m_particle_buckets.dim_size(1) ||
-                  node_bucket_handle_x(2) < 0 ||
-                  node_bucket_handle_x(2) >= m_particle_buckets.dim_size(2)) {
+              if (!m_particle_buckets.has_bucket(node_bucket_handle_x)) {
                 bucket_node_idx_solid_phi_x(node_idx * 8 + (r * 2 + s) * 2 +
                                             0) = -1;
                 bucket_node_idx_solid_phi_x(node_idx * 8 + (r * 2 + s) * 2 +
@@ -4522,12 +5754,7 @@ void TwoDScene::connectSolidPhiNodes() {
                 sphi_local_idx(2) -= m_num_nodes;
               }
 
-              if (node_bucket_handle_y(0) < 0 ||
-                  node_bucket_handle_y(0) >= m_particle_buckets.dim_size(0) ||
-                  node_bucket_handle_y(1) < 0 ||
-                  node_bucket_handle_y(1) >= m_particle_buckets.dim_size(1) ||
-                  node_bucket_handle_y(2) < 0 ||
-                  node_bucket_handle_y(2) >= m_particle_buckets.dim_size(2)) {
+              if (!m_particle_buckets.has_bucket(node_bucket_handle_y)) {
                 bucket_node_idx_solid_phi_y(node_idx * 8 + (r * 2 + s) * 2 +
                                             0) = -1;
                 bucket_node_idx_solid_phi_y(node_idx * 8 + (r * 2 + s) * 2 +
@@ -4569,12 +5796,7 @@ void TwoDScene::connectSolidPhiNodes() {
                 sphi_local_idx(1) -= m_num_nodes;
               }
 
-              if (node_bucket_handle_z(0) < 0 ||
-                  node_bucket_handle_z(0) >= m_particle_buckets.dim_size(0) ||
-                  node_bucket_handle_z(1) < 0 ||
-                  node_bucket_handle_z(1) >= m_particle_buckets.dim_size(1) ||
-                  node_bucket_handle_z(2) < 0 ||
-                  node_bucket_handle_z(2) >= m_particle_buckets.dim_size(2)) {
+              if (!m_particle_buckets.has_bucket(node_bucket_handle_z)) {
                 bucket_node_idx_solid_phi_z(node_idx * 8 + (r * 2 + s) * 2 +
                                             0) = -1;
                 bucket_node_idx_solid_phi_z(node_idx * 8 + (r * 2 + s) * 2 +
@@ -5038,16 +6260,10 @@ void TwoDScene::expandFluidNodesMarked(int layers) {
           if (t == 0 && s == 0 && r == 0) continue;
 
           Vector3i cur_bucket_handle = bucket_handle + Vector3i(r, s, t);
-          if (cur_bucket_handle(0) < 0 ||
-              cur_bucket_handle(0) >= m_particle_buckets.ni ||
-              cur_bucket_handle(1) < 0 ||
-              cur_bucket_handle(1) >= m_particle_buckets.nj ||
-              cur_bucket_handle(2) < 0 ||
-              cur_bucket_handle(2) >= m_particle_buckets.nk) {
-            continue;
-          }
+          const int nbidx = m_particle_buckets.find_bucket(
+              cur_bucket_handle(0), cur_bucket_handle(1), cur_bucket_handle(2));
+          if (nbidx < 0) continue;
 
-          const int nbidx = m_particle_buckets.bucket_index(cur_bucket_handle);
           if (activated[nbidx]) {
             return true;
           }
@@ -5111,6 +6327,8 @@ void TwoDScene::resampleNodes() {
               Vector3s(0.5, 0.5, 0.5), gauss_node_criteria);
   }
 
+  activateLiquidInteriorBuckets();
+
   expandFluidNodesMarked(1);
 
   // generate nodes in all activated buckets
@@ -5393,6 +6611,7 @@ void TwoDScene::resizeGroups(int num_group) {
 
   threadutils::for_each(m_group_distance_field, [&](auto dfptr) {
     dfptr->vote_param_indices();
+    dfptr->vote_material();
     dfptr->vote_usage();
     dfptr->vote_sampled();
   });
@@ -5457,6 +6676,27 @@ scalar TwoDScene::computePhiVel(
   return min_phi;
 }
 
+scalar TwoDScene::computePhiVelMaterial(const Vector3s& pos, Vector3s& vel,
+                                        int& material) const {
+  scalar min_phi = 3.0 * m_bucket_size;
+  Vector3s min_vel = Vector3s::Zero();
+  int min_material = -1;
+  for (auto dfptr : m_group_distance_field) {
+    Vector3s v;
+    scalar phi = dfptr->compute_phi_vel(pos, v);
+    if (phi < min_phi) {
+      min_phi = phi;
+      min_vel = v;
+      min_material = dfptr->material;
+    }
+  }
+
+  vel = min_vel;
+  material = min_material;
+
+  return min_phi;
+}
+
 /*!
  * sample particle from level set of rigid bodies
  */
@@ -5992,6 +7232,13 @@ void TwoDScene::mapParticleSaturationPsiNodes() {
                      m_rest_volume_fraction[pidx];
       }
 
+      if (m_liquid_info.use_narrow_band && !m_interior_phi.empty()) {
+        const scalar frac = mathutils::clamp(
+            0.5 - m_node_interior_phi_p[bucket_idx](i) / dx, 0.0, 1.0);
+        vol_liquid =
+            std::max(vol_liquid, frac * std::max(0.0, dV - vol_solid));
+      }
+
       scalar psi = mathutils::clamp(vol_solid / dV, 0.0, 1.0);
       scalar sat = mathutils::clamp(
           vol_liquid / std::max(1e-20, dV - vol_solid), 0.0, 1.0);
@@ -6200,12 +7447,7 @@ void TwoDScene::distributeElastoFluid() {
     }
   });
 
-  m_particle_buckets.sort(getNumParticles(), [&](int pidx, int& i, int& j,
-                                                 int& k) {
-    i = (int)floor((m_x(pidx * 4 + 0) - m_bucket_mincorner(0)) / m_bucket_size);
-    j = (int)floor((m_x(pidx * 4 + 1) - m_bucket_mincorner(1)) / m_bucket_size);
-    k = (int)floor((m_x(pidx * 4 + 2) - m_bucket_mincorner(2)) / m_bucket_size);
-  });
+  sortParticles();
 
   scalar new_sum_vol = m_fluid_vol.sum();
   if (new_sum_vol > 1e-20) {
@@ -7350,6 +8592,16 @@ std::shared_ptr<ElasticParameters>& TwoDScene::getElasticParameters(
   return m_strandParameters[index];
 }
 
+void TwoDScene::insertColliderMaterial(const ColliderMaterial& material) {
+  m_collider_materials.push_back(material);
+}
+
+const ColliderMaterial& TwoDScene::getColliderMaterial(const int index) const {
+  assert(0 <= index);
+  assert(index < m_collider_materials.size());
+  return m_collider_materials[index];
+}
+
 void TwoDScene::setEdgeRestLength(int idx, const scalar& l0) {
   m_edge_rest_length(idx) = l0;
 
@@ -7434,6 +8686,24 @@ const std::vector<std::shared_ptr<AttachForce> >& TwoDScene::getAttachForces()
   return m_attach_forces;
 }
 
+void TwoDScene::insertEmbeddedCloth(const EmbeddedClothMesh& mesh) {
+  m_embedded_clothes.push_back(mesh);
+}
+
+const std::vector<EmbeddedClothMesh>& TwoDScene::getEmbeddedClothes() const {
+  return m_embedded_clothes;
+}
+
+void TwoDScene::bindFollowerStrands(
+    const std::vector<std::vector<int> >& guides,
+    const std::vector<std::vector<int> >& followers) {
+  strandskinning::bind(m_x, guides, followers, m_follower_vertices);
+}
+
+const std::vector<FollowerVertex>& TwoDScene::getFollowerVertices() const {
+  return m_follower_vertices;
+}
+
 const Vector2iT TwoDScene::getEdge(int edg) const {
   assert(edg >= 0);
   assert(edg < (int)m_edges.rows());
@@ -7448,6 +8718,11 @@ void TwoDScene::insertScript(const std::shared_ptr<Script>& script) {
 void TwoDScene::insertForce(const std::shared_ptr<Force>& newforce) {
   m_forces.push_back(newforce);
 }
+
+const std::vector<std::shared_ptr<Force> >& TwoDScene::getForces() const {
+  return m_forces;
+}
+
 void TwoDScene::insertStrandForce(const std::shared_ptr<StrandForce>& new_strand_force)
 {
   m_strands.push_back(new_strand_force);
@@ -7461,6 +8736,60 @@ scalar TwoDScene::computeKineticEnergy() const {
   return 0.5 * T;
 }
 
+void TwoDScene::computeStatistics(SceneStatistics& stats) const {
+  stats.fluid_volume = 0.0;
+  stats.absorbed_volume = 0.0;
+  stats.spray_volume = 0.0;
+  stats.kinetic_energy = 0.0;
+  stats.fluid_momentum.setZero();
+  stats.elasto_momentum.setZero();
+
+  scalar pore_volume = 0.0;
+
+  const int num_elasto = getNumSoftElastoParticles();
+  Vector3s elasto_min = Vector3s::Constant(1e+63);
+  Vector3s elasto_max = Vector3s::Constant(-1e+63);
+  for (int i = 0; i < num_elasto; ++i) {
+    const Vector3s& v = m_v.segment<3>(i * 4);
+    stats.elasto_momentum += m_m(i * 4) * v;
+    stats.kinetic_energy += 0.5 * m_m(i * 4) * v.squaredNorm();
+    stats.absorbed_volume += m_fluid_vol(i);
+    pore_volume += m_vol(i) * (1.0 - m_volume_fraction(i));
+    elasto_min = elasto_min.cwiseMin(m_x.segment<3>(i * 4));
+    elasto_max = elasto_max.cwiseMax(m_x.segment<3>(i * 4));
+  }
+
+  const int num_fluid = getNumFluidParticles();
+  Vector3s fluid_min = Vector3s::Constant(1e+63);
+  Vector3s fluid_max = Vector3s::Constant(-1e+63);
+  for (int i = 0; i < num_fluid; ++i) {
+    const int pidx = m_fluids[i];
+    const Vector3s& v = m_fluid_v.segment<3>(pidx * 4);
+    stats.fluid_momentum += m_fluid_m(pidx * 4) * v;
+    stats.kinetic_energy += 0.5 * m_fluid_m(pidx * 4) * v.squaredNorm();
+    stats.fluid_volume += m_fluid_vol(pidx);
+    fluid_min = fluid_min.cwiseMin(m_x.segment<3>(pidx * 4));
+    fluid_max = fluid_max.cwiseMax(m_x.segment<3>(pidx * 4));
+  }
+
+  const int num_spray = getNumSprayParticles();
+  for (int i = 0; i < num_spray; ++i) {
+    const Vector3s& v = m_spray_v.segment<3>(i * 4);
+    const scalar m = m_spray_vol(i) * m_liquid_info.liquid_density;
+    stats.fluid_momentum += m * v;
+    stats.kinetic_energy += 0.5 * m * v.squaredNorm();
+    stats.spray_volume += m_spray_vol(i);
+  }
+
+  stats.saturation =
+      (pore_volume > 1e-20) ? stats.absorbed_volume / pore_volume : 0.0;
+
+  stats.elasto_bbox_min = num_elasto ? elasto_min : Vector3s::Zero();
+  stats.elasto_bbox_max = num_elasto ? elasto_max : Vector3s::Zero();
+  stats.fluid_bbox_min = num_fluid ? fluid_min : Vector3s::Zero();
+  stats.fluid_bbox_max = num_fluid ? fluid_max : Vector3s::Zero();
+}
+
 scalar TwoDScene::computePotentialEnergy() const {
   scalar U = 0.0;
   for (std::vector<Force*>::size_type i = 0; i < m_forces.size(); ++i)
@@ -7737,6 +9066,39 @@ void TwoDScene::accumulateGradU(VectorXs& F, const VectorXs& dx,
   }
 }
 
+void TwoDScene::accumulateGradUParallel(VectorXs& F) {
+  if (F.size() == 0) return;
+
+  VectorXs combined_mass = m_m + m_fluid_m;
+
+  const int num_forces = (int)m_forces.size();
+  const int num_chunks =
+      std::max(1, std::min(num_forces, (int)threadutils::get_num_threads()));
+
+  std::vector<VectorXs> chunk_F(num_chunks);
+  threadutils::for_each(0, num_chunks, [&](int c) {
+    chunk_F[c] = VectorXs::Zero(F.size());
+    const int f_begin = num_forces * c / num_chunks;
+    const int f_end = num_forces * (c + 1) / num_chunks;
+    for (int i = f_begin; i < f_end; ++i) {
+      if (m_forces[i]->flag() & 1)
+        m_forces[i]->addGradEToTotal(m_x, m_v, combined_mass, m_volume_fraction,
+                                     m_liquid_info.lambda, chunk_F[c]);
+    }
+  });
+
+  // sum the chunks in a fixed order so the result does not depend on the
+  // scheduling
+  const int num_dofs = (int)F.size();
+  const int num_blocks = (num_dofs + 1023) / 1024;
+  threadutils::for_each(0, num_blocks, [&](int b) {
+    const int begin = b * 1024;
+    const int len = std::min(1024, num_dofs - begin);
+    for (int c = 0; c < num_chunks; ++c)
+      F.segment(begin, len) += chunk_F[c].segment(begin, len);
+  });
+}
+
 void TwoDScene::accumulateFluidGradU(VectorXs& F, const VectorXs& dx,
                                      const VectorXs& dv) {
   if (dx.size() == 0)
@@ -7931,6 +9293,24 @@ void TwoDScene::accumulateAngularddUdxdx(TripletXs& A, const scalar& dt,
   }
 }
 
+void TwoDScene::accumulateTwistCouplingddUdxdx(TripletXs& A) {
+  int num_hess = 0;
+  const int num_strands = m_strands.size();
+
+  std::vector<int> offsets(num_strands);
+
+  for (int i = 0; i < num_strands; ++i) {
+    offsets[i] = num_hess;
+    num_hess += m_strands[i]->numTwistCouplingHessX();
+  }
+
+  if ((int)A.size() != num_hess) A.resize(num_hess);
+
+  for (int i = 0; i < num_strands; ++i) {
+    m_strands[i]->addTwistCouplingHessXToTotal(A, offsets[i]);
+  }
+}
+
 void TwoDScene::dump_geometry(std::string filename) {
   int s = getNumParticles();
   std::ofstream myfile;
@@ -15,11 +15,14 @@
 #include <Eigen/StdVector>
 #include <fstream>
 
+#include "ClothEmbedding.h"
+#include "ColliderMaterial.h"
 #include "ElasticParameters.h"
 #include "DistanceFields.h"
 #include "Force.h"
 #include "Script.h"
 #include "Sorter.h"
+#include "StrandSkinning.h"
 
 class StrandForce;
 class AttachForce;
@@ -56,10 +59,27 @@ struct LiquidInfo {
   scalar liquid_boundary_friction;
   scalar levelset_thickness;
   scalar elasto_capture_rate;
+  scalar narrow_band_width;
+  scalar spray_drag_coeff;
+  scalar max_velocity_bound;
+  scalar max_solver_residual;
+  scalar velocity_percentile;
+  scalar max_dt_growth;
+  scalar quasi_static_tolerance;
+  scalar guide_strand_ratio;
+  scalar follower_blend;
+  scalar elastic_cfl_number;
   int correction_step;
   int bending_scheme;
   int iteration_print_step;
   int surf_tension_smoothing_step;
+  int spray_neighbor_count;
+  int max_step_retries;
+  int target_solver_iterations;
+  int quasi_static_max_iterations;
+  int viscosity_split_iterations;
+  int grid_relaxation_iterations;
+  int elasto_integrator;  // 0: implicit, 1: explicit, 2: automatic
   bool use_surf_tension;
   bool use_cohesion;
   bool solid_cohesion;
@@ -86,6 +106,15 @@ struct LiquidInfo {
   bool use_group_precondition;
   bool use_lagrangian_mpm;
   bool use_cosolve_angular;
+  bool use_narrow_band;
+  bool use_spray_particles;
+  bool use_guarded_step;
+  bool use_adaptive_dt;
+  bool validate_fraction_kernels;
+  bool use_split_viscosity;
+  bool use_twist_condensation;
+  bool use_grid_relaxation;
+  bool use_monolithic_pressure;
 
   friend std::ostream& operator<<(std::ostream&, const LiquidInfo&);
 };
@@ -105,6 +134,99 @@ struct RayTriInfo {
   scalar weight;
 };
 
+/*!
+ * Aggregate state of a scene, as recorded per frame by the telemetry and
+ * compared against the golden scenes. Liquid is split into free particles,
+ * liquid absorbed by the elastic objects and spray; bounding boxes of empty
+ * sets are zero.
+ */
+struct SceneStatistics {
+  scalar fluid_volume;
+  scalar absorbed_volume;
+  scalar spray_volume;
+  scalar saturation;  // absorbed volume over the pore volume
+  scalar kinetic_energy;
+  Vector3s fluid_momentum;
+  Vector3s elasto_momentum;
+  Vector3s fluid_bbox_min;
+  Vector3s fluid_bbox_max;
+  Vector3s elasto_bbox_min;
+  Vector3s elasto_bbox_max;
+};
+
+/*!
+ * The part of the scene a sub-step changes and the next one reads, so that a
+ * failed sub-step can be rolled back. The buffers are reused between
+ * sub-steps and swapped back on a roll back. Element topology and rest
+ * shapes, which sub-steps never change, and the grid, which the next
+ * sub-step rebuilds, are not kept.
+ */
+struct SceneState {
+  int num_particles;
+
+  VectorXs x;
+  VectorXs rest_x;
+  VectorXs v;
+  VectorXs saved_v;
+  VectorXs dv;
+  VectorXs fluid_v;
+  VectorXs m;
+  VectorXs fluid_m;
+  VectorXs radius;
+  VectorXs vol;
+  VectorXs rest_vol;
+  VectorXs shape_factor;
+  VectorXs fluid_vol;
+  VectorXuc inside;
+  VectorXs volume_fraction;
+  VectorXs rest_volume_fraction;
+  VectorXs orientation;
+  MatrixXs B;
+  MatrixXs fB;
+  std::vector<ParticleClassifier> classifier;
+  std::vector<unsigned char> fixed;
+  std::vector<bool> twist;
+  std::vector<bool> is_strand_tip;
+  std::vector<int> particle_to_surfel;
+  std::vector<int> particle_group;
+  std::vector<int> fluids;
+  std::vector<Vector3s> surfel_norms;
+
+  VectorXs x_gauss;
+  VectorXs v_gauss;
+  VectorXs dv_gauss;
+  VectorXs fluid_v_gauss;
+  VectorXs m_gauss;
+  VectorXs vol_gauss;
+  VectorXs radius_gauss;
+  VectorXs fluid_m_gauss;
+  VectorXs fluid_vol_gauss;
+  VectorXs volume_fraction_gauss;
+  MatrixXs Fe_gauss;
+  MatrixXs d_gauss;
+  MatrixXs dFe_gauss;
+  MatrixXs norm_gauss;
+
+  std::vector<Vector3s> group_pos;
+  std::vector<Eigen::Quaternion<scalar> > group_rot;
+  std::vector<Vector3s> group_prev_pos;
+  std::vector<Eigen::Quaternion<scalar> > group_prev_rot;
+  std::vector<scalar> shooting_vol_accum;
+
+  Sorter interior_buckets;
+  Vector3s interior_mincorner;
+  Vector3s interior_bbx_min;
+  Vector3s interior_bbx_max;
+  std::vector<VectorXs> interior_phi;
+  std::vector<VectorXs> interior_vel_x;
+  std::vector<VectorXs> interior_vel_y;
+  std::vector<VectorXs> interior_vel_z;
+
+  VectorXs spray_x;
+  VectorXs spray_v;
+  VectorXs spray_vol;
+};
+
 class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   const static int m_kernel_order = 2;
   const static int m_num_armor = 0;
@@ -125,6 +247,8 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   int getNumElasticParameters() const;
 
+  int getNumColliderMaterials() const;
+
   const std::vector<int> getParticleGroup() const;
 
   const std::vector<unsigned char>& getFixed() const;
@@ -644,10 +768,16 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   std::shared_ptr<ElasticParameters>& getElasticParameters(const int index);
 
+  void insertColliderMaterial(const ColliderMaterial& material);
+
+  const ColliderMaterial& getColliderMaterial(const int index) const;
+
   const Vector2iT getEdge(int edg) const;
 
   void insertForce(const std::shared_ptr<Force>& newforce);
 
+  const std::vector<std::shared_ptr<Force> >& getForces() const;
+
   void insertStrandForce(const std::shared_ptr<StrandForce>& new_strand_force);
 
   void setTipVerts(int particle, bool tipVerts);
@@ -655,6 +785,10 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   void accumulateGradU(VectorXs& F, const VectorXs& dx = VectorXs(),
                        const VectorXs& dv = VectorXs());
 
+  // same as accumulateGradU at the current state, with the forces split into
+  // chunks that gather into private buffers concurrently
+  void accumulateGradUParallel(VectorXs& F);
+
   void accumulateFluidGradU(VectorXs& F, const VectorXs& dx = VectorXs(),
                             const VectorXs& dv = VectorXs());
 
@@ -688,9 +822,12 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
                                 const VectorXs& dx = VectorXs(),
                                 const VectorXs& dv = VectorXs());
 
+  void accumulateTwistCouplingddUdxdx(TripletXs& A);
+
   void computedEdFe();
 
   scalar computeKineticEnergy() const;
+  void computeStatistics(SceneStatistics& stats) const;
   scalar computePotentialEnergy() const;
   scalar computeTotalEnergy() const;
 
@@ -720,6 +857,7 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   void updateParticleBoundingBox();
   void rebucketizeParticles();
+  void sortParticles();
   void resampleNodes();
   void updateParticleWeights(scalar dt, int start, int end);
   void updateGaussWeights(scalar dt);
@@ -731,9 +869,22 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   void updateCurvatureP();
   void updateColorP();
   void advectCurvatureP(const scalar& dt);
-  void estimateVolumeFractions(std::vector<VectorXs>& volumes,
-                               const std::vector<VectorXs>& node_pos,
-                               const Vector3s& np_offset);
+  void updateLiquidPhiLattice();
+  void estimateVolumeFractionsFromLattice();
+  void updateLiquidNarrowBand();
+  void activateLiquidInteriorBuckets();
+  void advectLiquidInterior(scalar dt);
+  void mapLiquidInteriorNodes();
+  void initLiquidParticle(int part_idx, const Vector3s& pos,
+                          const Vector3s& vel, const scalar& vol);
+  void updateSprayParticles();
+  void advectSprayParticles(const scalar& dt);
+  int getNumSprayParticles() const;
+  const VectorXs& getSprayX() const;
+  const VectorXs& getSprayVol() const;
+  void saveState(SceneState& state);
+  void restoreState(SceneState& state);
+  bool checkStateHealth(std::string& reason) const;
   void updateOptiVolume();
   void splitLiquidParticles();
   void mergeLiquidParticles();
@@ -744,6 +895,8 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   bool propagateSolidVelocity() const;
 
   void correctLiquidParticles(const scalar& dt);
+  void relaxLiquidParticlesOnGrid(const scalar& dt);
+  Vector3s pushOutOfSolid(int pidx, const Vector3s& dpos) const;
 
   const VectorXs& getRestPos() const;
 
@@ -765,6 +918,15 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   const std::vector<std::shared_ptr<AttachForce> >& getAttachForces() const;
 
+  void insertEmbeddedCloth(const EmbeddedClothMesh& mesh);
+
+  const std::vector<EmbeddedClothMesh>& getEmbeddedClothes() const;
+
+  void bindFollowerStrands(const std::vector<std::vector<int> >& guides,
+                           const std::vector<std::vector<int> >& followers);
+
+  const std::vector<FollowerVertex>& getFollowerVertices() const;
+
   const std::vector<std::pair<int, int> >& getNodeParticlePairsX(
       int bucket_idx, int pidx) const;
 
@@ -818,6 +980,13 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
       const std::function<bool(const std::shared_ptr<DistanceField>&)>
           selector = nullptr) const;
 
+  /*!
+   * Same as computePhiVel over all the colliders, also returning the
+   * material of the closest one (-1 if it has none).
+   */
+  scalar computePhiVelMaterial(const Vector3s& pos, Vector3s& vel,
+                               int& material) const;
+
   void dump_geometry(std::string filename);
 
   int getKernelOrder() const;
@@ -828,6 +997,8 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   void solidProjection(const scalar& dt);
 
+  void updateFollowerStrands(const scalar& dt);
+
   void terminateParticles();
 
   void removeEmptyParticles();
@@ -855,6 +1026,25 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   scalar getMaxFluidVelocity() const;
 
+  // elastic CFL number times the time a stretching wave, sqrt(E / rho),
+  // takes to cross the shortest free rod or shell element; computed once per
+  // sub-step by updateElasticWaveStepSize
+  scalar getElasticWaveStepSize() const;
+
+  void updateElasticWaveStepSize();
+
+  // number of explicit elastic sub-cycles a sub-step of size dt takes to stay
+  // under the elastic wave bound
+  int getNumElastoSubcycles(const scalar& dt) const;
+
+  // Krylov iterations of the latest implicit elastic solve, the cost the
+  // automatic integrator choice weighs the sub-cycles against
+  void setElastoSolveIterations(int iterations);
+
+  // whether a sub-step of size dt advances the elastic objects with the
+  // explicit sub-cycles instead of the implicit solve
+  bool useExplicitElasto(const scalar& dt) const;
+
   scalar getDragCoeff(const scalar& psi, const scalar& sat, const scalar& dv,
                       int material) const;
 
@@ -887,9 +1077,6 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   const std::vector<Vector3s>& getFaceWeights() const;
 
-  scalar interpolateValue(const Vector3s& pos, const std::vector<VectorXs>& phi,
-                          const Vector3s& phi_ori, const scalar& default_val);
-
   inline Vector3s nodePosFromBucket(int bucket_idx, int raw_node_idx,
                                     const Vector3s& offset) const;
 
@@ -1046,6 +1233,8 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   Vector3s m_bbx_max;
 
   scalar m_bucket_size;
+  scalar m_elastic_wave_dt;
+  int m_elasto_solve_iterations;
   int m_num_colors;
   int m_num_nodes;
   int m_num_bucket_colors;
@@ -1054,6 +1243,7 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   Sorter m_particle_buckets;
   Sorter m_gauss_buckets;
+  // refinement of m_particle_buckets into grid cells, sorted along with it
   Sorter m_particle_cells;
 
   std::vector<unsigned char> m_bucket_activated;
@@ -1116,6 +1306,34 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
   std::vector<VectorXs> m_node_liquid_ey_vf;
   std::vector<VectorXs> m_node_liquid_ez_vf;
 
+  // bucket id -> liquid phi resampled on the half-cell lattice ((2n+2)^3)
+  std::vector<VectorXs> m_node_liquid_phi_lattice;
+
+  // narrow-band liquid: the deep interior (pressure node phi, negative
+  // inside, and fluid face velocities) kept on the grid it was built on
+  Sorter m_interior_buckets;
+  Vector3s m_interior_mincorner;
+  Vector3s m_interior_bbx_min;
+  Vector3s m_interior_bbx_max;
+  std::vector<VectorXs> m_interior_phi;
+  std::vector<VectorXs> m_interior_vel_x;
+  std::vector<VectorXs> m_interior_vel_y;
+  std::vector<VectorXs> m_interior_vel_z;
+
+  // bucket id -> interior advected onto the current grid
+  std::vector<VectorXs> m_node_interior_phi_p;
+  std::vector<VectorXs> m_node_interior_phi_x;
+  std::vector<VectorXs> m_node_interior_phi_y;
+  std::vector<VectorXs> m_node_interior_phi_z;
+  std::vector<VectorXs> m_node_interior_vel_x;
+  std::vector<VectorXs> m_node_interior_vel_y;
+  std::vector<VectorXs> m_node_interior_vel_z;
+
+  // secondary spray: ballistic liquid particles kept off the grid
+  VectorXs m_spray_x;
+  VectorXs m_spray_v;
+  VectorXs m_spray_vol;
+
   std::vector<VectorXs> m_node_orientation_x;
   std::vector<VectorXs> m_node_orientation_y;
   std::vector<VectorXs> m_node_orientation_z;
@@ -1199,8 +1417,16 @@ class TwoDScene : public std::enable_shared_from_this<TwoDScene> {
 
   std::vector<std::shared_ptr<AttachForce> > m_attach_forces;
 
+  // high-resolution clothes driven by simulated proxies
+  std::vector<EmbeddedClothMesh> m_embedded_clothes;
+
+  // vertices of the yarns interpolated from the simulated guides
+  std::vector<FollowerVertex> m_follower_vertices;
+
   std::vector<std::shared_ptr<ElasticParameters> > m_strandParameters;
 
+  std::vector<ColliderMaterial> m_collider_materials;
+
   std::vector<Vector3s> m_group_pos;
   std::vector<Eigen::Quaternion<scalar> > m_group_rot;
 
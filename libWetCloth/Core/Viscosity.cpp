@@ -10,10 +10,12 @@
 
 #include "Viscosity.h"
 
+#include <algorithm>
 #include <cstdlib>
 #include <iostream>
 #include <numeric>
 
+#include "GridAccessor.h"
 #include "ThreadUtils.h"
 #include "TwoDScene.h"
 #include "PCGSolver/PCGSolver.h"
@@ -21,103 +23,17 @@
 using namespace robertbridson;
 
 namespace viscosity {
-template <typename T>
-T get_value(const std::vector<Eigen::Matrix<T, Eigen::Dynamic, 1> >& data,
-            const Vector3i& bucket_handle, const Vector3i& node_handle,
-            const T& default_val, const int num_nodes, const Sorter& buckets) {
-  Vector3i cur_bucket_handle = bucket_handle;
-  Vector3i cur_node_handle = node_handle;
-
-  // check boundary
-  for (int r = 0; r < 3; ++r) {
-    while (cur_node_handle(r) < 0) {
-      cur_node_handle(r) += num_nodes;
-      --cur_bucket_handle(r);
-    }
-
-    while (cur_node_handle(r) >= num_nodes) {
-      cur_node_handle(r) -= num_nodes;
-      ++cur_bucket_handle(r);
-    }
-  }
-
-  if (cur_bucket_handle(0) < 0 || cur_bucket_handle(0) >= buckets.ni ||
-      cur_bucket_handle(1) < 0 || cur_bucket_handle(1) >= buckets.nj ||
-      cur_bucket_handle(2) < 0 || cur_bucket_handle(2) >= buckets.nk) {
-    return default_val;
-  }
-
-  const int bucket_idx = buckets.bucket_index(cur_bucket_handle);
-  if (data[bucket_idx].size() == 0) return default_val;
-
-  const int node_idx = cur_node_handle(2) * num_nodes * num_nodes +
-                       cur_node_handle(1) * num_nodes + cur_node_handle(0);
-  return data[bucket_idx][node_idx];
-};
-
-bool get_node_index(const std::vector<unsigned char>& bucket_activated,
-                    const Vector3i& bucket_handle, const Vector3i& node_handle,
-                    const int num_nodes, const Sorter& buckets,
-                    Vector2i& bucket_node) {
-  Vector3i cur_bucket_handle = bucket_handle;
-  Vector3i cur_node_handle = node_handle;
-
-  // check boundary
-  for (int r = 0; r < 3; ++r) {
-    while (cur_node_handle(r) < 0) {
-      cur_node_handle(r) += num_nodes;
-      --cur_bucket_handle(r);
-    }
-
-    while (cur_node_handle(r) >= num_nodes) {
-      cur_node_handle(r) -= num_nodes;
-      ++cur_bucket_handle(r);
-    }
-  }
-
-  if (cur_bucket_handle(0) < 0 || cur_bucket_handle(0) >= buckets.ni ||
-      cur_bucket_handle(1) < 0 || cur_bucket_handle(1) >= buckets.nj ||
-      cur_bucket_handle(2) < 0 || cur_bucket_handle(2) >= buckets.nk) {
-    bucket_node(0) = bucket_node(1) = -1;
-    return false;
-  }
-
-  const int bucket_idx = buckets.bucket_index(cur_bucket_handle);
-  if (!bucket_activated[bucket_idx]) {
-    bucket_node(0) = bucket_node(1) = -1;
-    return false;
-  }
-
-  const int node_idx = cur_node_handle(2) * num_nodes * num_nodes +
-                       cur_node_handle(1) * num_nodes + cur_node_handle(0);
-
-  bucket_node(0) = bucket_idx;
-  bucket_node(1) = node_idx;
-  return true;
-};
-
-void applyNodeViscosityImplicit(
+/*!
+ * copy the solution back to the fluid nodes, the other nodes take the solid
+ * velocity
+ */
+static void scatterSolution(
     const TwoDScene& scene, const std::vector<VectorXi>& node_global_indices_x,
     const std::vector<VectorXi>& node_global_indices_y,
     const std::vector<VectorXi>& node_global_indices_z, int offset_nodes_x,
-    int offset_nodes_y, int offset_nodes_z, const SparseMatrix<scalar>& matrix,
-    const std::vector<scalar>& rhs, std::vector<scalar>& soln,
+    int offset_nodes_y, int offset_nodes_z, const std::vector<scalar>& soln,
     std::vector<VectorXs>& node_vel_x, std::vector<VectorXs>& node_vel_y,
-    std::vector<VectorXs>& node_vel_z, scalar& residual, int& iter_out,
-    const scalar& criterion, int maxiters) {
-  soln.assign(rhs.size(), 0.0);
-
-  PCGSolver<double> solver;
-  solver.set_solver_parameters(criterion, maxiters, 0.97, 0.1);
-  bool success = false;
-
-  success = solver.solve(matrix, rhs, soln, residual, iter_out);
-  if (!success) {
-    std::cerr << "\n\n\n**********VISCOSITY FAILED**************\n\n\n"
-              << std::endl;
-    exit(0);
-  }
-
+    std::vector<VectorXs>& node_vel_z) {
   const std::vector<VectorXuc>& node_state_u = scene.getNodeStateX();
   const std::vector<VectorXuc>& node_state_v = scene.getNodeStateY();
   const std::vector<VectorXuc>& node_state_w = scene.getNodeStateZ();
@@ -164,6 +80,165 @@ void applyNodeViscosityImplicit(
   });
 }
 
+void applyNodeViscosityImplicit(
+    const TwoDScene& scene, const std::vector<VectorXi>& node_global_indices_x,
+    const std::vector<VectorXi>& node_global_indices_y,
+    const std::vector<VectorXi>& node_global_indices_z, int offset_nodes_x,
+    int offset_nodes_y, int offset_nodes_z, const SparseMatrix<scalar>& matrix,
+    const std::vector<scalar>& rhs, std::vector<scalar>& soln,
+    std::vector<VectorXs>& node_vel_x, std::vector<VectorXs>& node_vel_y,
+    std::vector<VectorXs>& node_vel_z, scalar& residual, int& iter_out,
+    const scalar& criterion, int maxiters) {
+  soln.assign(rhs.size(), 0.0);
+
+  PCGSolver<double> solver;
+  solver.set_solver_parameters(criterion, maxiters, 0.97, 0.1);
+  bool success = false;
+
+  success = solver.solve(matrix, rhs, soln, residual, iter_out);
+  if (!success) {
+    std::cerr << "\n\n\n**********VISCOSITY FAILED**************\n\n\n"
+              << std::endl;
+    exit(0);
+  }
+
+  scatterSolution(scene, node_global_indices_x, node_global_indices_y,
+                  node_global_indices_z, offset_nodes_x, offset_nodes_y,
+                  offset_nodes_z, soln, node_vel_x, node_vel_y, node_vel_z);
+}
+
+void applyNodeViscosityImplicitSplit(
+    const TwoDScene& scene, const std::vector<VectorXi>& node_global_indices_x,
+    const std::vector<VectorXi>& node_global_indices_y,
+    const std::vector<VectorXi>& node_global_indices_z, int offset_nodes_x,
+    int offset_nodes_y, int offset_nodes_z, const SparseMatrix<scalar>& matrix,
+    const std::vector<scalar>& rhs, std::vector<scalar>& soln,
+    const std::vector<VectorXs>& node_vel_src_x,
+    const std::vector<VectorXs>& node_vel_src_y,
+    const std::vector<VectorXs>& node_vel_src_z,
+    std::vector<VectorXs>& node_vel_x, std::vector<VectorXs>& node_vel_y,
+    std::vector<VectorXs>& node_vel_z, int outer_iterations,
+    scalar& residual, int& iter_out, scalar& coupled_error,
+    const scalar& criterion, int maxiters) {
+  const int total_num_nodes = (int)rhs.size();
+  const int offsets[] = {offset_nodes_x, offset_nodes_y, offset_nodes_z,
+                         total_num_nodes};
+
+  // start from the velocities before diffusion, so that a single outer
+  // iteration treats the shear coupling explicitly
+  soln.assign(total_num_nodes, 0.0);
+
+  const std::vector<VectorXi>* indices[] = {
+      &node_global_indices_x, &node_global_indices_y, &node_global_indices_z};
+  const std::vector<VectorXs>* vel_src[] = {&node_vel_src_x, &node_vel_src_y,
+                                            &node_vel_src_z};
+
+  const Sorter& buckets = scene.getParticleBuckets();
+  buckets.for_each_bucket([&](int bucket_idx) {
+    for (int r = 0; r < 3; ++r) {
+      const VectorXi& bucket_indices = (*indices[r])[bucket_idx];
+      const int num_nodes = bucket_indices.size();
+      for (int i = 0; i < num_nodes; ++i) {
+        const int dof_idx = bucket_indices[i];
+        if (dof_idx < 0) continue;
+        soln[dof_idx + offsets[r]] = (*vel_src[r])[bucket_idx][i];
+      }
+    }
+  });
+
+  // the same-component blocks on the diagonal of the coupled matrix
+  SparseMatrix<scalar> blocks[3];
+  std::vector<scalar> block_rhs[3];
+  std::vector<scalar> block_soln[3];
+
+  threadutils::for_each(0, 3, [&](int r) {
+    const int begin = offsets[r];
+    const int end = offsets[r + 1];
+    blocks[r].resize(end - begin);
+    block_rhs[r].resize(end - begin);
+
+    for (int i = begin; i < end; ++i) {
+      const std::vector<unsigned int>& row_index = matrix.index[i];
+      const std::vector<scalar>& row_value = matrix.value[i];
+      std::vector<unsigned int>& block_index = blocks[r].index[i - begin];
+      std::vector<scalar>& block_value = blocks[r].value[i - begin];
+
+      for (size_t k = 0; k < row_index.size(); ++k) {
+        const int j = (int)row_index[k];
+        if (j < begin || j >= end) continue;
+        block_index.push_back(j - begin);
+        block_value.push_back(row_value[k]);
+      }
+    }
+  });
+
+  std::vector<scalar> coupled_soln(soln);
+
+  residual = 0.0;
+  iter_out = 0;
+
+  for (int outer = 0; outer < outer_iterations; ++outer) {
+    int iters[3] = {0, 0, 0};
+    scalar residuals[3] = {0.0, 0.0, 0.0};
+    bool success[3] = {true, true, true};
+
+    // move the lagged cross-component terms to the right-hand side
+    threadutils::for_each(0, total_num_nodes, [&](int i) {
+      const int r = (i >= offsets[1]) + (i >= offsets[2]);
+      const std::vector<unsigned int>& row_index = matrix.index[i];
+      const std::vector<scalar>& row_value = matrix.value[i];
+
+      scalar b = rhs[i];
+      for (size_t k = 0; k < row_index.size(); ++k) {
+        const int j = (int)row_index[k];
+        if (j >= offsets[r] && j < offsets[r + 1]) continue;
+        b -= row_value[k] * coupled_soln[j];
+      }
+      block_rhs[r][i - offsets[r]] = b;
+    });
+
+    threadutils::for_each(0, 3, [&](int r) {
+      if (blocks[r].n == 0) return;
+
+      PCGSolver<double> solver;
+      solver.set_solver_parameters(criterion, maxiters, 0.97, 0.1);
+      success[r] = solver.solve(blocks[r], block_rhs[r], block_soln[r],
+                                residuals[r], iters[r]);
+    });
+
+    for (int r = 0; r < 3; ++r) {
+      if (!success[r]) {
+        std::cerr << "\n\n\n**********VISCOSITY FAILED**************\n\n\n"
+                  << std::endl;
+        exit(0);
+      }
+      iter_out += iters[r];
+      residual = std::max(residual, residuals[r]);
+
+      if (blocks[r].n == 0) continue;
+      std::copy(block_soln[r].begin(), block_soln[r].end(),
+                coupled_soln.begin() + offsets[r]);
+    }
+  }
+
+  soln.swap(coupled_soln);
+
+  // relative residual of the coupled system, the measure its PCG stops on
+  std::vector<scalar> coupled_residual(total_num_nodes);
+  multiply(matrix, soln, coupled_residual);
+  threadutils::for_each(0, total_num_nodes, [&](int i) {
+    coupled_residual[i] = rhs[i] - coupled_residual[i];
+  });
+
+  const scalar rhs_norm = total_num_nodes ? BLAS::abs_max(rhs) : 0.0;
+  coupled_error =
+      rhs_norm > 1e-30 ? BLAS::abs_max(coupled_residual) / rhs_norm : 0.0;
+
+  scatterSolution(scene, node_global_indices_x, node_global_indices_y,
+                  node_global_indices_z, offset_nodes_x, offset_nodes_y,
+                  offset_nodes_z, soln, node_vel_x, node_vel_y, node_vel_z);
+}
+
 void updateViscosityRHS(const TwoDScene& scene,
                         const std::vector<VectorXi>& node_global_indices_x,
                         const std::vector<VectorXi>& node_global_indices_y,
@@ -231,554 +306,487 @@ void updateViscosityRHS(const TwoDScene& scene,
   const std::vector<unsigned char>& bucket_activated =
       scene.getBucketActivated();
 
-  threadutils::for_each(0, total_num_nodes_x, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_x[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
+  threadutils::for_each_range(0, total_num_nodes_x, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const int index = dof_idx + offset_nodes_x;
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_x[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    rhs[index] = node_liquid_u_vf[bucket_idx][node_idx] *
-                 node_vel_src_x[bucket_idx][node_idx];
+      const int index = dof_idx + offset_nodes_x;
 
-    const scalar vol_left = get_value_fast(node_index_p_x, node_liquid_c_vf,
-                                           bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_right = get_value_fast(node_index_p_x, node_liquid_c_vf,
-                                            bucket_idx, node_idx, 2, 1, 0.0);
-
-    const scalar vol_back = get_value_fast(node_index_ex, node_liquid_ey_vf,
-                                           bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_ex, node_liquid_ey_vf,
-                                            bucket_idx, node_idx, 4, 1, 0.0);
+      rhs[index] = node_liquid_u_vf[bucket_idx][node_idx] *
+                   node_vel_src_x[bucket_idx][node_idx];
 
-    const scalar vol_bottom = get_value_fast(node_index_ex, node_liquid_ez_vf,
-                                             bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_top = get_value_fast(node_index_ex, node_liquid_ez_vf,
-                                          bucket_idx, node_idx, 4, 3, 0.0);
-
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
-
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
-
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_left = get_value_fast(node_index_p_x, node_liquid_c_vf,
+                                             bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_right = get_value_fast(node_index_p_x, node_liquid_c_vf,
+                                              bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_bottom;
-    }
+      const scalar vol_back = get_value_fast(node_index_ex, node_liquid_ey_vf,
+                                             bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_ex, node_liquid_ey_vf,
+                                              bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_ex, node_liquid_ez_vf,
+                                               bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_top = get_value_fast(node_index_ex, node_liquid_ez_vf,
+                                            bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_top > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor *
+              vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor *
+              vol_left;
       }
-    }
 
-    if (vol_bottom > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_bottom;
       }
-    }
 
-    if (vol_front > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_back;
       }
-    }
 
-    if (vol_back > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_top > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+
+        if (locator.locate(node_coord + Vector3i(-1, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_bottom > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
+
+        if (locator.locate(node_coord + Vector3i(-1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
       }
-    }
-  });
 
-  threadutils::for_each(0, total_num_nodes_y, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_y[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
+      if (vol_front > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
 
-    const int index = dof_idx + offset_nodes_y;
+        if (locator.locate(node_coord + Vector3i(-1, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
+      }
 
-    rhs[index] = node_liquid_v_vf[bucket_idx][node_idx] *
-                 node_vel_src_y[bucket_idx][node_idx];
+      if (vol_back > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
 
-    const scalar vol_bottom = get_value_fast(node_index_p_y, node_liquid_c_vf,
-                                             bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_top = get_value_fast(node_index_p_y, node_liquid_c_vf,
-                                          bucket_idx, node_idx, 2, 1, 0.0);
+        if (locator.locate(node_coord + Vector3i(-1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
+      }
+    }
+  });
 
-    const scalar vol_back = get_value_fast(node_index_ey, node_liquid_ex_vf,
-                                           bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_ey, node_liquid_ex_vf,
-                                            bucket_idx, node_idx, 4, 1, 0.0);
+  threadutils::for_each_range(0, total_num_nodes_y, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const scalar vol_left = get_value_fast(node_index_ey, node_liquid_ez_vf,
-                                           bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_right = get_value_fast(node_index_ey, node_liquid_ez_vf,
-                                            bucket_idx, node_idx, 4, 3, 0.0);
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_y[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
+      const int index = dof_idx + offset_nodes_y;
 
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
+      rhs[index] = node_liquid_v_vf[bucket_idx][node_idx] *
+                   node_vel_src_y[bucket_idx][node_idx];
 
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_p_y, node_liquid_c_vf,
+                                               bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_top = get_value_fast(node_index_p_y, node_liquid_c_vf,
+                                            bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -= -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor *
-                      vol_bottom;
-    }
+      const scalar vol_back = get_value_fast(node_index_ey, node_liquid_ex_vf,
+                                             bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_ey, node_liquid_ex_vf,
+                                              bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_left = get_value_fast(node_index_ey, node_liquid_ez_vf,
+                                             bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_right = get_value_fast(node_index_ey, node_liquid_ez_vf,
+                                              bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_right > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_left;
       }
-    }
 
-    if (vol_left > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor *
+              vol_bottom;
       }
-    }
 
-    if (vol_front > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_back;
       }
-    }
 
-    if (vol_back > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_right > 0.) {
+        if (locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
+
+        if (locator.locate(node_coord + Vector3i(1, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_left > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
       }
-    }
-  });
 
-  threadutils::for_each(0, total_num_nodes_z, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_z[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
+      if (vol_front > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
 
-    const int index = dof_idx + offset_nodes_z;
+        if (locator.locate(node_coord + Vector3i(0, -1, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
+      }
 
-    rhs[index] = node_liquid_w_vf[bucket_idx][node_idx] *
-                 node_vel_src_z[bucket_idx][node_idx];
+      if (vol_back > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
 
-    const scalar vol_back = get_value_fast(node_index_p_z, node_liquid_c_vf,
-                                           bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_p_z, node_liquid_c_vf,
-                                            bucket_idx, node_idx, 2, 1, 0.0);
+        if (locator.locate(node_coord + Vector3i(0, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
+      }
+    }
+  });
 
-    const scalar vol_bottom = get_value_fast(node_index_ez, node_liquid_ex_vf,
-                                             bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_top = get_value_fast(node_index_ez, node_liquid_ex_vf,
-                                          bucket_idx, node_idx, 4, 1, 0.0);
+  threadutils::for_each_range(0, total_num_nodes_z, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const scalar vol_left = get_value_fast(node_index_ez, node_liquid_ey_vf,
-                                           bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_right = get_value_fast(node_index_ez, node_liquid_ey_vf,
-                                            bucket_idx, node_idx, 4, 3, 0.0);
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_z[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
+      const int index = dof_idx + offset_nodes_z;
 
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
+      rhs[index] = node_liquid_w_vf[bucket_idx][node_idx] *
+                   node_vel_src_z[bucket_idx][node_idx];
 
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_back = get_value_fast(node_index_p_z, node_liquid_c_vf,
+                                             bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_p_z, node_liquid_c_vf,
+                                              bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_bottom;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_ez, node_liquid_ex_vf,
+                                               bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_top = get_value_fast(node_index_ez, node_liquid_ex_vf,
+                                            bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_left = get_value_fast(node_index_ez, node_liquid_ey_vf,
+                                             bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_right = get_value_fast(node_index_ez, node_liquid_ey_vf,
+                                              bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_right > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_left;
       }
-    }
 
-    if (vol_left > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_bottom;
       }
-    }
 
-    if (vol_top > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor *
+              vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor *
+              vol_back;
       }
-    }
 
-    if (vol_bottom > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+      if (vol_right > 0.) {
+        if (locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
+
+        if (locator.locate(node_coord + Vector3i(1, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-        if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+      if (vol_left > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+      }
+
+      if (vol_top > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 1, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+      }
+
+      if (vol_bottom > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
       }
     }
   });
@@ -1116,660 +1124,596 @@ void constructViscosityMatrixRHS(
       scene.getBucketActivated();
 
   // assamble X-matrix
-  threadutils::for_each(0, total_num_nodes_x, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_x[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
-
-    const int index = dof_idx + offset_nodes_x;
-
-    rhs[index] = node_liquid_u_vf[bucket_idx][node_idx] *
-                 node_vel_src_x[bucket_idx][node_idx];
-    matrix.set_element(index, index, node_liquid_u_vf[bucket_idx][node_idx]);
-
-    const scalar vol_left = get_value_fast(node_index_p_x, node_liquid_c_vf,
-                                           bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_right = get_value_fast(node_index_p_x, node_liquid_c_vf,
-                                            bucket_idx, node_idx, 2, 1, 0.0);
-
-    const scalar vol_back = get_value_fast(node_index_ex, node_liquid_ey_vf,
-                                           bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_ex, node_liquid_ey_vf,
-                                            bucket_idx, node_idx, 4, 1, 0.0);
+  threadutils::for_each_range(0, total_num_nodes_x, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const scalar vol_bottom = get_value_fast(node_index_ex, node_liquid_ez_vf,
-                                             bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_top = get_value_fast(node_index_ex, node_liquid_ez_vf,
-                                          bucket_idx, node_idx, 4, 3, 0.0);
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_x[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2 * factor * vol_right);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -2 * factor * vol_right);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
+      const int index = dof_idx + offset_nodes_x;
 
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2 * factor * vol_left);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -2 * factor * vol_left);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
+      rhs[index] = node_liquid_u_vf[bucket_idx][node_idx] *
+                   node_vel_src_x[bucket_idx][node_idx];
+      matrix.set_element(index, index, node_liquid_u_vf[bucket_idx][node_idx]);
 
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_top);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -factor * vol_top);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_left = get_value_fast(node_index_p_x, node_liquid_c_vf,
+                                             bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_right = get_value_fast(node_index_p_x, node_liquid_c_vf,
+                                              bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_bottom);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -factor * vol_bottom);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_bottom;
-    }
+      const scalar vol_back = get_value_fast(node_index_ex, node_liquid_ey_vf,
+                                             bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_ex, node_liquid_ey_vf,
+                                              bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_front);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -factor * vol_front);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_ex, node_liquid_ez_vf,
+                                               bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_top = get_value_fast(node_index_ex, node_liquid_ez_vf,
+                                            bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_back);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, u_ind(cur_node), -factor * vol_back);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_top > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, 2 * factor * vol_right);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_top);
+          matrix.add_to_element(index, u_ind(cur_node),
+                                -2 * factor * vol_right);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor *
+              vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, 2 * factor * vol_left);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), factor * vol_top);
+          matrix.add_to_element(index, u_ind(cur_node), -2 * factor * vol_left);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_x[cur_node(0)][cur_node(1)] * factor *
+              vol_left;
       }
-    }
 
-    if (vol_bottom > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_top);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), factor * vol_bottom);
+          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_top);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_bottom);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_bottom);
+          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_bottom);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_bottom;
       }
-    }
 
-    if (vol_front > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_front);
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_front);
+          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_front);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_back);
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), factor * vol_front);
+          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_back);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_back;
       }
-    }
 
-    if (vol_back > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), factor * vol_back);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_top > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), -factor * vol_top);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+
+        if (locator.locate(node_coord + Vector3i(-1, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), factor * vol_top);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(-1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_back);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_bottom > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), factor * vol_bottom);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
+
+        if (locator.locate(node_coord + Vector3i(-1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), -factor * vol_bottom);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
       }
-    }
-  });
 
-  threadutils::for_each(0, total_num_nodes_y, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_y[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
+      if (vol_front > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), -factor * vol_front);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
 
-    const int index = dof_idx + offset_nodes_y;
+        if (locator.locate(node_coord + Vector3i(-1, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), factor * vol_front);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
+      }
 
-    rhs[index] = node_liquid_v_vf[bucket_idx][node_idx] *
-                 node_vel_src_y[bucket_idx][node_idx];
-    matrix.set_element(index, index, node_liquid_v_vf[bucket_idx][node_idx]);
+      if (vol_back > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), factor * vol_back);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
 
-    const scalar vol_bottom = get_value_fast(node_index_p_y, node_liquid_c_vf,
-                                             bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_top = get_value_fast(node_index_p_y, node_liquid_c_vf,
-                                          bucket_idx, node_idx, 2, 1, 0.0);
+        if (locator.locate(node_coord + Vector3i(-1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), -factor * vol_back);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
+      }
+    }
+  });
 
-    const scalar vol_back = get_value_fast(node_index_ey, node_liquid_ex_vf,
-                                           bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_ey, node_liquid_ex_vf,
-                                            bucket_idx, node_idx, 4, 1, 0.0);
+  threadutils::for_each_range(0, total_num_nodes_y, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const scalar vol_left = get_value_fast(node_index_ey, node_liquid_ez_vf,
-                                           bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_right = get_value_fast(node_index_ey, node_liquid_ez_vf,
-                                            bucket_idx, node_idx, 4, 3, 0.0);
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_y[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_right);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node), -factor * vol_right);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
+      const int index = dof_idx + offset_nodes_y;
 
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_left);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node), -factor * vol_left);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
+      rhs[index] = node_liquid_v_vf[bucket_idx][node_idx] *
+                   node_vel_src_y[bucket_idx][node_idx];
+      matrix.set_element(index, index, node_liquid_v_vf[bucket_idx][node_idx]);
 
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2 * factor * vol_top);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node), -2. * factor * vol_top);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_p_y, node_liquid_c_vf,
+                                               bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_top = get_value_fast(node_index_p_y, node_liquid_c_vf,
+                                            bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2 * factor * vol_bottom);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node),
-                              -2. * factor * vol_bottom);
-      else if (state == NS_SOLID)
-        rhs[index] -= -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor *
-                      vol_bottom;
-    }
+      const scalar vol_back = get_value_fast(node_index_ey, node_liquid_ex_vf,
+                                             bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_ey, node_liquid_ex_vf,
+                                              bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_front);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node), -factor * vol_front);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_left = get_value_fast(node_index_ey, node_liquid_ez_vf,
+                                             bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_right = get_value_fast(node_index_ey, node_liquid_ez_vf,
+                                              bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_back);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, v_ind(cur_node), -factor * vol_back);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_right > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_right);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_right);
+          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_right);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_left);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), factor * vol_right);
+          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_left);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_left;
       }
-    }
 
-    if (vol_left > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, 2 * factor * vol_top);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), factor * vol_left);
+          matrix.add_to_element(index, v_ind(cur_node), -2. * factor * vol_top);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, 2 * factor * vol_bottom);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_left);
+          matrix.add_to_element(index, v_ind(cur_node),
+                                -2. * factor * vol_bottom);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -2. * node_vel_src_y[cur_node(0)][cur_node(1)] * factor *
+              vol_bottom;
       }
-    }
 
-    if (vol_front > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_front);
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_front);
+          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_front);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_back);
         const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), factor * vol_front);
+          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_back);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_back;
       }
-    }
 
-    if (vol_back > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), factor * vol_back);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_right > 0.) {
+        if (locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), -factor * vol_right);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
+
+        if (locator.locate(node_coord + Vector3i(1, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), factor * vol_right);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, -1, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_back);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+      if (vol_left > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), factor * vol_left);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), -factor * vol_left);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
       }
-    }
-  });
 
-  threadutils::for_each(0, total_num_nodes_z, [&](int dof_idx) {
-    const Vector2i& dof_loc = effective_node_indices_z[dof_idx];
-    const int bucket_idx = dof_loc[0];
-    const int node_idx = dof_loc[1];
+      if (vol_front > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), -factor * vol_front);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
 
-    const int index = dof_idx + offset_nodes_z;
+        if (locator.locate(node_coord + Vector3i(0, -1, 1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), factor * vol_front);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
+        }
+      }
 
-    rhs[index] = node_liquid_w_vf[bucket_idx][node_idx] *
-                 node_vel_src_z[bucket_idx][node_idx];
-    matrix.set_element(index, index, node_liquid_w_vf[bucket_idx][node_idx]);
+      if (vol_back > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), factor * vol_back);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
 
-    const scalar vol_back = get_value_fast(node_index_p_z, node_liquid_c_vf,
-                                           bucket_idx, node_idx, 2, 0, 0.0);
-    const scalar vol_front = get_value_fast(node_index_p_z, node_liquid_c_vf,
-                                            bucket_idx, node_idx, 2, 1, 0.0);
+        if (locator.locate(node_coord + Vector3i(0, -1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, w_ind(cur_node), -factor * vol_back);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
+        }
+      }
+    }
+  });
 
-    const scalar vol_bottom = get_value_fast(node_index_ez, node_liquid_ex_vf,
-                                             bucket_idx, node_idx, 4, 0, 0.0);
-    const scalar vol_top = get_value_fast(node_index_ez, node_liquid_ex_vf,
-                                          bucket_idx, node_idx, 4, 1, 0.0);
+  threadutils::for_each_range(0, total_num_nodes_z, [&](int begin, int end) {
+    BucketNodeLocator locator(buckets, num_nodes, &bucket_activated);
 
-    const scalar vol_left = get_value_fast(node_index_ez, node_liquid_ey_vf,
-                                           bucket_idx, node_idx, 4, 2, 0.0);
-    const scalar vol_right = get_value_fast(node_index_ez, node_liquid_ey_vf,
-                                            bucket_idx, node_idx, 4, 3, 0.0);
+    for (int dof_idx = begin; dof_idx < end; ++dof_idx) {
+      const Vector2i& dof_loc = effective_node_indices_z[dof_idx];
+      const int bucket_idx = dof_loc[0];
+      const int node_idx = dof_loc[1];
 
-    const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
-    const Vector3i& node_handle = scene.getNodeHandle(node_idx);
-
-    Vector2i cur_node;
-    if (vol_right > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_right);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -factor * vol_right);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_right;
-    }
+      const int index = dof_idx + offset_nodes_z;
 
-    if (vol_left > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(1, 0, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_left);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -factor * vol_left);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_left;
-    }
+      rhs[index] = node_liquid_w_vf[bucket_idx][node_idx] *
+                   node_vel_src_z[bucket_idx][node_idx];
+      matrix.set_element(index, index, node_liquid_w_vf[bucket_idx][node_idx]);
 
-    if (vol_top > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_top);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -factor * vol_top);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_top;
-    }
+      const scalar vol_back = get_value_fast(node_index_p_z, node_liquid_c_vf,
+                                             bucket_idx, node_idx, 2, 0, 0.0);
+      const scalar vol_front = get_value_fast(node_index_p_z, node_liquid_c_vf,
+                                              bucket_idx, node_idx, 2, 1, 0.0);
 
-    if (vol_bottom > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 1, 0)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, factor * vol_bottom);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -factor * vol_bottom);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_bottom;
-    }
+      const scalar vol_bottom = get_value_fast(node_index_ez, node_liquid_ex_vf,
+                                               bucket_idx, node_idx, 4, 0, 0.0);
+      const scalar vol_top = get_value_fast(node_index_ez, node_liquid_ex_vf,
+                                            bucket_idx, node_idx, 4, 1, 0.0);
 
-    if (vol_front > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle + Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2. * factor * vol_front);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -2. * factor * vol_front);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_front;
-    }
+      const scalar vol_left = get_value_fast(node_index_ez, node_liquid_ey_vf,
+                                             bucket_idx, node_idx, 4, 2, 0.0);
+      const scalar vol_right = get_value_fast(node_index_ez, node_liquid_ey_vf,
+                                              bucket_idx, node_idx, 4, 3, 0.0);
 
-    if (vol_back > 0. &&
-        get_node_index(bucket_activated, bucket_handle,
-                       Vector3i(node_handle - Vector3i(0, 0, 1)), num_nodes,
-                       buckets, cur_node)) {
-      matrix.add_to_element(index, index, 2. * factor * vol_back);
-      const NODE_STATE state =
-          (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
-      if (state == NS_FLUID)
-        matrix.add_to_element(index, w_ind(cur_node), -2. * factor * vol_back);
-      else if (state == NS_SOLID)
-        rhs[index] -=
-            -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_back;
-    }
+      const Vector3i node_coord = locator.globalHandle(
+          buckets.bucket_handle(bucket_idx), scene.getNodeHandle(node_idx));
 
-    if (vol_right > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      Vector2i cur_node;
+      if (vol_right > 0. &&
+          locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_right);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_right);
+          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_right);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_right;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(1, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_left > 0. &&
+          locator.locate(node_coord - Vector3i(1, 0, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_left);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), factor * vol_right);
+          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_left);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_left;
       }
-    }
 
-    if (vol_left > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_top > 0. &&
+          locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_top);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), factor * vol_left);
+          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_top);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_top;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_bottom > 0. &&
+          locator.locate(node_coord - Vector3i(0, 1, 0), cur_node)) {
+        matrix.add_to_element(index, index, factor * vol_bottom);
         const NODE_STATE state =
-            (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, u_ind(cur_node), -factor * vol_left);
+          matrix.add_to_element(index, w_ind(cur_node), -factor * vol_bottom);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+              -node_vel_src_z[cur_node(0)][cur_node(1)] * factor * vol_bottom;
       }
-    }
 
-    if (vol_top > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, 0)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_front > 0. &&
+          locator.locate(node_coord + Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, 2. * factor * vol_front);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_top);
+          matrix.add_to_element(index, w_ind(cur_node),
+                                -2. * factor * vol_front);
         else if (state == NS_SOLID)
           rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor *
+              vol_front;
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 1, -1)), num_nodes,
-                         buckets, cur_node)) {
+      if (vol_back > 0. &&
+          locator.locate(node_coord - Vector3i(0, 0, 1), cur_node)) {
+        matrix.add_to_element(index, index, 2. * factor * vol_back);
         const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+            (NODE_STATE)node_state_w[cur_node(0)][cur_node(1)];
         if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), factor * vol_top);
+          matrix.add_to_element(index, w_ind(cur_node),
+                                -2. * factor * vol_back);
         else if (state == NS_SOLID)
           rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+              -2. * node_vel_src_z[cur_node(0)][cur_node(1)] * factor *
+              vol_back;
       }
-    }
 
-    if (vol_bottom > 0.) {
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, 0)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), factor * vol_bottom);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+      if (vol_right > 0.) {
+        if (locator.locate(node_coord + Vector3i(1, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), -factor * vol_right);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
+
+        if (locator.locate(node_coord + Vector3i(1, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), factor * vol_right);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_right;
+        }
       }
 
-      if (get_node_index(bucket_activated, bucket_handle,
-                         Vector3i(node_handle + Vector3i(0, 0, -1)), num_nodes,
-                         buckets, cur_node)) {
-        const NODE_STATE state =
-            (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
-        if (state == NS_FLUID)
-          matrix.add_to_element(index, v_ind(cur_node), -factor * vol_bottom);
-        else if (state == NS_SOLID)
-          rhs[index] -=
-              -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+      if (vol_left > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), factor * vol_left);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_u[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, u_ind(cur_node), -factor * vol_left);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_x[cur_node(0)][cur_node(1)] * factor * vol_left;
+        }
+      }
+
+      if (vol_top > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 1, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), -factor * vol_top);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 1, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), factor * vol_top);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_top;
+        }
+      }
+
+      if (vol_bottom > 0.) {
+        if (locator.locate(node_coord + Vector3i(0, 0, 0), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), factor * vol_bottom);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
+
+        if (locator.locate(node_coord + Vector3i(0, 0, -1), cur_node)) {
+          const NODE_STATE state =
+              (NODE_STATE)node_state_v[cur_node(0)][cur_node(1)];
+          if (state == NS_FLUID)
+            matrix.add_to_element(index, v_ind(cur_node), -factor * vol_bottom);
+          else if (state == NS_SOLID)
+            rhs[index] -=
+                -node_vel_src_y[cur_node(0)][cur_node(1)] * factor * vol_bottom;
+        }
       }
     }
   });
@@ -1830,8 +1774,13 @@ void applyNodeViscosityExplicit(const TwoDScene& scene,
 
     const Vector3i bucket_handle = buckets.bucket_handle(bucket_idx);
 
+    GridAccessor<scalar> vel_src_x(node_vel_src_x, buckets, num_nodes, 0.0);
+    GridAccessor<scalar> vel_src_y(node_vel_src_y, buckets, num_nodes, 0.0);
+    GridAccessor<scalar> vel_src_z(node_vel_src_z, buckets, num_nodes, 0.0);
+
     for (int i = 0; i < num_node; ++i) {
-      const Vector3i& node_handle = scene.getNodeHandle(i);
+      const Vector3i node_coord =
+          vel_src_x.globalHandle(bucket_handle, scene.getNodeHandle(i));
       const scalar factor = coeff;
 
       const scalar vol_left = get_value_fast(node_index_p_x, node_liquid_c_vf,
@@ -1853,71 +1802,44 @@ void applyNodeViscosityExplicit(const TwoDScene& scene,
       scalar vel = centre_vel;
 
       vel += 2.0 * factor * vol_right *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(1, 0, 0), centre_vel) -
               centre_vel);
       vel += 2.0 * factor * vol_left *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(-1, 0, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_top *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(0, 1, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_bottom *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(0, -1, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_front *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(0, 0, 1), centre_vel) -
               centre_vel);
       vel += factor * vol_back *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, -1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_x.getValue(node_coord + Vector3i(0, 0, -1), centre_vel) -
               centre_vel);
 
       vel += factor * vol_top *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 1, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_y.getValue(node_coord + Vector3i(0, 1, 0), 0.0) -
+              vel_src_y.getValue(node_coord + Vector3i(-1, 1, 0), 0.0));
       vel += factor * vol_bottom *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_y.getValue(node_coord + Vector3i(-1, 0, 0), 0.0) -
+              vel_src_y.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       vel += factor * vol_front *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 1)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 1)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_z.getValue(node_coord + Vector3i(0, 0, 1), 0.0) -
+              vel_src_z.getValue(node_coord + Vector3i(-1, 0, 1), 0.0));
       vel += factor * vol_back *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_z.getValue(node_coord + Vector3i(-1, 0, 0), 0.0) -
+              vel_src_z.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       node_vel_x[bucket_idx](i) = vel;
     }
 
     for (int i = 0; i < num_node; ++i) {
-      const Vector3i& node_handle = scene.getNodeHandle(i);
+      const Vector3i node_coord =
+          vel_src_x.globalHandle(bucket_handle, scene.getNodeHandle(i));
       const scalar factor = coeff;
 
       const scalar vol_bottom = get_value_fast(node_index_p_y, node_liquid_c_vf,
@@ -1939,71 +1861,44 @@ void applyNodeViscosityExplicit(const TwoDScene& scene,
       scalar vel = centre_vel;
 
       vel += factor * vol_right *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(1, 0, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_left *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(-1, 0, 0), centre_vel) -
               centre_vel);
       vel += 2.0 * factor * vol_top *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(0, 1, 0), centre_vel) -
               centre_vel);
       vel += 2.0 * factor * vol_bottom *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(0, -1, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_front *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(0, 0, 1), centre_vel) -
               centre_vel);
       vel += factor * vol_back *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, -1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_y.getValue(node_coord + Vector3i(0, 0, -1), centre_vel) -
               centre_vel);
 
       vel += factor * vol_right *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, -1, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_x.getValue(node_coord + Vector3i(1, 0, 0), 0.0) -
+              vel_src_x.getValue(node_coord + Vector3i(1, -1, 0), 0.0));
       vel += factor * vol_left *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_x.getValue(node_coord + Vector3i(0, -1, 0), 0.0) -
+              vel_src_x.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       vel += factor * vol_front *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 1)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 1)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_z.getValue(node_coord + Vector3i(0, 0, 1), 0.0) -
+              vel_src_z.getValue(node_coord + Vector3i(0, -1, 1), 0.0));
       vel += factor * vol_back *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_z.getValue(node_coord + Vector3i(0, -1, 0), 0.0) -
+              vel_src_z.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       node_vel_y[bucket_idx](i) = vel;
     }
 
     for (int i = 0; i < num_node; ++i) {
-      const Vector3i& node_handle = scene.getNodeHandle(i);
+      const Vector3i node_coord =
+          vel_src_x.globalHandle(bucket_handle, scene.getNodeHandle(i));
       const scalar factor = coeff;
 
       const scalar vol_back = get_value_fast(node_index_p_z, node_liquid_c_vf,
@@ -2025,65 +1920,37 @@ void applyNodeViscosityExplicit(const TwoDScene& scene,
       scalar vel = centre_vel;
 
       vel += factor * vol_right *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(1, 0, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_left *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(-1, 0, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(-1, 0, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_top *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(0, 1, 0), centre_vel) -
               centre_vel);
       vel += factor * vol_bottom *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, -1, 0)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(0, -1, 0), centre_vel) -
               centre_vel);
       vel += 2.0 * factor * vol_front *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(0, 0, 1), centre_vel) -
               centre_vel);
       vel += 2.0 * factor * vol_back *
-             (get_value(node_vel_src_z, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, -1)), centre_vel,
-                        num_nodes, buckets) -
+             (vel_src_z.getValue(node_coord + Vector3i(0, 0, -1), centre_vel) -
               centre_vel);
 
       vel += factor * vol_right *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(1, 0, -1)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_x.getValue(node_coord + Vector3i(1, 0, 0), 0.0) -
+              vel_src_x.getValue(node_coord + Vector3i(1, 0, -1), 0.0));
       vel += factor * vol_left *
-             (get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, -1)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_x, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_x.getValue(node_coord + Vector3i(0, 0, -1), 0.0) -
+              vel_src_x.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       vel += factor * vol_top *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, 0)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 1, -1)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_y.getValue(node_coord + Vector3i(0, 1, 0), 0.0) -
+              vel_src_y.getValue(node_coord + Vector3i(0, 1, -1), 0.0));
       vel += factor * vol_bottom *
-             (get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, -1)), 0.0,
-                        num_nodes, buckets) -
-              get_value(node_vel_src_y, bucket_handle,
-                        Vector3i(node_handle + Vector3i(0, 0, 0)), 0.0,
-                        num_nodes, buckets));
+             (vel_src_y.getValue(node_coord + Vector3i(0, 0, -1), 0.0) -
+              vel_src_y.getValue(node_coord + Vector3i(0, 0, 0), 0.0));
 
       node_vel_z[bucket_idx](i) = vel;
     }
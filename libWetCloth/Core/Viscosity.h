@@ -59,6 +59,27 @@ void applyNodeViscosityImplicit(
     std::vector<VectorXs>& node_vel_z, scalar& residual, int& iter_out,
     const scalar& criterion, int maxiters);
 
+/*!
+ * Solves the same-component blocks of the viscosity system as three
+ * independent systems in parallel. The cross-component shear terms are lagged
+ * and refreshed for outer_iterations block-Jacobi sweeps, starting from the
+ * source velocities (one sweep treats them explicitly). coupled_error returns
+ * the relative residual of the result in the coupled system.
+ */
+void applyNodeViscosityImplicitSplit(
+    const TwoDScene& scene, const std::vector<VectorXi>& node_global_indices_x,
+    const std::vector<VectorXi>& node_global_indices_y,
+    const std::vector<VectorXi>& node_global_indices_z, int offset_nodes_x,
+    int offset_nodes_y, int offset_nodes_z, const SparseMatrix<scalar>& matrix,
+    const std::vector<scalar>& rhs, std::vector<scalar>& soln,
+    const std::vector<VectorXs>& node_vel_src_x,
+    const std::vector<VectorXs>& node_vel_src_y,
+    const std::vector<VectorXs>& node_vel_src_z,
+    std::vector<VectorXs>& node_vel_x, std::vector<VectorXs>& node_vel_y,
+    std::vector<VectorXs>& node_vel_z, int outer_iterations,
+    scalar& residual, int& iter_out, scalar& coupled_error,
+    const scalar& criterion, int maxiters);
+
 void applyNodeViscosityExplicit(const TwoDScene& scene,
                                 const std::vector<VectorXs>& node_vel_src_x,
                                 const std::vector<VectorXs>& node_vel_src_y,
@@ -9,6 +9,8 @@
 
 #include "VolumeFractions.h"
 
+#include <algorithm>
+
 #include "MathUtilities.h"
 
 // Assumes phi0<0 and phi1>=0, phi2>=0, or vice versa.
@@ -160,3 +162,181 @@ double volume_fraction(double phi000, double phi100, double phi010,
           2 * volume_fraction(phi100, phi111, phi001, phi010)) /
          12;
 }
+
+//============================================================================
+
+// Same as volume_fraction of a tetrahedron, with the sort done by min/max and
+// every case evaluated, so that the compiler emits selects instead of jumps.
+// The cases not taken may divide by zero; their results are discarded.
+template <class T>
+static inline T branchless_volume_fraction(T phi0, T phi1, T phi2, T phi3) {
+  // the sorting network of mathutils::sort
+  T a = std::min(phi0, phi1), b = std::max(phi0, phi1);
+  T c = std::min(phi2, phi3), d = std::max(phi2, phi3);
+  T t = std::min(a, c);
+  c = std::max(a, c);
+  a = t;
+  t = std::min(b, d);
+  d = std::max(b, d);
+  b = t;
+  t = std::min(b, c);
+  c = std::max(b, c);
+  b = t;
+
+  const T inside_tet = sorted_tet_fraction(a, b, c, d);
+  const T prism = sorted_prism_fraction(a, b, c, d);
+  const T outside_tet = 1 - sorted_tet_fraction(d, c, b, a);
+
+  T ret = (a <= 0) ? inside_tet : T(0);
+  ret = (b <= 0) ? prism : ret;
+  ret = (c <= 0) ? outside_tet : ret;
+  return (d <= 0) ? T(1) : ret;
+}
+
+template <class T>
+static void volume_fraction_batch_impl(const T* phi, int count, T* fractions) {
+  const T* p000 = phi;
+  const T* p100 = phi + count;
+  const T* p010 = phi + count * 2;
+  const T* p110 = phi + count * 3;
+  const T* p001 = phi + count * 4;
+  const T* p101 = phi + count * 5;
+  const T* p011 = phi + count * 6;
+  const T* p111 = phi + count * 7;
+
+  // same decomposition and summation order as the scalar version
+  for (int i = 0; i < count; ++i) {
+    fractions[i] =
+        (branchless_volume_fraction(p000[i], p001[i], p101[i], p011[i]) +
+         branchless_volume_fraction(p000[i], p101[i], p100[i], p110[i]) +
+         branchless_volume_fraction(p000[i], p010[i], p011[i], p110[i]) +
+         branchless_volume_fraction(p101[i], p011[i], p111[i], p110[i]) +
+         2 * branchless_volume_fraction(p000[i], p011[i], p101[i], p110[i]) +
+         branchless_volume_fraction(p100[i], p101[i], p001[i], p111[i]) +
+         branchless_volume_fraction(p100[i], p001[i], p000[i], p010[i]) +
+         branchless_volume_fraction(p100[i], p110[i], p111[i], p010[i]) +
+         branchless_volume_fraction(p001[i], p111[i], p011[i], p010[i]) +
+         2 * branchless_volume_fraction(p100[i], p111[i], p001[i], p010[i])) /
+        12;
+  }
+}
+
+void volume_fraction_batch(const float* phi, int count, float* fractions) {
+  volume_fraction_batch_impl(phi, count, fractions);
+}
+
+void volume_fraction_batch(const double* phi, int count, double* fractions) {
+  volume_fraction_batch_impl(phi, count, fractions);
+}
+
+//============================================================================
+
+namespace {
+enum SquareCase {
+  SC_OUTSIDE,
+  SC_ONE_INSIDE,
+  SC_ADJACENT,
+  SC_DIAGONAL,
+  SC_ONE_OUTSIDE,
+  SC_INSIDE
+};
+
+// For each pattern of negative corners in the counter-clockwise order
+// (bl, br, tr, tl), the case and the rotation mathutils::fraction_inside
+// arrives at after cycling its corner list.
+struct SquareSignTable {
+  unsigned char kind[16];
+  unsigned char rotation[16];
+
+  SquareSignTable() {
+    for (int mask = 0; mask < 16; ++mask) {
+      bool neg[4];
+      int count = 0;
+      for (int k = 0; k < 4; ++k) {
+        neg[k] = (mask >> k) & 1;
+        count += neg[k];
+      }
+
+      int r = 0;
+      switch (count) {
+        case 1:
+          while (!neg[r]) ++r;
+          kind[mask] = SC_ONE_INSIDE;
+          break;
+        case 2:
+          while (!neg[r] || !(neg[(r + 1) & 3] || neg[(r + 2) & 3])) ++r;
+          kind[mask] = neg[(r + 1) & 3] ? SC_ADJACENT : SC_DIAGONAL;
+          break;
+        case 3:
+          while (neg[r]) ++r;
+          kind[mask] = SC_ONE_OUTSIDE;
+          break;
+        case 4:
+          kind[mask] = SC_INSIDE;
+          break;
+        default:
+          kind[mask] = SC_OUTSIDE;
+          break;
+      }
+      rotation[mask] = (unsigned char)r;
+    }
+  }
+};
+
+const SquareSignTable g_square_sign_table;
+}  // namespace
+
+template <class T>
+static void fraction_inside_batch_impl(const T* phi, int count, T* fractions) {
+  const T* p_bl = phi;
+  const T* p_br = phi + count;
+  const T* p_tl = phi + count * 2;
+  const T* p_tr = phi + count * 3;
+
+  for (int i = 0; i < count; ++i) {
+    const T q0 = p_bl[i], q1 = p_br[i], q2 = p_tr[i], q3 = p_tl[i];
+    const int mask =
+        (q0 < 0) | ((q1 < 0) << 1) | ((q2 < 0) << 2) | ((q3 < 0) << 3);
+    const int kind = g_square_sign_table.kind[mask];
+    const int r = g_square_sign_table.rotation[mask];
+
+    const T q[8] = {q0, q1, q2, q3, q0, q1, q2, q3};
+    const T l0 = q[r], l1 = q[r + 1], l2 = q[r + 2], l3 = q[r + 3];
+
+    // at most four edge crossings are needed by any case; pick the operands
+    // first so that the divisions are shared, in the form fraction_inside
+    // evaluates them
+    const bool one_out = (kind == SC_ONE_OUTSIDE);
+    const T a = one_out ? l3 / (l3 - l0) : l0 / (l0 - l3);
+    const T b = one_out ? l1 / (l1 - l0)
+                        : ((kind == SC_ADJACENT) ? l1 / (l1 - l2)
+                                                 : l0 / (l0 - l1));
+    const T c = l2 / (l2 - l3);
+    const T d = l2 / (l2 - l1);
+
+    const T one_inside = 0.5 * a * b;
+    const T one_outside = 1. - 0.5 * (1. - a) * (1. - b);
+    const T adjacent = 0.5 * (a + b);
+
+    const T middle_point = 0.25 * (l0 + l1 + l2 + l3);
+    T area_in = 0.5 * (1. - a) * (1. - c);
+    area_in += 0.5 * (1. - b) * (1. - d);
+    T area_out = 0.5 * b * a;
+    area_out += 0.5 * d * c;
+    const T diagonal = (middle_point < 0) ? T(1. - area_in) : area_out;
+
+    T ret = (kind == SC_ONE_INSIDE) ? one_inside : T(0);
+    ret = (kind == SC_ADJACENT) ? adjacent : ret;
+    ret = (kind == SC_DIAGONAL) ? diagonal : ret;
+    ret = (kind == SC_ONE_OUTSIDE) ? one_outside : ret;
+    fractions[i] = (kind == SC_INSIDE) ? T(1) : ret;
+  }
+}
+
+void fraction_inside_batch(const float* phi, int count, float* fractions) {
+  fraction_inside_batch_impl(phi, count, fractions);
+}
+
+void fraction_inside_batch(const double* phi, int count, double* fractions) {
+  fraction_inside_batch_impl(phi, count, fractions);
+}
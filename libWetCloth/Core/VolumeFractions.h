@@ -33,4 +33,15 @@ double volume_fraction(double phi000, double phi100, double phi010,
                        double phi110, double phi001, double phi101,
                        double phi011, double phi111);
 
+// Batched, branch-free versions for count cells at once. The corners are
+// stored corner-major, i.e. corner c of cell i is phi[c * count + i], in the
+// argument order of the functions above. Results equal the scalar versions.
+void volume_fraction_batch(const float* phi, int count, float* fractions);
+void volume_fraction_batch(const double* phi, int count, double* fractions);
+
+// Batched, branch-free mathutils::fraction_inside over rectangles with
+// corners (bl, br, tl, tr), stored as for volume_fraction_batch
+void fraction_inside_batch(const float* phi, int count, float* fractions);
+void fraction_inside_batch(const double* phi, int count, double* fractions);
+
 #endif
@@ -9,12 +9,24 @@
 // file, You can obtain one at http://mozilla.org/MPL/2.0/.
 #include "WetClothCore.h"
 
+#include <cstring>
+#include <sstream>
+
 #include "MemUtilities.h"
 #include "TimingUtilities.h"
 
 WetClothCore::WetClothCore(const std::shared_ptr<TwoDScene>& scene,
                            const std::shared_ptr<SceneStepper>& scene_stepper)
     : m_scene(scene), m_scene_stepper(scene_stepper), m_current_step(0) {
+  const LiquidInfo& info = scene->getLiquidInfo();
+  if (info.use_adaptive_dt) {
+    m_dt_controller = std::make_shared<AdaptiveTimeStepController>(
+        info.velocity_percentile, info.target_solver_iterations,
+        info.max_dt_growth);
+  } else {
+    m_dt_controller = std::make_shared<CFLTimeStepController>();
+  }
+
   timing_buffer.resize(15);
   timing_buffer.assign(15, 0.0);
 
@@ -31,6 +43,26 @@ const std::shared_ptr<SceneStepper>& WetClothCore::getSceneStepper() const {
 
 int WetClothCore::getCurrentTime() const { return m_current_step; }
 
+void WetClothCore::setTimeStepController(
+    const std::shared_ptr<TimeStepController>& controller) {
+  m_dt_controller = controller;
+}
+
+const std::shared_ptr<TimeStepController>&
+WetClothCore::getTimeStepController() const {
+  return m_dt_controller;
+}
+
+void WetClothCore::setTelemetryWriter(
+    const std::shared_ptr<TelemetryWriter>& writer) {
+  m_telemetry = writer;
+}
+
+const std::shared_ptr<TelemetryWriter>& WetClothCore::getTelemetryWriter()
+    const {
+  return m_telemetry;
+}
+
 const std::shared_ptr<TwoDScene>& WetClothCore::getScene() const {
   return m_scene;
 }
@@ -51,15 +83,6 @@ void WetClothCore::stepSystem(const scalar& dt) {
 
   const scalar max_elasto_vel = m_scene->getMaxVelocity();
   const scalar max_fluid_vel = m_scene->getMaxFluidVelocity();
-  const scalar dx = m_scene->getCellSize();
-  const scalar max_elasto_dt = std::min(
-      dx / std::max(1e-63, max_elasto_vel) / 3.0, 1.0 / 30.0);  // 1/6 CFLs
-  const scalar max_fluid_dt = std::min(
-      dx / std::max(1e-63, max_fluid_vel) * 3.0, 1.0 / 30.0);  // 3 CFLs
-  const scalar max_dt = std::min(max_elasto_dt, max_fluid_dt);
-
-  const int num_substeps = std::max(1, (int)ceil(dt / max_dt));
-  const scalar sub_dt = dt / (scalar)num_substeps;
 
   m_info.m_historical_max_vel =
       std::max(m_info.m_historical_max_vel, max_elasto_vel);
@@ -68,125 +91,440 @@ void WetClothCore::stepSystem(const scalar& dt) {
 
   std::cout << "[step system max vel: (" << max_elasto_vel << " <"
             << m_info.m_historical_max_vel << ">, " << max_fluid_vel << " <"
-            << m_info.m_historical_max_vel_fluid << ">) max dt: " << max_dt
-            << " (" << max_elasto_dt << ", " << max_fluid_dt
-            << "), # sub-step: (" << num_substeps << "), sub-dt: " << sub_dt
-            << "]" << std::endl;
+            << m_info.m_historical_max_vel_fluid
+            << ">), dt controller: " << m_dt_controller->getName() << "]"
+            << std::endl;
+
+  m_dt_controller->beginFrame(*m_scene, dt);
+
+  const std::vector<scalar> frame_timing = timing_buffer;
+  std::vector<scalar> substep_timing;
+  int num_substeps = 0;
+  m_frame_solver_ranges.clear();
 
   // Start the possible sub-steps
-  for (int k = 0; k < num_substeps; ++k) {
-    scalar cur_time = (scalar)m_current_step * dt + k * sub_dt;
-    std::cout << "[(" << cur_time << " s) start substep: " << k << "/"
-              << num_substeps << "]" << std::endl;
+  scalar frame_time = 0.0;
+  for (int k = 0; frame_time < dt; ++k) {
+    const scalar remaining = dt - frame_time;
+    std::string reason;
+    scalar sub_dt = m_dt_controller->computeStepSize(*m_scene, remaining,
+                                                     reason);
+    // do not leave a sliver of the frame due to round-off
+    if (sub_dt >= remaining * (1.0 - 1e-8)) sub_dt = remaining;
+
+    scalar cur_time = (scalar)m_current_step * dt + frame_time;
+    std::cout << "[(" << cur_time << " s) start substep: " << k
+              << ", sub-dt: " << sub_dt << " (" << reason << ")]"
+              << std::endl;
 
-    scalar t0 = timingutils::seconds();
-    scalar t1;
+    m_scene_stepper->clearSolveStats();
+    if (m_telemetry) substep_timing = timing_buffer;
 
-    // Update Viscous Parameter for Elastic Rods
-    m_scene->updateStrandParamViscosity(sub_dt);
+    if (m_scene->getLiquidInfo().use_guarded_step) {
+      stepGuardedSubstep(cur_time, sub_dt, dt, 0);
+    } else {
+      stepSubstep(cur_time, sub_dt, dt);
+      acceptSubstep(sub_dt, false);
+    }
 
-    // Setup Scripting for Kinematic Objects
-    m_scene->stepScript(sub_dt, cur_time);
-    m_scene->applyScript(sub_dt);
+    if (m_telemetry)
+      writeTelemetry("substep", k, cur_time, sub_dt, reason, substep_timing);
 
-    // Emit Liquid Particles for Liquid Sources
-    m_scene->sampleLiquidDistanceFields(cur_time + sub_dt);
+    frame_time = (sub_dt == remaining) ? dt : frame_time + sub_dt;
+    num_substeps = k + 1;
+  }
 
-    // Remove Liquid Particles outside Simulation Domain (to save time)
-    std::cout << "[terminate particles]" << std::endl;
-    m_scene->terminateParticles();
+  // Summarize Divergence if Necessary
+  if (m_scene->getLiquidInfo().check_divergence) {
+    scalar avg_explicit_div =
+        m_info.m_explicit_div_accu / (scalar)(m_current_step + 1);
+    scalar avg_implicit_div =
+        m_info.m_implicit_div_accu / (scalar)(m_current_step + 1);
+    scalar avg_initial_div =
+        m_info.m_initial_div_accu / (scalar)(m_current_step + 1);
+    std::cout << "Div Check, " << avg_initial_div << ", " << avg_explicit_div
+              << ", " << avg_implicit_div << ", "
+              << (fabs(avg_implicit_div - avg_explicit_div) / avg_initial_div)
+              << std::endl;
+  }
 
-    // Calculate the Optimal Volume of Liquid Particles
-    std::cout << "[update optimal volume]" << std::endl;
-    m_scene->updateOptiVolume();
+  // Summarize Memory Usage
+  size_t cur_usage = memutils::getCurrentRSS();
 
-    // Split the Liquid Particles if They are too Large
-    std::cout << "[split particles]" << std::endl;
-    m_scene->splitLiquidParticles();
+  m_info.m_mem_usage_accu += (scalar)cur_usage;
+  m_info.m_num_particles_accu += (scalar)m_scene->getNumParticles();
+  m_info.m_num_elements_accu += (scalar)m_scene->getNumGausses();
+  m_info.m_num_fluid_particles_accu += (scalar)m_scene->getNumFluidParticles();
 
-    // Merge the Liquid Particles if They are too Small
-    std::cout << "[merge particles]" << std::endl;
-    m_scene->mergeLiquidParticles();
-    t1 = timingutils::seconds();
-    timing_buffer[0] += t1 - t0;  // Merge & Split Particles
-    t0 = t1;
+  if (m_telemetry)
+    writeTelemetry("frame", num_substeps, (scalar)m_current_step * dt, dt, "",
+                   frame_timing);
 
-    // Create Grid around Particles
-    m_scene->updateParticleBoundingBox();
-    m_scene->rebucketizeParticles();
-    m_scene->resampleNodes();
-    t1 = timingutils::seconds();
-    timing_buffer[1] += t1 - t0;  // build Grid
-    t0 = t1;
+  // Check for obvious problems in the simulated scene
+#ifdef DEBUG
+  m_scene->checkConsistency();
+#endif
 
-    // Update Particle-Node Weight
-    m_scene->computeWeights(sub_dt);
+  ++m_current_step;
+}
 
-    // Update Solid Stress
-    m_scene->computedEdFe();
+// keys of the stage timings in timing_buffer
+const static char* g_telemetry_stages[] = {
+    "particles", "grid",    "weights", "p2g",          "predict",
+    "pressure",  "solid",   "liquid",  "correct",      "g2p",
+    "advect",    "capture", "drip",    "quasi_static", "plasticity"};
+
+static std::string jsonEscape(const std::string& str) {
+  std::string ret;
+  for (char c : str) {
+    if (c == '"' || c == '\\') ret += '\\';
+    if ((unsigned char)c >= 0x20) ret += c;
+  }
+  return ret;
+}
 
-    m_scene->updateManifoldOperators();
+/*!
+ * Queue one JSON record with the current scene statistics, the linear
+ * solves of the last sub-step and the stage timings spent since
+ * timing_begin. Frame records carry the number of sub-steps instead of the
+ * sub-step index, the iteration range of each solve over the frame instead
+ * of the last solves, and the aggregate state of the scene.
+ */
+void WetClothCore::writeTelemetry(const char* type, int substep,
+                                  const scalar& cur_time, const scalar& sub_dt,
+                                  const std::string& reason,
+                                  const std::vector<scalar>& timing_begin) {
+  const int num_buckets = m_scene->getNumBuckets();
+  int num_active_buckets = 0;
+  int num_nodes = 0;
+  for (int i = 0; i < num_buckets; ++i) {
+    if (!m_scene->isBucketActivated(i)) continue;
+    ++num_active_buckets;
+    num_nodes += m_scene->getNumNodes(i);
+  }
 
-    // Update the Orientation Field
-    m_scene->updateOrientation();
+  const bool is_frame = !strcmp(type, "frame");
+
+  std::ostringstream oss;
+  oss.precision(9);
+  oss << "{\"type\":\"" << type << "\",\"frame\":" << m_current_step;
+  if (is_frame)
+    oss << ",\"substeps\":" << substep;
+  else
+    oss << ",\"substep\":" << substep;
+  oss << ",\"time\":" << cur_time << ",\"dt\":" << sub_dt;
+  if (!reason.empty())
+    oss << ",\"dt_reason\":\"" << jsonEscape(reason) << "\"";
+
+  oss << ",\"particles\":" << m_scene->getNumParticles()
+      << ",\"fluid_particles\":" << m_scene->getNumFluidParticles()
+      << ",\"elasto_particles\":" << m_scene->getNumElastoParticles()
+      << ",\"spray_particles\":" << m_scene->getNumSprayParticles()
+      << ",\"buckets\":" << num_buckets
+      << ",\"active_buckets\":" << num_active_buckets
+      << ",\"nodes\":" << num_nodes
+      << ",\"rollbacks\":" << m_info.m_num_rollbacks;
+
+  if (is_frame) {
+    oss << ",\"solver_ranges\":{";
+    bool first = true;
+    for (auto& entry : m_frame_solver_ranges) {
+      if (!first) oss << ",";
+      first = false;
+      oss << "\"" << jsonEscape(entry.first) << "\":[" << entry.second(0)
+          << "," << entry.second(1) << "]";
+    }
+    oss << "}";
+
+    SceneStatistics stats;
+    m_scene->computeStatistics(stats);
+
+    auto vec3 = [&](const char* key, const Vector3s& v) {
+      oss << ",\"" << key << "\":[" << v(0) << "," << v(1) << "," << v(2)
+          << "]";
+    };
+
+    oss << ",\"stats\":{\"fluid_volume\":" << stats.fluid_volume
+        << ",\"absorbed_volume\":" << stats.absorbed_volume
+        << ",\"spray_volume\":" << stats.spray_volume
+        << ",\"saturation\":" << stats.saturation
+        << ",\"kinetic_energy\":" << stats.kinetic_energy;
+    vec3("fluid_momentum", stats.fluid_momentum);
+    vec3("elasto_momentum", stats.elasto_momentum);
+    vec3("fluid_bbox_min", stats.fluid_bbox_min);
+    vec3("fluid_bbox_max", stats.fluid_bbox_max);
+    vec3("elasto_bbox_min", stats.elasto_bbox_min);
+    vec3("elasto_bbox_max", stats.elasto_bbox_max);
+    oss << "}";
+  } else {
+    oss << ",\"solvers\":{";
+    bool first = true;
+    for (auto& entry : m_scene_stepper->getSolveStats()) {
+      if (!first) oss << ",";
+      first = false;
+      oss << "\"" << jsonEscape(entry.first)
+          << "\":{\"iterations\":" << entry.second.iterations
+          << ",\"residual\":";
+      // JSON has no literal for inf and nan
+      if (std::isfinite(entry.second.residual))
+        oss << entry.second.residual;
+      else
+        oss << "null";
+      oss << ",\"success\":" << (entry.second.success ? "true" : "false")
+          << "}";
+    }
+    oss << "}";
+  }
 
-    // Update the Liquid Distance Field
-    m_scene->updateLiquidPhi(sub_dt);
+  oss << ",\"timings\":{";
+  const int num_stages = std::min(
+      (int)timing_buffer.size(),
+      (int)(sizeof(g_telemetry_stages) / sizeof(const char*)));
+  for (int i = 0; i < num_stages; ++i) {
+    if (i) oss << ",";
+    oss << "\"" << g_telemetry_stages[i]
+        << "\":" << (timing_buffer[i] - timing_begin[i]);
+  }
+  oss << "}";
 
-    // Compute Cohesion Force
-    m_scene->updateIntersection();
+  oss << ",\"rss\":" << memutils::getCurrentRSS()
+      << ",\"peak_rss\":" << memutils::getPeakRSS() << "}";
 
-    // Advect Surface Tension Force
-    m_scene_stepper->advectSurfTension(*m_scene, dt);
+  m_telemetry->write(oss.str());
+}
 
-    // Here's the precomputation of some forces lay
-    m_scene->updateStartState();
+/*!
+ * Report a sub-step that is kept to the step controller, with its own size
+ * and solves, and fold its solves into the iteration ranges of the frame.
+ * An implicit elastic solve, or the monolithic one in its place, also sets
+ * the cost the automatic elasto integrator weighs the sub-cycles against.
+ */
+void WetClothCore::acceptSubstep(const scalar& sub_dt, bool rolled_back) {
+  m_dt_controller->endStep(*m_scene, *m_scene_stepper, sub_dt, rolled_back);
+
+  for (auto& entry : m_scene_stepper->getSolveStats()) {
+    const int iterations = entry.second.iterations;
+    if (entry.first == "elasto" || entry.first == "monolithic")
+      m_scene->setElastoSolveIterations(iterations);
+
+    auto range = m_frame_solver_ranges.find(entry.first);
+    if (range == m_frame_solver_ranges.end()) {
+      m_frame_solver_ranges[entry.first] = Vector2i(iterations, iterations);
+    } else {
+      range->second(0) = std::min(range->second(0), iterations);
+      range->second(1) = std::max(range->second(1), iterations);
+    }
+  }
+}
 
-    // Update the Distance Function for Kinematic Objects
-    m_scene->updateSolidPhi();
+/*!
+ * Apply the pressure to a copy of the liquid velocity and add its divergence
+ * to the statistics of the step.
+ */
+void WetClothCore::accumulateExplicitDivergence(const scalar& sub_dt,
+                                                const scalar& div_weight) {
+  m_scene_stepper->pushFluidVelocity();
+  m_scene_stepper->applyPressureDragFluid(*m_scene, sub_dt);
+  scalar div = m_scene_stepper->computeDivergence(*m_scene) * div_weight;
+  m_info.m_explicit_div_accu += div;
+  m_scene_stepper->popFluidVelocity();
+}
 
-    // Update the Weight on Grid (see [Batty et al. 2007] for details) for
-    // Kinematic Objects
-    m_scene->updateSolidWeights();
+/*!
+ * Run a sub-step on a snapshot of the scene. If the result contains
+ * non-finite values, runaway velocities or a failed linear solve, roll back
+ * and cover the same time with two sub-steps of half the size. Every
+ * sub-step that is kept is reported through acceptSubstep.
+ */
+bool WetClothCore::stepGuardedSubstep(const scalar& cur_time,
+                                      const scalar& sub_dt, const scalar& dt,
+                                      int depth) {
+  const Info saved_info = m_info;
+  m_scene->saveState(m_saved_state);
+  m_scene_stepper->clearSolveFailure();
+  m_scene_stepper->clearSolveStats();
+
+  stepSubstep(cur_time, sub_dt, dt);
+
+  std::string reason;
+  bool healthy = m_scene->checkStateHealth(reason);
+  if (healthy && m_scene_stepper->hasSolveFailure()) {
+    reason = "linear solve failed";
+    healthy = false;
+  }
 
-    // Save Current Velocity
-    m_scene->saveParticleVelocity();
+  if (healthy) {
+    acceptSubstep(sub_dt, depth > 0);
+    return true;
+  }
 
-    t1 = timingutils::seconds();
-    timing_buffer[2] +=
-        t1 -
-        t0;  // Compute Weight, Solid Stress, and Distance Field (all above)
-    t0 = t1;
+  if (depth >= m_scene->getLiquidInfo().max_step_retries) {
+    std::cout << "[guarded step: (" << cur_time << " s) " << reason
+              << ", giving up after " << depth
+              << " retries, keep the sub-step]" << std::endl;
+    // smaller steps did not help, so do not keep shrinking them
+    acceptSubstep(sub_dt, false);
+    return false;
+  }
+
+  const scalar half_dt = sub_dt * 0.5;
+  std::cout << "[guarded step: (" << cur_time << " s) " << reason
+            << ", roll back and retry with sub-dt: " << half_dt << "]"
+            << std::endl;
 
-    // Map the Liquid Particles and Elastic Vertices onto Grid
-    m_scene->mapParticleNodesAPIC();
+  m_scene->restoreState(m_saved_state);
+  m_info = saved_info;
+  ++m_info.m_num_rollbacks;
 
-    // Save the Grid Velocity
-    m_scene->saveFluidVelocity();
+  const bool first_half = stepGuardedSubstep(cur_time, half_dt, dt, depth + 1);
+  const bool second_half =
+      stepGuardedSubstep(cur_time + half_dt, half_dt, dt, depth + 1);
+  return first_half && second_half;
+}
 
-    // Update Saturation and Solid Volume Fraction on Grid
-    m_scene->mapParticleSaturationPsiNodes();
+void WetClothCore::stepSubstep(const scalar& cur_time, const scalar& sub_dt,
+                               const scalar& dt) {
+  // weight of this sub-step in the divergence statistics
+  const scalar div_weight = sub_dt / dt;
 
-    // Compute the Pore Pressure on Grid
-    m_scene->updatePorePressureNodes();
+  scalar t0 = timingutils::seconds();
+  scalar t1;
 
-    t1 = timingutils::seconds();
-    timing_buffer[3] +=
-        t1 - t0;  // APIC Mapping & Computing the Fields (all above)
-    t0 = t1;
+  // Update Viscous Parameter for Elastic Rods
+  m_scene->updateStrandParamViscosity(sub_dt);
+
+  // Setup Scripting for Kinematic Objects
+  m_scene->stepScript(sub_dt, cur_time);
+  m_scene->applyScript(sub_dt);
+
+  // Emit Liquid Particles for Liquid Sources
+  m_scene->sampleLiquidDistanceFields(cur_time + sub_dt);
+
+  // Remove Liquid Particles outside Simulation Domain (to save time)
+  std::cout << "[terminate particles]" << std::endl;
+  m_scene->terminateParticles();
+
+  // Calculate the Optimal Volume of Liquid Particles
+  std::cout << "[update optimal volume]" << std::endl;
+  m_scene->updateOptiVolume();
+
+  // Split the Liquid Particles if They are too Large
+  std::cout << "[split particles]" << std::endl;
+  m_scene->splitLiquidParticles();
+
+  // Merge the Liquid Particles if They are too Small
+  std::cout << "[merge particles]" << std::endl;
+  m_scene->mergeLiquidParticles();
+
+  // Keep Liquid Particles only in a Band around the Liquid Surface
+  m_scene->updateLiquidNarrowBand();
+
+  // Move Isolated Liquid Particles off the Grid as Spray and Back
+  m_scene->updateSprayParticles();
+  t1 = timingutils::seconds();
+  timing_buffer[0] += t1 - t0;  // Merge & Split Particles
+  t0 = t1;
+
+  // Create Grid around Particles
+  m_scene->updateParticleBoundingBox();
+  m_scene->rebucketizeParticles();
+  m_scene->resampleNodes();
+
+  // Carry the Grid-Represented Liquid Interior onto the New Grid
+  m_scene->advectLiquidInterior(sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[1] += t1 - t0;  // build Grid
+  t0 = t1;
+
+  // Update Particle-Node Weight
+  m_scene->computeWeights(sub_dt);
+
+  // Update Solid Stress
+  m_scene->computedEdFe();
 
-    // Explicitly Integrate the Elastic and Liquid Velocity
-    m_scene_stepper->stepVelocity(*m_scene, sub_dt);
+  m_scene->updateManifoldOperators();
+
+  // Update the Orientation Field
+  m_scene->updateOrientation();
+
+  // Update the Liquid Distance Field
+  m_scene->updateLiquidPhi(sub_dt);
+
+  // Compute Cohesion Force
+  m_scene->updateIntersection();
+
+  // Advect Surface Tension Force
+  m_scene_stepper->advectSurfTension(*m_scene, dt);
+
+  // Here's the precomputation of some forces lay
+  m_scene->updateStartState();
+
+  // Bound the Explicit Elastic Sub-Cycles by the Elastic Wave Speed
+  m_scene->updateElasticWaveStepSize();
+
+  // Update the Distance Function for Kinematic Objects
+  m_scene->updateSolidPhi();
+
+  // Update the Weight on Grid (see [Batty et al. 2007] for details) for
+  // Kinematic Objects
+  m_scene->updateSolidWeights();
+
+  // Save Current Velocity
+  m_scene->saveParticleVelocity();
+
+  t1 = timingutils::seconds();
+  timing_buffer[2] +=
+      t1 -
+      t0;  // Compute Weight, Solid Stress, and Distance Field (all above)
+  t0 = t1;
+
+  // Map the Liquid Particles and Elastic Vertices onto Grid
+  m_scene->mapParticleNodesAPIC();
+
+  // Fill the Liquid Interior not Covered by Particles
+  m_scene->mapLiquidInteriorNodes();
+
+  // Save the Grid Velocity
+  m_scene->saveFluidVelocity();
+
+  // Update Saturation and Solid Volume Fraction on Grid
+  m_scene->mapParticleSaturationPsiNodes();
+
+  // Compute the Pore Pressure on Grid
+  m_scene->updatePorePressureNodes();
+
+  t1 = timingutils::seconds();
+  timing_buffer[3] +=
+      t1 - t0;  // APIC Mapping & Computing the Fields (all above)
+  t0 = t1;
+
+  // Explicitly Integrate the Elastic and Liquid Velocity
+  m_scene_stepper->stepVelocity(*m_scene, sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[4] += t1 - t0;  // Velocity Prediction
+  t0 = t1;
+
+  // Check Divergence if Necessary
+  if (m_scene->getLiquidInfo().check_divergence) {
+    m_info.m_initial_div_accu +=
+        m_scene_stepper->computeDivergence(*m_scene) * div_weight;
+  }
+
+  // An Explicit Elasto Step has Nothing Stiff to Couple, so it always
+  // Takes the Split Path
+  if (m_scene->getLiquidInfo().use_monolithic_pressure &&
+      m_scene->getLiquidInfo().solve_solid &&
+      !m_scene->useExplicitElasto(sub_dt)) {
+    // Solve the Pressure and the Elastic Objects as One System
+    m_scene_stepper->projectMonolithic(*m_scene, sub_dt);
     t1 = timingutils::seconds();
-    timing_buffer[4] += t1 - t0;  // Velocity Prediction
+    timing_buffer[5] += t1 - t0;  // Pressure Projection
     t0 = t1;
 
-    // Check Divergence if Necessary
-    if (m_scene->getLiquidInfo().check_divergence) {
-      m_info.m_initial_div_accu +=
-          m_scene_stepper->computeDivergence(*m_scene) / (scalar)num_substeps;
-    }
-
+    // Check Divergence if Necessary, with the Coupled Pressure
+    if (m_scene->getLiquidInfo().check_divergence)
+      accumulateExplicitDivergence(sub_dt, div_weight);
+  } else {
     // Do Pressure Projection for the Mixture
     m_scene_stepper->projectFine(*m_scene, sub_dt);
     t1 = timingutils::seconds();
@@ -203,128 +541,102 @@ void WetClothCore::stepSystem(const scalar& dt) {
 
     // Check Divergence if Necessary and Comparing with the Previously
     // Recorded Divergence to Measure the Error
-    if (m_scene->getLiquidInfo().check_divergence) {
-      m_scene_stepper->pushFluidVelocity();
-      m_scene_stepper->applyPressureDragFluid(*m_scene, sub_dt);
-      scalar div =
-          m_scene_stepper->computeDivergence(*m_scene) / (scalar)num_substeps;
-      m_info.m_explicit_div_accu += div;
-      m_scene_stepper->popFluidVelocity();
-    }
+    if (m_scene->getLiquidInfo().check_divergence)
+      accumulateExplicitDivergence(sub_dt, div_weight);
 
     if (m_scene->getLiquidInfo().solve_solid) {
-      // Implicitly Integrate the Elastic Objects
-      m_scene_stepper->stepImplicitElasto(*m_scene, sub_dt);
+      // Integrate the Elastic Objects, Implicitly or under the Elastic CFL
+      if (m_scene->useExplicitElasto(sub_dt))
+        m_scene_stepper->stepExplicitElasto(*m_scene, sub_dt);
+      else
+        m_scene_stepper->stepImplicitElasto(*m_scene, sub_dt);
       t1 = timingutils::seconds();
       timing_buffer[6] += t1 - t0;  // Solve solid velocity
       t0 = t1;
     }
+  }
 
-    // Apply Pressure Gradient to Liquid
-    m_scene_stepper->applyPressureDragFluid(*m_scene, sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[7] += t1 - t0;  // Solve Fluid velocity
-    t0 = t1;
-
-    // Update the Current Velocity with the Solved Ones
-    m_scene_stepper->acceptVelocity(*m_scene);
-
-    if (m_scene->getLiquidInfo().check_divergence) {
-      m_info.m_implicit_div_accu +=
-          m_scene_stepper->computeDivergence(*m_scene) / (scalar)num_substeps;
-    }
-
-    // Kinematic Projection of the Liquid Velocity at the Boundary (as
-    // Fail-safe)
-    m_scene->constrainLiquidVelocity();
-
-    // Relax the Liquid Particles (see [Ando et al. 2011] for details)
-    m_scene->correctLiquidParticles(sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[8] += t1 - t0;  // Particle Correction
-    t0 = t1;
-
-    // Transfer Velocity Back to Particles and Elastic Vertices
-    m_scene->mapNodeParticlesAPIC();
-    t1 = timingutils::seconds();
-    timing_buffer[9] += t1 - t0;  // APIC Map Particle Back
-    t0 = t1;
-
-    // Update the Multipliers applied on Geometric Stiffness
-    // (refer to the supplemental material of [Fei et al. 2017] for details)
-    m_scene->updateMultipliers(sub_dt);
-
-    // Advection of Liquid Particles and Elastic Vertices
-    m_scene_stepper->advectScene(*m_scene, sub_dt);
-
-    // Kinematic Projection of the Elastic Vertices at the Boundary (as
-    // Fail-safe)
-    m_scene->solidProjection(sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[10] += t1 - t0;  // Particle Advection
-    t0 = t1;
-
-    // Distribute the Liquid Volume onto Elastic Vertices (Capturing)
-    m_scene->distributeFluidElasto(sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[11] += t1 - t0;  // Liquid Capturing
-    t0 = t1;
-
-    // Emit Liquid Particles for Overflowed Elastic Vertices (Dripping)
-    m_scene->distributeElastoFluid();
-    t1 = timingutils::seconds();
-    timing_buffer[12] += t1 - t0;  // Liquid Dripping
-    t0 = t1;
-
-    // Update the Velocity Displacement
-    m_scene->updateVelocityDifference();
+  // Apply Pressure Gradient to Liquid
+  m_scene_stepper->applyPressureDragFluid(*m_scene, sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[7] += t1 - t0;  // Solve Fluid velocity
+  t0 = t1;
 
-    // Update the Acceleration of Liquid on Elastic Vertices
-    m_scene->updateGaussAccel();
+  // Update the Current Velocity with the Solved Ones
+  m_scene_stepper->acceptVelocity(*m_scene);
 
-    // Solve the Quasi-Static Equation on Elastic Vertices
-    m_scene_stepper->manifoldPropagate(*m_scene, sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[13] += t1 - t0;  // Solve Quasi-Static Equations
-    t0 = t1;
-
-    // Update the Variables on Elements
-    // We denote elements as 'Gauss' since they are computed at the Gaussian
-    // Quadrature Point (1-Point).
-    std::cout << "[update gauss system and plasticity]" << std::endl;
-    m_scene->updateGaussSystem(sub_dt);
-    m_scene->updatePlasticity(sub_dt);
-    t1 = timingutils::seconds();
-    timing_buffer[14] += t1 - t0;  // update Deformation Gradient
-    t0 = t1;
-  }
-
-  // Summarize Divergence if Necessary
   if (m_scene->getLiquidInfo().check_divergence) {
-    scalar avg_explicit_div =
-        m_info.m_explicit_div_accu / (scalar)(m_current_step + 1);
-    scalar avg_implicit_div =
-        m_info.m_implicit_div_accu / (scalar)(m_current_step + 1);
-    scalar avg_initial_div =
-        m_info.m_initial_div_accu / (scalar)(m_current_step + 1);
-    std::cout << "Div Check, " << avg_initial_div << ", " << avg_explicit_div
-              << ", " << avg_implicit_div << ", "
-              << (fabs(avg_implicit_div - avg_explicit_div) / avg_initial_div)
-              << std::endl;
+    m_info.m_implicit_div_accu +=
+        m_scene_stepper->computeDivergence(*m_scene) * div_weight;
   }
 
-  // Summarize Memory Usage
-  size_t cur_usage = memutils::getCurrentRSS();
-
-  m_info.m_mem_usage_accu += (scalar)cur_usage;
-  m_info.m_num_particles_accu += (scalar)m_scene->getNumParticles();
-  m_info.m_num_elements_accu += (scalar)m_scene->getNumGausses();
-  m_info.m_num_fluid_particles_accu += (scalar)m_scene->getNumFluidParticles();
-
-  // Check for obvious problems in the simulated scene
-#ifdef DEBUG
-  m_scene->checkConsistency();
-#endif
-
-  ++m_current_step;
+  // Kinematic Projection of the Liquid Velocity at the Boundary (as
+  // Fail-safe)
+  m_scene->constrainLiquidVelocity();
+
+  // Relax the Liquid Particles (see [Ando et al. 2011] for details)
+  m_scene->correctLiquidParticles(sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[8] += t1 - t0;  // Particle Correction
+  t0 = t1;
+
+  // Transfer Velocity Back to Particles and Elastic Vertices
+  m_scene->mapNodeParticlesAPIC();
+  t1 = timingutils::seconds();
+  timing_buffer[9] += t1 - t0;  // APIC Map Particle Back
+  t0 = t1;
+
+  // Update the Multipliers applied on Geometric Stiffness
+  // (refer to the supplemental material of [Fei et al. 2017] for details)
+  m_scene->updateMultipliers(sub_dt);
+
+  // Advection of Liquid Particles and Elastic Vertices
+  m_scene_stepper->advectScene(*m_scene, sub_dt);
+
+  // Ballistic Motion of the Spray
+  m_scene->advectSprayParticles(sub_dt);
+
+  // Kinematic Projection of the Elastic Vertices at the Boundary (as
+  // Fail-safe)
+  m_scene->solidProjection(sub_dt);
+
+  // Interpolation of the Follower Yarns from the Guides
+  m_scene->updateFollowerStrands(sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[10] += t1 - t0;  // Particle Advection
+  t0 = t1;
+
+  // Distribute the Liquid Volume onto Elastic Vertices (Capturing)
+  m_scene->distributeFluidElasto(sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[11] += t1 - t0;  // Liquid Capturing
+  t0 = t1;
+
+  // Emit Liquid Particles for Overflowed Elastic Vertices (Dripping)
+  m_scene->distributeElastoFluid();
+  t1 = timingutils::seconds();
+  timing_buffer[12] += t1 - t0;  // Liquid Dripping
+  t0 = t1;
+
+  // Update the Velocity Displacement
+  m_scene->updateVelocityDifference();
+
+  // Update the Acceleration of Liquid on Elastic Vertices
+  m_scene->updateGaussAccel();
+
+  // Solve the Quasi-Static Equation on Elastic Vertices
+  m_scene_stepper->manifoldPropagate(*m_scene, sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[13] += t1 - t0;  // Solve Quasi-Static Equations
+  t0 = t1;
+
+  // Update the Variables on Elements
+  // We denote elements as 'Gauss' since they are computed at the Gaussian
+  // Quadrature Point (1-Point).
+  std::cout << "[update gauss system and plasticity]" << std::endl;
+  m_scene->updateGaussSystem(sub_dt);
+  m_scene->updatePlasticity(sub_dt);
+  t1 = timingutils::seconds();
+  timing_buffer[14] += t1 - t0;  // update Deformation Gradient
+  t0 = t1;
 }
@@ -11,7 +11,11 @@
 #ifndef WET_CLOTH_CORE_H
 #define WET_CLOTH_CORE_H
 
+#include <map>
+
 #include "SceneStepper.h"
+#include "TelemetryWriter.h"
+#include "TimeStepController.h"
 #include "TwoDScene.h"
 
 class WetClothCore {
@@ -26,6 +30,7 @@ class WetClothCore {
     scalar m_implicit_div_accu;
     scalar m_historical_max_vel;
     scalar m_historical_max_vel_fluid;
+    int m_num_rollbacks;
   };
 
   WetClothCore(const std::shared_ptr<TwoDScene>& scene,
@@ -44,15 +49,47 @@ class WetClothCore {
 
   virtual int getCurrentTime() const;
 
+  virtual void setTimeStepController(
+      const std::shared_ptr<TimeStepController>& controller);
+  virtual const std::shared_ptr<TimeStepController>& getTimeStepController()
+      const;
+
+  // records of every sub-step and frame are sent to writer if not null
+  virtual void setTelemetryWriter(
+      const std::shared_ptr<TelemetryWriter>& writer);
+  virtual const std::shared_ptr<TelemetryWriter>& getTelemetryWriter() const;
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
  private:
+  void stepSubstep(const scalar& cur_time, const scalar& sub_dt,
+                   const scalar& dt);
+
+  bool stepGuardedSubstep(const scalar& cur_time, const scalar& sub_dt,
+                          const scalar& dt, int depth);
+
+  void acceptSubstep(const scalar& sub_dt, bool rolled_back);
+
+  void accumulateExplicitDivergence(const scalar& sub_dt,
+                                    const scalar& div_weight);
+
+  void writeTelemetry(const char* type, int substep, const scalar& cur_time,
+                      const scalar& sub_dt, const std::string& reason,
+                      const std::vector<scalar>& timing_begin);
+
   std::shared_ptr<TwoDScene> m_scene;
   std::shared_ptr<SceneStepper> m_scene_stepper;
+  std::shared_ptr<TimeStepController> m_dt_controller;
+  std::shared_ptr<TelemetryWriter> m_telemetry;
 
   int m_current_step;
 
   std::vector<scalar> timing_buffer;
 
+  // fewest and most iterations of each linear solve over the current frame
+  std::map<std::string, Vector2i> m_frame_solver_ranges;
+
+  SceneState m_saved_state;
+
   Info m_info;
 };
 
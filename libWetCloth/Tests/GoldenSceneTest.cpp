@@ -0,0 +1,378 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+// Compares the frame records of a telemetry stream written by WetClothApp
+// against the golden records of the same scene. Usage:
+//
+//   GoldenSceneTest --telemetry=<jsonl> --golden=<jsonl> [--tolerance=<k>]
+//                   [--timing=<factor>] [--timing-report=<file>]
+//   GoldenSceneTest --telemetry=<jsonl> --update=<jsonl>
+//
+// --tolerance scales every tolerance below, --timing > 0 also fails on any
+// stage that got slower than factor times its golden cost, and --update
+// replaces the golden records with the frame records of the telemetry.
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "JsonValue.h"
+
+namespace {
+
+struct Options {
+  std::string telemetry;
+  std::string golden;
+  std::string update;
+  std::string timing_report;
+  double tolerance;
+  double timing;
+
+  Options() : tolerance(1.0), timing(0.0) {}
+};
+
+Options g_options;
+std::vector<JsonValue> g_golden;
+std::vector<JsonValue> g_current;
+
+// relative tolerances, taken against the largest golden value of a series
+const double g_volume_rtol = 0.02;
+const double g_saturation_rtol = 0.05;
+const double g_energy_rtol = 0.05;
+const double g_momentum_rtol = 0.05;
+const double g_bbox_rtol = 0.02;
+const double g_fluid_count_rtol = 0.05;
+
+// iteration ranges may widen by this ratio plus a few iterations
+const double g_iteration_rtol = 0.25;
+const int g_iteration_slack = 2;
+
+// a stage is only checked for timing once it costs this much (in seconds)
+const double g_timing_floor = 0.05;
+
+bool parseOption(const std::string& arg, const char* name,
+                 std::string& value) {
+  const std::string prefix = std::string("--") + name + "=";
+  if (arg.compare(0, prefix.size(), prefix) != 0) return false;
+  value = arg.substr(prefix.size());
+  return true;
+}
+
+bool parseCommandLine(int argc, char** argv) {
+  for (int i = 1; i < argc; ++i) {
+    const std::string arg(argv[i]);
+    std::string value;
+    if (parseOption(arg, "telemetry", value)) {
+      g_options.telemetry = value;
+    } else if (parseOption(arg, "golden", value)) {
+      g_options.golden = value;
+    } else if (parseOption(arg, "update", value)) {
+      g_options.update = value;
+    } else if (parseOption(arg, "timing-report", value)) {
+      g_options.timing_report = value;
+    } else if (parseOption(arg, "tolerance", value)) {
+      g_options.tolerance = atof(value.c_str());
+    } else if (parseOption(arg, "timing", value)) {
+      g_options.timing = atof(value.c_str());
+    } else {
+      std::cerr << "unknown argument: " << arg << std::endl;
+      return false;
+    }
+  }
+
+  if (g_options.telemetry.empty() ||
+      (g_options.golden.empty() && g_options.update.empty())) {
+    std::cerr << "usage: " << argv[0]
+              << " --telemetry=<jsonl> (--golden=<jsonl> | --update=<jsonl>)"
+              << " [--tolerance=<k>] [--timing=<factor>]"
+              << " [--timing-report=<file>]" << std::endl;
+    return false;
+  }
+  return true;
+}
+
+// copies the frame records verbatim, so the golden file keeps every digit
+bool updateGolden() {
+  std::ifstream ifs(g_options.telemetry.c_str());
+  std::ofstream ofs(g_options.update.c_str());
+  if (!ifs.is_open() || !ofs.is_open()) {
+    std::cerr << "cannot copy " << g_options.telemetry << " to "
+              << g_options.update << std::endl;
+    return false;
+  }
+
+  std::string line;
+  int num_frames = 0;
+  while (std::getline(ifs, line)) {
+    if (line.find("\"type\":\"frame\"") == std::string::npos) continue;
+    ofs << line << "\n";
+    ++num_frames;
+  }
+
+  std::cout << "[golden: " << num_frames << " frames written to "
+            << g_options.update << "]" << std::endl;
+  return num_frames > 0;
+}
+
+int numFrames() { return (int)std::min(g_golden.size(), g_current.size()); }
+
+const JsonValue& stats(const std::vector<JsonValue>& records, int frame) {
+  return records[frame]["stats"];
+}
+
+double component(const JsonValue& vec, int i) {
+  return vec.isArray() && (int)vec.array().size() > i ? vec.array()[i].number()
+                                                      : 0.0;
+}
+
+double norm(const JsonValue& vec) {
+  double sum = 0.0;
+  for (int i = 0; i < 3; ++i) sum += component(vec, i) * component(vec, i);
+  return sqrt(sum);
+}
+
+double goldenMax(const std::string& key) {
+  double ret = 0.0;
+  for (const JsonValue& record : g_golden) {
+    const JsonValue& value = record["stats"][key];
+    ret = std::max(ret, value.isArray() ? norm(value) : fabs(value.number()));
+  }
+  return ret;
+}
+
+// compares a scalar statistic frame by frame, reporting the first mismatch
+void expectSeriesNear(const std::string& key, const double& tol) {
+  for (int f = 0; f < numFrames(); ++f) {
+    const double golden = stats(g_golden, f)[key].number();
+    const double current = stats(g_current, f)[key].number();
+    if (fabs(golden - current) > tol) {
+      ADD_FAILURE() << key << " at frame " << f << ": " << current
+                    << ", golden " << golden << ", tolerance " << tol;
+      return;
+    }
+  }
+}
+
+void expectVectorSeriesNear(const std::string& key, const double& tol) {
+  for (int f = 0; f < numFrames(); ++f) {
+    const JsonValue& golden = stats(g_golden, f)[key];
+    const JsonValue& current = stats(g_current, f)[key];
+    for (int i = 0; i < 3; ++i) {
+      if (fabs(component(golden, i) - component(current, i)) > tol) {
+        ADD_FAILURE() << key << "[" << i << "] at frame " << f << ": "
+                      << component(current, i) << ", golden "
+                      << component(golden, i) << ", tolerance " << tol;
+        return;
+      }
+    }
+  }
+}
+
+double bboxExtent(const std::string& min_key, const std::string& max_key) {
+  double ret = 0.0;
+  for (const JsonValue& record : g_golden) {
+    for (int i = 0; i < 3; ++i)
+      ret = std::max(ret, component(record["stats"][max_key], i) -
+                              component(record["stats"][min_key], i));
+  }
+  return ret;
+}
+
+// stage costs summed over all frames
+std::map<std::string, double> sumTimings(
+    const std::vector<JsonValue>& records) {
+  std::map<std::string, double> ret;
+  for (const JsonValue& record : records) {
+    for (auto& stage : record["timings"].object())
+      ret[stage.first] += stage.second.number();
+  }
+  return ret;
+}
+
+}  // namespace
+
+TEST(GoldenScene, FrameRecords) {
+  ASSERT_FALSE(g_golden.empty()) << "no golden frames";
+  ASSERT_EQ(g_golden.size(), g_current.size()) << "number of frames";
+
+  for (int f = 0; f < numFrames(); ++f) {
+    EXPECT_EQ(g_golden[f]["frame"].number(), g_current[f]["frame"].number());
+    ASSERT_TRUE(g_current[f]["stats"].isObject())
+        << "frame " << f << " carries no statistics";
+
+    const double golden_substeps = g_golden[f]["substeps"].number();
+    EXPECT_NEAR(g_current[f]["substeps"].number(), golden_substeps,
+                std::max(1.0, golden_substeps * 0.25 * g_options.tolerance))
+        << "sub-steps at frame " << f;
+  }
+}
+
+TEST(GoldenScene, ParticleCounts) {
+  for (int f = 0; f < numFrames(); ++f) {
+    EXPECT_EQ(g_golden[f]["elasto_particles"].number(),
+              g_current[f]["elasto_particles"].number())
+        << "elastic particles at frame " << f;
+
+    const double golden_fluid = g_golden[f]["fluid_particles"].number();
+    EXPECT_NEAR(g_current[f]["fluid_particles"].number(), golden_fluid,
+                golden_fluid * g_fluid_count_rtol * g_options.tolerance + 8.0)
+        << "liquid particles at frame " << f;
+  }
+}
+
+TEST(GoldenScene, LiquidVolume) {
+  // free, absorbed and spray liquid are all measured against the total
+  double total = 0.0;
+  for (const JsonValue& record : g_golden) {
+    const JsonValue& s = record["stats"];
+    total = std::max(total, s["fluid_volume"].number() +
+                                s["absorbed_volume"].number() +
+                                s["spray_volume"].number());
+  }
+  const double tol = total * g_volume_rtol * g_options.tolerance + 1e-12;
+
+  expectSeriesNear("fluid_volume", tol);
+  expectSeriesNear("absorbed_volume", tol);
+  expectSeriesNear("spray_volume", tol);
+}
+
+TEST(GoldenScene, Saturation) {
+  expectSeriesNear("saturation", goldenMax("saturation") * g_saturation_rtol *
+                                         g_options.tolerance +
+                                     1e-9);
+}
+
+TEST(GoldenScene, MomentumAndEnergy) {
+  expectSeriesNear("kinetic_energy", goldenMax("kinetic_energy") *
+                                         g_energy_rtol * g_options.tolerance +
+                                     1e-12);
+  expectVectorSeriesNear("fluid_momentum",
+                         goldenMax("fluid_momentum") * g_momentum_rtol *
+                                 g_options.tolerance +
+                             1e-12);
+  expectVectorSeriesNear("elasto_momentum",
+                         goldenMax("elasto_momentum") * g_momentum_rtol *
+                                 g_options.tolerance +
+                             1e-12);
+}
+
+TEST(GoldenScene, BoundingBoxes) {
+  const double fluid_tol =
+      bboxExtent("fluid_bbox_min", "fluid_bbox_max") * g_bbox_rtol *
+          g_options.tolerance +
+      1e-9;
+  expectVectorSeriesNear("fluid_bbox_min", fluid_tol);
+  expectVectorSeriesNear("fluid_bbox_max", fluid_tol);
+
+  const double elasto_tol =
+      bboxExtent("elasto_bbox_min", "elasto_bbox_max") * g_bbox_rtol *
+          g_options.tolerance +
+      1e-9;
+  expectVectorSeriesNear("elasto_bbox_min", elasto_tol);
+  expectVectorSeriesNear("elasto_bbox_max", elasto_tol);
+}
+
+TEST(GoldenScene, SolverIterations) {
+  const double rtol = g_iteration_rtol * g_options.tolerance;
+
+  for (int f = 0; f < numFrames(); ++f) {
+    const JsonValue& golden = g_golden[f]["solver_ranges"];
+    const JsonValue& current = g_current[f]["solver_ranges"];
+
+    for (auto& entry : current.object()) {
+      EXPECT_TRUE(golden.has(entry.first))
+          << "solver " << entry.first << " not in the golden frame " << f;
+    }
+
+    for (auto& entry : golden.object()) {
+      if (!current.has(entry.first)) {
+        ADD_FAILURE() << "solver " << entry.first << " missing at frame " << f;
+        continue;
+      }
+
+      const double lo = component(entry.second, 0);
+      const double hi = component(entry.second, 1);
+      const double cur_lo = component(current[entry.first], 0);
+      const double cur_hi = component(current[entry.first], 1);
+
+      EXPECT_GE(cur_lo, floor(lo * (1.0 - rtol)) - g_iteration_slack)
+          << entry.first << " iterations at frame " << f;
+      EXPECT_LE(cur_hi, ceil(hi * (1.0 + rtol)) + g_iteration_slack)
+          << entry.first << " iterations at frame " << f;
+    }
+  }
+}
+
+TEST(GoldenScene, StageTimings) {
+  const std::map<std::string, double> golden = sumTimings(g_golden);
+  const std::map<std::string, double> current = sumTimings(g_current);
+
+  double golden_total = 0.0;
+  double current_total = 0.0;
+  for (auto& stage : golden) golden_total += stage.second;
+  for (auto& stage : current) current_total += stage.second;
+
+  if (!g_options.timing_report.empty()) {
+    std::ofstream ofs(g_options.timing_report.c_str());
+    ofs << std::left << std::setw(16) << "stage" << std::right
+        << std::setw(12) << "golden (s)" << std::setw(12) << "current (s)"
+        << std::setw(10) << "ratio" << "\n";
+    for (auto& stage : golden) {
+      auto itr = current.find(stage.first);
+      const double cur = itr == current.end() ? 0.0 : itr->second;
+      ofs << std::left << std::setw(16) << stage.first << std::right
+          << std::fixed << std::setprecision(4) << std::setw(12)
+          << stage.second << std::setw(12) << cur << std::setprecision(2)
+          << std::setw(10) << (stage.second > 0.0 ? cur / stage.second : 0.0)
+          << "\n";
+    }
+    ofs << std::left << std::setw(16) << "total" << std::right << std::fixed
+        << std::setprecision(4) << std::setw(12) << golden_total
+        << std::setw(12) << current_total << std::setprecision(2)
+        << std::setw(10)
+        << (golden_total > 0.0 ? current_total / golden_total : 0.0) << "\n";
+  }
+
+  if (g_options.timing <= 0.0) GTEST_SKIP() << "timing checks disabled";
+
+  for (auto& stage : golden) {
+    auto itr = current.find(stage.first);
+    if (itr == current.end()) continue;
+    EXPECT_LE(itr->second, stage.second * g_options.timing + g_timing_floor)
+        << "stage " << stage.first;
+  }
+  EXPECT_LE(current_total, golden_total * g_options.timing + g_timing_floor)
+      << "total";
+}
+
+int main(int argc, char** argv) {
+  testing::InitGoogleTest(&argc, argv);
+
+  if (!parseCommandLine(argc, argv)) return 2;
+
+  if (!g_options.update.empty()) return updateGolden() ? 0 : 1;
+
+  std::string error;
+  if (!readJsonLines(g_options.golden, "frame", g_golden, error) ||
+      !readJsonLines(g_options.telemetry, "frame", g_current, error)) {
+    std::cerr << error << std::endl;
+    return 1;
+  }
+
+  return RUN_ALL_TESTS();
+}
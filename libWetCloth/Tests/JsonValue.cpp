@@ -0,0 +1,252 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#include "JsonValue.h"
+
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+class JsonValue::Parser {
+ public:
+  explicit Parser(const std::string& text) : m_text(text), m_pos(0) {}
+
+  bool parseDocument(JsonValue& value, std::string& error) {
+    if (!parseValue(value)) {
+      error = m_error;
+      return false;
+    }
+    skipSpace();
+    if (m_pos != m_text.size()) {
+      error = fail("trailing characters");
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::string fail(const std::string& what) {
+    std::ostringstream oss;
+    oss << what << " at offset " << m_pos;
+    m_error = oss.str();
+    return m_error;
+  }
+
+  void skipSpace() {
+    while (m_pos < m_text.size() &&
+           (m_text[m_pos] == ' ' || m_text[m_pos] == '\t' ||
+            m_text[m_pos] == '\r' || m_text[m_pos] == '\n'))
+      ++m_pos;
+  }
+
+  bool consume(const char* literal) {
+    const std::string lit(literal);
+    if (m_text.compare(m_pos, lit.size(), lit) != 0) return false;
+    m_pos += lit.size();
+    return true;
+  }
+
+  bool parseValue(JsonValue& value) {
+    skipSpace();
+    if (m_pos >= m_text.size()) {
+      fail("unexpected end");
+      return false;
+    }
+
+    const char c = m_text[m_pos];
+    if (c == '{') return parseObject(value);
+    if (c == '[') return parseArray(value);
+    if (c == '"') {
+      value.m_type = STRING;
+      return parseString(value.m_string);
+    }
+    if (consume("null")) {
+      value.m_type = NUL;
+      return true;
+    }
+    if (consume("true")) {
+      value.m_type = BOOLEAN;
+      value.m_boolean = true;
+      return true;
+    }
+    if (consume("false")) {
+      value.m_type = BOOLEAN;
+      value.m_boolean = false;
+      return true;
+    }
+    return parseNumber(value);
+  }
+
+  bool parseNumber(JsonValue& value) {
+    const char* begin = m_text.c_str() + m_pos;
+    char* end = NULL;
+    const double number = strtod(begin, &end);
+    if (end == begin) {
+      fail("unexpected character");
+      return false;
+    }
+    m_pos += end - begin;
+    value.m_type = NUMBER;
+    value.m_number = number;
+    return true;
+  }
+
+  bool parseString(std::string& str) {
+    ++m_pos;  // opening quote
+    str.clear();
+    while (m_pos < m_text.size() && m_text[m_pos] != '"') {
+      if (m_text[m_pos] == '\\') {
+        if (++m_pos >= m_text.size()) break;
+        switch (m_text[m_pos]) {
+          case 'n':
+            str += '\n';
+            break;
+          case 't':
+            str += '\t';
+            break;
+          default:
+            str += m_text[m_pos];
+            break;
+        }
+      } else {
+        str += m_text[m_pos];
+      }
+      ++m_pos;
+    }
+    if (m_pos >= m_text.size()) {
+      fail("unterminated string");
+      return false;
+    }
+    ++m_pos;  // closing quote
+    return true;
+  }
+
+  bool parseArray(JsonValue& value) {
+    ++m_pos;
+    value.m_type = ARRAY;
+    value.m_array.clear();
+
+    skipSpace();
+    if (consume("]")) return true;
+
+    while (true) {
+      value.m_array.push_back(JsonValue());
+      if (!parseValue(value.m_array.back())) return false;
+      skipSpace();
+      if (consume("]")) return true;
+      if (!consume(",")) {
+        fail("expected , or ]");
+        return false;
+      }
+    }
+  }
+
+  bool parseObject(JsonValue& value) {
+    ++m_pos;
+    value.m_type = OBJECT;
+    value.m_object.clear();
+
+    skipSpace();
+    if (consume("}")) return true;
+
+    while (true) {
+      skipSpace();
+      std::string key;
+      if (m_pos >= m_text.size() || m_text[m_pos] != '"') {
+        fail("expected key");
+        return false;
+      }
+      if (!parseString(key)) return false;
+      skipSpace();
+      if (!consume(":")) {
+        fail("expected :");
+        return false;
+      }
+      if (!parseValue(value.m_object[key])) return false;
+      skipSpace();
+      if (consume("}")) return true;
+      if (!consume(",")) {
+        fail("expected , or }");
+        return false;
+      }
+    }
+  }
+
+  const std::string& m_text;
+  size_t m_pos;
+  std::string m_error;
+};
+
+JsonValue::JsonValue() : m_type(NUL), m_boolean(false), m_number(0.0) {}
+
+bool JsonValue::parse(const std::string& text, JsonValue& value,
+                      std::string& error) {
+  Parser parser(text);
+  return parser.parseDocument(value, error);
+}
+
+JsonValue::Type JsonValue::type() const { return m_type; }
+
+bool JsonValue::isNumber() const { return m_type == NUMBER; }
+
+bool JsonValue::isArray() const { return m_type == ARRAY; }
+
+bool JsonValue::isObject() const { return m_type == OBJECT; }
+
+double JsonValue::number() const { return m_number; }
+
+bool JsonValue::boolean() const { return m_boolean; }
+
+const std::string& JsonValue::string() const { return m_string; }
+
+const std::vector<JsonValue>& JsonValue::array() const { return m_array; }
+
+const std::map<std::string, JsonValue>& JsonValue::object() const {
+  return m_object;
+}
+
+bool JsonValue::has(const std::string& key) const {
+  return m_type == OBJECT && m_object.count(key) > 0;
+}
+
+const JsonValue& JsonValue::operator[](const std::string& key) const {
+  static const JsonValue null_value;
+  if (m_type != OBJECT) return null_value;
+  auto itr = m_object.find(key);
+  return itr == m_object.end() ? null_value : itr->second;
+}
+
+bool readJsonLines(const std::string& filename, const std::string& type,
+                   std::vector<JsonValue>& records, std::string& error) {
+  std::ifstream ifs(filename.c_str());
+  if (!ifs.is_open()) {
+    error = "cannot open " + filename;
+    return false;
+  }
+
+  records.clear();
+  std::string line;
+  int line_number = 0;
+  while (std::getline(ifs, line)) {
+    ++line_number;
+    if (line.find_first_not_of(" \t\r") == std::string::npos) continue;
+
+    JsonValue record;
+    std::string parse_error;
+    if (!JsonValue::parse(line, record, parse_error)) {
+      std::ostringstream oss;
+      oss << filename << ":" << line_number << ": " << parse_error;
+      error = oss.str();
+      return false;
+    }
+    if (record["type"].string() == type) records.push_back(record);
+  }
+  return true;
+}
@@ -0,0 +1,65 @@
+//
+// This file is part of the libWetCloth open source project
+//
+// Copyright 2018 Yun (Raymond) Fei, Christopher Batty, Eitan Grinspun, and
+// Changxi Zheng
+//
+// This Source Code Form is subject to the terms of the Mozilla Public
+// License, v. 2.0. If a copy of the MPL was not distributed with this
+// file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+#ifndef JSON_VALUE_H
+#define JSON_VALUE_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+/*!
+ * Just enough of JSON to read back the telemetry records: objects, arrays,
+ * numbers, strings without unicode escapes, booleans and null.
+ */
+class JsonValue {
+ public:
+  enum Type { NUL, BOOLEAN, NUMBER, STRING, ARRAY, OBJECT };
+
+  JsonValue();
+
+  // returns false and fills error if text is not a single JSON value
+  static bool parse(const std::string& text, JsonValue& value,
+                    std::string& error);
+
+  Type type() const;
+
+  bool isNumber() const;
+  bool isArray() const;
+  bool isObject() const;
+
+  double number() const;
+  bool boolean() const;
+  const std::string& string() const;
+  const std::vector<JsonValue>& array() const;
+  const std::map<std::string, JsonValue>& object() const;
+
+  bool has(const std::string& key) const;
+
+  // null if the key is missing or this is not an object
+  const JsonValue& operator[](const std::string& key) const;
+
+ private:
+  class Parser;
+
+  Type m_type;
+  bool m_boolean;
+  double m_number;
+  std::string m_string;
+  std::vector<JsonValue> m_array;
+  std::map<std::string, JsonValue> m_object;
+};
+
+// reads the records of the given type ("frame" or "substep") from a
+// JSON-lines file; returns false if the file cannot be read or parsed
+bool readJsonLines(const std::string& filename, const std::string& type,
+                   std::vector<JsonValue>& records, std::string& error);
+
+#endif
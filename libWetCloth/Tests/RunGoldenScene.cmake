@@ -0,0 +1,65 @@
+# Runs one golden scene headless and checks its frame telemetry against the
+# golden records, or replaces them if MODE is "update". Invoked by ctest as
+#
+#   cmake -DAPP=<WetClothApp> -DCHECKER=<GoldenSceneTest> -DSCENE=<xml>
+#         -DGOLDEN=<jsonl> -DWORK_DIR=<dir> [-DMODE=check|update]
+#         [-DTOLERANCE=<k>] [-DTIMING=<factor>] -P RunGoldenScene.cmake
+
+foreach (var APP CHECKER SCENE GOLDEN WORK_DIR)
+  if (NOT DEFINED ${var})
+    message (FATAL_ERROR "RunGoldenScene.cmake: ${var} is not set")
+  endif (NOT DEFINED ${var})
+endforeach (var)
+
+if (NOT DEFINED MODE)
+  set (MODE check)
+endif (NOT DEFINED MODE)
+if (NOT DEFINED TOLERANCE)
+  set (TOLERANCE 1.0)
+endif (NOT DEFINED TOLERANCE)
+if (NOT DEFINED TIMING)
+  set (TIMING 0)
+endif (NOT DEFINED TIMING)
+
+file (REMOVE_RECURSE ${WORK_DIR})
+file (MAKE_DIRECTORY ${WORK_DIR})
+
+# the app asks for more time once the scene is done, 0 makes it exit
+file (WRITE ${WORK_DIR}/stdin.txt "0\n0\n")
+
+execute_process (
+  COMMAND ${APP} -s ${SCENE} -d 0 -o 0 -t ${WORK_DIR}/telemetry.jsonl
+  WORKING_DIRECTORY ${WORK_DIR}
+  INPUT_FILE ${WORK_DIR}/stdin.txt
+  OUTPUT_FILE ${WORK_DIR}/log.txt
+  ERROR_FILE ${WORK_DIR}/error.txt
+  RESULT_VARIABLE app_result)
+
+if (NOT app_result EQUAL 0)
+  message (FATAL_ERROR
+    "WetClothApp failed on ${SCENE} (${app_result}), see ${WORK_DIR}/log.txt")
+endif (NOT app_result EQUAL 0)
+
+if (MODE STREQUAL "update")
+  get_filename_component (golden_dir ${GOLDEN} DIRECTORY)
+  file (MAKE_DIRECTORY ${golden_dir})
+  execute_process (
+    COMMAND ${CHECKER} --telemetry=${WORK_DIR}/telemetry.jsonl
+            --update=${GOLDEN}
+    RESULT_VARIABLE check_result)
+else (MODE STREQUAL "update")
+  execute_process (
+    COMMAND ${CHECKER} --telemetry=${WORK_DIR}/telemetry.jsonl
+            --golden=${GOLDEN} --tolerance=${TOLERANCE} --timing=${TIMING}
+            --timing-report=${WORK_DIR}/timing.txt
+    RESULT_VARIABLE check_result)
+
+  if (EXISTS ${WORK_DIR}/timing.txt)
+    file (READ ${WORK_DIR}/timing.txt timing_report)
+    message ("Per-stage cost of ${SCENE}:\n${timing_report}")
+  endif (EXISTS ${WORK_DIR}/timing.txt)
+endif (MODE STREQUAL "update")
+
+if (NOT check_result EQUAL 0)
+  message (FATAL_ERROR "golden scene check failed for ${SCENE}")
+endif (NOT check_result EQUAL 0)